@@ -47,6 +47,27 @@ void writeFlatEXR(const DeepImage& img, const std::string& filename);
 void writeFlatEXR(const std::vector<float>& rgba, int width, int height,
                   const std::string& filename);
 
+/**
+ * An extra single-precision channel for a flat EXR (e.g. "Z" or "N.X")
+ */
+struct FlatChannel {
+    std::string name;
+    std::vector<float> data;  // width * height floats, row-major
+};
+
+/**
+ * Write a pre-flattened RGBA buffer plus extra channels to a standard EXR file
+ *
+ * @param rgba Flattened RGBA data (width * height * 4 floats)
+ * @param width Image width
+ * @param height Image height
+ * @param filename Output path
+ * @param extra Additional channels, written after RGBA
+ * @throws DeepWriterException on file errors or mis-sized channels
+ */
+void writeFlatEXR(const std::vector<float>& rgba, int width, int height,
+                  const std::string& filename, const std::vector<FlatChannel>& extra);
+
 /**
  * Write a flattened, tone-mapped PNG image
  *
@@ -83,6 +104,24 @@ std::array<float, 4> flattenPixel(const DeepPixel& pixel);
  */
 std::vector<float> flattenImage(const DeepImage& img);
 
+/**
+ * Flatten a run of deep pixels into RGBA, several pixels at a time in SIMD lanes
+ *
+ * A pixel's samples are front-to-back, each holding premultiplied R, G, B, A
+ * in consecutive floats, `stride` floats apart. A pixel stops compositing
+ * once its alpha reaches opaqueAlpha. Lanes keep their own sample counts and
+ * stop on their own, so the result matches flattening each pixel alone.
+ *
+ * @param pixels Per pixel, the R of its first sample (unused if it has none)
+ * @param sampleCounts Samples per pixel
+ * @param count Number of pixels
+ * @param stride Floats from one sample to the next
+ * @param opaqueAlpha Accumulated alpha at which a pixel stops
+ * @param rgba Output, count * 4 floats
+ */
+void flattenPixels(const float* const* pixels, const unsigned int* sampleCounts, size_t count,
+                   size_t stride, float opaqueAlpha, float* rgba);
+
 /**
  * Streaming deep EXR writer. Lets a producer feed one scanline at a time
  * instead of materializing a whole DeepImage in memory.
@@ -118,6 +157,86 @@ class DeepScanlineWriter {
     void writeScanline(const std::vector<unsigned int>& sample_counts,
                        const std::vector<DeepSample>& samples);
 
+    /**
+     * Write the next scanline straight from interleaved sample data, without
+     * copying it.
+     *
+     * @param sample_counts Per-pixel sample count, width() entries.
+     * @param samples Concatenated samples in column order, 6 floats each:
+     *                [R, G, B, A, Z, ZBack]. Must hold sum(sample_counts)
+     *                samples and stay valid until the call returns.
+     */
+    void writeInterleavedScanline(const unsigned int* sample_counts, const float* samples);
+
+    int width() const;
+    int height() const;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * Streaming flat RGBA EXR writer, the flat counterpart of DeepScanlineWriter.
+ * Scanlines go out as they are produced, so the whole image never has to be
+ * held in memory.
+ *
+ * The destructor closes the underlying file. If fewer than `height`
+ * scanlines are written, the resulting EXR will be incomplete.
+ */
+class FlatScanlineWriter {
+  public:
+    FlatScanlineWriter(int width, int height, const std::string& filename);
+    ~FlatScanlineWriter();
+
+    FlatScanlineWriter(const FlatScanlineWriter&) = delete;
+    FlatScanlineWriter& operator=(const FlatScanlineWriter&) = delete;
+    FlatScanlineWriter(FlatScanlineWriter&&) noexcept;
+    FlatScanlineWriter& operator=(FlatScanlineWriter&&) noexcept;
+
+    /**
+     * Write the next scanline.
+     *
+     * @param rgba Premultiplied RGBA, width() * 4 floats. Read in place.
+     */
+    void writeScanline(const float* rgba);
+
+    int width() const;
+    int height() const;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * Streaming PNG writer with the same tone mapping as writePNG(). The file is
+ * finished when the last scanline is written.
+ *
+ * The destructor closes the underlying file. If fewer than `height`
+ * scanlines are written, the resulting PNG is truncated: it has no IEND
+ * chunk and most decoders reject it.
+ *
+ * @throws DeepWriterException from the constructor if PNG support is not
+ *         compiled in
+ */
+class PNGScanlineWriter {
+  public:
+    PNGScanlineWriter(int width, int height, const std::string& filename);
+    ~PNGScanlineWriter();
+
+    PNGScanlineWriter(const PNGScanlineWriter&) = delete;
+    PNGScanlineWriter& operator=(const PNGScanlineWriter&) = delete;
+    PNGScanlineWriter(PNGScanlineWriter&&) noexcept;
+    PNGScanlineWriter& operator=(PNGScanlineWriter&&) noexcept;
+
+    /**
+     * Write the next scanline.
+     *
+     * @param rgba Premultiplied RGBA, width() * 4 floats
+     */
+    void writeScanline(const float* rgba);
+
     int width() const;
     int height() const;
 
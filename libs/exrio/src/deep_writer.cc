@@ -13,41 +13,123 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <stdexcept>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EXRIO_FLATTEN_SSE
+#endif
+
 namespace exrio {
 
 // ============================================================================
 // Flattening Operations
 // ============================================================================
 
-std::array<float, 4> flattenPixel(const DeepPixel& pixel) {
-    // Front-to-back over operation
-    // accum_rgb = accum_rgb + sample_rgb * (1 - accum_alpha)
-    // accum_alpha = accum_alpha + sample_alpha * (1 - accum_alpha)
+namespace {
+
+// Accumulated alpha at which flattenPixel() stops and reports the pixel as opaque
+constexpr float kOpaqueAlpha = 0.9999f;
 
-    float accumR = 0.0f;
-    float accumG = 0.0f;
-    float accumB = 0.0f;
-    float accumA = 0.0f;
+// DeepSample holds R, G, B, A in consecutive floats, so a pixel's samples can be flattened in place
+static_assert(sizeof(DeepSample) == 6 * sizeof(float), "DeepSample must be six packed floats");
+static_assert(offsetof(DeepSample, alpha) == offsetof(DeepSample, red) + 3 * sizeof(float),
+              "DeepSample RGBA must be consecutive");
+constexpr size_t kDeepSampleStride = sizeof(DeepSample) / sizeof(float);
+
+const float* firstRed(const DeepPixel& pixel) {
+    return pixel.isEmpty() ? nullptr : &pixel.samples()[0].red;
+}
 
-    for (const auto& sample : pixel.samples()) {
-        float oneMinusAccumA = 1.0f - accumA;
+// A pixel that reached kOpaqueAlpha is reported as fully opaque
+void clampOpaque(float* rgba) {
+    if (rgba[3] >= kOpaqueAlpha) rgba[3] = 1.0f;
+}
 
-        // Since colors are premultiplied, we composite directly
-        accumR += sample.red * oneMinusAccumA;
-        accumG += sample.green * oneMinusAccumA;
-        accumB += sample.blue * oneMinusAccumA;
-        accumA += sample.alpha * oneMinusAccumA;
+}  // namespace
 
-        // Early out if fully opaque
-        if (accumA >= 0.9999f) {
-            accumA = 1.0f;
-            break;
+void flattenPixels(const float* const* pixels, const unsigned int* sampleCounts, size_t count,
+                   size_t stride, float opaqueAlpha, float* rgba) {
+    // Front-to-back over operation
+    // accum_rgb = accum_rgb + sample_rgb * (1 - accum_alpha)
+    // accum_alpha = accum_alpha + sample_alpha * (1 - accum_alpha)
+    size_t x = 0;
+#ifdef EXRIO_FLATTEN_SSE
+    // Four pixels per register. Each step loads the next sample of every lane, transposes the
+    // four RGBA loads into R, G, B and A registers and composites the lanes still running: those
+    // with samples left that have not reached opaqueAlpha. Finished lanes read a zero sample.
+    alignas(16) static const float kNoSample[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 opaque = _mm_set1_ps(opaqueAlpha);
+    for (; x + 4 <= count; x += 4) {
+        const unsigned int* counts = sampleCounts + x;
+        const unsigned int maxCount =
+            std::max(std::max(counts[0], counts[1]), std::max(counts[2], counts[3]));
+        const __m128i laneCounts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(counts));
+        __m128 accR = _mm_setzero_ps();
+        __m128 accG = _mm_setzero_ps();
+        __m128 accB = _mm_setzero_ps();
+        __m128 accA = _mm_setzero_ps();
+        __m128 opaqueLanes = _mm_setzero_ps();
+        for (unsigned int s = 0; s < maxCount; ++s) {
+            const __m128 hasSample = _mm_castsi128_ps(
+                _mm_cmpgt_epi32(laneCounts, _mm_set1_epi32(static_cast<int>(s))));
+            const __m128 live = _mm_andnot_ps(opaqueLanes, hasSample);
+            const int liveBits = _mm_movemask_ps(live);
+            if (liveBits == 0) break;
+
+            __m128 r = _mm_loadu_ps((liveBits & 1) ? pixels[x] + s * stride : kNoSample);
+            __m128 g = _mm_loadu_ps((liveBits & 2) ? pixels[x + 1] + s * stride : kNoSample);
+            __m128 b = _mm_loadu_ps((liveBits & 4) ? pixels[x + 2] + s * stride : kNoSample);
+            __m128 a = _mm_loadu_ps((liveBits & 8) ? pixels[x + 3] + s * stride : kNoSample);
+            _MM_TRANSPOSE4_PS(r, g, b, a);
+
+            const __m128 weight = _mm_sub_ps(one, accA);
+            accR = _mm_add_ps(accR, _mm_and_ps(live, _mm_mul_ps(r, weight)));
+            accG = _mm_add_ps(accG, _mm_and_ps(live, _mm_mul_ps(g, weight)));
+            accB = _mm_add_ps(accB, _mm_and_ps(live, _mm_mul_ps(b, weight)));
+            accA = _mm_add_ps(accA, _mm_and_ps(live, _mm_mul_ps(a, weight)));
+            opaqueLanes = _mm_or_ps(opaqueLanes, _mm_cmpge_ps(accA, opaque));
         }
+        _MM_TRANSPOSE4_PS(accR, accG, accB, accA);
+        _mm_storeu_ps(rgba + x * 4, accR);
+        _mm_storeu_ps(rgba + x * 4 + 4, accG);
+        _mm_storeu_ps(rgba + x * 4 + 8, accB);
+        _mm_storeu_ps(rgba + x * 4 + 12, accA);
     }
+#endif
+    for (; x < count; ++x) {
+        float accumR = 0.0f;
+        float accumG = 0.0f;
+        float accumB = 0.0f;
+        float accumA = 0.0f;
+        const float* sample = pixels[x];
+        for (unsigned int s = 0; s < sampleCounts[x]; ++s, sample += stride) {
+            // Since colors are premultiplied, we composite directly
+            const float oneMinusAccumA = 1.0f - accumA;
+            accumR += sample[0] * oneMinusAccumA;
+            accumG += sample[1] * oneMinusAccumA;
+            accumB += sample[2] * oneMinusAccumA;
+            accumA += sample[3] * oneMinusAccumA;
+            if (accumA >= opaqueAlpha) break;
+        }
+        rgba[x * 4 + 0] = accumR;
+        rgba[x * 4 + 1] = accumG;
+        rgba[x * 4 + 2] = accumB;
+        rgba[x * 4 + 3] = accumA;
+    }
+}
 
-    return {accumR, accumG, accumB, accumA};
+std::array<float, 4> flattenPixel(const DeepPixel& pixel) {
+    const float* first = firstRed(pixel);
+    const unsigned int count = static_cast<unsigned int>(pixel.sampleCount());
+    std::array<float, 4> rgba;
+    flattenPixels(&first, &count, 1, kDeepSampleStride, kOpaqueAlpha, rgba.data());
+    clampOpaque(rgba.data());
+    return rgba;
 }
 
 std::vector<float> flattenImage(const DeepImage& img) {
@@ -55,17 +137,19 @@ std::vector<float> flattenImage(const DeepImage& img) {
     int height = img.height();
 
     std::vector<float> result(static_cast<size_t>(width) * height * 4);
+    std::vector<const float*> firstSamples(width);
+    std::vector<unsigned int> sampleCounts(width);
 
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
-            auto rgba = flattenPixel(img.pixel(x, y));
-
-            size_t idx = (static_cast<size_t>(y) * width + x) * 4;
-            result[idx + 0] = rgba[0];
-            result[idx + 1] = rgba[1];
-            result[idx + 2] = rgba[2];
-            result[idx + 3] = rgba[3];
+            const DeepPixel& pixel = img.pixel(x, y);
+            firstSamples[x] = firstRed(pixel);
+            sampleCounts[x] = static_cast<unsigned int>(pixel.sampleCount());
         }
+        float* row = result.data() + static_cast<size_t>(y) * width * 4;
+        flattenPixels(firstSamples.data(), sampleCounts.data(), width, kDeepSampleStride,
+                      kOpaqueAlpha, row);
+        for (int x = 0; x < width; ++x) clampOpaque(row + static_cast<size_t>(x) * 4);
     }
 
     return result;
@@ -358,6 +442,48 @@ void DeepScanlineWriter::writeScanline(const std::vector<unsigned int>& sample_c
     ++s.next_y;
 }
 
+void DeepScanlineWriter::writeInterleavedScanline(const unsigned int* sample_counts,
+                                                  const float* samples) {
+    Impl& s = *impl_;
+
+    if (s.next_y >= s.height) {
+        throw DeepWriterException(
+            "DeepScanlineWriter::writeInterleavedScanline: too many scanlines written");
+    }
+
+    // Point each channel's slice into the caller's samples; the 6-float
+    // sample stride skips over the other channels.
+    constexpr size_t kSampleFloats = 6;
+    std::vector<float*>* ptrs[kSampleFloats] = {&s.r_ptrs, &s.g_ptrs, &s.b_ptrs,
+                                                &s.a_ptrs, &s.z_ptrs, &s.zb_ptrs};
+    float* pixel = const_cast<float*>(samples);
+    for (int x = 0; x < s.width; ++x) {
+        const unsigned int n = sample_counts[x];
+        s.sample_counts[x] = n;
+        for (size_t c = 0; c < kSampleFloats; ++c) (*ptrs[c])[x] = n > 0 ? pixel + c : nullptr;
+        pixel += n * kSampleFloats;
+    }
+
+    // yStride = 0 as in writeScanline(); the slices describe just this row.
+    Imf::DeepFrameBuffer fb;
+    fb.insertSampleCountSlice(Imf::Slice(Imf::UINT, reinterpret_cast<char*>(s.sample_counts.data()),
+                                         sizeof(unsigned int), 0));
+    const char* names[kSampleFloats] = {"R", "G", "B", "A", "Z", "ZBack"};
+    for (size_t c = 0; c < kSampleFloats; ++c) {
+        fb.insert(names[c], Imf::DeepSlice(Imf::FLOAT, reinterpret_cast<char*>(ptrs[c]->data()),
+                                           sizeof(float*), 0, kSampleFloats * sizeof(float)));
+    }
+
+    try {
+        s.file->setFrameBuffer(fb);
+        s.file->writePixels(1);
+    } catch (const std::exception& e) {
+        throw DeepWriterException("Failed to write deep EXR scanline: " + std::string(e.what()));
+    }
+
+    ++s.next_y;
+}
+
 // ============================================================================
 // Flat EXR Writing
 // ============================================================================
@@ -369,12 +495,22 @@ void writeFlatEXR(const DeepImage& img, const std::string& filename) {
 
 void writeFlatEXR(const std::vector<float>& rgba, int width, int height,
                   const std::string& filename) {
+    writeFlatEXR(rgba, width, height, filename, {});
+}
+
+void writeFlatEXR(const std::vector<float>& rgba, int width, int height,
+                  const std::string& filename, const std::vector<FlatChannel>& extra) {
     logVerbose("  Writing flat EXR: " + filename);
     ensureDirectoryExists(filename);
 
     if (width <= 0 || height <= 0) {
         throw DeepWriterException("Invalid image dimensions");
     }
+    for (const FlatChannel& ch : extra) {
+        if (ch.data.size() != static_cast<size_t>(width) * height) {
+            throw DeepWriterException("Channel " + ch.name + " does not match the image size");
+        }
+    }
 
     // Set up header
     Imf::Header header(width, height);
@@ -382,6 +518,9 @@ void writeFlatEXR(const std::vector<float>& rgba, int width, int height,
     header.channels().insert("G", Imf::Channel(Imf::FLOAT));
     header.channels().insert("B", Imf::Channel(Imf::FLOAT));
     header.channels().insert("A", Imf::Channel(Imf::FLOAT));
+    for (const FlatChannel& ch : extra) {
+        header.channels().insert(ch.name, Imf::Channel(Imf::FLOAT));
+    }
 
     // Separate channels
     std::vector<float> rData(static_cast<size_t>(width) * height);
@@ -418,6 +557,13 @@ void writeFlatEXR(const std::vector<float>& rgba, int width, int height,
         frameBuffer.insert("A", Imf::Slice(Imf::FLOAT, reinterpret_cast<char*>(aData.data()),
                                            sizeof(float), sizeof(float) * width));
 
+        // The slices only read the extra channels, the cast just matches Imf::Slice
+        for (const FlatChannel& ch : extra) {
+            char* base = const_cast<char*>(reinterpret_cast<const char*>(ch.data.data()));
+            frameBuffer.insert(ch.name, Imf::Slice(Imf::FLOAT, base, sizeof(float),
+                                                   sizeof(float) * width));
+        }
+
         outFile.setFrameBuffer(frameBuffer);
         outFile.writePixels(height);
 
@@ -426,6 +572,74 @@ void writeFlatEXR(const std::vector<float>& rgba, int width, int height,
     }
 }
 
+// ============================================================================
+// Streaming Flat EXR Writing
+// ============================================================================
+
+struct FlatScanlineWriter::Impl {
+    int width;
+    int height;
+    int next_y = 0;
+    std::unique_ptr<Imf::OutputFile> file;
+};
+
+FlatScanlineWriter::FlatScanlineWriter(int width, int height, const std::string& filename) {
+    logVerbose("  Writing flat EXR: " + filename);
+    if (width <= 0 || height <= 0) {
+        throw DeepWriterException("Invalid image dimensions");
+    }
+    ensureDirectoryExists(filename);
+
+    Imf::Header header(width, height);
+    header.channels().insert("R", Imf::Channel(Imf::FLOAT));
+    header.channels().insert("G", Imf::Channel(Imf::FLOAT));
+    header.channels().insert("B", Imf::Channel(Imf::FLOAT));
+    header.channels().insert("A", Imf::Channel(Imf::FLOAT));
+
+    impl_ = std::make_unique<Impl>();
+    impl_->width = width;
+    impl_->height = height;
+    try {
+        impl_->file = std::make_unique<Imf::OutputFile>(filename.c_str(), header);
+    } catch (const std::exception& e) {
+        throw DeepWriterException("Failed to open flat EXR for streaming write: " +
+                                  std::string(e.what()));
+    }
+}
+
+FlatScanlineWriter::~FlatScanlineWriter() = default;
+FlatScanlineWriter::FlatScanlineWriter(FlatScanlineWriter&&) noexcept = default;
+FlatScanlineWriter& FlatScanlineWriter::operator=(FlatScanlineWriter&&) noexcept = default;
+
+int FlatScanlineWriter::width() const { return impl_->width; }
+int FlatScanlineWriter::height() const { return impl_->height; }
+
+void FlatScanlineWriter::writeScanline(const float* rgba) {
+    Impl& s = *impl_;
+    if (s.next_y >= s.height) {
+        throw DeepWriterException("FlatScanlineWriter::writeScanline: too many scanlines written");
+    }
+
+    // The slices read the interleaved row in place: a 4-float x stride, and
+    // yStride = 0 so whichever scanline OpenEXR is on maps onto this row.
+    char* base = const_cast<char*>(reinterpret_cast<const char*>(rgba));
+    const size_t xStride = 4 * sizeof(float);
+    Imf::FrameBuffer frameBuffer;
+    frameBuffer.insert("R", Imf::Slice(Imf::FLOAT, base, xStride, 0));
+    frameBuffer.insert("G", Imf::Slice(Imf::FLOAT, base + sizeof(float), xStride, 0));
+    frameBuffer.insert("B", Imf::Slice(Imf::FLOAT, base + 2 * sizeof(float), xStride, 0));
+    frameBuffer.insert("A", Imf::Slice(Imf::FLOAT, base + 3 * sizeof(float), xStride, 0));
+
+    try {
+        s.file->setFrameBuffer(frameBuffer);
+        s.file->writePixels(1);
+    } catch (const std::exception& e) {
+        throw DeepWriterException("Failed to write flat EXR scanline: " + std::string(e.what()));
+    }
+
+    ++s.next_y;
+}
+
 // ============================================================================
 // PNG Writing
 // ============================================================================
@@ -444,8 +658,85 @@ void writePNG(const DeepImage& img, const std::string& filename) {
 }
 
 void writePNG(const std::vector<float>& rgba, int width, int height, const std::string& filename) {
+    PNGScanlineWriter writer(width, height, filename);
+    for (int y = 0; y < height; ++y) {
+        writer.writeScanline(rgba.data() + static_cast<size_t>(y) * width * 4);
+    }
+}
+
+// ============================================================================
+// Streaming PNG Writing
+// ============================================================================
+
+#ifdef HAS_PNG_SUPPORT
+namespace {
+
+// Convert a row of premultiplied float RGBA to 8-bit with simple tone mapping
+void toneMapRow(const float* rgba, int width, uint8_t* out) {
+    for (int x = 0; x < width; ++x) {
+        const float* src = rgba + static_cast<size_t>(x) * 4;
+        uint8_t* dst = out + static_cast<size_t>(x) * 4;
+
+        // Get premultiplied colors
+        float r = src[0];
+        float g = src[1];
+        float b = src[2];
+        float a = src[3];
+
+        // Un-premultiply for display (if alpha > 0)
+        if (a > 0.0001f) {
+            r /= a;
+            g /= a;
+            b /= a;
+        }
+
+        // Per-channel Reinhard tone mapping (handles HDR gracefully)
+        r = std::max(0.0f, r);
+        g = std::max(0.0f, g);
+        b = std::max(0.0f, b);
+        r = r / (1.0f + r);
+        g = g / (1.0f + g);
+        b = b / (1.0f + b);
+
+        // sRGB gamma correction
+        r = std::pow(r, 1.0f / 2.2f);
+        g = std::pow(g, 1.0f / 2.2f);
+        b = std::pow(b, 1.0f / 2.2f);
+
+        // Clamp and convert to 8-bit
+        auto toU8 = [](float v) -> uint8_t {
+            return static_cast<uint8_t>(clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+        };
+
+        dst[0] = toU8(r);
+        dst[1] = toU8(g);
+        dst[2] = toU8(b);
+        dst[3] = toU8(a);
+    }
+}
+
+}  // namespace
+#endif
+
+struct PNGScanlineWriter::Impl {
+    int width;
+    int height;
+    int next_y = 0;
+#ifdef HAS_PNG_SUPPORT
+    FILE* fp = nullptr;
+    png_structp png = nullptr;
+    png_infop info = nullptr;
+    std::vector<uint8_t> row_data;
+
+    ~Impl() {
+        if (png) png_destroy_write_struct(&png, info ? &info : nullptr);
+        if (fp) fclose(fp);
+    }
+#endif
+};
+
+PNGScanlineWriter::PNGScanlineWriter(int width, int height, const std::string& filename) {
 #ifndef HAS_PNG_SUPPORT
-    (void)rgba;
     (void)width;
     (void)height;
     (void)filename;
@@ -458,92 +749,67 @@ void writePNG(const std::vector<float>& rgba, int width, int height, const std::
         throw DeepWriterException("Invalid image dimensions");
     }
 
+    impl_ = std::make_unique<Impl>();
+    Impl& s = *impl_;
+    s.width = width;
+    s.height = height;
+    s.row_data.resize(static_cast<size_t>(width) * 4);
+
     // Open file
-    FILE* fp = fopen(filename.c_str(), "wb");
-    if (!fp) {
+    s.fp = fopen(filename.c_str(), "wb");
+    if (!s.fp) {
         throw DeepWriterException("Failed to open PNG file for writing: " + filename);
     }
 
-    // Create PNG structures
-    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-    if (!png) {
-        fclose(fp);
+    // Create PNG structures; Impl's destructor releases them on any error
+    s.png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (!s.png) {
         throw DeepWriterException("Failed to create PNG write struct");
     }
 
-    png_infop info = png_create_info_struct(png);
-    if (!info) {
-        png_destroy_write_struct(&png, nullptr);
-        fclose(fp);
+    s.info = png_create_info_struct(s.png);
+    if (!s.info) {
         throw DeepWriterException("Failed to create PNG info struct");
     }
 
-    if (setjmp(png_jmpbuf(png))) {
-        png_destroy_write_struct(&png, &info);
-        fclose(fp);
+    if (setjmp(png_jmpbuf(s.png))) {
         throw DeepWriterException("PNG write error");
     }
 
-    png_init_io(png, fp);
+    png_init_io(s.png, s.fp);
 
     // Set image properties (RGBA, 8-bit)
-    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+    png_set_IHDR(s.png, s.info, width, height, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
                  PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
-    png_write_info(png, info);
+    png_write_info(s.png, s.info);
+#endif
+}
 
-    // Convert float RGBA to 8-bit with simple tone mapping
-    std::vector<uint8_t> rowData(static_cast<size_t>(width) * 4);
+PNGScanlineWriter::~PNGScanlineWriter() = default;
+PNGScanlineWriter::PNGScanlineWriter(PNGScanlineWriter&&) noexcept = default;
+PNGScanlineWriter& PNGScanlineWriter::operator=(PNGScanlineWriter&&) noexcept = default;
 
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            size_t srcIdx = (static_cast<size_t>(y) * width + x) * 4;
-            size_t dstIdx = static_cast<size_t>(x) * 4;
-
-            // Get premultiplied colors
-            float r = rgba[srcIdx + 0];
-            float g = rgba[srcIdx + 1];
-            float b = rgba[srcIdx + 2];
-            float a = rgba[srcIdx + 3];
-
-            // Un-premultiply for display (if alpha > 0)
-            if (a > 0.0001f) {
-                r /= a;
-                g /= a;
-                b /= a;
-            }
-
-            // Per-channel Reinhard tone mapping (handles HDR gracefully)
-            r = std::max(0.0f, r);
-            g = std::max(0.0f, g);
-            b = std::max(0.0f, b);
-            r = r / (1.0f + r);
-            g = g / (1.0f + g);
-            b = b / (1.0f + b);
-
-            // sRGB gamma correction
-            r = std::pow(r, 1.0f / 2.2f);
-            g = std::pow(g, 1.0f / 2.2f);
-            b = std::pow(b, 1.0f / 2.2f);
-
-            // Clamp and convert to 8-bit
-            auto toU8 = [](float v) -> uint8_t {
-                return static_cast<uint8_t>(clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
-            };
-
-            rowData[dstIdx + 0] = toU8(r);
-            rowData[dstIdx + 1] = toU8(g);
-            rowData[dstIdx + 2] = toU8(b);
-            rowData[dstIdx + 3] = toU8(a);
-        }
+int PNGScanlineWriter::width() const { return impl_->width; }
+int PNGScanlineWriter::height() const { return impl_->height; }
 
-        png_bytep rowPtr = rowData.data();
-        png_write_row(png, rowPtr);
+void PNGScanlineWriter::writeScanline(const float* rgba) {
+#ifndef HAS_PNG_SUPPORT
+    (void)rgba;
+    throw DeepWriterException("PNG support not compiled in");
+#else
+    Impl& s = *impl_;
+    if (s.next_y >= s.height) {
+        throw DeepWriterException("PNGScanlineWriter::writeScanline: too many scanlines written");
     }
 
-    png_write_end(png, nullptr);
-    png_destroy_write_struct(&png, &info);
-    fclose(fp);
+    toneMapRow(rgba, s.width, s.row_data.data());
+
+    if (setjmp(png_jmpbuf(s.png))) {
+        throw DeepWriterException("PNG write error");
+    }
+    png_write_row(s.png, s.row_data.data());
+    if (++s.next_y == s.height) png_write_end(s.png, nullptr);
 #endif
 }
 
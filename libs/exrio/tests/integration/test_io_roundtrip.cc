@@ -4,6 +4,7 @@
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include "../test_helpers.h"
 #include "deep_image.h"
@@ -119,6 +120,58 @@ TEST_F(IORoundtripTest, WriteAndReadPreservesDepthSortOrder) {
     EXPECT_TRUE(loaded.isValid());
 }
 
+TEST_F(IORoundtripTest, InterleavedScanlinesRoundtrip) {
+    // 2x2 image: [R, G, B, A, Z, ZBack] per sample, row by row
+    const std::vector<unsigned int> row0Counts = {2, 0};
+    const std::vector<float> row0 = {0.1f, 0.2f, 0.3f, 0.5f, 1.0f, 1.0f,  //
+                                     0.4f, 0.5f, 0.6f, 0.7f, 2.0f, 3.5f};
+    const std::vector<unsigned int> row1Counts = {0, 1};
+    const std::vector<float> row1 = {0.25f, 0.5f, 0.75f, 0.9f, 4.0f, 4.0f};
+    std::string path = tempPath("interleaved.exr");
+    {
+        DeepScanlineWriter writer(2, 2, path);
+        writer.writeInterleavedScanline(row0Counts.data(), row0.data());
+        writer.writeInterleavedScanline(row1Counts.data(), row1.data());
+    }
+
+    DeepImage loaded = loadDeepEXR(path);
+    ASSERT_EQ(loaded.pixel(0, 0).sampleCount(), 2u);
+    EXPECT_EQ(loaded.pixel(1, 0).sampleCount(), 0u);
+    EXPECT_EQ(loaded.pixel(0, 1).sampleCount(), 0u);
+    ASSERT_EQ(loaded.pixel(1, 1).sampleCount(), 1u);
+    const DeepSample& volume = loaded.pixel(0, 0)[1];
+    EXPECT_NEAR(volume.green, 0.5f, 1e-6f);
+    EXPECT_NEAR(volume.alpha, 0.7f, 1e-6f);
+    EXPECT_NEAR(volume.depth_back, 3.5f, 1e-6f);
+    EXPECT_NEAR(loaded.pixel(1, 1)[0].blue, 0.75f, 1e-6f);
+    EXPECT_NEAR(loaded.pixel(1, 1)[0].depth, 4.0f, 1e-6f);
+}
+
+TEST_F(IORoundtripTest, InterleavedScanlinePastHeightThrows) {
+    const unsigned int counts[] = {0};
+    DeepScanlineWriter writer(1, 1, tempPath("overflow.exr"));
+    writer.writeInterleavedScanline(counts, nullptr);
+    EXPECT_THROW(writer.writeInterleavedScanline(counts, nullptr), DeepWriterException);
+}
+
+TEST_F(IORoundtripTest, StreamedFlatEXRFileExists) {
+    const std::vector<float> row = {0.5f, 0.25f, 0.125f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    std::string path = tempPath("flat_streamed.exr");
+    {
+        FlatScanlineWriter writer(2, 3, path);
+        for (int y = 0; y < 3; ++y) writer.writeScanline(row.data());
+    }
+    std::ifstream f(path);
+    EXPECT_TRUE(f.good());
+}
+
+TEST_F(IORoundtripTest, FlatScanlinePastHeightThrows) {
+    const std::vector<float> row = {0.5f, 0.5f, 0.5f, 1.0f};
+    FlatScanlineWriter writer(1, 1, tempPath("flat_overflow.exr"));
+    writer.writeScanline(row.data());
+    EXPECT_THROW(writer.writeScanline(row.data()), DeepWriterException);
+}
+
 // ============================================================================
 // Error handling tests
 // ============================================================================
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <cmath>
+#include <vector>
 
 #include "../test_helpers.h"
 #include "deep_image.h"
@@ -134,3 +135,29 @@ TEST_F(FlattenTest, AllEmptyPixelsProduceZeroBuffer) {
         EXPECT_FLOAT_EQ(v, 0.0f);
     }
 }
+
+// flattenPixels composites four pixels at a time in SIMD lanes. Lanes with different sample
+// counts, an early-opaque lane and a tail of three pixels must each match flattening the pixel
+// alone, which always takes the scalar path.
+TEST_F(FlattenTest, FlattenPixelsLanesMatchScalarPath) {
+    const size_t count = 7;
+    const size_t stride = 4;
+    const unsigned int sampleCounts[count] = {3, 0, 1, 5, 2, 0, 4};
+    std::vector<std::vector<float>> samples(count);
+    std::vector<const float*> pixels(count);
+    for (size_t x = 0; x < count; ++x) {
+        for (unsigned int s = 0; s < sampleCounts[x]; ++s) {
+            const float a = (x == 3 && s == 1) ? 1.0f : 0.15f + 0.1f * s;
+            samples[x].insert(samples[x].end(), {0.1f * x * a, 0.2f * a, 0.05f * s * a, a});
+        }
+        pixels[x] = samples[x].data();
+    }
+
+    std::vector<float> lanes(count * 4);
+    flattenPixels(pixels.data(), sampleCounts, count, stride, 0.9999f, lanes.data());
+    for (size_t x = 0; x < count; ++x) {
+        float scalar[4];
+        flattenPixels(&pixels[x], &sampleCounts[x], 1, stride, 0.9999f, scalar);
+        for (int c = 0; c < 4; ++c) EXPECT_FLOAT_EQ(lanes[x * 4 + c], scalar[c]) << x << "," << c;
+    }
+}
@@ -14,6 +14,8 @@
 #include "composite_pipeline.h"
 #include "deep_compositor.h"
 #include "deep_info.h"
+#include "deep_options.h"
+#include "static_layer_cache.h"
 
 // RunBatchMode composites a contiguous frame chunk as a Cloud Batch task.
 //
@@ -27,9 +29,17 @@
 //   NUM_FRAMES           — total frames to composite
 //   LOOM_FRAMES_PER_TASK — frames assigned to each composite task
 //   LOOM_FRAME_PARALLELISM — max frames composited concurrently inside this task
+//   LOOM_MEMORY_BUDGET_MB — row buffer memory for the whole task, split between concurrent frames
+//                           (defaults to the CLI's --memory-budget default)
+//   LOOM_COMPACT_ROWS    — 1 to hold rows in flight at half precision (more rows per budget)
 //
-// Static layers contribute static.exr to every frame.
+// Static layers contribute static.exr to every frame. The task decodes and merges them once, up
+// front, and every frame composites against that cache.
 // Animated layers contribute frame-NNNN.exr for the frame being composited.
+//
+// Every frame keeps its own loader threads (each input file is read by one thread) and writer
+// thread, but the row merges of all concurrent frames run on one task-wide pool, so a frame
+// waiting on I/O leaves its share of the cores to the others.
 static int ParsePositiveIntEnv(const char* name, int fallback) {
     const char* value = std::getenv(name);
     if (!value) return fallback;
@@ -58,13 +68,17 @@ static int ParseNonNegativeIntEnv(const char* name, int fallback) {
 
 static void CompositeFrame(int frame, const std::vector<std::string>& prefixes,
                            const std::vector<std::string>& modes, const std::string& output_prefix,
-                           int row_thread_count, std::mutex& log_mutex) {
+                           int row_thread_count, size_t memory_budget_mb, bool compact_rows,
+                           std::shared_ptr<const deep_compositor::StaticLayerCache> static_cache,
+                           deep_compositor::TaskPool& merge_pool, std::mutex& log_mutex) {
     char frame_str[8];
     std::snprintf(frame_str, sizeof(frame_str), "%04d", frame);
 
     // Build per-frame input file list.
-    // Static layers always use static.exr; animated layers use frame-NNNN.exr.
+    // Static layers always use static.exr; animated layers use frame-NNNN.exr. Only the animated
+    // files are opened here, the static ones come from the cache.
     std::vector<std::string> input_files;
+    std::vector<std::string> animated_files;
     for (size_t i = 0; i < prefixes.size(); ++i) {
         std::string prefix = prefixes[i];
         if (!prefix.empty() && prefix.back() != '/') prefix += '/';
@@ -73,6 +87,7 @@ static void CompositeFrame(int frame, const std::vector<std::string>& prefixes,
             input_files.push_back(prefix + "static.exr");
         } else {
             input_files.push_back(prefix + "frame-" + frame_str + ".exr");
+            animated_files.push_back(input_files.back());
         }
     }
 
@@ -89,13 +104,22 @@ static void CompositeFrame(int frame, const std::vector<std::string>& prefixes,
         }
     }
 
-    std::vector<float> z_offsets(input_files.size() > 1 ? input_files.size() - 1 : 0, 0.0f);
-    Options opts{input_files, z_offsets, ""};
+    std::vector<float> z_offsets(animated_files.size() > 1 ? animated_files.size() - 1 : 0, 0.0f);
+    Options opts{animated_files, z_offsets, ""};
+    opts.memory_budget_mb = memory_budget_mb;
+    opts.compact_rows = compact_rows;
 
     std::vector<std::unique_ptr<deep_compositor::DeepInfo>> imagesInfo;
     if (exrio::SaveImageInfo(opts, imagesInfo) == 1) {
         throw std::runtime_error("Failed to load image info");
     }
+    if (static_cache) {
+        if (!imagesInfo.empty() && (imagesInfo[0]->width() != static_cache->width ||
+                                    imagesInfo[0]->height() != static_cache->height)) {
+            throw std::runtime_error("Static layers do not match the animated layers' dimensions");
+        }
+        imagesInfo.push_back(std::make_unique<deep_compositor::DeepInfo>(static_cache));
+    }
 
     int width = 0, height = 0;
     if (!imagesInfo.empty()) {
@@ -103,10 +127,9 @@ static void CompositeFrame(int frame, const std::vector<std::string>& prefixes,
         height = imagesInfo[0]->height();
     }
 
-    std::vector<float> flat_image =
-        deep_compositor::ProcessAllEXR(opts, height, width, imagesInfo, row_thread_count);
-    exrio::WriteFlatOutputs(flat_image, output_path, /*flatOutput=*/true, /*pngOutput=*/true, width,
-                            height);
+    deep_compositor::ProcessAllEXR(
+        opts, height, width, imagesInfo, row_thread_count,
+        exrio::FlatOutputsFor(output_path, /*flatOutput=*/true, /*pngOutput=*/true), &merge_pool);
 
     std::lock_guard<std::mutex> lock(log_mutex);
     std::cout << "[LOOM BATCH]: Composite complete: " << output_path << "\n";
@@ -181,12 +204,41 @@ static int RunBatchMode() {
     if (frame_parallelism < 1) return 1;
     frame_parallelism = std::min(frame_parallelism, frame_count);
 
+    // Per-frame threads only size a frame's loaders; the merges share one pool of every core
     const int row_thread_count = std::max(1, hardware_threads / frame_parallelism);
+    const int memory_budget_mb = ParsePositiveIntEnv(
+        "LOOM_MEMORY_BUDGET_MB", static_cast<int>(Options{}.memory_budget_mb));
+    if (memory_budget_mb < 1) return 1;
+    const int compact_rows = ParseNonNegativeIntEnv("LOOM_COMPACT_ROWS", 0);
+    if (compact_rows < 0) return 1;
+    const size_t frame_memory_budget_mb =
+        std::max<size_t>(1, static_cast<size_t>(memory_budget_mb) / frame_parallelism);
 
     std::cout << "[LOOM BATCH]: Chunk " << task_index << " | frames " << frame_start << "-"
               << frame_end << " | " << prefixes.size() << " layers | frame parallelism "
-              << frame_parallelism << " | row threads/frame " << row_thread_count << "\n";
+              << frame_parallelism << " | row threads/frame " << row_thread_count
+              << " | merge pool " << hardware_threads << "\n";
+
+    // Every frame shares the same static.exr files, so they are decoded and merged only once
+    std::vector<std::string> static_files;
+    for (size_t i = 0; i < prefixes.size(); ++i) {
+        if (modes[i] != "static") continue;
+        std::string prefix = prefixes[i];
+        if (!prefix.empty() && prefix.back() != '/') prefix += '/';
+        static_files.push_back(prefix + "static.exr");
+    }
+    std::shared_ptr<const deep_compositor::StaticLayerCache> static_cache;
+    if (!static_files.empty()) {
+        try {
+            static_cache = deep_compositor::BuildStaticLayerCache(
+                static_files, Options{}.merge_threshold, hardware_threads);
+        } catch (const std::exception& e) {
+            std::cerr << "[LOOM BATCH]: Failed to cache static layers: " << e.what() << "\n";
+            return 1;
+        }
+    }
 
+    deep_compositor::TaskPool merge_pool(hardware_threads);
     std::atomic<int> next_frame{frame_start};
     std::atomic<bool> failed{false};
     std::mutex log_mutex;
@@ -199,7 +251,9 @@ static int RunBatchMode() {
             if (frame > frame_end) return;
 
             try {
-                CompositeFrame(frame, prefixes, modes, output_prefix, row_thread_count, log_mutex);
+                CompositeFrame(frame, prefixes, modes, output_prefix, row_thread_count,
+                               frame_memory_budget_mb, compact_rows > 0, static_cache, merge_pool,
+                               log_mutex);
             } catch (const std::exception& e) {
                 failed.store(true);
                 std::lock_guard<std::mutex> lock(error_mutex);
@@ -0,0 +1,130 @@
+#include "compact_row.h"
+
+#include <half.h>
+
+#include <algorithm>
+
+// The F16C paths are compiled for F16C whatever the target flags, and only run when the CPU has it
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LOOM_COMPACT_F16C
+#define LOOM_TARGET_F16C __attribute__((target("avx,f16c")))
+#endif
+
+namespace {
+
+// Largest finite half; thicker volume samples saturate here instead of becoming infinite
+constexpr float MAX_HALF_THICKNESS = 65504.0f;
+
+uint16_t ToHalfBits(float f) { return half(f).bits(); }
+
+float FromHalfBits(uint16_t bits) {
+    half h;
+    h.setBits(bits);
+    return h;
+}
+
+#ifdef LOOM_COMPACT_F16C
+bool CpuHasF16C() {
+    static const bool has_f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    return has_f16c;
+}
+
+// Packs whole groups of four samples and returns how many samples it packed. Each sample's RGBA
+// is one conversion, and the four depths and thicknesses are gathered into one register each.
+LOOM_TARGET_F16C size_t PackF16C(const float* src, size_t n, uint16_t* rgba, float* z,
+                                 uint16_t* thickness) {
+    const __m128 max_thickness = _mm_set1_ps(MAX_HALF_THICKNESS);
+    size_t s = 0;
+    for (; s + 4 <= n; s += 4) {
+        const float* p = src + s * 6;
+        for (int k = 0; k < 4; ++k) {
+            const __m128i h = _mm_cvtps_ph(_mm_loadu_ps(p + k * 6), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(rgba + (s + k) * 4), h);
+        }
+        const __m128 front = _mm_setr_ps(p[4], p[10], p[16], p[22]);
+        const __m128 back = _mm_setr_ps(p[5], p[11], p[17], p[23]);
+        _mm_storeu_ps(z + s, front);
+        const __m128 t = _mm_min_ps(_mm_sub_ps(back, front), max_thickness);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(thickness + s),
+                         _mm_cvtps_ph(t, _MM_FROUND_TO_NEAREST_INT));
+    }
+    return s;
+}
+
+// Unpacks whole groups of four samples and returns how many samples it unpacked
+LOOM_TARGET_F16C size_t UnpackF16C(const uint16_t* rgba, const float* z,
+                                   const uint16_t* thickness, size_t n, float* dst) {
+    size_t s = 0;
+    for (; s + 4 <= n; s += 4) {
+        float* p = dst + s * 6;
+        for (int k = 0; k < 4; ++k) {
+            const __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rgba + (s + k) * 4));
+            _mm_storeu_ps(p + k * 6, _mm_cvtph_ps(h));
+        }
+        const __m128 front = _mm_loadu_ps(z + s);
+        const __m128 t =
+            _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(thickness + s)));
+        alignas(16) float fronts[4];
+        alignas(16) float backs[4];
+        _mm_store_ps(fronts, front);
+        _mm_store_ps(backs, _mm_add_ps(front, t));
+        for (int k = 0; k < 4; ++k) {
+            p[k * 6 + 4] = fronts[k];
+            p[k * 6 + 5] = backs[k];
+        }
+    }
+    return s;
+}
+#endif
+
+}  // namespace
+
+void CompactRow::Pack(const DeepRow& row) {
+    width = row.width;
+    sample_counts.assign(row.sample_counts.begin(), row.sample_counts.begin() + row.width);
+    total_samples_in_row = row.total_samples_in_row;
+    const size_t n = total_samples_in_row;
+    rgba.resize(n * 4);
+    z.resize(n);
+    thickness.resize(n);
+
+    const float* src = row.all_samples.get();
+    size_t s = 0;
+#ifdef LOOM_COMPACT_F16C
+    if (CpuHasF16C()) s = PackF16C(src, n, rgba.data(), z.data(), thickness.data());
+#endif
+    for (; s < n; ++s) {
+        const float* p = src + s * 6;
+        for (int c = 0; c < 4; ++c) rgba[s * 4 + c] = ToHalfBits(p[c]);
+        z[s] = p[4];
+        thickness[s] = ToHalfBits(std::min(p[5] - p[4], MAX_HALF_THICKNESS));
+    }
+}
+
+void CompactRow::Unpack(DeepRow& row) const {
+    row.width = width;
+    row.sample_counts.assign(sample_counts.begin(), sample_counts.end());
+    row.sample_offsets.resize(width);
+    size_t offset = 0;
+    for (int x = 0; x < width; ++x) {
+        row.sample_offsets[x] = offset;
+        offset += sample_counts[x];
+    }
+    row.total_samples_in_row = 0;  // Nothing worth copying if the block has to grow
+    row.EnsureCapacity(total_samples_in_row);
+    row.total_samples_in_row = total_samples_in_row;
+
+    float* dst = row.all_samples.get();
+    const size_t n = total_samples_in_row;
+    size_t s = 0;
+#ifdef LOOM_COMPACT_F16C
+    if (CpuHasF16C()) s = UnpackF16C(rgba.data(), z.data(), thickness.data(), n, dst);
+#endif
+    for (; s < n; ++s) {
+        float* p = dst + s * 6;
+        for (int c = 0; c < 4; ++c) p[c] = FromHalfBits(rgba[s * 4 + c]);
+        p[4] = z[s];
+        p[5] = z[s] + FromHalfBits(thickness[s]);
+    }
+}
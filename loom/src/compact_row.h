@@ -0,0 +1,38 @@
+#ifndef LOOM_SRC_COMPACT_ROW_H
+#define LOOM_SRC_COMPACT_ROW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "deep_row.h"
+
+// A row of deep samples in 14 bytes per sample instead of DeepRow's 24, for rows waiting in the
+// compositing window (Options::compact_rows).
+//
+// Color and alpha are stored as half floats and Z stays a float. ZBack is stored as a half
+// thickness ZBack - Z, which is exactly zero for surfaces, so only volume depths are rounded.
+// Thickness saturates at 65504, the largest half: a thicker volume sample comes back with
+// ZBack = Z + 65504. Channels are kept in separate arrays so pack and unpack convert four samples
+// per instruction on CPUs with F16C, which is detected at run time.
+struct CompactRow {
+    int width = 0;
+    std::vector<unsigned int> sample_counts;
+    size_t total_samples_in_row = 0;
+    std::vector<uint16_t> rgba;       // Half bits, 4 per sample
+    std::vector<float> z;             // 1 per sample
+    std::vector<uint16_t> thickness;  // Half bits of ZBack - Z, 1 per sample
+
+    // Encodes a DeepRow, reusing this row's storage
+    void Pack(const DeepRow& row);
+
+    // Decodes into a DeepRow, reusing its block when it is large enough
+    void Unpack(DeepRow& row) const;
+
+    unsigned int GetSampleCount(int x) const { return sample_counts[x]; }
+};
+
+// Bytes a compact row takes per sample
+constexpr size_t COMPACT_SAMPLE_BYTES = 4 * sizeof(uint16_t) + sizeof(float) + sizeof(uint16_t);
+
+#endif  // LOOM_SRC_COMPACT_ROW_H
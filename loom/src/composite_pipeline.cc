@@ -1,55 +1,42 @@
 #include "composite_pipeline.h"
 
+#include <OpenEXR/ImfThreading.h>
 #include <exrio/deep_reader.h>
-#include <exrio/deep_writer.h>
-#include <exrio/utils.h>
 
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 #include "deep_info.h"
 #include "utils.h"
 
 namespace exrio {
 
-// Write the results back to disk using exrio's write functions.
-void WriteFlatOutputs(const std::vector<float>& flatRgba, const std::string& outputUri,
-                      bool flatOutput, bool pngOutput, int width, int height) {
-    log("\nWriting outputs...");
-    Timer writeTimer;
-
-    // Use exrio's write functions to write the outputs (deep or flat)
-    try {
-        if (flatOutput) {
-            writeFlatEXR(flatRgba, width, height, outputUri);
-            log("  Wrote: " + outputUri);
+deep_compositor::FlatOutputs FlatOutputsFor(const std::string& outputUri, bool flatOutput,
+                                            bool pngOutput) {
+    deep_compositor::FlatOutputs outputs;
+    if (flatOutput) outputs.exr_path = outputUri;
+    if (pngOutput) {
+        std::string pngPath = outputUri;
+        size_t dot = pngPath.rfind('.');
+        if (dot != std::string::npos) {
+            pngPath = pngPath.substr(0, dot) + ".png";
+        } else {
+            pngPath += ".png";
         }
-
-        if (pngOutput) {
-            std::string pngPath = outputUri;
-            size_t dot = pngPath.rfind('.');
-            if (dot != std::string::npos) {
-                pngPath = pngPath.substr(0, dot) + ".png";
-            } else {
-                pngPath += ".png";
-            }
-
-            if (hasPNGSupport()) {
-                writePNG(flatRgba, width, height, pngPath);
-                log("  Wrote: " + pngPath);
-            } else {
-                log("  Skipped PNG (libpng not available)");
-            }
-        }
-    } catch (const DeepWriterException& e) {
-        throw std::runtime_error("Failed to write output: " + std::string(e.what()));
+        outputs.png_path = pngPath;
     }
-
-    logVerbose("  Write time: " + writeTimer.elapsedString());
+    return outputs;
 }
 
 int SaveImageInfo(const Options& opts,
                   std::vector<std::unique_ptr<deep_compositor::DeepInfo>>& imagesInfo) {
+    // Files pick up the global thread count when they are opened. With a pool, the loaders'
+    // multi-scanline reads decompress their line buffers in parallel.
+    if (Imf::globalThreadCount() == 0) {
+        Imf::setGlobalThreadCount(static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
     for (size_t i = 0; i < opts.input_files.size(); ++i) {
         const std::string& filename = opts.input_files[i];
 
@@ -3,8 +3,10 @@
 #include <exrio/deep_image.h>
 
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "deep_compositor.h"
 #include "deep_info.h"
 #include "deep_options.h"
 
@@ -14,9 +16,9 @@ namespace exrio {
 int SaveImageInfo(const Options& opts,
                   std::vector<std::unique_ptr<deep_compositor::DeepInfo>>& imagesInfo);
 
-// Write the results back to disk.
-// Throws std::runtime_error on failure.
-void WriteFlatOutputs(const std::vector<float>& flatRgba, const std::string& outputUri,
-                      bool flatOutput, bool pngOutput, int width, int height);
+// Output paths for a composited frame: the flat EXR at outputUri and the PNG beside it, with
+// the extension swapped. ProcessAllEXR streams both as it composites.
+deep_compositor::FlatOutputs FlatOutputsFor(const std::string& outputUri, bool flatOutput,
+                                            bool pngOutput);
 
 }  // namespace exrio
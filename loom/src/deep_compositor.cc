@@ -12,12 +12,18 @@
 
 #include <algorithm>
 #include <atomic>
+#include <exception>
+#include <limits>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include "compact_row.h"
 #include "deep_info.h"
 #include "deep_merger.h"
 #include "deep_row.h"
+#include "pipeline_queue.h"
+#include "static_layer_cache.h"
 #include "utils.h"
 
 namespace deep_compositor {
@@ -27,10 +33,38 @@ namespace deep_compositor {
 // 2. Merge samples across images based on depth proximity
 // 3. Output merged deep EXR, flattened EXR, and PNG preview
 
-const int NUM_CHANNELS = 6;
+// Rows a loader reads from one file per OpenEXR call. Must not exceed the window size.
+const int LOAD_CHUNK_ROWS = 16;
+
+// Bounds of the adaptive window, in rows
+const int MIN_WINDOW_ROWS = 2 * LOAD_CHUNK_ROWS;
+const int MAX_WINDOW_ROWS = 1024;
+
+// Rows whose sample counts are read up front to estimate the size of a row
+const int WINDOW_PROBE_ROWS = 16;
+
+// Time the threads of one pipeline stage spent working
+struct StageTimes {
+    std::atomic<long long> busy_us{0};
+    int threads = 0;
+
+    void Add(double busy_ms) { busy_us.fetch_add(static_cast<long long>(busy_ms * 1000.0)); }
+
+    // Busy share of the stage's thread time over a run that took wall_ms
+    std::string Summary(const char* name, double wall_ms) const {
+        const double capacity_us = wall_ms * 1000.0 * threads;
+        const int percent =
+            capacity_us > 0.0 ? static_cast<int>(100.0 * busy_us.load() / capacity_us) : 0;
+        return std::string(name) + " " + std::to_string(threads) + "x " +
+               std::to_string(percent) + "% busy";
+    }
+};
 
-enum RowStates { EMPTY, LOADED, MERGED, FLATTENED, ERROR };
 // Helper to group shared data passed between stages
+//
+// Rows flow loader -> merge task -> write_queue -> writer. Row y lives in window slot
+// y % window_size; loaders only start a row once the writer has flattened the row that held its
+// slot before, which bounds the rows in flight (and so the memory) to the window.
 struct PipelineContext {
     const Options& opts;
     int height;
@@ -41,198 +75,362 @@ struct PipelineContext {
 
     std::vector<std::vector<DeepRow>>& input_buffer;
     std::vector<DeepRow>& merged_buffer;
-    std::vector<std::atomic<int>>& row_status;
-    std::atomic<int>& loaded_scanlines;
-    std::atomic<int>& current_row;
-    std::vector<float>& final_image;
-    exrio::DeepImage* deep_image;  // nullptr if --deep-output not requested
+    std::vector<std::vector<CompactRow>>& compact_input;  // Stand in for the two above with
+    std::vector<CompactRow>& compact_merged;              // opts.compact_rows
+    std::vector<std::atomic<int>>& files_loaded;  // Input files read into each row so far
+    TaskPool& merge_pool;            // Runs a merge task per row every file has been read into
+    BoundedQueue<int>& write_queue;  // Merged rows, in any order
+    ProgressGate& rows_written;      // Rows [0, value) are flattened and their slots free
+    exrio::FlatScanlineWriter* flat_writer;  // Each output is nullptr if not requested
+    exrio::PNGScanlineWriter* png_writer;
+    exrio::DeepScanlineWriter* deep_writer;
+    PipelineError& error;  // First failed read, merge or write; stops all further work
+    int static_input;  // Input backed by a StaticLayerCache whose flat samples may stand in, or -1
+
+    StageTimes& load_times;
+    StageTimes& merge_times;
+    StageTimes& write_times;
+};
+
+// Per-pixel input views of a merge, kept per pool thread so the merge loop does not allocate. A
+// pool may serve several frames, so every merge sizes them for its own inputs.
+struct MergeScratch {
+    std::vector<const float*> runningPtrs;
+    std::vector<const float*> pixelDataPtrs;
+    std::vector<unsigned int> pixelSampleCounts;
+    std::vector<float> occlusionDepths;
+    std::vector<float> nearestDepths;
+    std::vector<char> inputHidden;
+    std::vector<float> pruneScratch;
+    std::vector<const DeepRow*> inputRows;
+    std::vector<DeepRow> unpackedInputs;  // Compact rows decoded for this merge
+    DeepRow unpackedMerged;
 };
 
-void LoaderWorker(int start_row, int end_row, PipelineContext& ctx) {
-    // printf("LOADING %d , %d \n", start_row, end_row);
-    fflush(stdout);
-    for (int load_y = start_row; load_y < end_row; load_y++) {
-        if (load_y >= ctx.height) break;
+// Merges row merge_y into its window slot.
+//
+// For flat-only output the merge skips what the flattened image cannot show: samples behind each
+// pixel's nearest opaque sample, and whole input rows that start behind every pixel's occluder.
+//
+// Where the other inputs of a pixel lie wholly in front of or behind the cached static layers,
+// the static samples are replaced by their single pre-flattened sample: the flattened result is
+// the same, and the merge sorts and splits one sample instead of all of them.
+void MergeRowSamples(int merge_y, PipelineContext& ctx) {
+    Timer total;
+    thread_local MergeScratch scratch;
+    const bool cull = !ctx.opts.deep_output;
+    const StaticLayerCache* static_cache =
+        ctx.static_input >= 0 ? ctx.images_info[ctx.static_input]->cache() : nullptr;
+
+    int slot = merge_y % ctx.window_size;
+    const bool compact = ctx.opts.compact_rows;
+    DeepRow& outputRow = compact ? scratch.unpackedMerged : ctx.merged_buffer[slot];
+
+    // Compact window rows are decoded into this thread's scratch and merged from there
+    std::vector<const DeepRow*>& inputRows = scratch.inputRows;
+    inputRows.resize(ctx.num_files);
+    if (compact && scratch.unpackedInputs.size() < static_cast<size_t>(ctx.num_files)) {
+        scratch.unpackedInputs.resize(ctx.num_files);
+    }
+    for (int i = 0; i < ctx.num_files; ++i) {
+        if (compact) {
+            ctx.compact_input[i][slot].Unpack(scratch.unpackedInputs[i]);
+            inputRows[i] = &scratch.unpackedInputs[i];
+        } else {
+            inputRows[i] = &ctx.input_buffer[i][slot];
+        }
+    }
 
-        int slot = load_y % ctx.window_size;
+    int total_input_samples =
+        0;  // tracks the maximum number of samples for any pixel across all files
+    for (int i = 0; i < ctx.num_files; ++i) {
+        total_input_samples += inputRows[i]->total_samples_in_row;
+    }
 
-        // Circular buffer safety: Wait if the slot is still being processed by the writer
-        if (load_y >= ctx.window_size) {
-            while (ctx.row_status[load_y - ctx.window_size].load() < FLATTENED) {
-                std::this_thread::yield();
-            }
+    // Safety buffer for volumetric splitting
+    outputRow.Allocate(ctx.width, total_input_samples * 2);
+
+    // One running pointer per input file to avoid O(x) prefix-sum in GetPixelData
+    std::vector<const float*>& runningPtrs = scratch.runningPtrs;
+    std::vector<const float*>& pixelDataPtrs = scratch.pixelDataPtrs;
+    std::vector<unsigned int>& pixelSampleCounts = scratch.pixelSampleCounts;
+    std::vector<float>& occlusionDepths = scratch.occlusionDepths;
+    std::vector<char>& inputHidden = scratch.inputHidden;
+    runningPtrs.resize(ctx.num_files);
+    pixelDataPtrs.resize(ctx.num_files);
+    pixelSampleCounts.resize(ctx.num_files);
+    scratch.nearestDepths.resize(ctx.num_files);
+    inputHidden.assign(ctx.num_files, 0);
+    for (int i = 0; i < ctx.num_files; ++i)
+        runningPtrs[i] = inputRows[i]->all_samples.get();
+
+    // Depth past which each pixel hides everything, and the input rows lying wholly behind
+    if (cull && ctx.width > 0) {
+        occlusionDepths.assign(ctx.width, std::numeric_limits<float>::infinity());
+        for (int i = 0; i < ctx.num_files; ++i) {
+            scratch.nearestDepths[i] =
+                UpdateOcclusionDepths(*inputRows[i], ctx.opts.merge_threshold, occlusionDepths);
+        }
+        const float rowCut = *std::max_element(occlusionDepths.begin(), occlusionDepths.end());
+        for (int i = 0; i < ctx.num_files; ++i) {
+            inputHidden[i] = scratch.nearestDepths[i] > rowCut;
         }
+    }
 
+    for (int x = 0; x < ctx.width; ++x) {
+        size_t pixelSamples = 0;
         for (int i = 0; i < ctx.num_files; ++i) {
-            Imf::DeepScanLineInputFile& file = ctx.images_info[i]->GetFile();
-            DeepRow& row = ctx.input_buffer[i][slot];
-
-            const unsigned int* tempCounts = ctx.images_info[i]->GetSampleCountsForRow(load_y);
-            row.Allocate(ctx.width, tempCounts);
-
-            size_t sampleStride = NUM_CHANNELS * sizeof(float);
-            std::vector<float*> rPtrs(ctx.width), gPtrs(ctx.width), bPtrs(ctx.width),
-                aPtrs(ctx.width), zPtrs(ctx.width), zbPtrs(ctx.width);
-
-            float* currentPixelPtr = row.all_samples.get();
-            for (int x = 0; x < ctx.width; ++x) {
-                rPtrs[x] = currentPixelPtr + 0;
-                gPtrs[x] = currentPixelPtr + 1;
-                bPtrs[x] = currentPixelPtr + 2;
-                aPtrs[x] = currentPixelPtr + 3;
-                zPtrs[x] = currentPixelPtr + 4;
-                zbPtrs[x] = currentPixelPtr + 5;
-                currentPixelPtr += row.sample_counts[x] * NUM_CHANNELS;
+            unsigned int cnt = inputRows[i]->GetSampleCount(x);
+            pixelDataPtrs[i] = runningPtrs[i];
+            pixelSampleCounts[i] = inputHidden[i] ? 0 : cnt;
+            pixelSamples += pixelSampleCounts[i];
+            runningPtrs[i] += cnt * 6;
+        }
+        if (cull && occlusionDepths[x] < std::numeric_limits<float>::infinity()) {
+            std::vector<float>& pruneScratch = scratch.pruneScratch;
+            if (pruneScratch.size() < pixelSamples * 6) pruneScratch.resize(pixelSamples * 6);
+            float* prune = pruneScratch.data();
+            for (int i = 0; i < ctx.num_files; ++i) {
+                if (pixelSampleCounts[i] == 0) continue;
+                const unsigned int cnt = pixelSampleCounts[i];
+                pixelSampleCounts[i] =
+                    PruneOccludedSamples(&pixelDataPtrs[i], cnt, occlusionDepths[x], prune);
+                prune += cnt * 6;
             }
-
-            Imf::DeepFrameBuffer frameBuffer;
-            int x_min = file.header().dataWindow().min.x;
-            frameBuffer.insertSampleCountSlice(Imf::Slice(
-                Imf::UINT, (char*)(row.sample_counts.data() - x_min), sizeof(unsigned int), 0));
-
-            size_t xStride = sizeof(float*);
-            frameBuffer.insert(
-                "R", Imf::DeepSlice(Imf::FLOAT, (char*)rPtrs.data(), xStride, 0, sampleStride));
-            frameBuffer.insert(
-                "G", Imf::DeepSlice(Imf::FLOAT, (char*)gPtrs.data(), xStride, 0, sampleStride));
-            frameBuffer.insert(
-                "B", Imf::DeepSlice(Imf::FLOAT, (char*)bPtrs.data(), xStride, 0, sampleStride));
-            frameBuffer.insert(
-                "A", Imf::DeepSlice(Imf::FLOAT, (char*)aPtrs.data(), xStride, 0, sampleStride));
-            frameBuffer.insert(
-                "Z", Imf::DeepSlice(Imf::FLOAT, (char*)zPtrs.data(), xStride, 0, sampleStride));
-            frameBuffer.insert("ZBack", Imf::DeepSlice(Imf::FLOAT, (char*)zbPtrs.data(), xStride, 0,
-                                                       sampleStride));
-
-            file.setFrameBuffer(frameBuffer);
-            int exr_y = load_y + ctx.images_info[i]->min_y();
-            file.readPixelSampleCounts(exr_y, exr_y);
-            file.readPixels(exr_y, exr_y);
         }
-
-        ctx.row_status[load_y].store(LOADED);
-        ctx.loaded_scanlines.fetch_add(1);
+        if (static_cache != nullptr && pixelSampleCounts[ctx.static_input] > 0) {
+            float other_min = std::numeric_limits<float>::infinity();
+            float other_max = -std::numeric_limits<float>::infinity();
+            for (int i = 0; i < ctx.num_files; ++i) {
+                if (i == ctx.static_input) continue;
+                for (unsigned int s = 0; s < pixelSampleCounts[i]; ++s) {
+                    other_min = std::min(other_min, pixelDataPtrs[i][s * 6 + 4]);
+                    other_max = std::max(other_max, pixelDataPtrs[i][s * 6 + 5]);
+                }
+            }
+            if (static_cache->IsSeparated(x, merge_y, other_min, other_max,
+                                          ctx.opts.merge_threshold)) {
+                pixelDataPtrs[ctx.static_input] = static_cache->FlatSample(x, merge_y);
+                pixelSampleCounts[ctx.static_input] = 1;
+            }
+        }
+        SortAndMergePixelsWithSplit(x, pixelDataPtrs, pixelSampleCounts, outputRow,
+                                    ctx.opts.merge_threshold);
     }
-}
 
-void MergerWorker(int start_row, int end_row, PipelineContext& ctx) {
-    // printf("MERGING %d , %d \n", start_row, end_row);
-    fflush(stdout);
-    for (int i = start_row; i < end_row; i++) {  // For loop for single threading support
-        int merge_y = ctx.current_row.fetch_add(1);
+    if (compact) ctx.compact_merged[slot].Pack(outputRow);
 
-        if (merge_y >= ctx.height || merge_y >= end_row) break;  // conditional to end;
+    ctx.merge_times.Add(total.ElapsedMs());
+}
 
-        while (ctx.row_status[merge_y].load() < LOADED) {
-            std::this_thread::yield();
+// Merges row merge_y and hands it to the writer. Runs as a task on ctx.merge_pool, so nothing may
+// escape it: a failed merge is recorded and the row still goes to the writer, which skips it.
+void MergeRow(int merge_y, PipelineContext& ctx) {
+    if (!ctx.error.Failed()) {
+        try {
+            MergeRowSamples(merge_y, ctx);
+        } catch (...) {
+            ctx.error.Record(std::current_exception());
         }
+    }
+    // Never blocks: the window bounds the rows in flight to the queue's capacity. This must be
+    // the last use of ctx, which goes away once the writer has popped the frame's last row.
+    ctx.write_queue.Push(merge_y);
+}
 
-        int slot = merge_y % ctx.window_size;
-        DeepRow& outputRow = ctx.merged_buffer[slot];
-
-        int total_input_samples =
-            0;  // tracks the maximum number of samples for any pixel across all files
-        for (int i = 0; i < ctx.num_files; ++i) {
-            total_input_samples += ctx.input_buffer[i][slot].total_samples_in_row;
+// Loads every row of the files first_file, first_file + file_step, ... in chunks of
+// LOAD_CHUNK_ROWS. Several loaders split the files between them, so a file is only ever read by
+// one thread; the last one to finish a row submits its merge to the pool. After a failure the
+// loader stops reading but still counts its rows loaded, so every row drains through the pipeline.
+void LoaderWorker(int first_file, int file_step, PipelineContext& ctx) {
+    Timer total;
+    double wait_ms = 0.0;
+    int my_files = 0;
+    for (int i = first_file; i < ctx.num_files; i += file_step) my_files++;
+
+    std::vector<DeepRow*> rows;
+    std::vector<DeepRow> staging;  // With compact rows, a chunk is read here and then packed
+    if (ctx.opts.compact_rows) staging.resize(LOAD_CHUNK_ROWS);
+    for (int chunk_y = 0; chunk_y < ctx.height; chunk_y += LOAD_CHUNK_ROWS) {
+        const int chunk_end = std::min(chunk_y + LOAD_CHUNK_ROWS, ctx.height);
+
+        // Circular buffer safety: the slots of this chunk must have been flattened
+        Timer wait;
+        ctx.rows_written.WaitFor(chunk_end - ctx.window_size);
+        wait_ms += wait.ElapsedMs();
+
+        for (int i = first_file; i < ctx.num_files && !ctx.error.Failed(); i += file_step) {
+            try {
+                rows.clear();
+                for (int y = chunk_y; y < chunk_end; ++y) {
+                    rows.push_back(ctx.opts.compact_rows
+                                       ? &staging[y - chunk_y]
+                                       : &ctx.input_buffer[i][y % ctx.window_size]);
+                }
+                ctx.images_info[i]->ReadRows(chunk_y, chunk_end, rows.data());
+                if (!ctx.opts.compact_rows) continue;
+                for (int y = chunk_y; y < chunk_end; ++y) {
+                    ctx.compact_input[i][y % ctx.window_size].Pack(staging[y - chunk_y]);
+                }
+            } catch (...) {
+                ctx.error.Record(std::current_exception());
+            }
         }
 
-        // Safety buffer for volumetric splitting
-        outputRow.Allocate(ctx.width, total_input_samples * 2);
-
-        // One running pointer per input file to avoid O(x) prefix-sum in GetPixelData
-        std::vector<const float*> runningPtrs(ctx.num_files);
-        for (int i = 0; i < ctx.num_files; ++i)
-            runningPtrs[i] = ctx.input_buffer[i][slot].all_samples.get();
-
-        for (int x = 0; x < ctx.width; ++x) {
-            std::vector<const float*> pixelDataPtrs;
-            std::vector<unsigned int> pixelSampleCounts;
-
-            for (int i = 0; i < ctx.num_files; ++i) {
-                DeepRow& inputRow = ctx.input_buffer[i][slot];
-                unsigned int cnt = inputRow.GetSampleCount(x);
-                pixelDataPtrs.push_back(runningPtrs[i]);
-                pixelSampleCounts.push_back(cnt);
-                runningPtrs[i] += cnt * 6;
-            }
-            SortAndMergePixelsWithSplit(x, pixelDataPtrs, pixelSampleCounts, outputRow,
-                                        ctx.opts.merge_threshold);
+        for (int y = chunk_y; y < chunk_end; ++y) {
+            if (ctx.files_loaded[y].fetch_add(my_files) + my_files != ctx.num_files) continue;
+            ctx.merge_pool.Submit([y, &ctx] { MergeRow(y, ctx); });
         }
-        ctx.row_status[merge_y].store(MERGED);
     }
+    ctx.load_times.Add(total.ElapsedMs() - wait_ms);
 }
 
-void WriterWorker(int start_row, int end_row, PipelineContext& ctx) {
-    // printf("WRITING %d , %d \n", start_row, end_row);
-    fflush(stdout);
-    for (int write_y = start_row; write_y < end_row; write_y++) {
-        if (write_y >= ctx.height || write_y >= end_row) break;
-
-        while (ctx.row_status[write_y].load() < MERGED) {
-            std::this_thread::yield();
+// Flattens the rows in order. Merges finish rows out of order; the ones that arrive early wait in
+// `arrived` until their turn.
+void WriterWorker(PipelineContext& ctx) {
+    Timer total;
+    double wait_ms = 0.0;
+    std::vector<char> arrived(static_cast<size_t>(ctx.height), 0);
+    std::vector<float> rowRGB(ctx.width * 4);
+    DeepRow unpacked;
+    for (int write_y = 0; write_y < ctx.height; write_y++) {
+        while (!arrived[write_y]) {
+            int merged_y = 0;
+            Timer wait;
+            ctx.write_queue.Pop(&merged_y);
+            wait_ms += wait.ElapsedMs();
+            arrived[merged_y] = 1;
         }
 
         int slot = write_y % ctx.window_size;
-        const DeepRow& deepRow = ctx.merged_buffer[slot];
-
-        if (ctx.deep_image != nullptr) {
-            const float* pixelData = deepRow.all_samples.get();
-            for (int x = 0; x < ctx.width; ++x) {
-                unsigned int numSamples = deepRow.GetSampleCount(x);
-                exrio::DeepPixel& outPixel = ctx.deep_image->pixel(x, write_y);
-                for (unsigned int s = 0; s < numSamples; ++s) {
-                    const float* sp = pixelData + s * 6;
-                    // DeepRow layout: [R, G, B, A, Z, ZBack]
-                    outPixel.addSample(exrio::DeepSample(sp[4], sp[5], sp[0], sp[1], sp[2], sp[3]));
+        DeepRow& deepRow = ctx.opts.compact_rows ? unpacked : ctx.merged_buffer[slot];
+
+        // Rows leave in order, so they stream straight into the output files. After a failure
+        // anywhere the rows are only counted off: the pipeline keeps draining and ProcessAllEXR
+        // rethrows after.
+        if (!ctx.error.Failed()) {
+            try {
+                if (ctx.opts.compact_rows) ctx.compact_merged[slot].Unpack(unpacked);
+                FlattenRow(deepRow, rowRGB);
+                if (ctx.flat_writer != nullptr) ctx.flat_writer->writeScanline(rowRGB.data());
+                if (ctx.png_writer != nullptr) ctx.png_writer->writeScanline(rowRGB.data());
+                if (ctx.deep_writer != nullptr) {
+                    ctx.deep_writer->writeInterleavedScanline(deepRow.sample_counts.data(),
+                                                              deepRow.all_samples.get());
                 }
-                pixelData += numSamples * 6;
+            } catch (...) {
+                ctx.error.Record(std::current_exception());
             }
         }
 
-        std::vector<float> rowRGB(ctx.width * 4);
-        FlattenRow(deepRow, rowRGB);
-
-        std::copy(rowRGB.begin(), rowRGB.end(),
-                  ctx.final_image.begin() + (write_y * ctx.width * 4));
-
-        const_cast<DeepRow&>(deepRow).Clear();
-        ctx.row_status[write_y].store(FLATTENED);
+        if (!ctx.opts.compact_rows) deepRow.Clear();
+        ctx.rows_written.Advance(write_y + 1);
     }
+    ctx.write_times.Add(total.ElapsedMs() - wait_ms);
+}
+
+// Rows of the circular window: as many as the memory budget holds, from the measured size of a
+// row. A row costs its input samples, the merged output (allocated at twice the input samples)
+// and the per-pixel counts and offsets of every buffer. Compact rows store the merged output
+// tight, at about the input's sample count, and keep no offsets.
+int ChooseWindowSize(const Options& opts, std::vector<std::unique_ptr<DeepInfo>>& images_info,
+                     int width, int height, size_t* row_bytes) {
+    double samples_per_row = 0.0;
+    for (auto& info : images_info) samples_per_row += info->ProbeSamplesPerRow(WINDOW_PROBE_ROWS);
+
+    const bool compact = opts.compact_rows;
+    const size_t sample_bytes = compact ? COMPACT_SAMPLE_BYTES : 6 * sizeof(float);
+    const double row_samples = samples_per_row * (compact ? 2.0 : 3.0);
+    const size_t pixel_bytes = sizeof(unsigned int) + (compact ? 0 : sizeof(size_t));
+    *row_bytes = static_cast<size_t>(row_samples * sample_bytes) +
+                 static_cast<size_t>(width) * pixel_bytes * (images_info.size() + 1);
+
+    const size_t budget = opts.memory_budget_mb * 1024 * 1024;
+    const size_t fit = *row_bytes > 0 ? budget / *row_bytes : MAX_WINDOW_ROWS;
+    int window = static_cast<int>(std::clamp<size_t>(fit, MIN_WINDOW_ROWS, MAX_WINDOW_ROWS));
+    return std::max(1, std::min(window, height));
 }
 
-std::vector<float> ProcessAllEXR(const Options& opts, int height, int width,
-                                 std::vector<std::unique_ptr<DeepInfo>>& images_info,
-                                 int thread_count) {
+void ProcessAllEXR(const Options& opts, int height, int width,
+                   std::vector<std::unique_ptr<DeepInfo>>& images_info, int thread_count,
+                   const FlatOutputs& flat_outputs, TaskPool* merge_pool) {
+    Timer wall;
     if ((width == 0 || height == 0) && !images_info.empty()) {
         width = images_info[0]->width();
         height = images_info[0]->height();
         printf("[Loom] Inherited dimensions from first input: %dx%d\n", width, height);
     }
 
-    const int window_size = 48;
-    int num_files = opts.input_files.size();
+    size_t row_bytes = 0;
+    const int window_size = ChooseWindowSize(opts, images_info, width, height, &row_bytes);
+    int num_files = static_cast<int>(images_info.size());
+
+    // The flat stand-in for static layers only holds for the flattened image; the deep output
+    // needs their real samples
+    int static_input = -1;
+    for (int i = 0; i < num_files && !opts.deep_output; ++i) {
+        if (images_info[i]->cache() != nullptr) {
+            static_input = i;
+            break;
+        }
+    }
 
     std::vector<std::vector<DeepRow>> m_inputBuffer(num_files);
-
+    std::vector<DeepRow> m_mergedBuffer;
+    std::vector<std::vector<CompactRow>> compactInput(num_files);
+    std::vector<CompactRow> compactMerged;
+    const int buffered_rows = opts.compact_rows ? 0 : window_size;
     for (int i = 0; i < num_files; ++i) {
-        m_inputBuffer[i].resize(window_size);
+        m_inputBuffer[i].resize(buffered_rows);
+        compactInput[i].resize(window_size - buffered_rows);
+    }
+    m_mergedBuffer.resize(buffered_rows);
+    compactMerged.resize(window_size - buffered_rows);
+
+    std::vector<std::atomic<int>> files_loaded(height);
+    for (int i = 0; i < height; ++i) files_loaded[i].store(0);
+
+    BoundedQueue<int> write_queue(window_size);
+    ProgressGate rows_written;
+    StageTimes load_times, merge_times, write_times;
+
+    // Output files are opened up front and filled as rows finish
+    const std::string deepPath = opts.output_prefix + "_merged.exr";
+    std::unique_ptr<exrio::FlatScanlineWriter> flat_writer;
+    std::unique_ptr<exrio::PNGScanlineWriter> png_writer;
+    std::unique_ptr<exrio::DeepScanlineWriter> deep_writer;
+    PipelineError error;
+    if (!flat_outputs.exr_path.empty()) {
+        flat_writer =
+            std::make_unique<exrio::FlatScanlineWriter>(width, height, flat_outputs.exr_path);
+    }
+    if (!flat_outputs.png_path.empty()) {
+        if (exrio::hasPNGSupport()) {
+            png_writer =
+                std::make_unique<exrio::PNGScanlineWriter>(width, height, flat_outputs.png_path);
+        } else {
+            Log("  Skipped PNG (libpng not available)");
+        }
     }
-
-    std::vector<DeepRow> m_mergedBuffer;
-    m_mergedBuffer.resize(window_size);
-
-    std::vector<std::atomic<int>> row_status(height);
-    for (int i = 0; i < height; ++i) row_status[i].store(EMPTY);
-
-    std::atomic<int> loaded_scanlines{0};
-    std::atomic<int> current_merge_row{0};
-    std::vector<float> final_image(width * height * 4, 0.0f);
-
-    std::unique_ptr<exrio::DeepImage> deep_image;
     if (opts.deep_output) {
-        deep_image = std::make_unique<exrio::DeepImage>(width, height);
+        deep_writer = std::make_unique<exrio::DeepScanlineWriter>(width, height, deepPath);
     }
 
+    // A quarter of the threads read, each owning every loaders-th file (a file handle is never
+    // shared), and one writes. Merges run on the caller's pool, shared with other frames, or on a
+    // pool of the remaining threads.
+    int n = thread_count > 0 ? thread_count : static_cast<int>(std::thread::hardware_concurrency());
+    n = std::max(1, n);
+    const int loaders = std::max(1, std::min(n / 4, num_files));
+    std::unique_ptr<TaskPool> own_pool;
+    if (merge_pool == nullptr) {
+        own_pool = std::make_unique<TaskPool>(n - 1 - loaders);
+        merge_pool = own_pool.get();
+    }
+    load_times.threads = loaders;
+    merge_times.threads = merge_pool->Size();
+    write_times.threads = 1;
+
     PipelineContext ctx{opts,
                         height,
                         width,
@@ -241,48 +439,51 @@ std::vector<float> ProcessAllEXR(const Options& opts, int height, int width,
                         images_info,
                         m_inputBuffer,
                         m_mergedBuffer,
-                        row_status,
-                        loaded_scanlines,
-                        current_merge_row,
-                        final_image,
-                        deep_image.get()};
+                        compactInput,
+                        compactMerged,
+                        files_loaded,
+                        *merge_pool,
+                        write_queue,
+                        rows_written,
+                        flat_writer.get(),
+                        png_writer.get(),
+                        deep_writer.get(),
+                        error,
+                        static_input,
+                        load_times,
+                        merge_times,
+                        write_times};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < loaders; ++i) {
+        threads.emplace_back(LoaderWorker, i, loaders, std::ref(ctx));
+    }
+    threads.emplace_back(WriterWorker, std::ref(ctx));
 
-    int n = thread_count > 0 ? thread_count : static_cast<int>(std::thread::hardware_concurrency());
-    n = std::max(1, n);
-    // Iterative loop
-    if (n <= 3) {
-        // printf("STARTED THIS LOOP");
-        fflush(stdout);
-        int iterations = (height + window_size - 1) / window_size;
-        for (int i = 0; i < iterations; i++) {
-            fflush(stdout);
-            int pos = window_size * i;
-            int end = std::min(pos + window_size, height);
-            LoaderWorker(pos, end, ctx);
-            MergerWorker(pos, end, ctx);
-            WriterWorker(pos, end, ctx);
-        }
-    } else {
-        std::vector<std::thread> threads;
-        threads.emplace_back(LoaderWorker, 0, height, std::ref(ctx));
-        for (int i = 0; i < n - 2; ++i) {
-            threads.emplace_back(MergerWorker, 0, height, std::ref(ctx));
-        }
-        threads.emplace_back(WriterWorker, 0, height, std::ref(ctx));
+    for (auto& t : threads)
+        if (t.joinable()) t.join();
 
-        for (auto& t : threads)
-            if (t.joinable()) t.join();
-    }
+    const double wall_ms = wall.ElapsedMs();
+    Log("  Window: " + std::to_string(window_size) + " rows of ~" + FormatBytes(row_bytes) +
+        " | " + load_times.Summary("load", wall_ms) + " | " +
+        merge_times.Summary("merge", wall_ms) + " | " + write_times.Summary("write", wall_ms));
 
     printf("\nPipeline complete!\n");
 
-    if (opts.deep_output && deep_image) {
-        std::string deepPath = opts.output_prefix + "_merged.exr";
-        exrio::writeDeepEXR(*deep_image, deepPath);
+    error.Rethrow();
+    // Closing the files writes out what OpenEXR still buffers
+    if (flat_writer) {
+        flat_writer.reset();
+        Log("  Wrote: " + flat_outputs.exr_path);
+    }
+    if (png_writer) {
+        png_writer.reset();
+        Log("  Wrote: " + flat_outputs.png_path);
+    }
+    if (deep_writer) {
+        deep_writer.reset();
         Log("  Wrote: " + deepPath);
     }
-
-    return final_image;
 }
 
 }  // namespace deep_compositor
@@ -4,10 +4,12 @@
 #include <exrio/deep_image.h>
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "deep_info.h"
 #include "deep_options.h"
+#include "pipeline_queue.h"
 
 namespace deep_compositor {
 
@@ -36,9 +38,30 @@ struct CompositorOptions {
  * @throws std::runtime_error if inputs have mismatched dimensions
  */
 
-std::vector<float> ProcessAllEXR(const Options& opts, int height, int width,
-                                 std::vector<std::unique_ptr<DeepInfo>>& imagesInfo,
-                                 int thread_count = 0);
+/**
+ * Where ProcessAllEXR streams the flattened image. An empty path skips that file.
+ */
+struct FlatOutputs {
+    std::string exr_path;
+    std::string png_path;
+};
+
+/**
+ * Composites the inputs row by row, streaming each finished row to the flat outputs and, with
+ * opts.deep_output, to <output_prefix>_merged.exr. No whole-frame buffer is kept.
+ *
+ * thread_count sizes the frame's own threads: a quarter of them read the inputs (each file on one
+ * thread) and one writes. Row merges run as tasks on merge_pool, which several concurrent calls
+ * may share; without one, the remaining threads form a private pool.
+ *
+ * An input that fails to read or a row that fails to merge stops the frame the same way: the
+ * pipeline drains and the first exception is rethrown once every thread is done.
+ *
+ * @throws exrio::DeepWriterException if an output cannot be written
+ */
+void ProcessAllEXR(const Options& opts, int height, int width,
+                   std::vector<std::unique_ptr<DeepInfo>>& imagesInfo, int thread_count = 0,
+                   const FlatOutputs& flat_outputs = {}, TaskPool* merge_pool = nullptr);
 
 // DeepImage deepMerge(const std::vector<DeepImage>& inputs,
 //                     const CompositorOptions& options = CompositorOptions(),
@@ -5,72 +5,146 @@
 #include <OpenEXR/ImfDeepScanLineInputFile.h>  // For reading deep EXR files
 #include <OpenEXR/ImfMultiPartInputFile.h>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "deep_row.h"
+#include "static_layer_cache.h"
+
 namespace deep_compositor {
 class DeepInfo {
   public:
     DeepInfo();
-    DeepInfo(const std::string& filename)
-        : file_(filename.c_str())  // This opens the file immediately
+    DeepInfo(const std::string& filename, bool verbose = true)
+        : file_(std::make_unique<Imf::DeepScanLineInputFile>(
+              filename.c_str()))  // This opens the file immediately
     {
         // Once the file is open, we extract the metadata (width/height)
-        Imath::Box2i dw = file_.header().dataWindow();
+        Imath::Box2i dw = file_->header().dataWindow();
         min_x_ = dw.min.x;
         min_y_ = dw.min.y;
         width_ = dw.max.x - dw.min.x + 1;
         height_ = dw.max.y - dw.min.y + 1;
-        printf("Loaded Deep EXR: %s (%dx%d)\n", filename.c_str(), width_, height_);
-        // printf("Number of parts in file: %d\n", file_.parts());
+        if (verbose) printf("Loaded Deep EXR: %s (%dx%d)\n", filename.c_str(), width_, height_);
+        // printf("Number of parts in file: %d\n", file_->parts());
         // We can verify if it's deep, though DeepScanLineInputFile
         // will throw an error if you point it at a non-deep file anyway.
     }
 
+    // An input served from already merged static layers instead of a file
+    explicit DeepInfo(std::shared_ptr<const StaticLayerCache> cache)
+        : width_(cache->width),
+          height_(cache->height),
+          min_x_(0),
+          min_y_(0),
+          cache_(std::move(cache)) {}
+
     int width() const { return width_; }
     int height() const { return height_; }
     int min_x() const { return min_x_; }
     int min_y() const { return min_y_; }
     // bool isDeep() const { return isDeep_; }
 
-    Imf::DeepScanLineInputFile& GetFile() { return file_; }
+    Imf::DeepScanLineInputFile& GetFile() { return *file_; }
+
+    // The static layer cache behind this input, or nullptr if it reads a file
+    const StaticLayerCache* cache() const { return cache_.get(); }
+
+    // Average samples per row over `probes` evenly spaced rows; only the counts are read
+    double ProbeSamplesPerRow(int probes) {
+        if (height_ <= 0 || width_ <= 0) return 0.0;
+        probes = std::clamp(probes, 1, height_);
+        if (cache_) {
+            size_t total = 0;
+            for (int p = 0; p < probes; ++p) {
+                const long long row = (2LL * p + 1) * height_ / (2LL * probes);
+                total += cache_->rows[row].total_samples_in_row;
+            }
+            return static_cast<double>(total) / probes;
+        }
+        chunk_sample_counts_.resize(width_);
 
-    // Temporary buffer for sample counts of a single row
-    const unsigned int* GetSampleCountsForRow(int y) {
-        FetchSampleCounts(y);
-        return temp_sample_counts.data();  // return pointer to the start of the row's sample counts
+        Imf::DeepFrameBuffer countBuffer;
+        countBuffer.insertSampleCountSlice(
+            Imf::Slice(Imf::UINT, (char*)(chunk_sample_counts_.data() - min_x_),
+                       sizeof(unsigned int), 0));
+        file_->setFrameBuffer(countBuffer);
+
+        size_t total = 0;
+        for (int p = 0; p < probes; ++p) {
+            const long long row = (2LL * p + 1) * height_ / (2LL * probes);  // Middle of each band
+            const int exr_y = min_y_ + static_cast<int>(row);
+            file_->readPixelSampleCounts(exr_y, exr_y);
+            for (unsigned int count : chunk_sample_counts_) total += count;
+        }
+        return static_cast<double>(total) / probes;
     }
 
     /**
-     * This function uses the OpenEXR IMF library to efficiently load deep image data:
-     * - Resizes the temporary buffer to accommodate one row of sample count integers
-     * - Calculates the byte offset corresponding to the requested row
-     * - Configures a DeepFrameBuffer with a sample count slice pointing to the appropriate
-     *   memory location using pointer arithmetic
-     * - Reads only the sample counts (not the actual sample data) for the specified row
+     * Reads rows [y_begin, y_end) of the data window into rows[0 .. y_end - y_begin).
      *
-     * The pointer arithmetic adjusts the base memory address by the total offset so that
-     * the IMF library can correctly map pixel coordinates to buffer locations.
+     * One frame buffer describes the whole chunk: the sample counts are read once, size the
+     * DeepRows, and then every row's pixels come in with a single readPixels call, which lets
+     * OpenEXR decompress the chunk's line buffers on its thread pool.
      *
-
+     * The slices point at per-file scratch, so one file must only be read by one thread at a time.
+     * Cache-backed inputs copy the cached rows instead.
      */
-    void FetchSampleCounts(int y) {
-        // Resize buffer to fit one row of integers
-        temp_sample_counts.resize(width_);
-
-        Imf::DeepFrameBuffer countBuffer;
-        // We point to the start of our vector, but tell OpenEXR
-        // that this memory represents pixel (min_x_, y)
-        char* base = (char*)(temp_sample_counts.data()) - (min_x_ * sizeof(unsigned int));
-        // Note: We don't subtract y because we only read one row (y, y)
-
-        countBuffer.insertSampleCountSlice(Imf::Slice(Imf::UINT, base,
-                                                      sizeof(unsigned int),  // xStride
-                                                      0  // yStride (0 because we read 1 row)
-                                                      ));
-
-        file_.setFrameBuffer(countBuffer);
-        int exr_y = y + min_y_;
-        file_.readPixelSampleCounts(exr_y, exr_y);
+    void ReadRows(int y_begin, int y_end, DeepRow* const* rows) {
+        const int num_rows = y_end - y_begin;
+        if (cache_) {
+            for (int r = 0; r < num_rows; ++r) {
+                const DeepRow& cached = cache_->rows[y_begin + r];
+                rows[r]->Allocate(width_, cached.sample_counts.data());
+                std::memcpy(rows[r]->all_samples.get(), cached.all_samples.get(),
+                            cached.total_samples_in_row * kNumChannels * sizeof(float));
+            }
+            return;
+        }
+        const size_t pixels = static_cast<size_t>(width_) * num_rows;
+        chunk_sample_counts_.resize(pixels);
+        for (auto& ptrs : chunk_channel_ptrs_) ptrs.resize(pixels);
+
+        // Each buffer starts at pixel (min_x_, min_y_ + y_begin); OpenEXR indexes slices by
+        // absolute pixel coordinates, so the base pointers are shifted back by that origin
+        const ptrdiff_t origin = static_cast<ptrdiff_t>(min_y_ + y_begin) * width_ + min_x_;
+        Imf::DeepFrameBuffer frameBuffer;
+        frameBuffer.insertSampleCountSlice(
+            Imf::Slice(Imf::UINT, (char*)(chunk_sample_counts_.data() - origin),
+                       sizeof(unsigned int), sizeof(unsigned int) * width_));
+        const size_t sampleStride = kNumChannels * sizeof(float);
+        for (int c = 0; c < kNumChannels; ++c) {
+            char* base = (char*)(chunk_channel_ptrs_[c].data() - origin);
+            frameBuffer.insert(kChannelNames[c],
+                               Imf::DeepSlice(Imf::FLOAT, base, sizeof(float*),
+                                              sizeof(float*) * width_, sampleStride));
+        }
+        file_->setFrameBuffer(frameBuffer);
+
+        const int exr_begin = y_begin + min_y_;
+        const int exr_end = y_end - 1 + min_y_;
+        file_->readPixelSampleCounts(exr_begin, exr_end);
+
+        for (int r = 0; r < num_rows; ++r) {
+            DeepRow& row = *rows[r];
+            const size_t first = static_cast<size_t>(r) * width_;
+            row.Allocate(width_, chunk_sample_counts_.data() + first);
+
+            float* currentPixelPtr = row.all_samples.get();
+            for (int x = 0; x < width_; ++x) {
+                for (int c = 0; c < kNumChannels; ++c) {
+                    chunk_channel_ptrs_[c][first + x] = currentPixelPtr + c;
+                }
+                currentPixelPtr += row.sample_counts[x] * kNumChannels;
+            }
+        }
+
+        file_->readPixels(exr_begin, exr_end);
     }
 
     // 2. Explicitly forbid Copying (Since the EXR file handle can't be duplicated)
@@ -86,9 +160,16 @@ class DeepInfo {
     int min_x_;
     int min_y_;
 
-    std::vector<unsigned int> temp_sample_counts;
+    // DeepRow layout: [R, G, B, A, Z, ZBack]
+    static constexpr int kNumChannels = 6;
+    static constexpr const char* kChannelNames[kNumChannels] = {"R", "G", "B", "A", "Z", "ZBack"};
+
+    // Scratch for ReadRows(), reused across chunks
+    std::vector<unsigned int> chunk_sample_counts_;
+    std::array<std::vector<float*>, kNumChannels> chunk_channel_ptrs_;
 
-    Imf::DeepScanLineInputFile file_;
+    std::unique_ptr<Imf::DeepScanLineInputFile> file_;  // Null for cache-backed inputs
+    std::shared_ptr<const StaticLayerCache> cache_;
 
     // bool isDeep_;
     bool IsValidCoord(int x, int y) const {
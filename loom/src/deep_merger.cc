@@ -2,7 +2,8 @@
 
 #include <algorithm>
 #include <cmath>
-#include <set>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 bool IsVolume(const RawSample& s) {
@@ -75,189 +76,287 @@ std::pair<RawSample, RawSample> SplitSample(const RawSample& s, float zSplit) {
     return {front, back};
 }
 
-void SortAndMergePixelsDirect(int x, const std::vector<const float*>& pixelDataPtrs,
-                              const std::vector<unsigned int>& pixelSampleCounts,
-                              DeepRow& outputRow, float merge_threshold) {
-    // Collect all raw samples into a temporary flat vector
-    // We reuse this vector across pixels to avoid re-allocation
-    static thread_local std::vector<RawSample> staging;
+namespace {
+
+// Per-thread scratch for the merge kernels. Every vector only grows, so after the first few pixels
+// a merge allocates nothing.
+struct MergeArena {
+    std::vector<RawSample> staging;    // Input samples in (z, z_back) order
+    std::vector<RawSample> fragments;  // Split samples, bucketed by the split point they start at
+    std::vector<float> points;         // Unique split points, ascending
+    std::vector<float> backs;          // z_back of every sample, sorted for the sweep
+    std::vector<uint32_t> fragment_point;  // Index into points of each fragment's z
+    std::vector<uint32_t> bucket_start;    // Counting sort offsets, one per split point + 1
+    std::vector<RawSample> sorted;         // Fragments after the counting sort
+    std::vector<const float*> heads;       // k-way merge cursors, one per non-empty input
+    std::vector<const float*> ends;
+};
+
+MergeArena& GetMergeArena() {
+    static thread_local MergeArena arena;
+    return arena;
+}
+
+inline RawSample LoadSample(const float* p) { return {p[0], p[1], p[2], p[3], p[4], p[5]}; }
+
+inline void StoreSample(const RawSample& s, float* dest) {
+    dest[0] = s.r;
+    dest[1] = s.g;
+    dest[2] = s.b;
+    dest[3] = s.a;
+    dest[4] = s.z;
+    dest[5] = s.z_back;
+}
+
+// Loads every input sample of the pixel into arena.staging in (z, z_back) order. Deep files store
+// each pixel's samples front to back, so the inputs are k-way merged; an input that turns out not
+// to be sorted sends the whole pixel down the sort fallback.
+void GatherSorted(const std::vector<const float*>& pixelDataPtrs,
+                  const std::vector<unsigned int>& pixelSampleCounts, MergeArena& arena) {
+    std::vector<RawSample>& staging = arena.staging;
     staging.clear();
+    arena.heads.clear();
+    arena.ends.clear();
 
+    size_t total = 0;
+    bool all_sorted = true;
     for (size_t i = 0; i < pixelDataPtrs.size(); ++i) {
+        const unsigned int count = pixelSampleCounts[i];
+        if (count == 0) continue;
         const float* data = pixelDataPtrs[i];
-        unsigned int count = pixelSampleCounts[i];
-
-        for (unsigned int s = 0; s < count; ++s) {
-            // Offset is sample_index * 6 channels
-            const float* sData = data + (s * 6);
-            // Order: R, G, B, A, Z, zback
-            staging.push_back({sData[0], sData[1], sData[2], sData[3], sData[4],
-                               sData[5]});  // Using Z for ZBack as well if not present
+        for (unsigned int s = 1; s < count && all_sorted; ++s) {
+            all_sorted = !(LoadSample(data + s * 6) < LoadSample(data + (s - 1) * 6));
         }
+        arena.heads.push_back(data);
+        arena.ends.push_back(data + static_cast<size_t>(count) * 6);
+        total += count;
     }
+    staging.reserve(total);
 
-    if (staging.empty()) {
-        outputRow.sample_counts[x] = 0;
-        if (x + 1 < outputRow.width) outputRow.sample_offsets[x + 1] = outputRow.sample_offsets[x];
+    if (!all_sorted || arena.heads.size() == 1) {
+        for (size_t i = 0; i < arena.heads.size(); ++i) {
+            for (const float* p = arena.heads[i]; p != arena.ends[i]; p += 6) {
+                staging.push_back(LoadSample(p));
+            }
+        }
+        if (!all_sorted) std::sort(staging.begin(), staging.end());
         return;
     }
 
-    // Volumetric splitting and sorting
-    std::sort(staging.begin(), staging.end());
-
-    if (!staging.empty()) {
-        std::vector<RawSample> merged;
-        merged.reserve(staging.size());
-        float epsilon = merge_threshold;
+    // Few layers per pixel: a linear scan over the heads beats a heap
+    size_t live = arena.heads.size();
+    while (live > 0) {
+        size_t best = 0;
+        RawSample best_sample = LoadSample(arena.heads[0]);
+        for (size_t i = 1; i < live; ++i) {
+            RawSample candidate = LoadSample(arena.heads[i]);
+            if (candidate < best_sample) {
+                best = i;
+                best_sample = candidate;
+            }
+        }
+        staging.push_back(best_sample);
+        arena.heads[best] += 6;
+        if (arena.heads[best] == arena.ends[best]) {
+            --live;
+            arena.heads[best] = arena.heads[live];
+            arena.ends[best] = arena.ends[live];
+        }
+    }
+}
 
-        size_t i = 0;
-        while (i < staging.size()) {
-            RawSample current = staging[i];
-            i++;
+// Marks pixel x as empty in a row written with running offsets
+void WriteEmptyPixel(int x, DeepRow& outputRow) {
+    outputRow.sample_offsets[x] = outputRow.total_samples_in_row;
+    outputRow.sample_counts[x] = 0;
+}
 
-            // Merge coincident samples using Beer-Lambert transmission blending
-            while (i < staging.size() && IsNearDepth(current, staging[i], epsilon)) {
-                current = BlendCoincidentSamples(current, staging[i]);
-                i++;
-            }
+}  // namespace
 
-            merged.push_back(current);
-        }
+void SortAndMergePixelsDirect(int x, const std::vector<const float*>& pixelDataPtrs,
+                              const std::vector<unsigned int>& pixelSampleCounts,
+                              DeepRow& outputRow, float merge_threshold) {
+    MergeArena& arena = GetMergeArena();
+    GatherSorted(pixelDataPtrs, pixelSampleCounts, arena);
+    const std::vector<RawSample>& staging = arena.staging;
 
-        staging.swap(merged);
+    if (staging.empty()) {
+        outputRow.sample_counts[x] = 0;
+        if (x + 1 < outputRow.width) outputRow.sample_offsets[x + 1] = outputRow.sample_offsets[x];
+        return;
     }
 
-    // Write results back to the outputRow
+    // Merge coincident samples using Beer-Lambert transmission blending, writing straight into
+    // the output row
     float* outPtr = outputRow.GetPixelData(x);
-
-    // Write the sorted samples back
-    for (size_t s = 0; s < staging.size(); ++s) {
-        float* dest = outPtr + (s * 6);
-        dest[0] = staging[s].r;
-        dest[1] = staging[s].g;
-        dest[2] = staging[s].b;
-        dest[3] = staging[s].a;
-        dest[4] = staging[s].z;
-        dest[5] = staging[s].z_back;  // If we have ZBack, write it here
+    size_t written = 0;
+    size_t i = 0;
+    while (i < staging.size()) {
+        RawSample current = staging[i];
+        i++;
+        while (i < staging.size() && IsNearDepth(current, staging[i], merge_threshold)) {
+            current = BlendCoincidentSamples(current, staging[i]);
+            i++;
+        }
+        StoreSample(current, outPtr + written * 6);
+        written++;
     }
 
     // Update the output sample count for this pixel
-    outputRow.sample_counts[x] = static_cast<unsigned int>(staging.size());
+    outputRow.sample_counts[x] = static_cast<unsigned int>(written);
     if (x + 1 < outputRow.width)
-        outputRow.sample_offsets[x + 1] = outputRow.sample_offsets[x] + staging.size();
+        outputRow.sample_offsets[x + 1] = outputRow.sample_offsets[x] + written;
 }
 
 void SortAndMergePixelsWithSplit(int x, const std::vector<const float*>& pixelDataPtrs,
                                  const std::vector<unsigned int>& pixelSampleCounts,
                                  DeepRow& outputRow, float merge_threshold) {
-    // Collect all raw samples into a temporary flat vector
-    static thread_local std::vector<RawSample> staging;
-    staging.clear();
-
-    for (size_t i = 0; i < pixelDataPtrs.size(); ++i) {
-        const float* data = pixelDataPtrs[i];
-        unsigned int count = pixelSampleCounts[i];
-
-        for (unsigned int s = 0; s < count; ++s) {
-            const float* sData = data + (s * 6);
-            staging.push_back({sData[0], sData[1], sData[2], sData[3], sData[4], sData[5]});
-        }
-    }
+    MergeArena& arena = GetMergeArena();
+    GatherSorted(pixelDataPtrs, pixelSampleCounts, arena);
+    const std::vector<RawSample>& staging = arena.staging;
 
     if (staging.empty()) {
-        outputRow.sample_counts[x] = 0;
-        if (x + 1 < outputRow.width) outputRow.sample_offsets[x + 1] = outputRow.sample_offsets[x];
+        WriteEmptyPixel(x, outputRow);
         return;
     }
 
-    float epsilon = merge_threshold;
-
-    // Gather split points: every unique depth and depth_back
-    std::set<float> splitPointSet;
-    for (const auto& s : staging) {
-        splitPointSet.insert(s.z);
-        splitPointSet.insert(s.z_back);
+    // 1. Split points: every unique depth and depth_back. The depths are already in order; the
+    // backs usually are too, so building the sorted union is a linear merge.
+    std::vector<float>& backs = arena.backs;
+    backs.clear();
+    for (const RawSample& s : staging) backs.push_back(s.z_back);
+    if (!std::is_sorted(backs.begin(), backs.end())) std::sort(backs.begin(), backs.end());
+
+    std::vector<float>& points = arena.points;
+    points.clear();
+    size_t bi = 0;
+    for (const RawSample& s : staging) {
+        while (bi < backs.size() && backs[bi] < s.z) points.push_back(backs[bi++]);
+        points.push_back(s.z);
     }
-    std::vector<float> splitPoints(splitPointSet.begin(), splitPointSet.end());
-    // splitPoints is naturally sorted by std::set
+    points.insert(points.end(), backs.begin() + bi, backs.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    // 2. Split each volumetric sample at every split point inside its range. Samples arrive in z
+    // order, so the first point past z is found by a cursor that only moves forward. Every
+    // fragment starts at a split point; remember which one for the sort below.
+    std::vector<RawSample>& fragments = arena.fragments;
+    std::vector<uint32_t>& fragment_point = arena.fragment_point;
+    fragments.clear();
+    fragment_point.clear();
+    size_t next_point = 0;  // First split point strictly greater than the current sample's z
+    for (const RawSample& sample : staging) {
+        while (next_point < points.size() && points[next_point] <= sample.z) ++next_point;
+        // points[] holds sample.z; the guard only matters for NaN depths
+        uint32_t start_point = static_cast<uint32_t>(next_point > 0 ? next_point - 1 : 0);
 
-    // Split each volumetric sample at every split point inside its range
-    std::vector<RawSample> fragments;
-    fragments.reserve(staging.size() * 2);
-
-    for (const auto& sample : staging) {
         if (!IsVolume(sample)) {
             fragments.push_back(sample);
+            fragment_point.push_back(start_point);
             continue;
         }
 
-        // Find split points strictly inside (z, z_back)
-        auto it = std::upper_bound(splitPoints.begin(), splitPoints.end(), sample.z);
-
-        std::vector<float> cuts;
-        while (it != splitPoints.end() && *it < sample.z_back - 1e-7f) {
-            cuts.push_back(*it);
-            ++it;
-        }
-
-        if (cuts.empty()) {
-            fragments.push_back(sample);
-            continue;
-        }
-
-        // Iteratively split the sample at each cut point
         RawSample remainder = sample;
-        for (float zCut : cuts) {
-            if (zCut <= remainder.z + 1e-7f || zCut >= remainder.z_back - 1e-7f) {
-                continue;
-            }
+        for (size_t p = next_point; p < points.size() && points[p] < sample.z_back - 1e-7f; ++p) {
+            const float zCut = points[p];
+            if (zCut <= remainder.z + 1e-7f || zCut >= remainder.z_back - 1e-7f) continue;
             auto [front, back] = SplitSample(remainder, zCut);
             fragments.push_back(front);
+            fragment_point.push_back(start_point);
             remainder = back;
+            start_point = static_cast<uint32_t>(p);
         }
         fragments.push_back(remainder);
+        fragment_point.push_back(start_point);
     }
 
-    // Sort fragments by (z, z_back)
-    std::sort(fragments.begin(), fragments.end());
+    // 3. Order fragments by (z, z_back): a counting sort on the split point each one starts at,
+    // then an insertion sort on z_back inside each (almost always tiny) bucket
+    std::vector<uint32_t>& bucket_start = arena.bucket_start;
+    bucket_start.assign(points.size() + 1, 0);
+    for (uint32_t p : fragment_point) ++bucket_start[p + 1];
+    for (size_t p = 1; p < bucket_start.size(); ++p) bucket_start[p] += bucket_start[p - 1];
+
+    std::vector<RawSample>& sorted = arena.sorted;
+    sorted.resize(fragments.size());
+    for (size_t f = 0; f < fragments.size(); ++f) {
+        sorted[bucket_start[fragment_point[f]]++] = fragments[f];
+    }
+    // bucket_start[p] now holds the end of bucket p, which is where bucket p + 1 begins
+    size_t begin = 0;
+    for (size_t p = 0; p < points.size(); ++p) {
+        const size_t end = bucket_start[p];
+        for (size_t i = begin + 1; i < end; ++i) {
+            RawSample key = sorted[i];
+            size_t j = i;
+            for (; j > begin && key.z_back < sorted[j - 1].z_back; --j) sorted[j] = sorted[j - 1];
+            sorted[j] = key;
+        }
+        begin = end;
+    }
 
-    // Blend consecutive fragments with matching intervals
-    std::vector<RawSample> blended;
-    blended.reserve(fragments.size());
+    // 4. Blend consecutive fragments with matching intervals straight into the output row. The
+    // fragment count bounds the blended count, so one capacity check covers the pixel.
+    outputRow.EnsureCapacity(outputRow.total_samples_in_row + sorted.size());
+    outputRow.sample_offsets[x] = outputRow.total_samples_in_row;
+    float* outPtr = outputRow.GetPixelData(x);
 
+    size_t written = 0;
     size_t i = 0;
-    while (i < fragments.size()) {
-        RawSample current = fragments[i];
+    while (i < sorted.size()) {
+        RawSample current = sorted[i];
         i++;
 
         // Merge all subsequent fragments that share the exact same interval
-        while (i < fragments.size() && IsNearDepth(current, fragments[i], epsilon)) {
-            current = BlendCoincidentSamples(current, fragments[i]);
+        while (i < sorted.size() && IsNearDepth(current, sorted[i], merge_threshold)) {
+            current = BlendCoincidentSamples(current, sorted[i]);
             i++;
         }
 
-        blended.push_back(current);
+        StoreSample(current, outPtr + written * 6);
+        written++;
     }
 
-    // Ensure we have enough capacity in the contiguous buffer for the new fragments
-    outputRow.EnsureCapacity(outputRow.total_samples_in_row + blended.size());
-
-    // Write results back to the outputRow
-    outputRow.sample_offsets[x] = outputRow.total_samples_in_row;
+    // Update the output sample count for this pixel
+    outputRow.sample_counts[x] = static_cast<unsigned int>(written);
+    outputRow.total_samples_in_row += written;
+}
 
-    // Write results back to the outputRow
-    float* outPtr = outputRow.GetPixelData(x);
-    for (size_t s = 0; s < blended.size(); ++s) {
-        float* dest = outPtr + (s * 6);
-        dest[0] = blended[s].r;
-        dest[1] = blended[s].g;
-        dest[2] = blended[s].b;
-        dest[3] = blended[s].a;
-        dest[4] = blended[s].z;
-        dest[5] = blended[s].z_back;
+float UpdateOcclusionDepths(const DeepRow& row, float merge_threshold,
+                            std::vector<float>& occlusionDepths) {
+    float nearest = std::numeric_limits<float>::infinity();
+    const float* pixel_data = row.all_samples.get();
+    for (int x = 0; x < row.width; ++x) {
+        const unsigned int count = row.sample_counts[x];
+        float occlusion = occlusionDepths[x];
+        for (unsigned int s = 0; s < count; ++s) {
+            const float* sp = pixel_data + s * 6;
+            nearest = std::min(nearest, sp[4]);
+            if (sp[3] >= OPAQUE_ALPHA) occlusion = std::min(occlusion, sp[5] + merge_threshold);
+        }
+        occlusionDepths[x] = occlusion;
+        pixel_data += count * 6;
     }
+    return nearest;
+}
 
-    // Update the output sample count for this pixel
-    outputRow.sample_counts[x] = static_cast<unsigned int>(blended.size());
-    outputRow.total_samples_in_row += blended.size();
+unsigned int PruneOccludedSamples(const float** samples, unsigned int count, float cutDepth,
+                                  float* scratch) {
+    const float* src = *samples;
+    unsigned int kept = 0;
+    while (kept < count && src[kept * 6 + 4] <= cutDepth) kept++;
+
+    // Anything visible after the first hidden sample means the input is not sorted by depth
+    unsigned int s = kept;
+    while (s < count && src[s * 6 + 4] > cutDepth) s++;
+    if (s == count) return kept;
+
+    std::copy(src, src + kept * 6, scratch);
+    for (; s < count; ++s) {
+        if (src[s * 6 + 4] > cutDepth) continue;
+        std::copy(src + s * 6, src + s * 6 + 6, scratch + kept * 6);
+        kept++;
+    }
+    *samples = scratch;
+    return kept;
 }
@@ -35,4 +35,20 @@ void SortAndMergePixelsWithSplit(int x, const std::vector<const float*>& pixelDa
                                  const std::vector<unsigned int>& pixelSampleCounts,
                                  DeepRow& outputRow, float merge_threshold = 0.001f);
 
+// Occlusion culling for flat-only output. Once a pixel has composited a sample that is opaque on
+// its own (alpha >= OPAQUE_ALPHA), FlattenRow stops, so samples that start behind it, and beyond
+// merge_threshold of it, never reach the image and need not be merged.
+
+// Lowers occlusionDepths[x] to the depth past which row pixel x hides everything: the back of its
+// nearest opaque sample plus merge_threshold. Returns the row's nearest sample depth (+inf if the
+// row is empty), so a caller can skip a layer that starts behind every pixel's occluder.
+float UpdateOcclusionDepths(const DeepRow& row, float merge_threshold,
+                            std::vector<float>& occlusionDepths);
+
+// Drops the samples of one input pixel that start behind cutDepth and returns how many are left.
+// Depth-sorted input only loses a tail; otherwise the kept samples are copied into scratch, which
+// must have room for `count` samples, and *samples is pointed at it.
+unsigned int PruneOccludedSamples(const float** samples, unsigned int count, float cutDepth,
+                                  float* scratch);
+
 #endif  // LOOM_SRC_DEEP_MERGER_H
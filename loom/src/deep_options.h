@@ -17,6 +17,8 @@ struct Options {
     bool show_help = false;
     bool mod_offset = false;
     bool enable_merging = true;
+    size_t memory_budget_mb = 2048;  // Row buffers in flight; sizes the compositing window
+    bool compact_rows = false;       // Keep window rows as half color and half thickness
 };
 
 #endif  // LOOM_SRC_DEEP_OPTIONS_H
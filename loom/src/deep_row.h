@@ -1,6 +1,8 @@
 #ifndef LOOM_SRC_DEEP_ROW_H
 #define LOOM_SRC_DEEP_ROW_H
 
+#include <exrio/deep_writer.h>
+
 #include <cstring>
 #include <memory>
 #include <vector>
@@ -120,44 +122,26 @@ struct DeepRow {
     ~DeepRow() = default;
 };
 
-// Converts a row of deep data into a flattened RGBA image row
+// Accumulated alpha at which flattening stops: whatever lies behind contributes at most 0.1%
+constexpr float OPAQUE_ALPHA = 0.999f;
+
+// Converts a row of deep data into a flattened RGBA image row, several pixels at a time in SIMD
+// lanes (exrio::flattenPixels)
 inline void FlattenRow(const DeepRow& deepRow, std::vector<float>& rgbaOutput) {
     size_t required = static_cast<size_t>(deepRow.width) * 4;
     if (rgbaOutput.size() < required) {
         rgbaOutput.resize(required);
     }
+    // Each pixel's samples start where the previous pixel's end
+    thread_local std::vector<const float*> pixel_starts;
+    pixel_starts.resize(deepRow.width);
     const float* pixel_data = deepRow.all_samples.get();
     for (int x = 0; x < deepRow.width; ++x) {
-        int num_samples = deepRow.sample_counts[x];
-
-        float accR = 0, accG = 0, accB = 0, accA = 0;
-
-        for (int s = 0; s < num_samples; ++s) {
-            const float* sPtr = pixel_data + (s * 6);
-
-            float r = sPtr[0];
-            float g = sPtr[1];
-            float b = sPtr[2];
-            float a = sPtr[3];
-
-            // Standard Front-to-Back "Over"
-            float weight = (1.0f - accA);
-            accR += r * weight;
-            accG += g * weight;
-            accB += b * weight;
-            accA += a * weight;
-
-            if (accA >= 0.999f) break;
-        }
-
-        // Store as RGBA (4 channels)
-        rgbaOutput[x * 4 + 0] = accR;
-        rgbaOutput[x * 4 + 1] = accG;
-        rgbaOutput[x * 4 + 2] = accB;
-        rgbaOutput[x * 4 + 3] = accA;
-
-        pixel_data += num_samples * 6;
+        pixel_starts[x] = pixel_data;
+        pixel_data += static_cast<size_t>(deepRow.sample_counts[x]) * 6;
     }
+    exrio::flattenPixels(pixel_starts.data(), deepRow.sample_counts.data(), deepRow.width, 6,
+                         OPAQUE_ALPHA, rgbaOutput.data());
 }
 
 #endif  // LOOM_SRC_DEEP_ROW_H
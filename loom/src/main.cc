@@ -5,6 +5,7 @@
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -42,6 +43,8 @@ void printUsage(const char* programName) {
               << "  --no-png-output      Don't write PNG preview\n"
               << "  --verbose, -v        Detailed Logging\n"
               << "  --merge-threshold N  Depth epsilon for merging samples (default: 0.001)\n"
+              << "  --memory-budget MB   Memory for rows in flight (default: 2048)\n"
+              << "  --compact-rows       Hold rows in flight at half precision (default: off)\n"
               << "  --help, -h           Show this help message\n\n"
               << "Example:\n"
               << "  " << programName << " --deep-output --verbose \\\n"
@@ -78,6 +81,8 @@ bool parseArgs(int argc, char* argv[], Options& opts) {
             opts.png_output = true;
         } else if (arg == "--no-png-output") {
             opts.png_output = false;
+        } else if (arg == "--compact-rows") {
+            opts.compact_rows = true;
         } else if (arg == "--mod-offset") {
             opts.mod_offset = true;
         } else if (arg == "--merge-threshold") {
@@ -91,6 +96,19 @@ bool parseArgs(int argc, char* argv[], Options& opts) {
                 std::cerr << "Error: Invalid merge threshold value\n";
                 return false;
             }
+        } else if (arg == "--memory-budget") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --memory-budget requires a value\n";
+                return false;
+            }
+            try {
+                const long budget = std::stol(argv[++i]);
+                if (budget < 1) throw std::invalid_argument("budget");
+                opts.memory_budget_mb = static_cast<size_t>(budget);
+            } catch (...) {
+                std::cerr << "Error: Invalid memory budget value\n";
+                return false;
+            }
         } else if (arg[0] == '-' && !isFloat(arg)) {
             std::cerr << "Error: Unknown option: " << arg << "\n";
             return false;
@@ -179,38 +197,18 @@ int main(int argc, char* argv[]) {
     int width = imagesInfo[0]->width();
 
     Log("Starting processing...");
-    std::vector<float> finalImage = ProcessAllEXR(opts, height, width, imagesInfo);
-
-    Log("\nWriting outputs...");
-    Timer writeTimer;
+    FlatOutputs flatOutputs;
+    if (opts.flat_output) flatOutputs.exr_path = opts.output_prefix + "_flat.exr";
+    if (opts.png_output) flatOutputs.png_path = opts.output_prefix + ".png";
 
     try {
-        // Write flat EXR if requested
-        if (opts.flat_output) {
-            std::string flatPath = opts.output_prefix + "_flat.exr";
-            exrio::writeFlatEXR(finalImage, width, height, flatPath);
-            Log("  Wrote: " + flatPath);
-        }
-
-        // Write PNG if requested
-        if (opts.png_output) {
-            std::string pngPath = opts.output_prefix + ".png";
-
-            if (exrio::hasPNGSupport()) {
-                exrio::writePNG(finalImage, width, height, pngPath);
-                Log("  Wrote: " + pngPath);
-            } else {
-                Log("  Skipped PNG (libpng not available)");
-            }
-        }
-
+        // Outputs are streamed out row by row while compositing
+        ProcessAllEXR(opts, height, width, imagesInfo, 0, flatOutputs);
     } catch (const exrio::DeepWriterException& e) {
         LogError("Failed to write output: " + std::string(e.what()));
         return 1;
     }
 
-    // LogVerbose("  Write time: " + writeTimer.elapsedString());
-
     // ========================================================================
     // Summary
     // ========================================================================
@@ -0,0 +1,199 @@
+#ifndef LOOM_SRC_PIPELINE_QUEUE_H
+#define LOOM_SRC_PIPELINE_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace deep_compositor {
+
+/**
+ * Bounded multi-producer multi-consumer queue that hands work between pipeline stages.
+ *
+ * Push blocks while the queue is full and Pop while it is empty, so idle stages sleep on a
+ * condition variable instead of spinning. Close() wakes every waiter: Pop then drains what is
+ * left and returns false once the queue is empty, and Push refuses new items.
+ */
+template <typename T>
+class BoundedQueue {
+  public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+    // Returns false if the queue was closed before the item could be added. Notifies under the
+    // lock, so a consumer that pops the last item may destroy the queue as soon as it has it.
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        if (closed_) return false;
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Returns false once the queue is closed and empty
+    bool Pop(T* item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        *item = std::move(items_.front());
+        items_.pop_front();
+        lock.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    size_t Capacity() const { return capacity_; }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  private:
+    const size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+/**
+ * Monotonic counter other threads can block on, e.g. "rows written so far".
+ */
+class ProgressGate {
+  public:
+    void Advance(int value) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (value <= value_) return;
+            value_ = value;
+        }
+        changed_.notify_all();
+    }
+
+    // Blocks until the counter reaches at least value
+    void WaitFor(int value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this, value] { return value_ >= value; });
+    }
+
+    int Value() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return value_;
+    }
+
+  private:
+    int value_ = 0;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+};
+
+/**
+ * First exception thrown by any stage of a pipeline.
+ *
+ * A stage that fails records its exception here instead of letting it escape its thread (or pool
+ * task), which would terminate the process. Once it is set every stage skips its work but still
+ * hands its rows on, so the pipeline drains and the caller can join it and rethrow.
+ */
+class PipelineError {
+  public:
+    // Keeps the first exception; later ones are usually its consequences and are dropped
+    void Record(std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) error_ = std::move(error);
+        }
+        failed_.store(true, std::memory_order_release);
+    }
+
+    bool Failed() const { return failed_.load(std::memory_order_acquire); }
+
+    // Rethrows the recorded exception, if any
+    void Rethrow() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_) std::rethrow_exception(error_);
+    }
+
+  private:
+    std::exception_ptr error_;
+    std::atomic<bool> failed_{false};
+    std::mutex mutex_;
+};
+
+/**
+ * Fixed set of threads running submitted tasks in FIFO order.
+ *
+ * One pool can serve several pipelines at once (e.g. the frames of a batch task), so their tasks
+ * share the cores. Tasks must not block on each other or throw. The destructor runs the tasks still
+ * queued and joins the threads.
+ */
+class TaskPool {
+  public:
+    explicit TaskPool(int threads) {
+        threads = std::max(1, threads);
+        for (int i = 0; i < threads; ++i) threads_.emplace_back([this] { Run(); });
+    }
+
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        has_task_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    void Submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        has_task_.notify_one();
+    }
+
+    int Size() const { return static_cast<int>(threads_.size()); }
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+  private:
+    void Run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                has_task_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::mutex mutex_;
+    std::condition_variable has_task_;
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace deep_compositor
+
+#endif  // LOOM_SRC_PIPELINE_QUEUE_H
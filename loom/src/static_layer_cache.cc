@@ -0,0 +1,148 @@
+#include "static_layer_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "deep_info.h"
+#include "deep_merger.h"
+#include "utils.h"
+
+namespace deep_compositor {
+
+namespace {
+
+// Rows a thread reads and merges at a time
+const int CACHE_CHUNK_ROWS = 16;
+
+// Copies a merged row into a tight cache row and fills in its pixels' pre-flattened samples
+void StoreRow(int y, const DeepRow& merged, std::vector<float>& rgba, StaticLayerCache& cache) {
+    DeepRow& row = cache.rows[y];
+    row.Allocate(merged.width, merged.sample_counts.data());
+    std::memcpy(row.all_samples.get(), merged.all_samples.get(),
+                row.total_samples_in_row * 6 * sizeof(float));
+
+    FlattenRow(row, rgba);
+    const float* pixel_data = row.all_samples.get();
+    for (int x = 0; x < cache.width; ++x) {
+        const unsigned int count = row.sample_counts[x];
+        float z_min = std::numeric_limits<float>::infinity();
+        float z_max = -std::numeric_limits<float>::infinity();
+        for (unsigned int s = 0; s < count; ++s) {
+            z_min = std::min(z_min, pixel_data[s * 6 + 4]);
+            z_max = std::max(z_max, pixel_data[s * 6 + 5]);
+        }
+        pixel_data += count * 6;
+
+        float* flat = cache.flat_samples.data() + (static_cast<size_t>(y) * cache.width + x) * 6;
+        std::copy(rgba.begin() + x * 4, rgba.begin() + x * 4 + 4, flat);
+        flat[4] = z_min;
+        flat[5] = z_min;
+        cache.z_max[static_cast<size_t>(y) * cache.width + x] = z_max;
+    }
+}
+
+}  // namespace
+
+std::shared_ptr<const StaticLayerCache> BuildStaticLayerCache(
+    const std::vector<std::string>& files, float merge_threshold, int thread_count) {
+    auto cache = std::make_shared<StaticLayerCache>();
+    if (files.empty()) return cache;
+
+    {
+        DeepInfo first(files[0]);
+        cache->width = first.width();
+        cache->height = first.height();
+    }
+    const int width = cache->width;
+    const int height = cache->height;
+    cache->rows.resize(height);
+    cache->flat_samples.assign(static_cast<size_t>(width) * height * 6, 0.0f);
+    cache->z_max.assign(static_cast<size_t>(width) * height, 0.0f);
+
+    const int num_files = static_cast<int>(files.size());
+    const int num_chunks = (height + CACHE_CHUNK_ROWS - 1) / CACHE_CHUNK_ROWS;
+    const int threads = std::clamp(thread_count, 1, std::max(1, num_chunks));
+    std::atomic<int> next_chunk{0};
+    std::mutex error_mutex;
+    std::exception_ptr first_error;
+
+    // Every thread opens its own handles (an EXR file is read by one thread at a time) and
+    // claims chunks of rows until none are left
+    auto worker = [&]() {
+        try {
+            std::vector<std::unique_ptr<DeepInfo>> inputs;
+            for (const std::string& file : files) {
+                inputs.push_back(std::make_unique<DeepInfo>(file, /*verbose=*/false));
+                if (inputs.back()->width() != width || inputs.back()->height() != height) {
+                    throw std::runtime_error("Static layer dimensions mismatch: " + file);
+                }
+            }
+            std::vector<std::vector<DeepRow>> chunk_rows(num_files);
+            for (auto& rows : chunk_rows) rows.resize(CACHE_CHUNK_ROWS);
+            std::vector<DeepRow*> row_ptrs;
+            DeepRow merged;
+            std::vector<float> rgba;
+            std::vector<const float*> running_ptrs(num_files);
+            std::vector<const float*> pixel_ptrs(num_files);
+            std::vector<unsigned int> pixel_counts(num_files);
+
+            for (int chunk = next_chunk.fetch_add(1); chunk < num_chunks;
+                 chunk = next_chunk.fetch_add(1)) {
+                const int chunk_y = chunk * CACHE_CHUNK_ROWS;
+                const int chunk_end = std::min(chunk_y + CACHE_CHUNK_ROWS, height);
+                for (int i = 0; i < num_files; ++i) {
+                    row_ptrs.clear();
+                    for (int r = 0; r < chunk_end - chunk_y; ++r) {
+                        row_ptrs.push_back(&chunk_rows[i][r]);
+                    }
+                    inputs[i]->ReadRows(chunk_y, chunk_end, row_ptrs.data());
+                }
+
+                for (int r = 0; r < chunk_end - chunk_y; ++r) {
+                    size_t total_input_samples = 0;
+                    for (int i = 0; i < num_files; ++i) {
+                        total_input_samples += chunk_rows[i][r].total_samples_in_row;
+                        running_ptrs[i] = chunk_rows[i][r].all_samples.get();
+                    }
+                    merged.Allocate(width, static_cast<int>(total_input_samples * 2));
+                    for (int x = 0; x < width; ++x) {
+                        for (int i = 0; i < num_files; ++i) {
+                            const unsigned int count = chunk_rows[i][r].GetSampleCount(x);
+                            pixel_ptrs[i] = running_ptrs[i];
+                            pixel_counts[i] = count;
+                            running_ptrs[i] += count * 6;
+                        }
+                        SortAndMergePixelsWithSplit(x, pixel_ptrs, pixel_counts, merged,
+                                                    merge_threshold);
+                    }
+                    StoreRow(chunk_y + r, merged, rgba, *cache);
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!first_error) first_error = std::current_exception();
+            next_chunk.store(num_chunks);  // Stop the other threads early
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    if (first_error) std::rethrow_exception(first_error);
+
+    size_t total_samples = 0;
+    for (const DeepRow& row : cache->rows) total_samples += row.total_samples_in_row;
+    Log("  Cached " + std::to_string(files.size()) + " static layer(s): " +
+        FormatNumber(total_samples) + " merged samples (" +
+        FormatBytes(total_samples * 6 * sizeof(float)) + ")");
+    return cache;
+}
+
+}  // namespace deep_compositor
@@ -0,0 +1,57 @@
+#ifndef LOOM_SRC_STATIC_LAYER_CACHE_H
+#define LOOM_SRC_STATIC_LAYER_CACHE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "deep_row.h"
+
+namespace deep_compositor {
+
+/**
+ * The static layers of a shot, decoded and merged once and kept in memory.
+ *
+ * Static layers render to the same static.exr for every frame, so a batch task merges them into
+ * one deep layer up front and every frame reads that instead of re-decoding the files. Besides
+ * the merged deep rows, each pixel keeps a pre-flattened copy: a single sample holding the
+ * premultiplied "over" of all static samples, and the depth range they cover. When every other
+ * input of a pixel lies outside that range, the flattened sample composites exactly like the
+ * deep samples it replaces.
+ */
+struct StaticLayerCache {
+    int width = 0;
+    int height = 0;
+    std::vector<DeepRow> rows;        // Merged static samples, one tight row per scanline
+    std::vector<float> flat_samples;  // Per pixel: [R, G, B, A, Z, ZBack] with Z = ZBack = z_min
+    std::vector<float> z_max;         // Per pixel: furthest ZBack of the static samples
+
+    const float* FlatSample(int x, int y) const {
+        return flat_samples.data() + (static_cast<size_t>(y) * width + x) * 6;
+    }
+
+    // Whether the other inputs of a pixel, spanning [other_min, other_max] in depth, lie entirely
+    // in front of or behind the static samples. Samples closer than merge_threshold would be
+    // blended by the merge, so they do not count as separate.
+    bool IsSeparated(int x, int y, float other_min, float other_max,
+                     float merge_threshold) const {
+        const size_t i = static_cast<size_t>(y) * width + x;
+        const float static_min = flat_samples[i * 6 + 4];
+        return other_max < static_min - merge_threshold ||
+               other_min > z_max[i] + merge_threshold;
+    }
+};
+
+/**
+ * Decodes and merges the given deep EXR files into a StaticLayerCache, reading and merging row
+ * chunks on up to thread_count threads (each with its own file handles).
+ *
+ * @throws std::runtime_error if the files do not share the same dimensions
+ */
+std::shared_ptr<const StaticLayerCache> BuildStaticLayerCache(
+    const std::vector<std::string>& files, float merge_threshold, int thread_count);
+
+}  // namespace deep_compositor
+
+#endif  // LOOM_SRC_STATIC_LAYER_CACHE_H
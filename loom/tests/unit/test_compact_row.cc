@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "compact_row.h"
+#include "deep_row.h"
+
+namespace {
+
+// A row holding the given samples, with one entry of counts per pixel
+void FillRow(DeepRow& row, const std::vector<unsigned int>& counts,
+             const std::vector<float>& samples) {
+    row.Allocate(counts.size(), counts.data());
+    std::copy(samples.begin(), samples.end(), row.all_samples.get());
+}
+
+}  // namespace
+
+TEST(CompactRowTest, SurfaceDepthsRoundTripExactly) {
+    // Seven samples: on CPUs with F16C the first four take the four-wide path and the rest the
+    // one-at-a-time tail; elsewhere all seven take the one-at-a-time path
+    std::vector<float> samples;
+    for (int s = 0; s < 7; ++s) {
+        const float z = 1.0f + 1234.567f * s;
+        samples.insert(samples.end(), {0.25f, 0.5f, 0.125f, 1.0f, z, z});
+    }
+    DeepRow row;
+    FillRow(row, {3, 0, 4}, samples);
+
+    CompactRow compact;
+    compact.Pack(row);
+    DeepRow unpacked;
+    compact.Unpack(unpacked);
+
+    ASSERT_EQ(unpacked.width, 3);
+    EXPECT_EQ(unpacked.GetSampleCount(1), 0u);
+    ASSERT_EQ(unpacked.total_samples_in_row, 7u);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        EXPECT_EQ(unpacked.all_samples[i], samples[i]) << i;
+    }
+    EXPECT_EQ(unpacked.GetPixelData(2), unpacked.all_samples.get() + 3 * 6);
+}
+
+TEST(CompactRowTest, VolumesKeepHalfPrecision) {
+    std::vector<float> samples;
+    for (int s = 0; s < 5; ++s) {
+        samples.insert(samples.end(),
+                       {0.1f * s, 0.3f, 0.7f + 0.01f * s, 0.45f, 10.0f + s, 10.0f + s + 0.37f * s});
+    }
+    DeepRow row;
+    FillRow(row, {5}, samples);
+
+    CompactRow compact;
+    compact.Pack(row);
+    DeepRow unpacked;
+    compact.Unpack(unpacked);
+
+    for (int s = 0; s < 5; ++s) {
+        const float* in = samples.data() + s * 6;
+        const float* out = unpacked.GetSampleData(0, s);
+        for (int c = 0; c < 4; ++c) EXPECT_NEAR(out[c], in[c], std::abs(in[c]) / 1024.0f) << s;
+        EXPECT_EQ(out[4], in[4]) << s;
+        EXPECT_NEAR(out[5] - out[4], in[5] - in[4], (in[5] - in[4]) / 1024.0f) << s;
+        EXPECT_GE(out[5], out[4]) << s;
+    }
+}
+
+TEST(CompactRowTest, ThickVolumesSaturateInsteadOfOverflowing) {
+    // Five samples so the saturation is checked on both paths
+    std::vector<float> samples;
+    for (int s = 0; s < 5; ++s) {
+        samples.insert(samples.end(), {0.5f, 0.5f, 0.5f, 0.5f, 100.0f, 100.0f + 1.0e6f * (s + 1)});
+    }
+    DeepRow row;
+    FillRow(row, {5}, samples);
+
+    CompactRow compact;
+    compact.Pack(row);
+    DeepRow unpacked;
+    compact.Unpack(unpacked);
+
+    for (int s = 0; s < 5; ++s) {
+        const float* out = unpacked.GetSampleData(0, s);
+        EXPECT_EQ(out[4], 100.0f) << s;
+        EXPECT_EQ(out[5], 100.0f + 65504.0f) << s;
+    }
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "deep_compositor.h"
+#include "deep_info.h"
+#include "deep_options.h"
+#include "static_layer_cache.h"
+
+using deep_compositor::DeepInfo;
+using deep_compositor::ProcessAllEXR;
+using deep_compositor::StaticLayerCache;
+using deep_compositor::TaskPool;
+
+namespace {
+
+// An input whose every row claims more samples than can ever be allocated, so reading it throws
+std::vector<std::unique_ptr<DeepInfo>> UnreadableInput() {
+    auto cache = std::make_shared<StaticLayerCache>();
+    cache->width = 1 << 14;
+    cache->height = 40;
+    cache->rows.resize(cache->height);
+    for (auto& row : cache->rows) {
+        row.sample_counts.assign(cache->width, 0xFFFFFFFFu);
+        row.total_samples_in_row = static_cast<size_t>(cache->width) * 0xFFFFFFFFu;
+    }
+    std::vector<std::unique_ptr<DeepInfo>> inputs;
+    inputs.push_back(std::make_unique<DeepInfo>(std::move(cache)));
+    return inputs;
+}
+
+}  // namespace
+
+// A failed read must come back to the caller instead of terminating the loader thread
+TEST(DeepCompositorTest, RethrowsFailedRead) {
+    Options opts;
+    opts.flat_output = false;
+    opts.png_output = false;
+    auto inputs = UnreadableInput();
+    EXPECT_THROW(ProcessAllEXR(opts, 0, 0, inputs, 4), std::bad_alloc);
+}
+
+// A shared pool outlives the failed frame and keeps serving the next one
+TEST(DeepCompositorTest, SharedPoolSurvivesFailedFrame) {
+    Options opts;
+    opts.flat_output = false;
+    opts.png_output = false;
+    TaskPool pool(2);
+    for (int frame = 0; frame < 2; ++frame) {
+        auto inputs = UnreadableInput();
+        EXPECT_THROW(ProcessAllEXR(opts, 0, 0, inputs, 4, {}, &pool), std::bad_alloc);
+    }
+}
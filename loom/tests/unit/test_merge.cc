@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <vector>
 
 #include "deep_merger.h"  // Assuming this contains RawSample and merge functions
@@ -107,6 +108,88 @@ TEST_F(DeepPixelMergeTest, VolumetricSplitHandlesOverlappingSamples) {
     EXPECT_FLOAT_EQ(row.GetSampleData(0, 2)[4], 5.0f);
 }
 
+TEST_F(DeepPixelMergeTest, SplitMergeInterleavesSortedLayers) {
+    DeepRow row;
+    row.Allocate(2, 1);  // Too small on purpose; the merge grows the row
+
+    // Three layers, each front to back, whose samples interleave in depth
+    auto a = packSamples(
+        {MakeSample(0.1f, 0.0f, 0.0f, 0.2f, 1.0f), MakeSample(0.1f, 0.0f, 0.0f, 0.2f, 4.0f)});
+    auto b = packSamples(
+        {MakeSample(0.0f, 0.1f, 0.0f, 0.2f, 2.0f), MakeSample(0.0f, 0.1f, 0.0f, 0.2f, 5.0f)});
+    auto c = packSamples({MakeSample(0.0f, 0.0f, 0.1f, 0.2f, 0.5f, 3.0f)});
+    SortAndMergePixelsWithSplit(0, {a.data(), b.data(), c.data()}, {2, 2, 1}, row);
+    SortAndMergePixelsWithSplit(1, {a.data(), b.data(), c.data()}, {0, 0, 0}, row);
+
+    // The volume splits at 1 and 2: [0.5,1] [1] [1,2] [2] [2,3] [4] [5]
+    const float expected_z[] = {0.5f, 1.0f, 1.0f, 2.0f, 2.0f, 4.0f, 5.0f};
+    ASSERT_EQ(row.GetSampleCount(0), 7u);
+    for (unsigned int s = 0; s < 7; ++s) {
+        EXPECT_FLOAT_EQ(row.GetSampleData(0, s)[4], expected_z[s]) << s;
+    }
+    EXPECT_EQ(row.GetSampleCount(1), 0u);
+    EXPECT_EQ(row.total_samples_in_row, 7u);
+}
+
+TEST_F(DeepPixelMergeTest, SplitMergeSortsUnorderedInput) {
+    DeepRow sorted, unsorted;
+    sorted.Allocate(1, 4);
+    unsorted.Allocate(1, 4);
+
+    RawSample nearS = MakeSample(0.2f, 0.2f, 0.2f, 0.5f, 1.0f, 2.0f);
+    RawSample farS = MakeSample(0.4f, 0.4f, 0.4f, 0.5f, 3.0f);
+    auto inOrder = packSamples({nearS, farS});
+    auto reversed = packSamples({farS, nearS});
+    SortAndMergePixelsWithSplit(0, {inOrder.data()}, {2}, sorted);
+    SortAndMergePixelsWithSplit(0, {reversed.data()}, {2}, unsorted);
+
+    ASSERT_EQ(unsorted.GetSampleCount(0), sorted.GetSampleCount(0));
+    for (unsigned int s = 0; s < sorted.GetSampleCount(0); ++s) {
+        for (int c = 0; c < 6; ++c) {
+            EXPECT_FLOAT_EQ(unsorted.GetSampleData(0, s)[c], sorted.GetSampleData(0, s)[c]);
+        }
+    }
+}
+
+TEST_F(DeepPixelMergeTest, OcclusionDepthIsBehindNearestOpaqueSample) {
+    // Pixel 0: translucent, then opaque volume [3, 4], then opaque at 6. Pixel 1: translucent only.
+    auto pixel0 = packSamples({MakeSample(0.1f, 0.1f, 0.1f, 0.3f, 1.0f),
+                               MakeSample(0.5f, 0.5f, 0.5f, 1.0f, 3.0f, 4.0f),
+                               MakeSample(0.2f, 0.2f, 0.2f, 1.0f, 6.0f)});
+    auto pixel1 = packSamples({MakeSample(0.1f, 0.1f, 0.1f, 0.3f, 2.0f)});
+    const unsigned int counts[] = {3, 1};
+    DeepRow row;
+    row.Allocate(2, counts);
+    std::copy(pixel0.begin(), pixel0.end(), row.GetPixelData(0));
+    std::copy(pixel1.begin(), pixel1.end(), row.GetPixelData(1));
+
+    std::vector<float> depths = {10.0f, 10.0f};
+    EXPECT_FLOAT_EQ(UpdateOcclusionDepths(row, 0.01f, depths), 1.0f);
+    EXPECT_FLOAT_EQ(depths[0], 4.01f);
+    EXPECT_FLOAT_EQ(depths[1], 10.0f);  // Never raised
+}
+
+TEST_F(DeepPixelMergeTest, PruneDropsSamplesBehindCut) {
+    RawSample nearS = MakeSample(0.1f, 0.1f, 0.1f, 0.3f, 1.0f);
+    RawSample straddling = MakeSample(0.2f, 0.2f, 0.2f, 0.3f, 1.5f, 3.0f);  // Starts in front
+    RawSample farS = MakeSample(0.4f, 0.4f, 0.4f, 0.5f, 5.0f);
+
+    // Sorted input keeps its prefix in place
+    auto inOrder = packSamples({nearS, straddling, farS});
+    const float* samples = inOrder.data();
+    std::vector<float> scratch(3 * 6);
+    EXPECT_EQ(PruneOccludedSamples(&samples, 3, 2.0f, scratch.data()), 2u);
+    EXPECT_EQ(samples, inOrder.data());
+
+    // Unsorted input is compacted into the scratch buffer
+    auto shuffled = packSamples({farS, straddling, nearS});
+    samples = shuffled.data();
+    ASSERT_EQ(PruneOccludedSamples(&samples, 3, 2.0f, scratch.data()), 2u);
+    EXPECT_EQ(samples, scratch.data());
+    EXPECT_FLOAT_EQ(samples[4], 1.5f);
+    EXPECT_FLOAT_EQ(samples[6 + 4], 1.0f);
+}
+
 // ============================================================================
 // Not Implemented Tests
 // ============================================================================
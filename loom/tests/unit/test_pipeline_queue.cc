@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "pipeline_queue.h"
+
+using deep_compositor::BoundedQueue;
+using deep_compositor::PipelineError;
+using deep_compositor::ProgressGate;
+using deep_compositor::TaskPool;
+
+TEST(PipelineQueueTest, DeliversEveryItemOnceAcrossThreads) {
+    BoundedQueue<int> queue(4);  // Much smaller than the item count, so producers block
+    constexpr int kProducers = 3;
+    constexpr int kItemsEach = 500;
+    std::vector<std::atomic<int>> seen(kProducers * kItemsEach);
+
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < 4; ++c) {
+        consumers.emplace_back([&] {
+            int item = 0;
+            while (queue.Pop(&item)) seen[item].fetch_add(1);
+        });
+    }
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < kItemsEach; ++i) EXPECT_TRUE(queue.Push(p * kItemsEach + i));
+        });
+    }
+    for (auto& t : producers) t.join();
+    queue.Close();
+    for (auto& t : consumers) t.join();
+
+    for (size_t i = 0; i < seen.size(); ++i) EXPECT_EQ(seen[i].load(), 1) << i;
+}
+
+TEST(PipelineQueueTest, CloseDrainsThenStops) {
+    BoundedQueue<int> queue(2);
+    ASSERT_TRUE(queue.Push(7));
+    queue.Close();
+    EXPECT_FALSE(queue.Push(8));
+
+    int item = 0;
+    ASSERT_TRUE(queue.Pop(&item));
+    EXPECT_EQ(item, 7);
+    EXPECT_FALSE(queue.Pop(&item));
+}
+
+TEST(PipelineQueueTest, GateReleasesWaitersInOrder) {
+    ProgressGate gate;
+    std::atomic<int> released{0};
+    std::thread waiter([&] {
+        gate.WaitFor(3);
+        released.store(gate.Value());
+    });
+    gate.Advance(1);
+    gate.Advance(3);
+    gate.Advance(2);  // Never moves backwards
+    waiter.join();
+    EXPECT_GE(released.load(), 3);
+    EXPECT_EQ(gate.Value(), 3);
+}
+
+TEST(PipelineQueueTest, PoolRunsTasksFromSeveralSubmitters) {
+    constexpr int kSubmitters = 3;
+    constexpr int kTasksEach = 400;
+    std::vector<std::atomic<int>> runs(kSubmitters * kTasksEach);
+    {
+        TaskPool pool(2);
+        EXPECT_EQ(pool.Size(), 2);
+        std::vector<std::thread> submitters;
+        for (int s = 0; s < kSubmitters; ++s) {
+            submitters.emplace_back([&, s] {
+                for (int i = 0; i < kTasksEach; ++i) {
+                    const int task = s * kTasksEach + i;
+                    pool.Submit([&runs, task] { runs[task].fetch_add(1); });
+                }
+            });
+        }
+        for (auto& t : submitters) t.join();
+    }  // The destructor runs what is still queued
+
+    for (size_t i = 0; i < runs.size(); ++i) EXPECT_EQ(runs[i].load(), 1) << i;
+}
+
+TEST(PipelineQueueTest, ErrorKeepsFirstException) {
+    PipelineError error;
+    EXPECT_FALSE(error.Failed());
+    EXPECT_NO_THROW(error.Rethrow());
+
+    std::thread stage([&error] {
+        error.Record(std::make_exception_ptr(std::runtime_error("first")));
+    });
+    stage.join();
+    error.Record(std::make_exception_ptr(std::logic_error("second")));
+
+    EXPECT_TRUE(error.Failed());
+    EXPECT_THROW(error.Rethrow(), std::runtime_error);
+}
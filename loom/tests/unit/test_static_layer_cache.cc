@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "deep_merger.h"
+#include "deep_row.h"
+#include "static_layer_cache.h"
+
+using deep_compositor::StaticLayerCache;
+
+namespace {
+
+// One-pixel cache whose flat sample is the "over" of the given static samples
+StaticLayerCache MakeCache(const std::vector<float>& samples) {
+    StaticLayerCache cache;
+    cache.width = 1;
+    cache.height = 1;
+    cache.rows.resize(1);
+    const unsigned int count = static_cast<unsigned int>(samples.size() / 6);
+    cache.rows[0].Allocate(1, &count);
+    std::copy(samples.begin(), samples.end(), cache.rows[0].all_samples.get());
+
+    std::vector<float> rgba;
+    FlattenRow(cache.rows[0], rgba);
+    cache.flat_samples = {rgba[0], rgba[1], rgba[2], rgba[3], samples[4], samples[4]};
+    cache.z_max = {samples[samples.size() - 1]};
+    return cache;
+}
+
+std::vector<float> MergeAndFlatten(const std::vector<const float*>& ptrs,
+                                   const std::vector<unsigned int>& counts) {
+    DeepRow row;
+    row.Allocate(1, 64);
+    SortAndMergePixelsWithSplit(0, ptrs, counts, row);
+    std::vector<float> rgba;
+    FlattenRow(row, rgba);
+    return rgba;
+}
+
+}  // namespace
+
+TEST(StaticLayerCacheTest, SeparationRespectsMergeThreshold) {
+    // Static samples span depth [5, 7]
+    const StaticLayerCache cache = MakeCache({0.2f, 0.2f, 0.2f, 0.5f, 5.0f, 5.0f,  //
+                                              0.1f, 0.1f, 0.1f, 0.4f, 6.0f, 7.0f});
+    EXPECT_TRUE(cache.IsSeparated(0, 0, 1.0f, 4.0f, 0.001f));
+    EXPECT_TRUE(cache.IsSeparated(0, 0, 8.0f, 9.0f, 0.001f));
+    EXPECT_FALSE(cache.IsSeparated(0, 0, 4.0f, 5.5f, 0.001f));
+    EXPECT_FALSE(cache.IsSeparated(0, 0, 6.5f, 9.0f, 0.001f));
+
+    // Within the threshold of the front sample the merge would blend them
+    EXPECT_FALSE(cache.IsSeparated(0, 0, 1.0f, 4.9995f, 0.001f));
+    EXPECT_TRUE(cache.IsSeparated(0, 0, 1.0f, 4.9995f, 0.0f));
+}
+
+// Swapping separated static samples for their flat sample must not change the flattened pixel
+TEST(StaticLayerCacheTest, FlatSampleCompositesLikeDeepSamples) {
+    const std::vector<float> statics = {0.2f, 0.1f, 0.0f, 0.5f, 5.0f, 5.0f,  //
+                                        0.1f, 0.3f, 0.1f, 0.4f, 6.0f, 7.0f};
+    const StaticLayerCache cache = MakeCache(statics);
+
+    const std::vector<float> in_front = {0.3f, 0.0f, 0.0f, 0.3f, 1.0f, 2.0f};
+    const std::vector<float> behind = {0.0f, 0.0f, 0.6f, 0.6f, 9.0f, 9.0f};
+    for (const std::vector<float>* other : {&in_front, &behind}) {
+        const std::vector<float> deep =
+            MergeAndFlatten({other->data(), statics.data()}, {1, 2});
+        const std::vector<float> flat =
+            MergeAndFlatten({other->data(), cache.FlatSample(0, 0)}, {1, 1});
+        for (int c = 0; c < 4; ++c) EXPECT_NEAR(flat[c], deep[c], 1e-6f) << c;
+    }
+}
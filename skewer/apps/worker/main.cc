@@ -13,6 +13,7 @@
 #include "film/film.h"
 #include "integrators/path_trace.h"
 #include "io/scene_loader.h"
+#include "materials/texture_cache.h"
 #include "scene/camera.h"
 #include "scene/scene.h"
 
@@ -100,6 +101,10 @@ static int RunBatchMode() {
         // Load the scene (context + layer geometry) once.
         // The BVH is built here and reused across all frames in this chunk.
         auto scene = std::make_unique<skwr::Scene>();
+        if (config.texture_cache_mb > 0) {
+            scene->EnableTextureCache(config.texture_cache_mb << 20);
+        }
+        scene->SetPrecomputeTextureCurves(config.spectral_textures);
         if (!context_paths.empty()) {
             skwr::LoadContextIntoScene(context_paths, *scene);
         } else if (!config.context_paths.empty()) {
@@ -122,6 +127,7 @@ static int RunBatchMode() {
             scene->Build();  // rebuilds BVH with correct motion bounds for this shutter
 
             auto cam = std::make_unique<skwr::Camera>(config.camera_timeline, aspect, t0, t1);
+            cam->SetImageHeight(opts.image_config.height);
             opts.integrator_config.cam_w = -cam->GetW();
 
             auto film =
@@ -134,6 +140,11 @@ static int RunBatchMode() {
             film->WriteDeepEXRStreaming(out_path);
 
             std::cout << "[SKEWER BATCH]: Wrote " << out_path << "\n";
+            if (const skwr::TextureCache* cache = scene->texture_cache()) {
+                std::cout << "[SKEWER BATCH]: Texture cache: "
+                          << skwr::FormatTextureCacheStats(cache->Stats(), cache->budget_bytes())
+                          << "\n";
+            }
         };
 
         auto copy_to_cache = [&](const std::string& src, const std::string& cache_prefix,
@@ -3,9 +3,11 @@ set(_SKEWER_CORE_SOURCE_ROOT "${CMAKE_CURRENT_LIST_DIR}/..")
 set(SKEWER_CORE_SOURCES
     "${_SKEWER_CORE_SOURCE_ROOT}/src/session/render_session.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/scene/scene.cc"
+    "${_SKEWER_CORE_SOURCE_ROOT}/src/scene/camera.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/scene/interp_curve.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/scene/animation.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/film/film.cc"
+    "${_SKEWER_CORE_SOURCE_ROOT}/src/film/denoiser.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/film/image_buffer.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/integrators/path_trace.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/integrators/normals.cc"
@@ -18,8 +20,11 @@ set(SKEWER_CORE_SOURCES
     "${_SKEWER_CORE_SOURCE_ROOT}/src/io/image_io.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/materials/bsdf.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/materials/texture.cc"
+    "${_SKEWER_CORE_SOURCE_ROOT}/src/materials/texture_cache.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/core/spectral/rgb2spec.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/core/spectral/srgb_spec_data.cc"
+    "${_SKEWER_CORE_SOURCE_ROOT}/src/core/sampling/sampler.cc"
+    "${_SKEWER_CORE_SOURCE_ROOT}/src/core/transport/sd_tree.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/kernels/path_kernel.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/kernels/sample_media.cc"
     "${_SKEWER_CORE_SOURCE_ROOT}/src/kernels/volume_dispatch.cc"
@@ -246,6 +246,7 @@ bool TLAS::Intersect(const Ray& ray, float t_min, float t_max, SurfaceInteractio
                         hit_anything = true;
                         closest_t = si->t;
                         TransformHitToWorld(world_from_local, ray, si);
+                        si->object_id = node.left_first + i;
                         // tri_light_indices are in BLAS triangle order (post-BVH reorder).
                         if (tri_idx < inst.tri_light_indices.size()) {
                             si->light_index = inst.tri_light_indices[tri_idx];
@@ -24,6 +24,8 @@ class TLAS {
                    const std::vector<BLAS>& blases, const std::vector<Instance>& instances) const;
 
     bool IsEmpty() const { return nodes_.empty(); }
+    // World bounds of every instance over the shutter interval (empty box if no instances).
+    BoundBox Bounds() const { return nodes_.empty() ? BoundBox() : nodes_[0].bounds; }
 
   private:
     std::vector<BVHNode> nodes_;
@@ -30,6 +30,10 @@ constexpr float kRayOffsetEpsilon = 1e-3f;
 constexpr float kBoundsEpsilon = 1e-4f;
 constexpr float kFarClip = 1e10f;
 constexpr float kIsotropicPhaseEpsilon = 1e-3f;
+// Spread angle (radians) a fully rough bounce adds to a ray cone
+constexpr float kRayConeRoughSpread = 0.5f;
+// Grazing-angle clamp for projecting a ray-cone footprint onto a surface
+constexpr float kRayConeMinCos = 0.05f;
 }  // namespace RenderConstants
 
 namespace Rec709 {
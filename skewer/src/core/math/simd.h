@@ -0,0 +1,117 @@
+#ifndef SKWR_CORE_MATH_SIMD_H_
+#define SKWR_CORE_MATH_SIMD_H_
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define SKWR_SIMD_SSE
+#endif
+
+#if defined(SKWR_SIMD_SSE) && defined(__AVX__)
+#define SKWR_SIMD_AVX
+#endif
+
+namespace skwr {
+
+/**
+ * Thin lane-wise wrappers over SSE (Float4) and AVX (Float8) registers.
+ *
+ * They expose the same operators as float, so generic lambdas can be written once and run on a
+ * scalar, a Float4 or a Float8. Loads and stores are unaligned; on current x86 cores that costs
+ * nothing when the data happens to be aligned.
+ */
+namespace simd {
+
+// Lane-wise a / b, or 0 where |b| <= eps. Scalar overload for the generic fallbacks.
+inline float SafeDiv(float a, float b, float eps) { return std::abs(b) > eps ? a / b : 0.0f; }
+
+#ifdef SKWR_SIMD_SSE
+struct Float4 {
+    __m128 v;
+
+    static Float4 Load(const float* p) { return {_mm_loadu_ps(p)}; }
+    static Float4 Broadcast(float a) { return {_mm_set1_ps(a)}; }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend Float4 operator/(Float4 a, Float4 b) { return {_mm_div_ps(a.v, b.v)}; }
+};
+
+inline Float4 SafeDiv(Float4 a, Float4 b, float eps) {
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 ok = _mm_cmpgt_ps(_mm_and_ps(b.v, abs_mask), _mm_set1_ps(eps));
+    return {_mm_and_ps(ok, _mm_div_ps(a.v, b.v))};
+}
+#endif
+
+#ifdef SKWR_SIMD_AVX
+struct Float8 {
+    __m256 v;
+
+    static Float8 Load(const float* p) { return {_mm256_loadu_ps(p)}; }
+    static Float8 Broadcast(float a) { return {_mm256_set1_ps(a)}; }
+    void Store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend Float8 operator+(Float8 a, Float8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+    friend Float8 operator-(Float8 a, Float8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    friend Float8 operator*(Float8 a, Float8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    friend Float8 operator/(Float8 a, Float8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+};
+
+inline Float8 SafeDiv(Float8 a, Float8 b, float eps) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 ok = _mm256_cmp_ps(_mm256_and_ps(b.v, abs_mask), _mm256_set1_ps(eps), _CMP_GT_OQ);
+    return {_mm256_and_ps(ok, _mm256_div_ps(a.v, b.v))};
+}
+#endif
+
+/**
+ * Apply f lane-wise over n floats: dst[i] = f(a[i], b[i]). Runs 8 lanes per step with AVX when
+ * n is a multiple of 8, 4 with SSE when n is a multiple of 4, and plain floats otherwise.
+ * f must be callable with (float, float) and, where enabled, (Float4, Float4) / (Float8, Float8).
+ */
+template <int N, typename F>
+inline void Lanewise(float* dst, const float* a, const float* b, F f) {
+#ifdef SKWR_SIMD_AVX
+    if constexpr (N % 8 == 0) {
+        for (int i = 0; i < N; i += 8) f(Float8::Load(a + i), Float8::Load(b + i)).Store(dst + i);
+        return;
+    }
+#endif
+#ifdef SKWR_SIMD_SSE
+    if constexpr (N % 4 == 0) {
+        for (int i = 0; i < N; i += 4) f(Float4::Load(a + i), Float4::Load(b + i)).Store(dst + i);
+        return;
+    }
+#endif
+    for (int i = 0; i < N; ++i) dst[i] = f(a[i], b[i]);
+}
+
+// Same as Lanewise with b broadcast from a single scalar.
+template <int N, typename F>
+inline void LanewiseScalar(float* dst, const float* a, float b, F f) {
+#ifdef SKWR_SIMD_AVX
+    if constexpr (N % 8 == 0) {
+        const Float8 bv = Float8::Broadcast(b);
+        for (int i = 0; i < N; i += 8) f(Float8::Load(a + i), bv).Store(dst + i);
+        return;
+    }
+#endif
+#ifdef SKWR_SIMD_SSE
+    if constexpr (N % 4 == 0) {
+        const Float4 bv = Float4::Broadcast(b);
+        for (int i = 0; i < N; i += 4) f(Float4::Load(a + i), bv).Store(dst + i);
+        return;
+    }
+#endif
+    for (int i = 0; i < N; ++i) dst[i] = f(a[i], b);
+}
+
+}  // namespace simd
+
+}  // namespace skwr
+
+#endif  // SKWR_CORE_MATH_SIMD_H_
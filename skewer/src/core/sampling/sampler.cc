@@ -0,0 +1,107 @@
+#include "core/sampling/sampler.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "core/sampling/sampling.h"
+
+namespace skwr {
+
+namespace {
+
+// The 24 permutations of a base-4 digit
+constexpr uint8_t kBase4Permutations[24][4] = {
+    {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 2, 1}, {0, 3, 1, 2},
+    {1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0}, {1, 3, 2, 0}, {1, 3, 0, 2},
+    {2, 1, 0, 3}, {2, 1, 3, 0}, {2, 0, 1, 3}, {2, 0, 3, 1}, {2, 3, 0, 1}, {2, 3, 1, 0},
+    {3, 1, 2, 0}, {3, 1, 0, 2}, {3, 2, 1, 0}, {3, 2, 0, 1}, {3, 0, 2, 1}, {3, 0, 1, 2}};
+
+int CeilLog2(int v) {
+    int log2 = 0;
+    while ((1 << log2) < v) ++log2;
+    return log2;
+}
+
+}  // namespace
+
+Sampler::Sampler(SamplerType type, int samples_per_pixel, int width, int height, uint32_t seed)
+    : type_(type), samples_per_pixel_(std::max(1, samples_per_pixel)), width_(width), seed_(seed) {
+    if (type_ == SamplerType::ZSobol) {
+        log2_spp_ = CeilLog2(samples_per_pixel_);
+        samples_per_pixel_ = 1 << log2_spp_;
+        // Morton index = pixel digits over a square power-of-two image, then the sample digits
+        int log4_spp = (log2_spp_ + 1) / 2;
+        base4_digits_ = CeilLog2(std::max({width, height, 1})) + log4_spp;
+    }
+}
+
+void Sampler::StartPixelSample(int x, int y, int sample_index) {
+    pixel_key_ = static_cast<uint64_t>(y) * width_ + x;
+    sample_index_ = sample_index;
+    morton_index_ = (EncodeMorton2(x, y) << log2_spp_) | static_cast<uint64_t>(sample_index);
+    dimension_ = 0;
+}
+
+// Sobol' index of the current sample: the Morton index with each base-4 digit permuted by a hash
+// of the digits above it and the dimension. Pixels in every aligned power-of-two block still draw
+// disjoint, stratified parts of the sequence, but in a different order per dimension.
+uint64_t Sampler::ZSobolIndex() const {
+    uint64_t sample_index = 0;
+    // With an odd log2(spp) the lowest digit is base 2
+    const bool pow2_samples = (log2_spp_ & 1) != 0;
+    const int last_digit = pow2_samples ? 1 : 0;
+    const uint64_t dim_salt = 0x55555555ULL * static_cast<uint64_t>(dimension_);
+
+    for (int i = base4_digits_ - 1; i >= last_digit; --i) {
+        int digit_shift = 2 * i - (pow2_samples ? 1 : 0);
+        int digit = static_cast<int>((morton_index_ >> digit_shift) & 3);
+        uint64_t higher_digits = morton_index_ >> (digit_shift + 2);
+        int p = static_cast<int>((SplitMix64(higher_digits ^ dim_salt) >> 24) % 24);
+        digit = kBase4Permutations[p][digit];
+        sample_index |= static_cast<uint64_t>(digit) << digit_shift;
+    }
+
+    if (pow2_samples) {
+        uint64_t digit = morton_index_ & 1;
+        sample_index |= digit ^ (SplitMix64((morton_index_ >> 1) ^ dim_salt) & 1);
+    }
+    return sample_index;
+}
+
+uint64_t Sampler::IndependentHash() const {
+    uint64_t key = SplitMix64(pixel_key_ ^ (static_cast<uint64_t>(seed_) << 40));
+    key = SplitMix64(key ^ static_cast<uint64_t>(sample_index_));
+    return SplitMix64(key ^ static_cast<uint64_t>(dimension_));
+}
+
+float Sampler::Get1D() {
+    if (type_ == SamplerType::Independent) {
+        uint64_t h = IndependentHash();
+        ++dimension_;
+        return BitsToUnitFloat(static_cast<uint32_t>(h >> 32));
+    }
+
+    uint64_t index = ZSobolIndex();
+    ++dimension_;
+    uint32_t scramble = static_cast<uint32_t>(SplitMix64(dimension_ ^ (uint64_t(seed_) << 32)));
+    return BitsToUnitFloat(FastOwenScramble(SobolSampleBits(index, 0), scramble));
+}
+
+Sample2D Sampler::Get2D() {
+    if (type_ == SamplerType::Independent) {
+        uint64_t h = IndependentHash();
+        dimension_ += 2;
+        return {BitsToUnitFloat(static_cast<uint32_t>(h)),
+                BitsToUnitFloat(static_cast<uint32_t>(h >> 32))};
+    }
+
+    uint64_t index = ZSobolIndex();
+    dimension_ += 2;
+    uint64_t scramble = SplitMix64(dimension_ ^ (uint64_t(seed_) << 32));
+    return {BitsToUnitFloat(FastOwenScramble(SobolSampleBits(index, 0),
+                                             static_cast<uint32_t>(scramble))),
+            BitsToUnitFloat(FastOwenScramble(SobolSampleBits(index, 1),
+                                             static_cast<uint32_t>(scramble >> 32)))};
+}
+
+}  // namespace skwr
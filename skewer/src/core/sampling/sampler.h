@@ -0,0 +1,127 @@
+#ifndef SKWR_CORE_SAMPLING_SAMPLER_H_
+#define SKWR_CORE_SAMPLING_SAMPLER_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include "core/math/constants.h"
+#include "core/sampling/sampling.h"
+
+namespace skwr {
+
+enum class SamplerType {
+    Independent,  // Hashed white noise per dimension
+    ZSobol,       // Owen-scrambled Sobol' points over Morton-ordered pixels
+};
+
+/**
+ * Per-dimension sample generator for one path sample.
+ *
+ * A sample is addressed by (pixel, sample index, dimension). StartPixelSample() selects the pixel
+ * and sample, StartBounce() jumps to the fixed block of dimensions owned by a bounce, and each
+ * Get1D()/Get2D() call consumes the next one or two dimensions. Dimensions are assigned by
+ * position rather than by consumption order, so a bounce that skips NEE or hits a medium does
+ * not shift the dimensions seen by later bounces.
+ *
+ * ZSobol (Ahmed & Wonka 2020, as in pbrt-v4) enumerates one global Sobol' sequence along a Morton
+ * curve over the image, with a hashed base-4 digit permutation per dimension. Neighbouring pixels
+ * receive complementary parts of the sequence, so the per-pixel error is distributed as blue
+ * noise. Every dimension uses the first two Sobol' dimensions with its own Owen scramble seed.
+ *
+ * Samplers are small value types; each render thread owns one.
+ */
+class Sampler {
+  public:
+    // Pixel jitter (2), wavelength (1), shutter time (1), lens (2)
+    static constexpr int kCameraDimensions = 6;
+    // Light selection (1), light position (2), BSDF lobe (1), BSDF direction (2)
+    static constexpr int kBounceDimensions = 6;
+
+    // samples_per_pixel bounds the sample indices passed to StartPixelSample(); ZSobol rounds it
+    // up to a power of two.
+    Sampler(SamplerType type, int samples_per_pixel, int width, int height, uint32_t seed = 0);
+
+    void StartPixelSample(int x, int y, int sample_index);
+
+    // Jump to the first dimension of a bounce's block.
+    void StartBounce(int depth) { dimension_ = kCameraDimensions + depth * kBounceDimensions; }
+
+    float Get1D();
+    Sample2D Get2D();
+    // Sub-pixel offset in [0, 1)^2; always the first two dimensions of a sample.
+    Sample2D GetPixel2D() { return Get2D(); }
+
+    SamplerType type() const { return type_; }
+    int samples_per_pixel() const { return samples_per_pixel_; }
+
+  private:
+    uint64_t ZSobolIndex() const;
+    uint64_t IndependentHash() const;
+
+    SamplerType type_;
+    int samples_per_pixel_;
+    int width_;
+    uint32_t seed_;
+
+    // ZSobol layout
+    int log2_spp_ = 0;
+    int base4_digits_ = 0;
+
+    // Current sample
+    uint64_t pixel_key_ = 0;  // Independent: linear pixel id
+    int sample_index_ = 0;
+    uint64_t morton_index_ = 0;
+    int dimension_ = 0;
+};
+
+// Interleave the bits of x (even) and y (odd).
+inline uint64_t EncodeMorton2(uint32_t x, uint32_t y) {
+    auto spread = [](uint64_t v) {
+        v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+        v = (v | (v << 8)) & 0x00ff00ff00ff00ffULL;
+        v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        v = (v | (v << 2)) & 0x3333333333333333ULL;
+        v = (v | (v << 1)) & 0x5555555555555555ULL;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+inline uint32_t ReverseBits32(uint32_t v) {
+    v = (v << 16) | (v >> 16);
+    v = ((v & 0x00ff00ffu) << 8) | ((v & 0xff00ff00u) >> 8);
+    v = ((v & 0x0f0f0f0fu) << 4) | ((v & 0xf0f0f0f0u) >> 4);
+    v = ((v & 0x33333333u) << 2) | ((v & 0xccccccccu) >> 2);
+    v = ((v & 0x55555555u) << 1) | ((v & 0xaaaaaaaau) >> 1);
+    return v;
+}
+
+// Hash-based approximation of a nested uniform (Owen) scramble (Burley 2020, pbrt-v4 variant).
+inline uint32_t FastOwenScramble(uint32_t v, uint32_t seed) {
+    v = ReverseBits32(v);
+    v ^= v * 0x3d20adeau;
+    v += seed;
+    v *= (seed >> 16) | 1u;
+    v ^= v * 0x05526c56u;
+    v ^= v * 0x53a22864u;
+    return ReverseBits32(v);
+}
+
+// Point `index` of Sobol' dimension 0 (van der Corput) or 1, before scrambling.
+inline uint32_t SobolSampleBits(uint64_t index, int dim) {
+    if (dim == 0) return ReverseBits32(static_cast<uint32_t>(index));
+    // Dimension 1: primitive polynomial x + 1, direction numbers v_i = v_{i-1} ^ (v_{i-1} >> 1)
+    uint32_t v = 0;
+    for (uint32_t c = 1u << 31; index != 0; index >>= 1, c ^= c >> 1) {
+        if (index & 1) v ^= c;
+    }
+    return v;
+}
+
+inline float BitsToUnitFloat(uint32_t bits) {
+    return std::min(float(bits) * 0x1p-32f, float(MathConstants::kOneMinusEpsilon));
+}
+
+}  // namespace skwr
+
+#endif  // SKWR_CORE_SAMPLING_SAMPLER_H_
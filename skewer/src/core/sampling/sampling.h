@@ -1,6 +1,8 @@
 #ifndef SKWR_CORE_SAMPLING_SAMPLING_H_
 #define SKWR_CORE_SAMPLING_SAMPLING_H_
 
+#include <cmath>
+
 #include "core/math/constants.h"
 #include "core/math/vec3.h"
 #include "core/sampling/rng.h"
@@ -48,20 +50,56 @@ inline Vec3 RandomInUnitDisk(RNG& rng) {
     }
 }
 
-// Returns a random direction in the Local Frame (Z is up)
+// A pair of canonical uniform samples in [0, 1)^2, as drawn from a Sampler.
+struct Sample2D {
+    float u;
+    float v;
+};
+
+// Maps a uniform sample to a direction in the Local Frame (Z is up)
 // The probability of picking a direction is proportional to Cosine(theta)
+inline Vec3 SampleCosineHemisphere(Sample2D u) {
+    // Standard mapping from unit square to hemisphere
+    float phi = 2.0f * MathConstants::kPi * u.u;
+
+    float x = std::cos(phi) * std::sqrt(u.v);  // Sqrt corrects the density
+    float y = std::sin(phi) * std::sqrt(u.v);
+    float z = std::sqrt(1.0f - u.v);  // This ensures z^2 + r^2 = 1
+
+    return Vec3(x, y, z);
+}
+
+// Returns a random direction in the Local Frame (Z is up), cosine-weighted
 inline Vec3 RandomCosineDirection(RNG& rng) {
     float r1 = rng.UniformFloat();
     float r2 = rng.UniformFloat();
+    return SampleCosineHemisphere({r1, r2});
+}
 
-    // Standard mapping from unit square to hemisphere
-    float phi = 2.0f * MathConstants::kPi * r1;
-
-    float x = std::cos(phi) * std::sqrt(r2);  // Sqrt corrects the density
-    float y = std::sin(phi) * std::sqrt(r2);
-    float z = std::sqrt(1.0f - r2);  // This ensures z^2 + r^2 = 1
+// Concentric (Shirley-Chiu) mapping to the unit disk in the XY plane. Unlike rejection sampling
+// it consumes exactly two dimensions and keeps the stratification of low-discrepancy points.
+inline Vec3 SampleUniformDiskConcentric(Sample2D u) {
+    float ox = 2.0f * u.u - 1.0f;
+    float oy = 2.0f * u.v - 1.0f;
+    if (ox == 0.0f && oy == 0.0f) return Vec3(0.0f, 0.0f, 0.0f);
+
+    float r, theta;
+    if (std::abs(ox) > std::abs(oy)) {
+        r = ox;
+        theta = 0.25f * MathConstants::kPi * (oy / ox);
+    } else {
+        r = oy;
+        theta = 0.5f * MathConstants::kPi - 0.25f * MathConstants::kPi * (ox / oy);
+    }
+    return Vec3(r * std::cos(theta), r * std::sin(theta), 0.0f);
+}
 
-    return Vec3(x, y, z);
+// Uniform direction on the unit sphere
+inline Vec3 SampleUniformSphere(Sample2D u) {
+    float z = 1.0f - 2.0f * u.u;
+    float r = std::sqrt(std::fmax(0.0f, 1.0f - z * z));
+    float phi = 2.0f * MathConstants::kPi * u.v;
+    return Vec3(r * std::cos(phi), r * std::sin(phi), z);
 }
 
 // 64-bit mixing function for RNG seeding
@@ -40,8 +40,8 @@ float rgb2spec_eval_precise(float coeff[RGB2SPEC_N_COEFFS], float lambda);
 /// Evaluate the model for a given wavelength (fast, with recip. square root)
 float rgb2spec_eval_fast(float coeff[RGB2SPEC_N_COEFFS], float lambda);
 
-#if defined(__SSE4_2__)
-/// SSE 4.2 version -- evaluates 4 wavelengths at once
+#if defined(RGB2SPEC_HAS_SIMD)
+/// SSE version -- evaluates 4 wavelengths at once
 __m128 rgb2spec_eval_sse(float coeff[RGB2SPEC_N_COEFFS], __m128 lambda);
 #endif
 
@@ -61,8 +61,29 @@ inline SpectralCurve RGBToCurve(const RGB& color) {
 inline Spectrum CurveToSpectrum(const SpectralCurve& curve, const SampledWavelengths& wl) {
     Spectrum result(0.0f);
     if (curve.scale <= 0.0f) return result;
+    float* coeff = const_cast<float*>(curve.coeff);
+#if defined(__AVX__)
+    if constexpr (kNSamples % 8 == 0) {
+        const __m256 scale = _mm256_set1_ps(curve.scale);
+        for (int i = 0; i < kNSamples; i += 8) {
+            __m256 v = rgb2spec_eval_avx(coeff, _mm256_loadu_ps(&wl.lambda[i]));
+            _mm256_storeu_ps(&result[i], _mm256_mul_ps(v, scale));
+        }
+        return result;
+    }
+#endif
+#if defined(RGB2SPEC_HAS_SIMD)
+    if constexpr (kNSamples % 4 == 0) {
+        const __m128 scale = _mm_set1_ps(curve.scale);
+        for (int i = 0; i < kNSamples; i += 4) {
+            __m128 v = rgb2spec_eval_sse(coeff, _mm_loadu_ps(&wl.lambda[i]));
+            _mm_storeu_ps(&result[i], _mm_mul_ps(v, scale));
+        }
+        return result;
+    }
+#endif
     for (int i = 0; i < kNSamples; ++i) {
-        result[i] = rgb2spec_eval_fast(const_cast<float*>(curve.coeff), wl.lambda[i]) * curve.scale;
+        result[i] = rgb2spec_eval_fast(coeff, wl.lambda[i]) * curve.scale;
     }
     return result;
 }
@@ -7,6 +7,7 @@
 
 #include "core/cpu_config.h"
 #include "core/math/constants.h"
+#include "core/math/simd.h"
 
 namespace skwr {
 
@@ -40,42 +41,37 @@ struct alignas(16) SpectralPacket {
         return false;
     }
 
+    // Arithmetic runs on SSE registers (AVX for 8-wide packets) via simd::Lanewise
     SpectralPacket& operator+=(const SpectralPacket& s) {
-        for (int i = 0; i < NSamples; ++i) values[i] += s.values[i];
+        simd::Lanewise<NSamples>(values.data(), values.data(), s.values.data(),
+                                 [](auto x, auto y) { return x + y; });
         return *this;
     }
     SpectralPacket& operator-=(const SpectralPacket& s) {
-        for (int i = 0; i < NSamples; ++i) {
-            values[i] -= s.values[i];
-        }
+        simd::Lanewise<NSamples>(values.data(), values.data(), s.values.data(),
+                                 [](auto x, auto y) { return x - y; });
         return *this;
     }
     SpectralPacket& operator*=(const SpectralPacket& s) {
-        for (int i = 0; i < NSamples; ++i) {
-            values[i] *= s.values[i];
-        }
+        simd::Lanewise<NSamples>(values.data(), values.data(), s.values.data(),
+                                 [](auto x, auto y) { return x * y; });
         return *this;
     }
     SpectralPacket& operator*=(float a) {
-        for (int i = 0; i < NSamples; ++i) {
-            values[i] *= a;
-        }
+        simd::LanewiseScalar<NSamples>(values.data(), values.data(), a,
+                                       [](auto x, auto y) { return x * y; });
         return *this;
     }
+    // Lanes dividing by (near) zero become 0
     SpectralPacket& operator/=(const SpectralPacket& s) {
-        for (int i = 0; i < NSamples; ++i) {
-            if (std::abs(s.values[i]) > Numeric::kNearZeroEpsilon) {
-                values[i] /= s.values[i];
-            } else {
-                values[i] = 0.0f;
-            }
-        }
+        simd::Lanewise<NSamples>(values.data(), values.data(), s.values.data(), [](auto x, auto y) {
+            return simd::SafeDiv(x, y, Numeric::kNearZeroEpsilon);
+        });
         return *this;
     }
     SpectralPacket& operator/=(float a) {
-        for (int i = 0; i < NSamples; ++i) {
-            values[i] /= a;
-        }
+        simd::LanewiseScalar<NSamples>(values.data(), values.data(), a,
+                                       [](auto x, auto y) { return x / y; });
         return *this;
     }
 
@@ -136,13 +132,7 @@ inline SpectralPacket<NSamples> operator/(SpectralPacket<NSamples> s, float a) {
 
 template <int NSamples>
 inline SpectralPacket<NSamples> operator/(SpectralPacket<NSamples> s, SpectralPacket<NSamples> c) {
-    SpectralPacket<NSamples> result(0.0f);
-    for (int i = 0; i < NSamples; ++i) {
-        if (std::abs(c[i]) > Numeric::kNearZeroEpsilon) {  // Protect against exact 0 and denormals
-            result[i] = s[i] / c[i];
-        }
-    }
-    return result;
+    return s /= c;  // Protects against exact 0 and denormals
 }
 
 template <int N>
@@ -0,0 +1,35 @@
+#ifndef SKWR_CORE_TRANSPORT_RAY_CONE_H_
+#define SKWR_CORE_TRANSPORT_RAY_CONE_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/math/constants.h"
+
+namespace skwr {
+
+/**
+ * Ray cone footprint (Akenine-Möller et al., "Texture Level of Detail Strategies for Real-Time
+ * Ray Tracing"). A path carries the cone's width at the current ray origin and its spread angle;
+ * the width at a hit t along the ray is width + spread * t (small-angle approximation).
+ * Camera rays start with zero width and the pixel spread angle. Glossy and diffuse bounces widen
+ * the spread, so later texture lookups fall to coarser MIP levels.
+ */
+struct RayCone {
+    float width = 0.0f;
+    float spread = 0.0f;
+
+    float WidthAt(float t) const { return std::abs(width + spread * t); }
+
+    // Move the cone origin to a hit at distance t.
+    void Propagate(float t) { width = WidthAt(t); }
+
+    // Widen the cone after scattering off a surface/phase function of the given roughness [0,1].
+    void Scatter(float roughness) {
+        spread += std::clamp(roughness, 0.0f, 1.0f) * RenderConstants::kRayConeRoughSpread;
+    }
+};
+
+}  // namespace skwr
+
+#endif  // SKWR_CORE_TRANSPORT_RAY_CONE_H_
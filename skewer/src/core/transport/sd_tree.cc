@@ -0,0 +1,284 @@
+#include "core/transport/sd_tree.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+#include "core/math/constants.h"
+
+namespace skwr {
+
+namespace {
+
+// Spatial leaves split once they receive more than kSpatialThreshold * sqrt(pass spp) samples
+constexpr float kSpatialThreshold = 12000.0f;
+constexpr int kMaxSpatialDepth = 48;
+// Directional quadrants subdivide while they hold more than this fraction of the leaf's energy
+constexpr float kDTreeThreshold = 0.01f;
+constexpr int kDTreeMaxDepth = 20;
+
+void AtomicAdd(std::atomic<float>& a, float v) {
+    float cur = a.load(std::memory_order_relaxed);
+    while (!a.compare_exchange_weak(cur, cur + v, std::memory_order_relaxed)) {
+    }
+}
+
+// Exponent-bit test, so it still rejects NaN and Inf when built with -ffast-math
+bool IsFiniteBits(float v) { return (std::bit_cast<uint32_t>(v) & 0x7f800000u) != 0x7f800000u; }
+
+float ClampUnit(float v) { return std::clamp(v, 0.0f, MathConstants::kOneMinusEpsilon); }
+
+}  // namespace
+
+Sample2D DirectionToCanonical(const Vec3& dir) {
+    float cos_theta = std::clamp(dir.z(), -1.0f, 1.0f);
+    float phi = std::atan2(dir.y(), dir.x());
+    if (phi < 0.0f) phi += 2.0f * MathConstants::kPi;
+    return {ClampUnit(0.5f * (cos_theta + 1.0f)),
+            ClampUnit(phi * (0.5f * MathConstants::kInvPi))};
+}
+
+Vec3 CanonicalToDirection(Sample2D p) {
+    float cos_theta = 2.0f * p.u - 1.0f;
+    float sin_theta = std::sqrt(std::fmax(0.0f, 1.0f - cos_theta * cos_theta));
+    float phi = 2.0f * MathConstants::kPi * p.v;
+    return Vec3(sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta);
+}
+
+//------------------------------------------------------------------------------
+// DTree
+//------------------------------------------------------------------------------
+
+DTree::Node& DTree::Node::operator=(const Node& other) {
+    for (int q = 0; q < 4; ++q) {
+        sum[q].store(other.sum[q].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    child = other.child;
+    return *this;
+}
+
+float DTree::Node::Total() const {
+    float total = 0.0f;
+    for (int q = 0; q < 4; ++q) total += sum[q].load(std::memory_order_relaxed);
+    return total;
+}
+
+void DTree::Record(Sample2D p, float energy) {
+    uint32_t n = 0;
+    while (true) {
+        int x = p.u >= 0.5f ? 1 : 0;
+        int y = p.v >= 0.5f ? 1 : 0;
+        int q = x + 2 * y;
+        AtomicAdd(nodes_[n].sum[q], energy);
+        uint32_t c = nodes_[n].child[q];
+        if (c == 0) return;
+        p = {2.0f * p.u - static_cast<float>(x), 2.0f * p.v - static_cast<float>(y)};
+        n = c;
+    }
+}
+
+float DTree::Pdf(Sample2D p) const {
+    float pdf = 1.0f;
+    uint32_t n = 0;
+    while (true) {
+        const Node& node = nodes_[n];
+        float total = node.Total();
+        if (!(total > 0.0f)) return pdf;
+        int x = p.u >= 0.5f ? 1 : 0;
+        int y = p.v >= 0.5f ? 1 : 0;
+        int q = x + 2 * y;
+        pdf *= 4.0f * node.sum[q].load(std::memory_order_relaxed) / total;
+        uint32_t c = node.child[q];
+        if (c == 0) return pdf;
+        p = {2.0f * p.u - static_cast<float>(x), 2.0f * p.v - static_cast<float>(y)};
+        n = c;
+    }
+}
+
+Sample2D DTree::Sample(Sample2D u) const {
+    float ox = 0.0f;
+    float oy = 0.0f;
+    float size = 1.0f;
+    uint32_t n = 0;
+    while (true) {
+        const Node& node = nodes_[n];
+        float s[4];
+        for (int q = 0; q < 4; ++q) s[q] = node.sum[q].load(std::memory_order_relaxed);
+        float total = s[0] + s[1] + s[2] + s[3];
+        if (!(total > 0.0f)) break;
+
+        // Pick the column from the marginal, then the row within it, reusing u each time
+        int x, y;
+        float p_left = (s[0] + s[2]) / total;
+        if (u.u < p_left) {
+            x = 0;
+            u.u = ClampUnit(u.u / p_left);
+        } else {
+            x = 1;
+            u.u = ClampUnit((u.u - p_left) / (1.0f - p_left));
+        }
+        float column = s[x] + s[x + 2];
+        float p_bottom = column > 0.0f ? s[x] / column : 0.5f;
+        if (u.v < p_bottom) {
+            y = 0;
+            u.v = ClampUnit(u.v / p_bottom);
+        } else {
+            y = 1;
+            u.v = ClampUnit((u.v - p_bottom) / (1.0f - p_bottom));
+        }
+
+        size *= 0.5f;
+        ox += static_cast<float>(x) * size;
+        oy += static_cast<float>(y) * size;
+        uint32_t c = node.child[x + 2 * y];
+        if (c == 0) break;
+        n = c;
+    }
+    return {ClampUnit(ox + u.u * size), ClampUnit(oy + u.v * size)};
+}
+
+float DTree::Energy() const { return nodes_[0].Total(); }
+
+DTree DTree::Refined(float threshold, int max_depth) const {
+    DTree out;
+    const float total = Energy();
+    if (!(total > 0.0f)) return out;
+
+    struct Work {
+        uint32_t out_node;
+        int64_t in_node;  // -1: region is a leaf quadrant of this tree, energy spread evenly
+        float energy;     // Energy of the region when in_node == -1
+        int depth;
+    };
+    std::vector<Work> stack = {{0, 0, total, 1}};
+    while (!stack.empty()) {
+        Work w = stack.back();
+        stack.pop_back();
+        for (int q = 0; q < 4; ++q) {
+            float e = w.in_node >= 0 ? nodes_[w.in_node].sum[q].load(std::memory_order_relaxed)
+                                     : 0.25f * w.energy;
+            if (!(e / total > threshold) || w.depth >= max_depth) continue;
+
+            int64_t in_child = -1;
+            if (w.in_node >= 0 && nodes_[w.in_node].child[q] != 0) {
+                in_child = nodes_[w.in_node].child[q];
+            }
+            uint32_t c = static_cast<uint32_t>(out.nodes_.size());
+            out.nodes_.emplace_back();
+            out.nodes_[w.out_node].child[q] = c;
+            stack.push_back({c, in_child, e, w.depth + 1});
+        }
+    }
+    return out;
+}
+
+//------------------------------------------------------------------------------
+// SDTree
+//------------------------------------------------------------------------------
+
+SDTree::SDTree(const BoundBox& bounds) : nodes_(1), leaves_(1) {
+    // Cubic bounds so spatial splits alternate over equally sized axes
+    Point3 lo = bounds.IsValid() ? bounds.min() : Point3(-1.0f, -1.0f, -1.0f);
+    Vec3 d = bounds.IsValid() ? bounds.Diagonal() : Vec3(2.0f, 2.0f, 2.0f);
+    float extent = std::fmax(std::fmax(d.x(), d.y()), std::fmax(d.z(), 1e-4f)) * 1.001f;
+    bounds_ = BoundBox(lo, lo + Vec3(extent, extent, extent));
+    inv_extent_ = Vec3(1.0f / extent, 1.0f / extent, 1.0f / extent);
+}
+
+int SDTree::LeafIndex(const Point3& p) const {
+    float q[3];
+    for (int a = 0; a < 3; ++a) {
+        q[a] = std::clamp((p[a] - bounds_.min()[a]) * inv_extent_[a], 0.0f, 1.0f);
+    }
+    uint32_t n = 0;
+    while (nodes_[n].child[0] != 0) {
+        const Node& node = nodes_[n];
+        float& c = q[node.axis];
+        if (c < 0.5f) {
+            c *= 2.0f;
+            n = node.child[0];
+        } else {
+            c = 2.0f * c - 1.0f;
+            n = node.child[1];
+        }
+    }
+    return static_cast<int>(nodes_[n].leaf);
+}
+
+float SDTree::Pdf(int leaf, const Vec3& dir) const {
+    return leaves_[leaf].sampling.Pdf(DirectionToCanonical(dir)) * (0.25f * MathConstants::kInvPi);
+}
+
+Vec3 SDTree::Sample(int leaf, Sample2D u) const {
+    return CanonicalToDirection(leaves_[leaf].sampling.Sample(u));
+}
+
+void SDTree::Record(int leaf, const Vec3& dir, float radiance_over_pdf) {
+    if (!training_) return;
+    Leaf& l = leaves_[leaf];
+    l.samples.fetch_add(1, std::memory_order_relaxed);
+    if (IsFiniteBits(radiance_over_pdf) && radiance_over_pdf > 0.0f) {
+        l.building.Record(DirectionToCanonical(dir), radiance_over_pdf);
+    }
+}
+
+void SDTree::SplitLeaf(uint32_t node_index, int depth) {
+    const uint32_t leaf0 = nodes_[node_index].leaf;
+    leaves_[leaf0].samples.store(leaves_[leaf0].samples.load() / 2);
+    Leaf copy = leaves_[leaf0];
+    leaves_.push_back(std::move(copy));
+    const uint32_t leaf1 = static_cast<uint32_t>(leaves_.size() - 1);
+
+    const uint32_t first_child = static_cast<uint32_t>(nodes_.size());
+    nodes_[node_index].axis = static_cast<uint8_t>(depth % 3);
+    nodes_[node_index].child[0] = first_child;
+    nodes_[node_index].child[1] = first_child + 1;
+    Node c0;
+    c0.leaf = leaf0;
+    Node c1;
+    c1.leaf = leaf1;
+    nodes_.push_back(c0);
+    nodes_.push_back(c1);
+}
+
+void SDTree::Refine(int pass_spp) {
+    const uint32_t threshold = static_cast<uint32_t>(
+        kSpatialThreshold * std::sqrt(static_cast<float>(std::max(pass_spp, 1))));
+
+    // Spatial: split busy leaves, halving their counts until every leaf is under the threshold
+    std::vector<std::pair<uint32_t, int>> stack = {{0, 0}};
+    while (!stack.empty()) {
+        auto [n, depth] = stack.back();
+        stack.pop_back();
+        if (nodes_[n].child[0] == 0) {
+            if (leaves_[nodes_[n].leaf].samples.load() <= threshold || depth >= kMaxSpatialDepth) {
+                continue;
+            }
+            SplitLeaf(n, depth);
+        }
+        stack.push_back({nodes_[n].child[0], depth + 1});
+        stack.push_back({nodes_[n].child[1], depth + 1});
+    }
+
+    // Directional: what was learned this pass becomes the sampling distribution
+    for (Leaf& leaf : leaves_) {
+        leaf.sampling = leaf.building;
+        leaf.building = leaf.building.Refined(kDTreeThreshold, kDTreeMaxDepth);
+        leaf.samples.store(0);
+    }
+    ++iterations_;
+}
+
+//------------------------------------------------------------------------------
+// GuidingPathRecorder
+//------------------------------------------------------------------------------
+
+void GuidingPathRecorder::Flush(SDTree* tree) const {
+    for (const GuidingVertex& v : vertices_) {
+        if (!v.closed || !(v.pdf > 0.0f)) continue;
+        tree->Record(v.leaf, v.dir, v.radiance.Average() / v.pdf);
+    }
+}
+
+}  // namespace skwr
@@ -0,0 +1,175 @@
+#ifndef SKWR_CORE_TRANSPORT_SD_TREE_H_
+#define SKWR_CORE_TRANSPORT_SD_TREE_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "core/math/vec3.h"
+#include "core/sampling/sampling.h"
+#include "core/spectral/spectrum.h"
+#include "geometry/boundbox.h"
+
+namespace skwr {
+
+// Equal-area mapping between unit directions and [0, 1)^2: u = (cos theta + 1) / 2, v = phi / 2pi.
+// A density p over the square is a density of p / 4pi over solid angle.
+Sample2D DirectionToCanonical(const Vec3& dir);
+Vec3 CanonicalToDirection(Sample2D p);
+
+/**
+ * Directional quadtree over the canonical square, storing the energy (incident radiance over
+ * sampling pdf) recorded in every quadrant. Sampling descends the tree picking quadrants in
+ * proportion to their energy, so the resulting density is piecewise constant on the leaves.
+ *
+ * Record() only performs atomic adds and may run concurrently with other Record(), Sample() and
+ * Pdf() calls. The node layout itself only changes in Refined(), between render passes.
+ */
+class DTree {
+  public:
+    DTree() : nodes_(1) {}
+
+    void Record(Sample2D p, float energy);
+
+    // Density over the canonical square (1 everywhere for an empty tree).
+    float Pdf(Sample2D p) const;
+    Sample2D Sample(Sample2D u) const;
+
+    float Energy() const;
+    bool IsEmpty() const { return !(Energy() > 0.0f); }
+    size_t NodeCount() const { return nodes_.size(); }
+
+    // A new, empty tree whose leaves are subdivided until each holds at most `threshold` of this
+    // tree's energy (or max_depth is reached).
+    DTree Refined(float threshold, int max_depth) const;
+
+  private:
+    struct Node {
+        std::array<std::atomic<float>, 4> sum{};  // Energy per quadrant (x + 2y)
+        std::array<uint32_t, 4> child{};          // 0 = quadrant is a leaf
+
+        Node() = default;
+        Node(const Node& other) { *this = other; }
+        Node& operator=(const Node& other);
+
+        float Total() const;
+    };
+
+    std::vector<Node> nodes_;  // nodes_[0] is the root
+};
+
+/**
+ * Spatial-directional radiance cache for path guiding ("Practical Path Guiding", Mueller et al.
+ * 2017). A binary kd-tree over the scene bounds stores, per leaf, a DTree to sample from (trained
+ * in the previous pass) and a DTree being trained in the current pass.
+ *
+ * Render threads call LeafIndex(), Sample(), Pdf() and Record() concurrently during a pass.
+ * Refine() must run between passes with no render threads active: it splits leaves that received
+ * many samples, promotes each training DTree to sampling and starts a refined, empty one.
+ */
+class SDTree {
+  public:
+    explicit SDTree(const BoundBox& bounds);
+
+    int LeafIndex(const Point3& p) const;
+
+    // Solid-angle density of Sample() for direction dir at a leaf.
+    float Pdf(int leaf, const Vec3& dir) const;
+    Vec3 Sample(int leaf, Sample2D u) const;
+
+    // Adds one radiance sample (incident radiance along dir over the pdf it was sampled with).
+    void Record(int leaf, const Vec3& dir, float radiance_over_pdf);
+
+    // pass_spp is the sample count of the pass just finished; larger passes need more samples
+    // per leaf before a spatial split.
+    void Refine(int pass_spp);
+
+    // True once at least one pass has been recorded and promoted to sampling.
+    bool IsTrained() const { return iterations_ > 0; }
+    // Recording is ignored while training is off (e.g. during the final pass).
+    void SetTraining(bool training) { training_ = training; }
+    bool IsTraining() const { return training_; }
+
+    size_t LeafCount() const { return leaves_.size(); }
+
+  private:
+    struct Node {
+        uint32_t child[2] = {0, 0};  // 0 = leaf
+        uint32_t leaf = 0;           // Index into leaves_ when this node is a leaf
+        uint8_t axis = 0;
+    };
+
+    struct Leaf {
+        DTree sampling;
+        DTree building;
+        std::atomic<uint32_t> samples{0};
+
+        Leaf() = default;
+        Leaf(const Leaf& other)
+            : sampling(other.sampling),
+              building(other.building),
+              samples(other.samples.load(std::memory_order_relaxed)) {}
+    };
+
+    // Turn a leaf node into an inner node whose two children share the leaf's DTrees.
+    void SplitLeaf(uint32_t node_index, int depth);
+
+    BoundBox bounds_;
+    Vec3 inv_extent_;
+    std::vector<Node> nodes_;
+    std::vector<Leaf> leaves_;
+    int iterations_ = 0;
+    bool training_ = true;
+};
+
+/**
+ * Collects the guided vertices of one path and their incident radiance, then records them into
+ * an SDTree when the path ends (like DeepPathRecorder, one per Li call).
+ */
+class GuidingPathRecorder {
+  public:
+    explicit GuidingPathRecorder(int max_depth) { vertices_.reserve(max_depth); }
+
+    // A vertex that scattered towards dir with the given pdf. Its throughput is set by
+    // CloseVertex() once the bounce (including Russian roulette) has been applied.
+    void AppendVertex(int leaf, const Vec3& dir, float pdf) {
+        GuidingVertex v;
+        v.leaf = leaf;
+        v.dir = dir;
+        v.pdf = pdf;
+        vertices_.push_back(v);
+    }
+
+    void CloseVertex(const Spectrum& throughput) {
+        if (!vertices_.empty() && !vertices_.back().closed) {
+            vertices_.back().throughput = throughput;
+            vertices_.back().closed = true;
+        }
+    }
+
+    // contribution is what was just added to the path radiance (beta * L).
+    void AddRadiance(const Spectrum& contribution) {
+        for (GuidingVertex& v : vertices_) {
+            if (v.closed) v.radiance += contribution / v.throughput;
+        }
+    }
+
+    void Flush(SDTree* tree) const;
+
+  private:
+    struct GuidingVertex {
+        int leaf;
+        Vec3 dir;
+        float pdf;
+        Spectrum throughput = Spectrum(1.0f);  // Path throughput just after this vertex
+        Spectrum radiance = Spectrum(0.0f);    // Incident radiance along dir
+        bool closed = false;
+    };
+
+    std::vector<GuidingVertex> vertices_;
+};
+
+}  // namespace skwr
+
+#endif  // SKWR_CORE_TRANSPORT_SD_TREE_H_
@@ -10,6 +10,9 @@
 
 namespace skwr {
 
+// object_id of hits that do not belong to an instance or sphere (legacy flattened mesh BVH)
+constexpr uint32_t kNoObjectId = 0xFFFFFFFFu;
+
 // "Surface Interaction" is basically a beefed up HitRecord
 // It's a "fat" data struct that's calculated immediately
 struct SurfaceInteraction {
@@ -18,6 +21,7 @@ struct SurfaceInteraction {
     Vec3 wo;       // Outgoing direction (points to Camera/viewer)
     float t;       // Distance along ray
     uint32_t material_id;
+    uint32_t object_id = kNoObjectId;  // Instance index, then static spheres, then animated ones
     int32_t light_index = -1;
     uint16_t exterior_medium;
     uint16_t interior_medium;
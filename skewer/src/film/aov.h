@@ -0,0 +1,81 @@
+#ifndef SKWR_FILM_AOV_H_
+#define SKWR_FILM_AOV_H_
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "core/color/color.h"
+#include "core/math/vec3.h"
+
+namespace skwr {
+
+// Utility passes the film can store next to the beauty image, written as extra flat EXR channels.
+enum class AOVType : uint8_t {
+    Depth,       // Distance of the first hit along the camera axis
+    Normal,      // World-space shading normal of the first hit
+    Albedo,      // First-hit albedo (white for dielectrics)
+    MaterialId,  // Cryptomatte-style float hash of the first-hit material
+    ObjectId,    // Same for the object (instance or sphere)
+    Motion,      // Screen-space motion of the first hit from shutter open to close, in pixels
+};
+
+constexpr size_t kAOVTypeCount = 6;
+
+// How samples combine into a pixel value
+enum class AOVFilter : uint8_t {
+    Average,  // Weighted mean over all samples of the pixel (misses count as 0)
+    Min,      // Nearest value; pixels no sample hit keep kFarClip
+    First,    // Value of the first sample that hit; IDs must not be blended
+};
+
+struct AOVInfo {
+    const char* name;  // Name in the scene file
+    int channels;
+    AOVFilter filter;
+    std::array<const char*, 3> channel_names;  // EXR channel names
+};
+
+inline const AOVInfo& GetAOVInfo(AOVType type) {
+    static constexpr std::array<AOVInfo, kAOVTypeCount> kInfo = {{
+        {"depth", 1, AOVFilter::Min, {"Z", nullptr, nullptr}},
+        {"normal", 3, AOVFilter::Average, {"N.X", "N.Y", "N.Z"}},
+        {"albedo", 3, AOVFilter::Average, {"albedo.R", "albedo.G", "albedo.B"}},
+        {"material_id", 1, AOVFilter::First, {"materialId", nullptr, nullptr}},
+        {"object_id", 1, AOVFilter::First, {"objectId", nullptr, nullptr}},
+        {"motion", 2, AOVFilter::Average, {"motion.X", "motion.Y", nullptr}},
+    }};
+    return kInfo[static_cast<size_t>(type)];
+}
+
+// Hashes an id to a float the way Cryptomatte does (MurmurHash3 finalizer, exponent kept away
+// from 0 and 255 so the value is never 0, denormal, Inf or NaN). Ids are numeric, so the hashes
+// are stable for a scene but carry no name manifest.
+inline float HashIdToFloat(uint32_t id) {
+    uint32_t h = id + 1;
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    const uint32_t exponent = (h >> 23) & 0xffU;
+    if (exponent == 0 || exponent == 0xffU) h ^= 1U << 23;
+    return std::bit_cast<float>(h);
+}
+
+// First surface hit of a camera path: everything the AOVs are derived from
+struct FirstHit {
+    Point3 point;
+    Point3 point_open;   // The same surface point at shutter open and close (for motion)
+    Point3 point_close;
+    Vec3 normal;
+    RGB albedo;
+    float depth;
+    uint32_t material_id;
+    uint32_t object_id;
+};
+
+}  // namespace skwr
+
+#endif  // SKWR_FILM_AOV_H_
@@ -0,0 +1,232 @@
+#include "film/denoiser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace skwr {
+
+namespace {
+
+// Rows filtered per work item, and columns weighted per inner step
+constexpr int kBandRows = 16;
+constexpr int kChunk = 256;
+// Distance given to neighbours outside the image; exp(-d) of it is 0
+constexpr float kOutsideDistance = 1e4f;
+// Keeps the colour distance finite where no variance was measured
+constexpr float kVarianceEpsilon = 1e-4f;
+
+// e^-x for x >= 0: 2^floor from the exponent bits and a polynomial for the fraction. No
+// branches or libm calls, so the loops using it vectorise.
+inline float FastExpNeg(float x) {
+    float t = -1.44269504f * std::min(x, 80.0f);
+    float i = std::floor(t);
+    float f = t - i;
+    float p = 1.0f + f * (0.69314718f + f * (0.24022651f + f * (0.05550411f + f * 0.00961813f)));
+    uint32_t e = static_cast<uint32_t>(static_cast<int32_t>(i) + 127);
+    return std::bit_cast<float>(e << 23) * p;
+}
+
+// Per-thread buffers, reused across bands
+struct BandScratch {
+    std::vector<float> dist;  // Per-pixel colour distance, halo rows
+    std::vector<float> hbox;  // dist summed over the patch width, halo rows
+    std::vector<float> vbox;  // hbox summed over the patch height, one row
+    std::array<std::vector<float>, 4> acc;  // Weighted colour sums and weight sum, band rows
+};
+
+void FilterBand(const DenoiseImage& img, const DenoiseOptions& opts, int y0, int y1,
+                BandScratch& s, std::array<std::vector<float>, 3>& out) {
+    const int w = img.width;
+    const int h = img.height;
+    const int f = std::max(0, opts.patch_radius);
+    const int r = std::max(0, opts.search_radius);
+    const int hy0 = std::max(0, y0 - f);
+    const int hy1 = std::min(h, y1 + f);
+    const size_t halo_size = static_cast<size_t>(hy1 - hy0) * w;
+    const size_t band_size = static_cast<size_t>(y1 - y0) * w;
+
+    const float k2 = opts.strength * opts.strength;
+    const float inv_patch = 1.0f / static_cast<float>((2 * f + 1) * (2 * f + 1));
+    const float inv_albedo = 1.0f / std::max(opts.albedo_sigma * opts.albedo_sigma, 1e-8f);
+    const float inv_normal = 1.0f / std::max(opts.normal_sigma * opts.normal_sigma, 1e-8f);
+
+    s.dist.resize(halo_size);
+    s.hbox.resize(halo_size);
+    s.vbox.resize(w);
+    for (std::vector<float>& a : s.acc) a.assign(band_size, 0.0f);
+
+    for (int dy = -r; dy <= r; ++dy) {
+        for (int dx = -r; dx <= r; ++dx) {
+            // Columns whose neighbour (x + dx) is inside the image
+            const int x_lo = std::max(0, -dx);
+            const int x_hi = std::min(w, w - dx);
+            if (x_lo >= x_hi) continue;
+
+            // 1. Variance-normalised colour distance to the neighbour, for every halo pixel
+            for (int y = hy0; y < hy1; ++y) {
+                float* d = &s.dist[static_cast<size_t>(y - hy0) * w];
+                const int qy = y + dy;
+                if (qy < 0 || qy >= h) {
+                    std::fill(d, d + w, kOutsideDistance);
+                    continue;
+                }
+                std::fill(d, d + x_lo, kOutsideDistance);
+                std::fill(d + x_hi, d + w, kOutsideDistance);
+                std::fill(d + x_lo, d + x_hi, 0.0f);
+
+                const size_t p_row = static_cast<size_t>(y) * w;
+                const size_t q_row = static_cast<size_t>(qy) * w;
+                for (int c = 0; c < 3; ++c) {
+                    const float* cp = img.color[c].data() + p_row;
+                    const float* cq = img.color[c].data() + q_row;
+                    const float* vp = img.variance[c].data() + p_row;
+                    const float* vq = img.variance[c].data() + q_row;
+                    for (int x = x_lo; x < x_hi; ++x) {
+                        float diff = cp[x] - cq[x + dx];
+                        float var_p = vp[x];
+                        float var_q = vq[x + dx];
+                        // Subtracting the variances cancels the expected noise in diff^2
+                        d[x] += (diff * diff - (var_p + std::min(var_p, var_q))) /
+                                (kVarianceEpsilon + k2 * (var_p + var_q));
+                    }
+                }
+                for (int x = x_lo; x < x_hi; ++x) d[x] *= (1.0f / 3.0f);
+            }
+
+            // 2. Sum over the patch width (clamped at the image edges)
+            for (size_t row = 0; row < halo_size; row += w) {
+                const float* d = &s.dist[row];
+                float* hb = &s.hbox[row];
+                const int inner_lo = std::min(f, w);
+                const int inner_hi = std::max(inner_lo, w - f);
+                std::fill(hb + inner_lo, hb + inner_hi, 0.0f);
+                for (int k = -f; k <= f; ++k) {
+                    for (int x = inner_lo; x < inner_hi; ++x) hb[x] += d[x + k];
+                }
+                for (int x = 0; x < w; ++x) {
+                    if (x >= inner_lo && x < inner_hi) continue;
+                    float sum = 0.0f;
+                    for (int k = -f; k <= f; ++k) sum += d[std::clamp(x + k, 0, w - 1)];
+                    hb[x] = sum;
+                }
+            }
+
+            // 3. Sum over the patch height, then weight and accumulate the neighbour
+            for (int y = y0; y < y1; ++y) {
+                const int qy = y + dy;
+                if (qy < 0 || qy >= h) continue;
+
+                float* vb = s.vbox.data();
+                std::fill(vb + x_lo, vb + x_hi, 0.0f);
+                for (int k = -f; k <= f; ++k) {
+                    const int hy = std::clamp(y + k, hy0, hy1 - 1);
+                    const float* hb = &s.hbox[static_cast<size_t>(hy - hy0) * w];
+                    for (int x = x_lo; x < x_hi; ++x) vb[x] += hb[x];
+                }
+
+                const size_t p = static_cast<size_t>(y) * w;
+                const size_t q = static_cast<size_t>(qy) * w + dx;
+                const size_t a_row = static_cast<size_t>(y - y0) * w;
+                const float* ar_p = img.albedo[0].data() + p;
+                const float* ag_p = img.albedo[1].data() + p;
+                const float* ab_p = img.albedo[2].data() + p;
+                const float* ar_q = img.albedo[0].data() + q;
+                const float* ag_q = img.albedo[1].data() + q;
+                const float* ab_q = img.albedo[2].data() + q;
+                const float* nx_p = img.normal[0].data() + p;
+                const float* ny_p = img.normal[1].data() + p;
+                const float* nz_p = img.normal[2].data() + p;
+                const float* nx_q = img.normal[0].data() + q;
+                const float* ny_q = img.normal[1].data() + q;
+                const float* nz_q = img.normal[2].data() + q;
+
+                // Weights go to a stack chunk first: with a single loop writing four heap rows
+                // while reading fifteen, GCC needs too many alias checks and stays scalar.
+                for (int x0 = x_lo; x0 < x_hi; x0 += kChunk) {
+                    const int n = std::min(kChunk, x_hi - x0);
+                    float wgt[kChunk];
+                    for (int i = 0; i < n; ++i) {
+                        const int x = x0 + i;
+                        float ea_r = ar_p[x] - ar_q[x];
+                        float ea_g = ag_p[x] - ag_q[x];
+                        float ea_b = ab_p[x] - ab_q[x];
+                        float en_x = nx_p[x] - nx_q[x];
+                        float en_y = ny_p[x] - ny_q[x];
+                        float en_z = nz_p[x] - nz_q[x];
+                        float da = ea_r * ea_r + ea_g * ea_g + ea_b * ea_b;
+                        float dn = en_x * en_x + en_y * en_y + en_z * en_z;
+                        float patch = std::max(0.0f, vb[x] * inv_patch);
+                        wgt[i] = FastExpNeg(patch + da * inv_albedo + dn * inv_normal);
+                    }
+                    for (int c = 0; c < 3; ++c) {
+                        const float* cq = img.color[c].data() + q + x0;
+                        float* acc = s.acc[c].data() + a_row + x0;
+                        for (int i = 0; i < n; ++i) acc[i] += wgt[i] * cq[i];
+                    }
+                    float* acc_w = s.acc[3].data() + a_row + x0;
+                    for (int i = 0; i < n; ++i) acc_w[i] += wgt[i];
+                }
+            }
+        }
+    }
+
+    // The centre offset always has weight 1, so acc_w >= 1
+    const size_t out_row = static_cast<size_t>(y0) * w;
+    for (int c = 0; c < 3; ++c) {
+        const float* acc = s.acc[c].data();
+        const float* acc_w = s.acc[3].data();
+        float* dst = out[c].data() + out_row;
+        for (size_t i = 0; i < band_size; ++i) dst[i] = acc[i] / acc_w[i];
+    }
+}
+
+}  // namespace
+
+DenoiseImage::DenoiseImage(int w, int h) : width(w), height(h) {
+    const size_t n = static_cast<size_t>(std::max(w, 0)) * std::max(h, 0);
+    for (int c = 0; c < 3; ++c) {
+        color[c].assign(n, 0.0f);
+        variance[c].assign(n, 0.0f);
+        albedo[c].assign(n, 0.0f);
+        normal[c].assign(n, 0.0f);
+    }
+}
+
+std::array<std::vector<float>, 3> Denoise(const DenoiseImage& image, const DenoiseOptions& opts) {
+    std::array<std::vector<float>, 3> out;
+    for (std::vector<float>& plane : out) plane.assign(image.color[0].size(), 0.0f);
+    if (image.width <= 0 || image.height <= 0) return out;
+
+    const int band_count = (image.height + kBandRows - 1) / kBandRows;
+    int thread_count = opts.num_threads;
+    if (thread_count <= 0) {
+        thread_count = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    thread_count = std::clamp(thread_count, 1, band_count);
+
+    std::atomic<int> next_band(0);
+    auto worker = [&]() {
+        BandScratch scratch;
+        while (true) {
+            const int band = next_band.fetch_add(1);
+            if (band >= band_count) break;
+            const int y0 = band * kBandRows;
+            const int y1 = std::min(image.height, y0 + kBandRows);
+            FilterBand(image, opts, y0, y1, scratch, out);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < thread_count; ++t) threads.emplace_back(worker);
+    worker();
+    for (std::thread& t : threads) t.join();
+    return out;
+}
+
+}  // namespace skwr
@@ -0,0 +1,46 @@
+#ifndef SKWR_FILM_DENOISER_H_
+#define SKWR_FILM_DENOISER_H_
+
+#include <array>
+#include <vector>
+
+namespace skwr {
+
+struct DenoiseOptions {
+    int search_radius = 7;       // Half-size of the window searched for similar pixels
+    int patch_radius = 1;        // Half-size of the patches compared by the colour term
+    float strength = 0.5f;       // Scales the variance tolerated in the colour distance
+    float albedo_sigma = 0.1f;   // Albedo distance at which a neighbour's weight falls to 1/e
+    float normal_sigma = 0.25f;  // Same for normals
+    int num_threads = 0;         // 0 = auto-detect (hardware_concurrency)
+};
+
+// Planar (one array per channel) filter input, so the inner loops run over contiguous rows.
+struct DenoiseImage {
+    DenoiseImage(int w, int h);
+
+    int width;
+    int height;
+    std::array<std::vector<float>, 3> color;     // Pixel estimate (mean of the samples)
+    std::array<std::vector<float>, 3> variance;  // Variance of that mean, per channel
+    std::array<std::vector<float>, 3> albedo;    // First-hit albedo
+    std::array<std::vector<float>, 3> normal;    // First-hit shading normal
+};
+
+/**
+ * Non-local means filter guided by per-pixel variance and first-hit albedo/normal features
+ * (Rousselle et al. 2012, with the feature edge stops of cross-bilateral filtering).
+ *
+ * For every offset in the search window, a per-pixel colour distance normalised by the sample
+ * variance is box-filtered over the patch, turned into a weight together with the albedo and
+ * normal distances, and accumulated. Working one offset at a time keeps every step a branch-free
+ * loop over contiguous rows, so the compiler vectorises them; rows are split into bands that are
+ * filtered on separate threads.
+ *
+ * Returns the filtered colour planes.
+ */
+std::array<std::vector<float>, 3> Denoise(const DenoiseImage& image, const DenoiseOptions& opts);
+
+}  // namespace skwr
+
+#endif  // SKWR_FILM_DENOISER_H_
@@ -3,6 +3,7 @@
 #include <exrio/deep_writer.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cmath>
 #include <cstdint>
@@ -18,6 +19,7 @@
 #include "core/progress_config.h"
 #include "core/transport/deep_segment.h"
 #include "film/deep_bucket.h"
+#include "film/denoiser.h"
 #include "film/image_buffer.h"
 
 namespace skwr {
@@ -32,7 +34,9 @@ inline DeepAlphaClass ClassifyAlpha(float alpha) {
 
 }  // namespace
 
-Film::Film(int width, int height) : width_(width), height_(height), pixels_(width_ * height_) {}
+Film::Film(int width, int height) : width_(width), height_(height), pixels_(width_ * height_) {
+    aov_index_.fill(-1);
+}
 
 void Film::AddSample(int x, int y, const RGB& L, float alpha, float weight) {
     Pixel& p = GetPixel(x, y);
@@ -41,6 +45,7 @@ void Film::AddSample(int x, int y, const RGB& L, float alpha, float weight) {
     p.alpha_sum += alpha * weight;
     p.weight_sum += weight;
     ++p.sample_count;
+    p.color_sq_sum += L * L * weight;  // Denoiser variance estimate
 }
 
 void Film::AddAdaptiveSample(int x, int y, const RGB& L, float alpha, float weight) {
@@ -75,6 +80,99 @@ bool Film::IsPixelConverged(int x, int y, float noise_threshold) const {
     return noise / std::max(mean_lum, 0.5f) < noise_threshold;
 }
 
+float Film::PixelLuminance(int x, int y) const {
+    const Pixel& p = pixels_[y * width_ + x];
+    if (p.weight_sum <= 0.0f) return 0.0f;
+    RGB mean = p.color_sum / p.weight_sum;
+    return Rec709::kWeightRed * mean.r() + Rec709::kWeightGreen * mean.g() +
+           Rec709::kWeightBlue * mean.b();
+}
+
+void Film::EnableAOV(AOVType type) {
+    if (HasAOV(type)) return;
+    const AOVInfo& info = GetAOVInfo(type);
+    AOVPlane plane;
+    plane.type = type;
+    plane.channels = info.channels;
+    plane.filter = info.filter;
+    const float init = info.filter == AOVFilter::Min ? RenderConstants::kFarClip : 0.0f;
+    plane.data.assign(pixels_.size() * info.channels, init);
+    aov_index_[static_cast<size_t>(type)] = static_cast<int8_t>(aovs_.size());
+    aovs_.push_back(std::move(plane));
+}
+
+void Film::AddAOVSample(int x, int y, AOVType type, const float* values, float weight) {
+    const int idx = aov_index_[static_cast<size_t>(type)];
+    if (idx < 0) return;
+    AOVPlane& plane = aovs_[idx];
+    float* dst = &plane.data[(static_cast<size_t>(y) * width_ + x) * plane.channels];
+    switch (plane.filter) {
+        case AOVFilter::Average:
+            for (int c = 0; c < plane.channels; ++c) dst[c] += values[c] * weight;
+            break;
+        case AOVFilter::Min:
+            for (int c = 0; c < plane.channels; ++c) dst[c] = std::min(dst[c], values[c]);
+            break;
+        case AOVFilter::First:
+            // Hashed ids are never 0, so 0 marks a pixel no sample has hit yet
+            if (dst[0] == 0.0f) {
+                for (int c = 0; c < plane.channels; ++c) dst[c] = values[c];
+            }
+            break;
+    }
+}
+
+float Film::GetAOV(int x, int y, AOVType type, int channel) const {
+    const int idx = aov_index_[static_cast<size_t>(type)];
+    if (idx < 0) return 0.0f;
+    const AOVPlane& plane = aovs_[idx];
+    const size_t pixel = static_cast<size_t>(y) * width_ + x;
+    const float v = plane.data[pixel * plane.channels + channel];
+    if (plane.filter != AOVFilter::Average) return v;
+    const float w = pixels_[pixel].weight_sum;
+    return w > 0.0f ? v / w : 0.0f;
+}
+
+DenoiseImage Film::CreateDenoiseImage() const {
+    DenoiseImage img(width_, height_);
+    for (size_t i = 0; i < pixels_.size(); ++i) {
+        const Pixel& p = pixels_[i];
+        if (!(p.weight_sum > 0.0f)) continue;
+
+        const float inv_w = 1.0f / p.weight_sum;
+        const RGB mean = p.color_sum * inv_w;
+        const RGB mean_sq = p.color_sq_sum * inv_w;
+        // Variance of the mean: the sample variance (E[L^2] - E[L]^2) * n / (n - 1), over n
+        const float n = static_cast<float>(p.sample_count);
+        const float var_scale = n > 1.0f ? 1.0f / (n - 1.0f) : 0.0f;
+        for (int c = 0; c < 3; ++c) {
+            img.color[c][i] = mean[c];
+            img.variance[c][i] = std::max(0.0f, mean_sq[c] - mean[c] * mean[c]) * var_scale;
+        }
+    }
+
+    // Feature planes stay at zero when the AOVs are disabled
+    for (int y = 0; y < height_; ++y) {
+        for (int x = 0; x < width_; ++x) {
+            const size_t i = static_cast<size_t>(y) * width_ + x;
+            for (int c = 0; c < 3; ++c) {
+                img.albedo[c][i] = GetAOV(x, y, AOVType::Albedo, c);
+                img.normal[c][i] = GetAOV(x, y, AOVType::Normal, c);
+            }
+        }
+    }
+    return img;
+}
+
+void Film::Denoise(const DenoiseOptions& opts) {
+    std::array<std::vector<float>, 3> filtered = skwr::Denoise(CreateDenoiseImage(), opts);
+    for (size_t i = 0; i < pixels_.size(); ++i) {
+        Pixel& p = pixels_[i];
+        if (!(p.weight_sum > 0.0f)) continue;
+        p.color_sum = RGB(filtered[0][i], filtered[1][i], filtered[2][i]) * p.weight_sum;
+    }
+}
+
 void Film::AddDeepSample(int x, int y,
                          const BoundedArray<DeepSegment, kMaxDeepSegments>& segments) {
     if (segments.empty()) return;
@@ -323,7 +421,22 @@ void Film::WriteImage(const std::string& filename) const {
     }
 
     if (filename.ends_with(".exr")) {
-        exrio::writeFlatEXR(rgba, width_, height_, filename);
+        std::vector<exrio::FlatChannel> aov_channels;
+        for (const AOVPlane& plane : aovs_) {
+            const AOVInfo& info = GetAOVInfo(plane.type);
+            for (int c = 0; c < plane.channels; ++c) {
+                exrio::FlatChannel ch;
+                ch.name = info.channel_names[c];
+                ch.data.resize(static_cast<size_t>(width_) * height_);
+                for (int y = 0; y < height_; ++y) {
+                    for (int x = 0; x < width_; ++x) {
+                        ch.data[static_cast<size_t>(y) * width_ + x] = GetAOV(x, y, plane.type, c);
+                    }
+                }
+                aov_channels.push_back(std::move(ch));
+            }
+        }
+        exrio::writeFlatEXR(rgba, width_, height_, filename, aov_channels);
         std::cout << "Wrote flat EXR to " << filename << "\n";
     } else {
         exrio::writePNG(rgba, width_, height_, filename);
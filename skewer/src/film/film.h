@@ -3,7 +3,9 @@
 
 #include <exrio/deep_image.h>
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -13,7 +15,9 @@
 #include "core/cpu_config.h"
 #include "core/math/constants.h"
 #include "core/transport/deep_segment.h"
+#include "film/aov.h"
 #include "film/deep_bucket.h"
+#include "film/denoiser.h"
 #include "film/image_buffer.h"
 
 namespace skwr {
@@ -52,9 +56,30 @@ class Film {
     // convergence check, should called every adaptive_step samples.
     bool IsPixelConverged(int x, int y, float noise_threshold) const;
 
+    // Rec. 709 luminance of the pixel's running mean; 0 before its first sample.
+    float PixelLuminance(int x, int y) const;
+
+    // AOVs are off until enabled, and should be enabled before rendering starts.
+    void EnableAOV(AOVType type);
+    bool HasAOVs() const { return !aovs_.empty(); }
+    bool HasAOV(AOVType type) const { return aov_index_[static_cast<size_t>(type)] >= 0; }
+
+    // values holds GetAOVInfo(type).channels floats. No-op when the AOV is disabled.
+    void AddAOVSample(int x, int y, AOVType type, const float* values, float weight);
+
+    // Resolved pixel value of one AOV channel (0 when the AOV is disabled).
+    float GetAOV(int x, int y, AOVType type, int channel) const;
+
+    // Per-pixel mean, variance of the mean, and mean albedo/normal, laid out for Denoise().
+    DenoiseImage CreateDenoiseImage() const;
+
+    // Replaces the accumulated color with its denoised version. Alpha, AOVs and deep buckets
+    // are left as they are, so this only affects the flat outputs.
+    void Denoise(const DenoiseOptions& opts);
+
     void AddDeepSample(int x, int y, const BoundedArray<DeepSegment, kMaxDeepSegments>& segments);
 
-    // Saves to disk (PNG, EXR)
+    // Saves to disk (PNG, EXR). Enabled AOVs become extra channels of the EXR.
     void WriteImage(const std::string& filename) const;
 
     // Debug: writes a heatmap PNG showing sample count per pixel.
@@ -84,8 +109,19 @@ class Film {
     // ready to hand to exrio. Applies the back-to-front true_opacity pass.
     void BuildPixelDeepSamples(const Pixel& p, std::vector<exrio::DeepSample>& out) const;
 
+    // One enabled AOV: its channels interleaved per pixel, as running sums (Average) or the
+    // current value (Min, First).
+    struct AOVPlane {
+        AOVType type;
+        int channels;
+        AOVFilter filter;
+        std::vector<float> data;
+    };
+
     int width_, height_;
     std::vector<Pixel> pixels_;
+    std::vector<AOVPlane> aovs_;
+    std::array<int8_t, kAOVTypeCount> aov_index_;  // Index into aovs_, -1 = disabled
     std::size_t forced_evictions_ = 0;
 };
 
@@ -3,15 +3,22 @@
 
 #include "core/containers/bounded_array.h"
 #include "core/cpu_config.h"
+#include "core/math/vec3.h"
 #include "core/transport/deep_segment.h"
+#include "core/transport/surface_interaction.h"
+#include "film/aov.h"
 #include "film/film.h"
+#include "scene/camera.h"
 
 namespace skwr {
 
 class SampleWriter {
   public:
-    SampleWriter(Film* film, int x, int y, float weight, bool is_adaptive, bool enable_deep)
+    // camera is only needed for the motion AOV; without it motion is written as zero.
+    SampleWriter(Film* film, int x, int y, float weight, bool is_adaptive, bool enable_deep,
+                 const Camera* camera = nullptr)
         : film_(film),
+          camera_(camera),
           x_(x),
           y_(y),
           sample_weight_(weight),
@@ -26,11 +33,48 @@ class SampleWriter {
         }
     }
 
-    // TODO: add AOV system, or individual WriteAlbedo, WriteNormals, etc
-    // inline void WriteAOV(int aov_type, const RGB& value) const {
-    //         // Assuming your film has an AOV system. If not, this is how you'd hook it up.
-    //         film->AddAOVSample(x, y, aov_type, value, sample_weight);
-    //     }
+    // Luminance of the pixel's samples so far; the reference for efficiency roulette
+    inline float PixelEstimate() const { return film_->PixelLuminance(x_, y_); }
+
+    // Whether the kernel should fill a FirstHit for this sample at all
+    inline bool WantsFirstHit() const { return film_->HasAOVs(); }
+    inline bool WantsAOV(AOVType type) const { return film_->HasAOV(type); }
+
+    // Derives every enabled AOV from the camera path's first surface hit. Samples that miss
+    // write nothing, which counts as zero for averaged AOVs.
+    inline void WriteFirstHit(const FirstHit& hit) const {
+        if (film_->HasAOV(AOVType::Depth)) {
+            film_->AddAOVSample(x_, y_, AOVType::Depth, &hit.depth, sample_weight_);
+        }
+        if (film_->HasAOV(AOVType::Normal)) {
+            const float n[3] = {hit.normal.x(), hit.normal.y(), hit.normal.z()};
+            film_->AddAOVSample(x_, y_, AOVType::Normal, n, sample_weight_);
+        }
+        if (film_->HasAOV(AOVType::Albedo)) {
+            const float a[3] = {hit.albedo.r(), hit.albedo.g(), hit.albedo.b()};
+            film_->AddAOVSample(x_, y_, AOVType::Albedo, a, sample_weight_);
+        }
+        if (film_->HasAOV(AOVType::MaterialId)) {
+            const float id = HashIdToFloat(hit.material_id);
+            film_->AddAOVSample(x_, y_, AOVType::MaterialId, &id, sample_weight_);
+        }
+        if (film_->HasAOV(AOVType::ObjectId) && hit.object_id != kNoObjectId) {
+            const float id = HashIdToFloat(hit.object_id);
+            film_->AddAOVSample(x_, y_, AOVType::ObjectId, &id, sample_weight_);
+        }
+        if (film_->HasAOV(AOVType::Motion)) {
+            // Pixels moved from shutter open to close, x right and y down like the image
+            float m[2] = {0.0f, 0.0f};
+            float s0, t0, s1, t1;
+            if (camera_ != nullptr &&
+                camera_->Project(hit.point_open, camera_->ShutterOpen(), &s0, &t0) &&
+                camera_->Project(hit.point_close, camera_->ShutterClose(), &s1, &t1)) {
+                m[0] = (s1 - s0) * static_cast<float>(film_->width());
+                m[1] = (t0 - t1) * static_cast<float>(film_->height());
+            }
+            film_->AddAOVSample(x_, y_, AOVType::Motion, m, sample_weight_);
+        }
+    }
 
     inline void PushDeepSegment(float z_front, float z_back, const RGB& final_rgb, float alpha) {
         deep_segments_.push_back({z_front, z_back, final_rgb, alpha});
@@ -44,6 +88,7 @@ class SampleWriter {
 
   private:
     Film* film_;
+    const Camera* camera_;
     int x_;
     int y_;
     float sample_weight_;
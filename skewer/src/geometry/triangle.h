@@ -18,7 +18,7 @@ struct Triangle {
     uint16_t interior_medium;
     uint16_t exterior_medium;
     uint16_t priority;
-    bool needs_tangent_frame = false;  // True only when material uses a normal map
+    bool needs_tangent_frame = false;  // True only when material uses textures
 };
 
 }  // namespace skwr
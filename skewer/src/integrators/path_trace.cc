@@ -1,17 +1,30 @@
 #include "integrators/path_trace.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
+#include <memory>
+#include <numeric>
 #include <thread>
 #include <vector>
 
 #include "barkeep.h"
+#include "core/cpu_config.h"
+#include "core/math/constants.h"
 #include "core/progress_config.h"
+#include "core/ray.h"
+#include "core/sampling/rng.h"
+#include "core/sampling/sampler.h"
 #include "core/sampling/sampling.h"
 #include "core/sampling/wavelength_sampler.h"
 #include "core/spectral/spectrum.h"
+#include "core/transport/ray_cone.h"
+#include "core/transport/sd_tree.h"
 #include "film/film.h"
 #include "film/sample_writer.h"
 #include "kernels/path_kernel.h"
+#include "materials/material.h"
+#include "materials/texture_lookup.h"
 #include "scene/camera.h"
 #include "scene/light.h"
 #include "scene/scene.h"
@@ -21,6 +34,31 @@ namespace bk = barkeep;
 
 namespace skwr {
 
+namespace {
+
+// Sort key of a camera ray's first hit: material type, then material id. Misses and null
+// materials have nothing to shade and sort last.
+constexpr uint64_t kUnshadedKey = UINT64_MAX;
+
+uint64_t ShadingSortKey(const Scene& scene, const PrimaryHit& primary) {
+    if (!primary.hit || primary.si.material_id == kNullMaterialId) return kUnshadedKey;
+    const Material& mat = scene.GetMaterial(primary.si.material_id);
+    return (static_cast<uint64_t>(mat.type) << 32) | primary.si.material_id;
+}
+
+// One camera sample of a tile pixel in material-sorted mode
+struct SortedSample {
+    int pixel;  // Index into the tile, row-major
+    float u_wavelength;
+    Ray ray;
+    RayCone cone;
+    Vec3 forward;
+    uint64_t key;
+    PrimaryHit primary;
+};
+
+}  // namespace
+
 void PathTrace::Render(const Scene& scene, const Camera& cam, Film* film,
                        const IntegratorConfig& config) {
     int width = film->width();
@@ -43,12 +81,37 @@ void PathTrace::Render(const Scene& scene, const Camera& cam, Film* film,
     std::cout << "[Session] Rendering with " << thread_count << " threads, " << tile_size << "x"
               << tile_size << " tiles (" << total_tiles << " total)...\n";
 
+    // Sample passes. Without path guiding one pass renders every sample. With guiding, the first
+    // quarter of the budget is split into doubling training passes (1, 2, 4, ... spp) that each
+    // refine the SD-tree; the remaining samples are rendered with the last trained tree.
+    struct SamplePass {
+        int begin;  // First sample index, relative to config.start_sample
+        int count;
+    };
+    std::vector<SamplePass> passes;
+    std::unique_ptr<SDTree> guide;
+    int training_passes = 0;
+    if (config.path_guiding) {
+        guide = std::make_unique<SDTree>(scene.Bounds());
+        const int budget = config.max_samples / 4;
+        int done = 0;
+        for (int spp = 1; done + spp <= budget; spp *= 2) {
+            passes.push_back({done, spp});
+            done += spp;
+        }
+        training_passes = static_cast<int>(passes.size());
+        if (done < config.max_samples) passes.push_back({done, config.max_samples - done});
+    } else {
+        passes.push_back({0, config.max_samples});
+    }
+
     std::atomic<int> next_tile(0);
     std::atomic<int> tiles_completed(0);
 
     const auto progress_mode = GetProgressOutputMode();
+    const int total_work = total_tiles * static_cast<int>(passes.size());
     auto bar = bk::ProgressBar(&tiles_completed, {
-                                                     .total = total_tiles,
+                                                     .total = total_work,
                                                      .speed = 0.2,
                                                      .speed_unit = "tiles/s",
                                                      .style = progress_mode.style,
@@ -61,8 +124,135 @@ void PathTrace::Render(const Scene& scene, const Camera& cam, Film* film,
     const int step = config.adaptive_step;
     std::atomic<long long> total_samples_rendered(0);
 
-    // Worker function — each thread grabs tiles dynamically
-    auto render_thread = [&]() {
+    // Worker function — each thread grabs tiles dynamically. Convergence is only checked in the
+    // final pass so training passes see every pixel.
+    auto render_thread = [&](SamplePass pass, bool final_pass) {
+        // Sample indices run over [start_sample, start_sample + max_samples) for every pixel. The
+        // ZSobol layout depends on that total, so splitting one job into sample chunks would need
+        // every chunk sized for the whole job; nothing renders in sample chunks yet.
+        Sampler sampler(config.sampler, config.start_sample + config.max_samples, width, height);
+        CameraRayBlock block;
+        float u_wavelength[CameraRayBlock::kCapacity];
+
+        // Material-sorted mode works on waves: one sample of every pixel of the tile that is
+        // still sampling. A wave is traced to its first hits, the hits are ordered by material
+        // and their shading data resolved a material at a time, then Li() continues the paths
+        // in that order. Every pixel keeps its own RNG and takes its samples in order, so the
+        // samples are the ones the pixel-order loop below would take.
+        std::vector<RNG> pixel_rngs;
+        std::vector<int> pixel_taken;
+        std::vector<int> pixel_next_check;
+        std::vector<int> active;
+        std::vector<SortedSample> wave;
+        std::vector<uint32_t> order;
+        auto render_tile_sorted = [&](int x0, int y0, int x1, int y1) -> long long {
+            const int tile_w = x1 - x0;
+            const int pixel_count = tile_w * (y1 - y0);
+            const int first_sample = config.start_sample + pass.begin;
+            const uint16_t global_med = scene.GetGlobalMedium();
+
+            pixel_rngs.resize(pixel_count);
+            pixel_taken.assign(pixel_count, pass.begin);
+            pixel_next_check.assign(pixel_count, std::max(min_s, pass.begin + 1));
+            active.resize(pixel_count);
+            for (int p = 0; p < pixel_count; ++p) {
+                const int x = x0 + p % tile_w;
+                const int y = y0 + p / tile_w;
+                pixel_rngs[p] = MakeDeterministicPixelRNG(x, y, width, first_sample);
+                active[p] = p;
+            }
+
+            for (int s = 0; s < pass.count && !active.empty(); ++s) {
+                const int sample_index = first_sample + s;
+                const int wave_size = static_cast<int>(active.size());
+                wave.resize(wave_size);
+
+                // 1. Camera rays
+                for (int b0 = 0; b0 < wave_size; b0 += CameraRayBlock::kCapacity) {
+                    block.count = std::min(CameraRayBlock::kCapacity, wave_size - b0);
+                    for (int i = 0; i < block.count; ++i) {
+                        const int p = active[b0 + i];
+                        const int x = x0 + p % tile_w;
+                        const int y = y0 + p / tile_w;
+                        sampler.StartPixelSample(x, y, sample_index);
+                        Sample2D jitter = sampler.GetPixel2D();
+                        block.s[i] = (float(x) + jitter.u) / width;
+                        block.t[i] = 1.0f - (float(y) + jitter.v) / height;
+                        wave[b0 + i].u_wavelength = sampler.Get1D();
+                        block.u_time[i] = sampler.Get1D();
+                        Sample2D u_lens = sampler.Get2D();
+                        block.lens_u[i] = u_lens.u;
+                        block.lens_v[i] = u_lens.v;
+                    }
+                    cam.GenerateRays(&block);
+                    for (int i = 0; i < block.count; ++i) {
+                        SortedSample& w = wave[b0 + i];
+                        w.pixel = active[b0 + i];
+                        w.ray = block.GetRay(i);
+                        if (global_med != 0) w.ray.vol_stack().Push(global_med, 0);
+                        w.cone = block.Cone(i);
+                        w.forward = block.Forward(i);
+                    }
+                }
+
+                // 2. First hits, ordered by material (ties by pixel, for a stable order)
+                for (SortedSample& w : wave) {
+                    w.primary.hit = scene.Intersect(w.ray, RenderConstants::kRayOffsetEpsilon,
+                                                    MathConstants::kFloatInfinity, &w.primary.si);
+                    w.key = ShadingSortKey(scene, w.primary);
+                }
+                order.resize(wave_size);
+                std::iota(order.begin(), order.end(), 0u);
+                std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                    return wave[a].key != wave[b].key ? wave[a].key < wave[b].key : a < b;
+                });
+
+                // 3. Shading data, one material at a time
+                for (size_t b0 = 0; b0 < order.size();) {
+                    const uint64_t key = wave[order[b0]].key;
+                    if (key == kUnshadedKey) break;
+                    const uint32_t material_id = wave[order[b0]].primary.si.material_id;
+                    const Material& mat = scene.GetMaterial(material_id);
+                    for (; b0 < order.size() && wave[order[b0]].key == key; ++b0) {
+                        PrimaryHit& primary = wave[order[b0]].primary;
+                        const float width_at_hit = wave[order[b0]].cone.WidthAt(primary.si.t);
+                        primary.sd = ResolveShadingData(mat, primary.si, scene, width_at_hit);
+                    }
+                }
+
+                // 4. The paths, in material order
+                for (uint32_t i : order) {
+                    SortedSample& w = wave[i];
+                    const int x = x0 + w.pixel % tile_w;
+                    const int y = y0 + w.pixel / tile_w;
+                    sampler.StartPixelSample(x, y, sample_index);
+                    SampledWavelengths wl = WavelengthSampler::Sample(w.u_wavelength);
+                    SampleWriter writer(film, x, y, 1.0f, is_adaptive, config.enable_deep, &cam);
+                    Li(w.ray, w.cone, scene, sampler, pixel_rngs[w.pixel], guide.get(), config,
+                       w.forward, wl, writer, &w.primary);
+                }
+
+                // 5. Convergence, at the same sample counts as the pixel-order loop
+                size_t still_active = 0;
+                for (int p : active) {
+                    const int taken = ++pixel_taken[p];
+                    if (is_adaptive && final_pass && taken == pixel_next_check[p]) {
+                        if (film->IsPixelConverged(x0 + p % tile_w, y0 + p / tile_w,
+                                                   config.noise_threshold)) {
+                            continue;
+                        }
+                        pixel_next_check[p] += step;
+                    }
+                    active[still_active++] = p;
+                }
+                active.resize(still_active);
+            }
+
+            long long tile_samples = 0;
+            for (int taken : pixel_taken) tile_samples += taken - pass.begin;
+            return tile_samples;
+        };
+
         while (true) {
             int tile_idx = next_tile.fetch_add(1);
             if (tile_idx >= total_tiles) break;
@@ -74,43 +264,75 @@ void PathTrace::Render(const Scene& scene, const Camera& cam, Film* film,
             int x1 = std::min(x0 + tile_size, width);
             int y1 = std::min(y0 + tile_size, height);
 
+            if (config.material_sort) {
+                total_samples_rendered.fetch_add(render_tile_sorted(x0, y0, x1, y1));
+                tiles_completed.fetch_add(1);
+                continue;
+            }
+
             long long tile_samples = 0;
 
             for (int y = y0; y < y1; ++y) {
                 for (int x = x0; x < x1; ++x) {
-                    RNG rng = MakeDeterministicPixelRNG(x, y, width, config.start_sample);
+                    const int first_sample = config.start_sample + pass.begin;
+                    RNG rng = MakeDeterministicPixelRNG(x, y, width, first_sample);
 
                     uint16_t global_med = scene.GetGlobalMedium();
-                    int next_check = min_s;
-                    int samples_taken = 0;
-
-                    for (int s = 0; s < config.max_samples; ++s) {
-                        float u = (float(x) + rng.UniformFloat()) / width;
-                        float v = 1.0f - (float(y) + rng.UniformFloat()) / height;
-
-                        SampledWavelengths wl = WavelengthSampler::Sample(rng.UniformFloat());
-                        Vec3 primary_cam_w;
-                        Ray r = cam.GetRay(u, v, rng, &primary_cam_w);
-
-                        if (global_med != 0) {
-                            // Global medium usually has priority 0 so bounded media can override it
-                            r.vol_stack().Push(global_med, 0);
+                    // samples_taken counts earlier passes too, as the film does
+                    int next_check = std::max(min_s, pass.begin + 1);
+                    int samples_taken = pass.begin;
+
+                    // Camera rays are generated a block of samples at a time. Each sample's
+                    // camera dimensions are drawn first; the sampler is restarted on the sample
+                    // before tracing it, since Li() only uses the per-bounce dimensions.
+                    bool converged = false;
+                    for (int s0 = 0; s0 < pass.count && !converged; s0 += block.count) {
+                        int count = std::min(CameraRayBlock::kCapacity, pass.count - s0);
+                        if (is_adaptive && final_pass) {
+                            count = std::clamp(next_check - samples_taken, 1, count);
+                        }
+                        block.count = count;
+                        for (int i = 0; i < count; ++i) {
+                            sampler.StartPixelSample(x, y, first_sample + s0 + i);
+                            Sample2D jitter = sampler.GetPixel2D();
+                            block.s[i] = (float(x) + jitter.u) / width;
+                            block.t[i] = 1.0f - (float(y) + jitter.v) / height;
+                            u_wavelength[i] = sampler.Get1D();
+                            block.u_time[i] = sampler.Get1D();
+                            Sample2D u_lens = sampler.Get2D();
+                            block.lens_u[i] = u_lens.u;
+                            block.lens_v[i] = u_lens.v;
                         }
+                        cam.GenerateRays(&block);
+
+                        for (int i = 0; i < count; ++i) {
+                            sampler.StartPixelSample(x, y, first_sample + s0 + i);
+                            SampledWavelengths wl = WavelengthSampler::Sample(u_wavelength[i]);
+                            Ray r = block.GetRay(i);
+                            if (global_med != 0) {
+                                // Global medium usually has priority 0 so bounded media can
+                                // override it
+                                r.vol_stack().Push(global_med, 0);
+                            }
 
-                        SampleWriter writer(film, x, y, 1.0f, is_adaptive, config.enable_deep);
+                            SampleWriter writer(film, x, y, 1.0f, is_adaptive, config.enable_deep,
+                                                &cam);
 
-                        Li(r, scene, rng, config, primary_cam_w, wl, writer);
+                            Li(r, block.Cone(i), scene, sampler, rng, guide.get(), config,
+                               block.Forward(i), wl, writer);
 
-                        samples_taken++;
+                            samples_taken++;
 
-                        if (is_adaptive && samples_taken == next_check) {
-                            if (film->IsPixelConverged(x, y, config.noise_threshold)) {
-                                break;
+                            if (is_adaptive && final_pass && samples_taken == next_check) {
+                                if (film->IsPixelConverged(x, y, config.noise_threshold)) {
+                                    converged = true;
+                                    break;
+                                }
+                                next_check += step;
                             }
-                            next_check += step;
                         }
                     }
-                    tile_samples += samples_taken;
+                    tile_samples += samples_taken - pass.begin;
                 }
             }
 
@@ -121,18 +343,32 @@ void PathTrace::Render(const Scene& scene, const Camera& cam, Film* film,
 
     bar->show();
 
-    // Launch worker threads
-    std::vector<std::thread> threads;
-    for (int t = 0; t < thread_count; ++t) {
-        threads.emplace_back(render_thread);
-    }
+    for (size_t p = 0; p < passes.size(); ++p) {
+        const bool training = static_cast<int>(p) < training_passes;
+        if (guide) guide->SetTraining(training);
+        next_tile = 0;
+
+        // Launch worker threads
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back(render_thread, passes[p], p + 1 == passes.size());
+        }
+
+        // Wait for all threads to complete
+        for (auto& thread : threads) {
+            thread.join();
+        }
 
-    // Wait for all threads to complete
-    for (auto& thread : threads) {
-        thread.join();
+        // No thread touches the tree between passes, so it can be restructured here
+        if (training) guide->Refine(passes[p].count);
     }
 
     bar->done();
+
+    if (guide) {
+        std::cout << "[Session] Path guiding: " << training_passes << " training passes, "
+                  << guide->LeafCount() << " spatial cells\n";
+    }
 }
 
 }  // namespace skwr
@@ -22,7 +22,7 @@ namespace skwr {
 // Helper: load a texture from an .mtl texture name if non-empty.
 // Returns kNoTexture if the name is empty or load fails.
 static uint32_t LoadMtlTexture(const std::string& texname, const std::string& base_path,
-                               Scene& scene) {
+                               Scene& scene, TextureUsage usage = TextureUsage::Color) {
     if (texname.empty()) return kNoTexture;
 
     std::string filepath;
@@ -33,7 +33,10 @@ static uint32_t LoadMtlTexture(const std::string& texname, const std::string& ba
     }
 
     ImageTexture tex;
-    if (!tex.Load(filepath)) return kNoTexture;
+    bool loaded = scene.texture_cache() ? tex.LoadCached(filepath, scene.texture_cache(), usage)
+                                        : tex.Load(filepath, usage);
+    if (!loaded) return kNoTexture;
+    if (usage == TextureUsage::Color && scene.precompute_texture_curves()) tex.PrecomputeCurves();
 
     return scene.AddTexture(std::move(tex));
 }
@@ -48,11 +51,12 @@ Material ConvertObjMaterial(const tinyobj::material_t& mtl, Scene& scene,
         mat.albedo = RGBToCurve(RGB(mtl.diffuse[0], mtl.diffuse[1], mtl.diffuse[2]));
         mat.roughness = std::max(0.0f, std::min(1.0f, mtl.roughness * 0.5f));
         mat.albedo_tex = LoadMtlTexture(mtl.diffuse_texname, base_path, scene);
-        mat.roughness_tex = LoadMtlTexture(mtl.roughness_texname, base_path, scene);
+        mat.roughness_tex =
+            LoadMtlTexture(mtl.roughness_texname, base_path, scene, TextureUsage::Scalar);
         {
             const std::string& n =
                 mtl.normal_texname.empty() ? mtl.bump_texname : mtl.normal_texname;
-            mat.normal_tex = LoadMtlTexture(n, base_path, scene);
+            mat.normal_tex = LoadMtlTexture(n, base_path, scene, TextureUsage::Data);
         }
         return mat;
     }
@@ -78,7 +82,7 @@ Material ConvertObjMaterial(const tinyobj::material_t& mtl, Scene& scene,
         {
             const std::string& n =
                 mtl.normal_texname.empty() ? mtl.bump_texname : mtl.normal_texname;
-            mat.normal_tex = LoadMtlTexture(n, base_path, scene);
+            mat.normal_tex = LoadMtlTexture(n, base_path, scene, TextureUsage::Data);
         }
         return mat;
     }
@@ -99,9 +103,10 @@ Material ConvertObjMaterial(const tinyobj::material_t& mtl, Scene& scene,
     mat.albedo_tex = LoadMtlTexture(mtl.diffuse_texname, base_path, scene);
     {
         const std::string& n = mtl.normal_texname.empty() ? mtl.bump_texname : mtl.normal_texname;
-        mat.normal_tex = LoadMtlTexture(n, base_path, scene);
+        mat.normal_tex = LoadMtlTexture(n, base_path, scene, TextureUsage::Data);
     }
-    mat.roughness_tex = LoadMtlTexture(mtl.roughness_texname, base_path, scene);
+    mat.roughness_tex =
+        LoadMtlTexture(mtl.roughness_texname, base_path, scene, TextureUsage::Scalar);
 
     return mat;
 }
@@ -17,6 +17,7 @@
 #include "core/math/vec3.h"
 #include "core/spectral/spectral_curve.h"
 #include "core/spectral/spectral_utils.h"
+#include "film/aov.h"
 #include "geometry/sphere.h"
 #include "io/graph_from_json.h"
 #include "io/obj_loader.h"
@@ -208,6 +209,19 @@ static MediaMap ParseMedia(const json& j, Scene& scene, const std::string& scene
                 throw std::runtime_error("Failed to load NanoVDB: " + filepath);
             }
 
+            // Residual ratio tracking control: a density value, or "auto" for the lowest active
+            // density of each majorant cell
+            if (m.contains("control_density") && m["control_density"].is_string()) {
+                std::string mode = m["control_density"].get<std::string>();
+                if (mode != "auto") {
+                    throw std::runtime_error("Invalid control_density for medium '" + name +
+                                             "': " + mode);
+                }
+                med.auto_control = true;
+            } else {
+                med.control_density = GetOr(m, "control_density", 0.0f) * med.density_multiplier;
+            }
+
             uint16_t id = scene.AddNanoVDBMedium(std::move(med));
             media_map[name] = id;
         } else {
@@ -228,7 +242,8 @@ using MaterialMap = std::map<std::string, uint32_t>;
 // Resolves relative paths against scene_dir.
 // Returns kNoTexture if the string is empty or load fails.
 static uint32_t LoadSceneTexture(const json& m, const std::string& key,
-                                 const std::string& scene_dir, Scene& scene) {
+                                 const std::string& scene_dir, Scene& scene,
+                                 TextureUsage usage = TextureUsage::Color) {
     if (!m.contains(key)) return kNoTexture;
 
     std::string texpath = m[key].get<std::string>();
@@ -237,7 +252,10 @@ static uint32_t LoadSceneTexture(const json& m, const std::string& key,
     std::string filepath = ResolvePath(texpath, scene_dir);
 
     ImageTexture tex;
-    if (!tex.Load(filepath)) return kNoTexture;
+    bool loaded = scene.texture_cache() ? tex.LoadCached(filepath, scene.texture_cache(), usage)
+                                        : tex.Load(filepath, usage);
+    if (!loaded) return kNoTexture;
+    if (usage == TextureUsage::Color && scene.precompute_texture_curves()) tex.PrecomputeCurves();
 
     return scene.AddTexture(std::move(tex));
 }
@@ -284,8 +302,10 @@ static MaterialMap ParseMaterials(const json& j, Scene& scene, const std::string
 
         // Optional texture maps (paths resolved relative to scene file directory)
         mat.albedo_tex = LoadSceneTexture(m, "albedo_texture", scene_dir, scene);
-        mat.normal_tex = LoadSceneTexture(m, "normal_texture", scene_dir, scene);
-        mat.roughness_tex = LoadSceneTexture(m, "roughness_texture", scene_dir, scene);
+        mat.normal_tex =
+            LoadSceneTexture(m, "normal_texture", scene_dir, scene, TextureUsage::Data);
+        mat.roughness_tex = LoadSceneTexture(m, "roughness_texture", scene_dir, scene,
+                                             TextureUsage::Scalar);
 
         uint32_t id = scene.AddMaterial(mat);
         mat_map[name] = id;
@@ -506,6 +526,14 @@ static void ParseGraph(const json& j, const MaterialMap& mat_map, const MediaMap
 // Render Options Parsing
 //------------------------------------------------------------------------------
 
+static AOVType ParseAOVType(const std::string& str) {
+    for (size_t i = 0; i < kAOVTypeCount; ++i) {
+        AOVType type = static_cast<AOVType>(i);
+        if (str == GetAOVInfo(type).name) return type;
+    }
+    throw std::runtime_error("Unknown AOV type: " + str);
+}
+
 static RenderOptions ParseRenderOptions(const json& j) {
     RenderOptions opts{};
 
@@ -540,12 +568,35 @@ static RenderOptions ParseRenderOptions(const json& j) {
         opts.integrator_config.max_depth = GetOr(r, "max_depth", 50);
         opts.integrator_config.num_threads = GetOr(r, "threads", 0);
         opts.integrator_config.enable_deep = GetOr(r, "enable_deep", false);
+        opts.integrator_config.path_guiding = GetOr(r, "path_guiding", false);
+        opts.integrator_config.material_sort = GetOr(r, "material_sort", false);
+        opts.integrator_config.denoise = GetOr(r, "denoise", false);
         if (r.contains("transparent_background")) {
             opts.integrator_config.transparent_background = r["transparent_background"].get<bool>();
         }
         opts.integrator_config.visibility_depth = GetOr(r, "visibility_depth", 1);
         opts.integrator_config.tile_size = GetOr(r, "tile_size", 32);
 
+        std::string sampler_str = GetOr<std::string>(r, "sampler", "zsobol");
+        if (sampler_str == "zsobol") {
+            opts.integrator_config.sampler = SamplerType::ZSobol;
+        } else if (sampler_str == "independent") {
+            opts.integrator_config.sampler = SamplerType::Independent;
+        } else {
+            throw std::runtime_error("Unknown sampler type: " + sampler_str);
+        }
+
+        std::string roulette_str = GetOr<std::string>(r, "roulette", "throughput");
+        if (roulette_str == "throughput") {
+            opts.integrator_config.roulette = RouletteMode::Throughput;
+        } else if (roulette_str == "efficiency") {
+            opts.integrator_config.roulette = RouletteMode::Efficiency;
+        } else {
+            throw std::runtime_error("Unknown roulette type: " + roulette_str);
+        }
+        opts.integrator_config.roulette_window = GetOr(r, "roulette_window", 0.25f);
+        opts.integrator_config.split_factor = GetOr(r, "split_factor", 1);
+
         // Adaptive sampling
         opts.integrator_config.noise_threshold = GetOr(r, "noise_threshold", 0.0f);
         opts.integrator_config.min_samples = GetOr(r, "min_samples", 1);
@@ -559,6 +610,11 @@ static RenderOptions ParseRenderOptions(const json& j) {
             opts.image_config.height = GetOr(img, "height", 450);
             opts.image_config.outfile = GetOr<std::string>(img, "outfile", "output.png");
             opts.image_config.exrfile = GetOr<std::string>(img, "exrfile", "output.exr");
+            if (img.contains("aovs")) {
+                for (const auto& name : img["aovs"]) {
+                    opts.image_config.aovs.push_back(ParseAOVType(name.get<std::string>()));
+                }
+            }
         }
     }
 
@@ -723,6 +779,8 @@ SceneConfig LoadSceneFile(const std::string& filepath) {
 
     // Output directory (local path or cloud URI — used as-is, not resolved)
     config.output_dir = GetOr<std::string>(j, "output_dir", "");
+    config.texture_cache_mb = GetOr<size_t>(j, "texture_cache_mb", 0);
+    config.spectral_textures = GetOr(j, "spectral_textures", false);
 
     if (j.contains("skybox")) {
         config.skybox = ParseSkybox(j.at("skybox"), scene_dir);
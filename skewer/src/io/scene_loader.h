@@ -84,6 +84,15 @@ struct SceneConfig {
 
     // Optional finite, non-lighting background box.
     std::optional<Skybox> skybox;
+
+    // Texture cache budget in MiB. 0 keeps every texture fully decoded in memory; > 0 loads
+    // textures lazily as tiles and evicts least recently used tiles beyond the budget.
+    size_t texture_cache_mb = 0;
+
+    // Precompute rgb2spec coefficients per texel for albedo textures so shading interpolates
+    // coefficients instead of converting RGB on every hit. Costs 16 bytes per texel; ignored for
+    // textures served by the texture cache.
+    bool spectral_textures = false;
 };
 
 // Load a scene.json file. Parses camera, context refs, and layer refs.
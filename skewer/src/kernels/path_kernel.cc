@@ -1,20 +1,29 @@
 #include "kernels/path_kernel.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <cstdlib>
 
+#include "core/containers/bounded_array.h"
 #include "core/cpu_config.h"
 #include "core/math/constants.h"
 #include "core/math/vec3.h"
 #include "core/ray.h"
 #include "core/sampling/rng.h"
+#include "core/sampling/sampler.h"
 #include "core/sampling/sampling.h"
 #include "core/spectral/spectral_utils.h"
 #include "core/spectral/spectrum.h"
 #include "core/transport/deep_path_recorder.h"
 #include "core/transport/medium_interaction.h"
+#include "core/transport/ray_cone.h"
+#include "core/transport/sd_tree.h"
 #include "core/transport/surface_interaction.h"
+#include "film/aov.h"
 #include "film/sample_writer.h"
 #include "kernels/utils/direct_lighting.h"
+#include "kernels/utils/roulette.h"
 #include "kernels/utils/visibility.h"
 #include "kernels/utils/volume_tracking.h"
 #include "kernels/volume_dispatch.h"
@@ -28,6 +37,52 @@
 
 namespace skwr {
 
+namespace {
+
+// Share of guided directions in the one-sample MIS mixture with the BSDF
+constexpr float kGuidingFraction = 0.5f;
+
+// Most paths the first diffuse vertex can split into (IntegratorConfig::split_factor)
+constexpr int kMaxSplitFactor = 8;
+
+// Path state right after a scattering event; also a branch waiting to be traced
+struct PathBranch {
+    Ray r;
+    RayCone cone;
+    Spectrum beta;
+    float prev_scatter_pdf;
+    float ray_t;
+    int depth;  // Of the vertex the branch leaves
+    int vis_checks;
+    bool specular_bounce;
+    bool is_camera_path;
+};
+
+// One-sample MIS between the SD-tree and the BSDF: u_lobe picks the technique, and the sample is
+// weighted by the mixture pdf so either choice is unbiased. Only used for Lambertian surfaces,
+// the one lobe EvalBSDF/PdfBSDF can evaluate in arbitrary directions.
+bool SampleGuidedBSDF(const SDTree& guide, int leaf, const Material& mat, const ShadingData& sd,
+                      const Ray& r_in, const SurfaceInteraction& si, float u_lobe, Sample2D u,
+                      const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f) {
+    if (u_lobe < kGuidingFraction) {
+        wi = guide.Sample(leaf, u);
+    } else {
+        float bsdf_pdf;
+        Spectrum bsdf_f;
+        if (!SampleBSDF<MaterialType::Lambertian>(mat, sd, r_in, si, u_lobe, u, wl, wi, bsdf_pdf,
+                                                  bsdf_f)) {
+            return false;
+        }
+    }
+    f = EvalBSDF<MaterialType::Lambertian>(mat, sd, si.wo, wi, wl);
+    if (f.IsBlack()) return false;
+    pdf = kGuidingFraction * guide.Pdf(leaf, wi) +
+          (1.0f - kGuidingFraction) * PdfBSDF<MaterialType::Lambertian>(mat, sd, si.wo, wi);
+    return pdf > 0.0f;
+}
+
+}  // namespace
+
 /**
  * Iterative path tracer:
  * |- For depth:
@@ -47,273 +102,437 @@ namespace skwr {
  *
  * |- Deferred Deep Output pass
  */
-void Li(const Ray& ray, const Scene& scene, RNG& rng, const IntegratorConfig& config,
-        const Vec3& primary_cam_w, const SampledWavelengths& wl, SampleWriter& writer) {
+void Li(const Ray& ray, const RayCone& camera_cone, const Scene& scene, Sampler& sampler,
+        RNG& rng, SDTree* guide, const IntegratorConfig& config, const Vec3& primary_cam_w,
+        const SampledWavelengths& wl, SampleWriter& writer, const PrimaryHit* primary) {
     Spectrum L(0.0f);     // Accumulated Radiance (color)
     Spectrum beta(1.0f);  // Throughput (attenuation)
     Ray r = ray;
+    RayCone cone = camera_cone;  // Footprint of r, for texture LOD
     bool specular_bounce = true;
 
     float ray_t = 0.0f;  // Running parametric distance
 
     DeepPathRecorder dpr(config.max_depth);  // Deferred State tracker
 
+    // Path guiding: diffuse vertices are recorded so their incident radiance trains the SD-tree
+    const bool record_guiding = guide != nullptr && guide->IsTraining();
+    GuidingPathRecorder gpr(record_guiding ? config.max_depth : 0);
+    auto accumulate = [&](const Spectrum& contribution) {
+        L += contribution;
+        if (record_guiding) gpr.AddRadiance(contribution);
+    };
+
     bool is_camera_path = true;
     float prev_scatter_pdf = 1.0f;  // pdf of previous bounce (for directional MIS)
 
+    // AOV inputs from the first non-null surface; misses and media write no AOV sample
+    bool need_first_hit = writer.WantsFirstHit();
+    bool has_first_hit = false;
+    FirstHit first_hit{};
+
     bool saw_visible = false;
     bool hit_opaque_background = false;
     int vis_checks = 0;
     const bool transparent_bg = config.transparent_background.value_or(false);
-
-    for (int depth = 0; depth < config.max_depth; ++depth) {  // TODO: switch to while?
-        SurfaceInteraction si;
-        MediumInteraction mi;
-        bool scatter_surface = scene.Intersect(r, RenderConstants::kRayOffsetEpsilon,
-                                               MathConstants::kFloatInfinity, &si);
-        float t_max = scatter_surface ? si.t : MathConstants::kFloatInfinity;
-        bool scatter_medium = false;
-
-        // Local vertex segment tracking
-        Spectrum current_beta = beta;  // Track beta before the bounce
-        Spectrum local_vertex_L(0.0f);
-        float vertex_alpha = 1.0f;
-
-        if (r.vol_stack().GetActiveMedium() != 0) {
-            scatter_medium = SampleMedium(r, scene, t_max, rng, beta, &mi, wl);
-        }
-        // vol dispatch, sample medium with t_surface as upper bound
-        if (scatter_medium) {
-            ray_t += mi.t;
-            if (transparent_bg && vis_checks < config.visibility_depth) {
-                vis_checks++;
-                saw_visible = true;  // Participating media contribute layer coverage
-            }
-
-            /* Volume Next Event Estimation (Direct Lighting) */
-            DirectLightSample dls;
-            if (GenerateLightSample(mi.point, scene, rng, wl, &dls)) {
-                Ray shadow_ray(mi.point, dls.wi, r.time());
-                shadow_ray.vol_stack() = r.vol_stack();
-
-                Spectrum Tr = EvaluateVisibility(scene, shadow_ray, dls.dist, rng, wl);
-
-                if (Tr.MaxComponentValue() > 0.0f) {
-                    // Evaluate Phase & Transmittance
-                    float phase_pdf = EvalHenyeyGreenstein(mi.phase_g, mi.wo, dls.wi);
-                    float mis_weight = PowerHeuristic(dls.pdf, phase_pdf);
-
-                    Spectrum direct_L = mis_weight * phase_pdf * Tr * dls.emission / dls.pdf;
-                    local_vertex_L += direct_L;
-                }
-            }
-
-            vertex_alpha = mi.alpha;
-
-            L += current_beta * local_vertex_L;  // forward beauty accumulation
-
-            dpr.AppendVertex(ray_t, ray_t, local_vertex_L, vertex_alpha, is_camera_path, true);
-            is_camera_path = false;  // Volumes always scatter, leaving camera path
-
-            /* Sample Phase Function for Indirect Bounce */
-            Vec3 next_wi;
-            SampleHenyeyGreenstein(mi.phase_g, mi.wo, rng.UniformFloat(), rng.UniformFloat(),
-                                   next_wi);
-            prev_scatter_pdf = EvalHenyeyGreenstein(mi.phase_g, mi.wo, next_wi);
-
-            // Note: For Henyey-Greenstein, the phase_eval / phase_pdf ratio is EXACTLY 1.0
-            // The sampling routine perfectly importance samples the distribution so beta is
-            // unchanged by the directional scatter itself
-            Ray next_r(mi.point, next_wi, r.time());
-            next_r.vol_stack() = r.vol_stack();
-            r = next_r;
-            specular_bounce = false;
-        } else if (scatter_surface) {
-            ray_t += si.t;
-
-            // TRANSPORT POLICY (Medium Transitions)
-            if (si.interior_medium != si.exterior_medium) {
-                float cos = Dot(r.direction(), si.n_geom);
-                if (cos < 0.0f) {  // Entering the interior medium
-                    if (si.interior_medium != kVacuumMediumId && si.interior_medium != 0) {
-                        r.vol_stack().Push(si.interior_medium, si.priority, si.nano_vdb_trs);
-                    }
-                } else {  // Exiting the interior medium
-                    if (si.interior_medium != kVacuumMediumId && si.interior_medium != 0) {
-                        r.vol_stack().Pop(si.interior_medium);
-                    }
-                }
-            }
-            // SHADING POLICY (Opacity & BSDF)
-            if (si.material_id == kNullMaterialId) {
-                Ray next_ray(si.point + (r.direction() * RenderConstants::kRayOffsetEpsilon),
-                             r.direction(), r.time());
-                next_ray.vol_stack() = r.vol_stack();
-                r = next_ray;
-                depth--;
-                continue;
-            }
-
-            const Material& mat = scene.GetMaterial(si.material_id);
-            if (transparent_bg && vis_checks < config.visibility_depth) {
-                vis_checks++;
-                if (mat.visible) saw_visible = true;
+    bool primary_pending = primary != nullptr;  // Until the first intersection is consumed
+
+    // Efficiency roulette and splitting weigh a path against the pixel's estimate so far.
+    // Splitting is off for deep output and guiding training, which record one vertex chain.
+    const bool efficiency_rr = config.roulette == RouletteMode::Efficiency;
+    const int split_factor = config.enable_deep || record_guiding
+                                 ? 1
+                                 : std::clamp(config.split_factor, 1, kMaxSplitFactor);
+    const float pixel_estimate =
+        efficiency_rr || split_factor > 1 ? writer.PixelEstimate() : 0.0f;
+    bool can_split = split_factor > 1;
+    bool on_branch = false;  // Tracing a branch split off the camera path
+    float split_scale = 1.0f;  // Paths after the split carry 1 / split_scale of the throughput
+    BoundedArray<PathBranch, kMaxSplitFactor - 1> branches;
+    size_t next_branch = 0;
+
+    int depth = 0;
+    while (true) {
+        for (; depth < config.max_depth; ++depth) {
+            SurfaceInteraction si;
+            MediumInteraction mi;
+            const bool from_primary = primary_pending;
+            primary_pending = false;
+            bool scatter_surface = false;
+            if (from_primary) {
+                scatter_surface = primary->hit;
+                if (scatter_surface) si = primary->si;
+            } else {
+                scatter_surface = scene.Intersect(r, RenderConstants::kRayOffsetEpsilon,
+                                                  MathConstants::kFloatInfinity, &si);
             }
-            ShadingData sd = ResolveShadingData(mat, si, scene);
-
-            // Lazy Evaluation
-            Spectrum opacity(1.0f);
-            float alpha = 1.0f;
-            if (mat.IsTransparent() && mat.type != MaterialType::Dielectric) {
-                opacity = CurveToSpectrum(mat.opacity, wl);
-                alpha = opacity.Average();
+            float t_max = scatter_surface ? si.t : MathConstants::kFloatInfinity;
+            bool scatter_medium = false;
+
+            // Every bounce owns a fixed block of sampler dimensions; draw them all up front so
+            // skipping NEE (or scattering in a medium) does not shift the dimensions used below.
+            // Split-off branches would all replay the same dimensions, so they use the RNG.
+            if (!on_branch) sampler.StartBounce(depth);
+            auto draw_1d = [&]() { return on_branch ? rng.UniformFloat() : sampler.Get1D(); };
+            auto draw_2d = [&]() {
+                return on_branch ? Sample2D{rng.UniformFloat(), rng.UniformFloat()}
+                                 : sampler.Get2D();
+            };
+            const float u_light = draw_1d();
+            const Sample2D u_light_pos = draw_2d();
+            const float u_lobe = draw_1d();
+            const Sample2D u_scatter = draw_2d();
+
+            // Local vertex segment tracking
+            Spectrum current_beta = beta;  // Track beta before the bounce
+            Spectrum local_vertex_L(0.0f);
+            float vertex_alpha = 1.0f;
+
+            if (r.vol_stack().GetActiveMedium() != 0) {
+                scatter_medium = SampleMedium(r, scene, t_max, rng, beta, &mi, wl);
             }
-
-            Spectrum emission(0.0f);
-            if (mat.IsEmissive()) {
-                emission = CurveToSpectrum(mat.emission, wl);
-                if (specular_bounce) {
-                    local_vertex_L += emission;
-                } else if (si.light_index != -1) {
-                    // Calculate the PDF that NEE would have generated to hit this exact spot
-                    float pdf_a = LightPdfArea(scene, si.light_index);
-                    float dist_sq = si.t * si.t;
-                    float cos_light = std::fmax(0.0f, Dot(-r.direction(), si.n_geom));
-                    float pdf_w = (pdf_a * dist_sq) / cos_light;
-                    pdf_w *= scene.InvLightCount();
-
-                    float mis_weight = PowerHeuristic(prev_scatter_pdf, pdf_w);
-                    local_vertex_L += emission * mis_weight;
-                } else {
-                    local_vertex_L += emission;
+            // vol dispatch, sample medium with t_surface as upper bound
+            if (scatter_medium) {
+                ray_t += mi.t;
+                need_first_hit = false;
+                if (transparent_bg && vis_checks < config.visibility_depth) {
+                    vis_checks++;
+                    saw_visible = true;  // Participating media contribute layer coverage
                 }
-            }
 
-            // /* Handle transparency - straight-through transmission */
-            // if (mat.IsTransparent()) {
-            //     // For non-refractive transparent surfaces (like foliage, smoke, etc.)
-            //     // This is separate from Dielectric refraction
-
-            //     Spectrum transmittance = Spectrum(1.0f) - opacity;
-
-            //     if (transmittance.MaxComponent() > 0.0f) {
-            //         // Continue ray through surface for the transmitted portion
-            //         // This requires spawning a transmission ray
-            //         // For now, we'll handle this in the BSDF sampling below
-            //     }
-            // }
-
-            /* Next Event Estimation */
-            if (mat.type != MaterialType::Metal && mat.type != MaterialType::Dielectric) {
+                /* Volume Next Event Estimation (Direct Lighting) */
                 DirectLightSample dls;
-                if (GenerateLightSample(
-                        si.point + (si.n_shading * RenderConstants::kRayOffsetEpsilon), scene, rng,
-                        wl, &dls)) {
-                    Ray shadow_ray(si.point + (dls.wi * RenderConstants::kRayOffsetEpsilon), dls.wi,
-                                   r.time());
+                if (GenerateLightSample(mi.point, scene, u_light, u_light_pos, wl, &dls)) {
+                    Ray shadow_ray(mi.point, dls.wi, r.time());
                     shadow_ray.vol_stack() = r.vol_stack();
 
                     Spectrum Tr = EvaluateVisibility(scene, shadow_ray, dls.dist, rng, wl);
 
                     if (Tr.MaxComponentValue() > 0.0f) {
-                        float cos_surf = std::fmax(0.0f, Dot(dls.wi, sd.n_shading));
-                        Spectrum f_val = EvalBSDF(mat, sd, si.wo, dls.wi, wl);
+                        // Evaluate Phase & Transmittance
+                        float phase_pdf = EvalHenyeyGreenstein(mi.phase_g, mi.wo, dls.wi);
+                        float mis_weight = PowerHeuristic(dls.pdf, phase_pdf);
 
-                        Spectrum direct_L = f_val * Tr * dls.emission * cos_surf / dls.pdf;
-                        direct_L *= opacity;
+                        Spectrum direct_L = mis_weight * phase_pdf * Tr * dls.emission / dls.pdf;
                         local_vertex_L += direct_L;
                     }
                 }
-            }
 
-            vertex_alpha = alpha;
-            L += current_beta * local_vertex_L;
-            dpr.AppendVertex(ray_t, ray_t, local_vertex_L, vertex_alpha, is_camera_path, false);
-
-            /* Indirect bounce case */
-            Vec3 wi;
-            float pdf;
-            Spectrum f;
-
-            /* BSDF check */
-            if (SampleBSDF(mat, sd, r, si, rng, wl, wi, pdf, f)) {
-                if (pdf > 0) {
-                    float refract = Dot(wi, si.n_geom);
-                    float cos_theta = std::abs(refract);
-                    Spectrum weight = f * cos_theta / pdf;  // Universal pdf func now
-
-                    // Modulate throughput by opacity for non-specular bounces
-                    // For Dielectrics/Metals, opacity is typically 1.0
-                    // For transparent diffuse, we need to account for absorption
-                    if (mat.type == MaterialType::Lambertian) {
-                        weight *= alpha;  // Absorb based on opacity
+                vertex_alpha = mi.alpha;
+
+                accumulate(current_beta * local_vertex_L);  // forward beauty accumulation
+
+                dpr.AppendVertex(ray_t, ray_t, local_vertex_L, vertex_alpha, is_camera_path, true);
+                is_camera_path = false;  // Volumes always scatter, leaving camera path
+
+                /* Sample Phase Function for Indirect Bounce */
+                Vec3 next_wi;
+                SampleHenyeyGreenstein(mi.phase_g, mi.wo, u_scatter.u, u_scatter.v, next_wi);
+                prev_scatter_pdf = EvalHenyeyGreenstein(mi.phase_g, mi.wo, next_wi);
+
+                // Note: For Henyey-Greenstein, the phase_eval / phase_pdf ratio is EXACTLY 1.0
+                // The sampling routine perfectly importance samples the distribution so beta is
+                // unchanged by the directional scatter itself
+                Ray next_r(mi.point, next_wi, r.time());
+                next_r.vol_stack() = r.vol_stack();
+                r = next_r;
+                specular_bounce = false;
+                cone.Propagate(mi.t);
+                cone.Scatter(1.0f - std::abs(mi.phase_g));
+            } else if (scatter_surface) {
+                ray_t += si.t;
+
+                // TRANSPORT POLICY (Medium Transitions)
+                if (si.interior_medium != si.exterior_medium) {
+                    float cos = Dot(r.direction(), si.n_geom);
+                    if (cos < 0.0f) {  // Entering the interior medium
+                        if (si.interior_medium != kVacuumMediumId && si.interior_medium != 0) {
+                            r.vol_stack().Push(si.interior_medium, si.priority, si.nano_vdb_trs);
+                        }
+                    } else {  // Exiting the interior medium
+                        if (si.interior_medium != kVacuumMediumId && si.interior_medium != 0) {
+                            r.vol_stack().Pop(si.interior_medium);
+                        }
                     }
+                }
+                // SHADING POLICY (Opacity & BSDF)
+                if (si.material_id == kNullMaterialId) {
+                    Ray next_ray(si.point + (r.direction() * RenderConstants::kRayOffsetEpsilon),
+                                 r.direction(), r.time());
+                    next_ray.vol_stack() = r.vol_stack();
+                    r = next_ray;
+                    cone.Propagate(si.t);
+                    depth--;
+                    continue;
+                }
 
-                    prev_scatter_pdf = pdf;
-                    beta *= weight;
-                    Ray next_r(si.point + (wi * RenderConstants::kRayOffsetEpsilon), wi, r.time());
-                    next_r.vol_stack() = r.vol_stack();
+                const Material& mat = scene.GetMaterial(si.material_id);
+                if (transparent_bg && vis_checks < config.visibility_depth) {
+                    vis_checks++;
+                    if (mat.visible) saw_visible = true;
+                }
+                ShadingData sd = from_primary
+                                     ? primary->sd
+                                     : ResolveShadingData(mat, si, scene, cone.WidthAt(si.t));
+                if (need_first_hit) {
+                    first_hit.point = si.point;
+                    first_hit.normal = sd.n_shading;
+                    // Dielectrics have no meaningful albedo; white keeps the glass from being
+                    // smeared
+                    first_hit.albedo = mat.type == MaterialType::Dielectric
+                                           ? RGB(1.0f)
+                                           : SpectrumToRGB(CurveToSpectrum(sd.albedo, wl), wl);
+                    first_hit.depth = Dot(si.point - ray.origin(), primary_cam_w);
+                    first_hit.material_id = si.material_id;
+                    first_hit.object_id = si.object_id;
+                    if (writer.WantsAOV(AOVType::Motion)) {
+                        scene.ObjectPointAtShutter(si.object_id, si.point, r.time(),
+                                                   &first_hit.point_open, &first_hit.point_close);
+                    }
+                    has_first_hit = true;
+                    need_first_hit = false;
+                }
 
-                    // Update is_camera_path based on transmission
-                    float in_dot = Dot(r.direction(), si.n_shading);
-                    float out_dot = Dot(next_r.direction(), si.n_shading);
-                    bool is_transmission = (in_dot * out_dot > 0.0f);
+                // The rest of the vertex is compiled once per material type (kType), so the type
+                // checks below and in the BSDF calls are resolved at compile time
+                auto shade_surface = [&](auto type_tag) -> bool {
+                    constexpr MaterialType kType = decltype(type_tag)::value;
+
+                    // Lazy Evaluation
+                    Spectrum opacity(1.0f);
+                    float alpha = 1.0f;
+                    if (kType != MaterialType::Dielectric && mat.IsTransparent()) {
+                        opacity = CurveToSpectrum(mat.opacity, wl);
+                        alpha = opacity.Average();
+                    }
 
-                    is_camera_path = is_camera_path && is_transmission;
-                    r = next_r;
+                    Spectrum emission(0.0f);
+                    if (mat.IsEmissive()) {
+                        emission = CurveToSpectrum(mat.emission, wl);
+                        if (specular_bounce) {
+                            local_vertex_L += emission;
+                        } else if (si.light_index != -1) {
+                            // Calculate the PDF that NEE would have generated to hit this spot
+                            float pdf_a = LightPdfArea(scene, si.light_index);
+                            float dist_sq = si.t * si.t;
+                            float cos_light = std::fmax(0.0f, Dot(-r.direction(), si.n_geom));
+                            float pdf_w = (pdf_a * dist_sq) / cos_light;
+                            pdf_w *= scene.InvLightCount();
+
+                            float mis_weight = PowerHeuristic(prev_scatter_pdf, pdf_w);
+                            local_vertex_L += emission * mis_weight;
+                        } else {
+                            local_vertex_L += emission;
+                        }
+                    }
 
-                    // If this bounce was sharp (Metal/Glass), next hit counts as specular
-                    specular_bounce =
-                        (mat.type == MaterialType::Metal || mat.type == MaterialType::Dielectric);
-                }
+                    // /* Handle transparency - straight-through transmission */
+                    // if (mat.IsTransparent()) {
+                    //     // For non-refractive transparent surfaces (like foliage, smoke, etc.)
+                    //     // This is separate from Dielectric refraction
+
+                    //     Spectrum transmittance = Spectrum(1.0f) - opacity;
+
+                    //     if (transmittance.MaxComponent() > 0.0f) {
+                    //         // Continue ray through surface for the transmitted portion
+                    //         // This requires spawning a transmission ray
+                    //         // For now, we'll handle this in the BSDF sampling below
+                    //     }
+                    // }
+
+                    /* Next Event Estimation */
+                    if constexpr (kType == MaterialType::Lambertian) {
+                        DirectLightSample dls;
+                        const Point3 nee_origin =
+                            si.point + (si.n_shading * RenderConstants::kRayOffsetEpsilon);
+                        if (GenerateLightSample(nee_origin, scene, u_light, u_light_pos, wl,
+                                                &dls)) {
+                            Ray shadow_ray(si.point + (dls.wi * RenderConstants::kRayOffsetEpsilon),
+                                           dls.wi, r.time());
+                            shadow_ray.vol_stack() = r.vol_stack();
+
+                            Spectrum Tr = EvaluateVisibility(scene, shadow_ray, dls.dist, rng, wl);
+
+                            if (Tr.MaxComponentValue() > 0.0f) {
+                                float cos_surf = std::fmax(0.0f, Dot(dls.wi, sd.n_shading));
+                                Spectrum f_val = EvalBSDF<kType>(mat, sd, si.wo, dls.wi, wl);
+
+                                Spectrum direct_L = f_val * Tr * dls.emission * cos_surf / dls.pdf;
+                                direct_L *= opacity;
+                                local_vertex_L += direct_L;
+                            }
+                        }
+                    }
+
+                    vertex_alpha = alpha;
+                    accumulate(current_beta * local_vertex_L);
+                    dpr.AppendVertex(ray_t, ray_t, local_vertex_L, vertex_alpha, is_camera_path,
+                                     false);
+
+                    /* Indirect bounce case */
+                    // BSDF check (mixed with the guiding distribution on diffuse surfaces)
+                    const bool guided = guide != nullptr && kType == MaterialType::Lambertian;
+                    const int guide_leaf = guided ? guide->LeafIndex(si.point) : -1;
+                    auto sample_direction = [&](float uc, Sample2D u, Vec3& wi, float& pdf,
+                                                Spectrum& f) {
+                        return guided && guide->IsTrained()
+                                   ? SampleGuidedBSDF(*guide, guide_leaf, mat, sd, r, si, uc, u,
+                                                      wl, wi, pdf, f)
+                                   : SampleBSDF<kType>(mat, sd, r, si, uc, u, wl, wi, pdf, f);
+                    };
+
+                    // The path state after scattering into wi, with the throughput split n ways
+                    auto scatter = [&](const Vec3& wi, float pdf, const Spectrum& f, int n) {
+                        PathBranch next;
+                        float refract = Dot(wi, si.n_geom);
+                        float cos_theta = std::abs(refract);
+                        Spectrum weight = f * cos_theta / pdf;  // Universal pdf func now
+
+                        // Modulate throughput by opacity for non-specular bounces
+                        // For Dielectrics/Metals, opacity is typically 1.0
+                        // For transparent diffuse, we need to account for absorption
+                        if constexpr (kType == MaterialType::Lambertian) {
+                            weight *= alpha;  // Absorb based on opacity
+                        }
+
+                        next.prev_scatter_pdf = pdf;
+                        next.beta = beta * weight * (1.0f / static_cast<float>(n));
+                        next.r = Ray(si.point + (wi * RenderConstants::kRayOffsetEpsilon), wi,
+                                     r.time());
+                        next.r.vol_stack() = r.vol_stack();
+
+                        // Update is_camera_path based on transmission
+                        float in_dot = Dot(r.direction(), si.n_shading);
+                        float out_dot = Dot(wi, si.n_shading);
+                        bool is_transmission = (in_dot * out_dot > 0.0f);
+                        next.is_camera_path = is_camera_path && is_transmission;
+
+                        // If this bounce was sharp (Metal/Glass), next hit counts as specular
+                        next.specular_bounce =
+                            kType == MaterialType::Metal || kType == MaterialType::Dielectric;
+
+                        next.cone = cone;
+                        next.cone.Propagate(si.t);
+                        next.cone.Scatter(kType == MaterialType::Lambertian ? 1.0f
+                                                                            : sd.roughness);
+                        next.ray_t = ray_t;
+                        next.depth = depth;
+                        next.vis_checks = vis_checks;
+                        return next;
+                    };
+
+                    // Splitting: the first diffuse vertex sends out up to split_factor paths.
+                    // The extra ones draw their directions from the RNG and are traced after
+                    // this one ends.
+                    int split = 1;
+                    if (kType == MaterialType::Lambertian && can_split) {
+                        can_split = false;
+                        split = SplitCount(split_factor, current_beta, local_vertex_L,
+                                           efficiency_rr ? pixel_estimate : 0.0f);
+                        split_scale = static_cast<float>(split);
+                        for (int k = 1; k < split; ++k) {
+                            Vec3 wi;
+                            float pdf;
+                            Spectrum f;
+                            const float uc = rng.UniformFloat();
+                            const Sample2D u{rng.UniformFloat(), rng.UniformFloat()};
+                            if (sample_direction(uc, u, wi, pdf, f) && pdf > 0) {
+                                branches.push_back(scatter(wi, pdf, f, split));
+                            }
+                        }
+                    }
+
+                    Vec3 wi;
+                    float pdf;
+                    Spectrum f;
+                    if (sample_direction(u_lobe, u_scatter, wi, pdf, f)) {
+                        if (pdf > 0) {
+                            if (guided && record_guiding) gpr.AppendVertex(guide_leaf, wi, pdf);
+
+                            const PathBranch next = scatter(wi, pdf, f, split);
+                            prev_scatter_pdf = next.prev_scatter_pdf;
+                            beta = next.beta;
+                            r = next.r;
+                            is_camera_path = next.is_camera_path;
+                            specular_bounce = next.specular_bounce;
+                            cone = next.cone;
+                        }
+                    } else {
+                        return false;
+                    }
+                    return true;
+                };
+                if (!DispatchMaterialType(mat.type, shade_surface)) break;
             } else {
-                break;
-            }
-        } else {
-            if (transparent_bg && vis_checks < config.visibility_depth) {
-                vis_checks++;
-                // Environment hit = no visible object along this path segment
-            }
+                if (transparent_bg && vis_checks < config.visibility_depth) {
+                    vis_checks++;
+                    // Environment hit = no visible object along this path segment
+                }
+
+                SkyboxSample skybox_sample;
+                if (scene.SampleSkybox(r, RenderConstants::kRayOffsetEpsilon,
+                                       MathConstants::kFloatInfinity, &skybox_sample)) {
+                    if (is_camera_path) {
+                        Spectrum skybox_L = CurveToSpectrum(RGBToCurve(skybox_sample.color), wl);
+                        dpr.AppendVertex(ray_t + skybox_sample.t, ray_t + skybox_sample.t, skybox_L,
+                                         1.0f, true, false);
+                        accumulate(skybox_L * current_beta);
+                        hit_opaque_background = true;
+                    }
+                    break;
+                }
 
-            SkyboxSample skybox_sample;
-            if (scene.SampleSkybox(r, RenderConstants::kRayOffsetEpsilon,
-                                   MathConstants::kFloatInfinity, &skybox_sample)) {
-                if (is_camera_path) {
-                    Spectrum skybox_L = CurveToSpectrum(RGBToCurve(skybox_sample.color), wl);
-                    dpr.AppendVertex(ray_t + skybox_sample.t, ray_t + skybox_sample.t, skybox_L,
-                                     1.0f, true, false);
-                    L += skybox_L * current_beta;
+                Spectrum env_L = EvaluateEnvironment(r.direction(), wl);
+                dpr.AppendVertex(RenderConstants::kFarClip, RenderConstants::kFarClip, env_L, 1.0f,
+                                 is_camera_path, false);
+                accumulate(env_L * current_beta);
+                if (!transparent_bg) {
                     hit_opaque_background = true;
                 }
                 break;
             }
 
-            Spectrum env_L = EvaluateEnvironment(r.direction(), wl);
-            dpr.AppendVertex(RenderConstants::kFarClip, RenderConstants::kFarClip, env_L, 1.0f,
-                             is_camera_path, false);
-            L += env_L * current_beta;
-            if (!transparent_bg) {
-                hit_opaque_background = true;
+            // Russian Roulette. Efficiency mode survives with probability ratio / window, where
+            // ratio is the expected contribution relative to the pixel; it needs a pixel estimate.
+            // Split paths are judged on the throughput they had before the split, so roulette
+            // does not undo the splitting.
+            const bool weight_window = efficiency_rr && depth > 0 && pixel_estimate > 0.0f;
+            if (weight_window || depth > 3) {
+                const float p = RouletteSurvival(beta * split_scale, local_vertex_L,
+                                                 weight_window ? pixel_estimate : 0.0f,
+                                                 config.roulette_window);
+                if (p <= 0.0f) break;
+                if (p < 1.0f) {
+                    if (rng.UniformFloat() > p) break;
+                    beta = beta * (1.0f / p);
+                }
             }
-            break;
-        }
 
-        // Russian Roulette
-        if (depth > 3) {
-            float max_beta = beta.MaxComponentValue();
-            if (max_beta < 0.001f) break;
-            float p = std::min(0.95f, max_beta);
-            if (rng.UniformFloat() > p) break;
-            beta = beta * (1.0f / p);
+            dpr.UpdateBSDFWeight(beta, current_beta);
+            if (record_guiding) gpr.CloseVertex(beta);
         }
 
-        dpr.UpdateBSDFWeight(beta, current_beta);
+        // The path ended; trace the next branch split off at the first diffuse vertex, if any
+        if (next_branch == branches.size()) break;
+        const PathBranch& branch = branches[next_branch++];
+        r = branch.r;
+        cone = branch.cone;
+        beta = branch.beta;
+        prev_scatter_pdf = branch.prev_scatter_pdf;
+        ray_t = branch.ray_t;
+        vis_checks = branch.vis_checks;
+        specular_bounce = branch.specular_bounce;
+        is_camera_path = branch.is_camera_path;
+        depth = branch.depth + 1;
+        on_branch = true;
     }
 
+    if (record_guiding) gpr.Flush(guide);
     dpr.ResolveToDeep(writer, ray, primary_cam_w, wl);
     const float out_alpha =
         (transparent_bg && !saw_visible && !hit_opaque_background) ? 0.0f : 1.0f;
     writer.WriteBeauty(SpectrumToRGB(L, wl), out_alpha);
+    if (has_first_hit) writer.WriteFirstHit(first_hit);
     writer.FlushDeepSegments();
 }
 
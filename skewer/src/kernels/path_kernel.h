@@ -3,17 +3,37 @@
 
 #include "core/math/vec3.h"
 #include "core/spectral/spectrum.h"
+#include "core/transport/ray_cone.h"
+#include "core/transport/surface_interaction.h"
 #include "film/sample_writer.h"
+#include "materials/texture_lookup.h"
 
 namespace skwr {
 
 class Scene;
 class Ray;
 class RNG;
+class Sampler;
+class SDTree;
 struct IntegratorConfig;
 
-void Li(const Ray& ray, const Scene& scene, RNG& rng, const IntegratorConfig& config,
-        const Vec3& primary_cam_w, const SampledWavelengths& wl, SampleWriter& writer);
+// First intersection of a camera ray, found and shaded before Li() runs so a batch of camera rays
+// can be bucketed by material (see IntegratorConfig::material_sort)
+struct PrimaryHit {
+    bool hit = false;
+    SurfaceInteraction si;
+    ShadingData sd;  // Resolved for hits on a non-null material
+};
+
+// camera_cone is the primary ray's footprint (see Camera::GetRay); it drives texture LOD.
+// sampler must have been started on this pixel sample; it supplies light and BSDF/phase samples
+// per bounce. rng drives the remaining decisions (free-flight distances, Russian roulette).
+// guide is the path-guiding SD-tree, or null when guiding is off. Once trained it is mixed into
+// diffuse BSDF sampling; while training, the path's diffuse vertices are recorded into it.
+// primary, when given, is ray's first intersection and replaces the first scene.Intersect().
+void Li(const Ray& ray, const RayCone& camera_cone, const Scene& scene, Sampler& sampler,
+        RNG& rng, SDTree* guide, const IntegratorConfig& config, const Vec3& primary_cam_w,
+        const SampledWavelengths& wl, SampleWriter& writer, const PrimaryHit* primary = nullptr);
 
 }  // namespace skwr
 
@@ -11,6 +11,7 @@
 #include "core/spectral/spectrum.h"
 #include "core/transport/medium_interaction.h"
 #include "geometry/boundbox.h"
+#include "kernels/utils/spectral_mis.h"
 #include "media/mediums.h"
 
 namespace skwr {
@@ -20,9 +21,10 @@ namespace skwr {
  * distance t without hitting a particle is given by the transmittance (Beer-Lambert law):
  *      T_r(t) = e^(−σ_t * t)
  * For us, σ_t is a Spectrum, not a single float. A ray might travel further in the red channel than
- * the blue channel. So to prevent color bias, we randomly pick one color channel to generate the
- * distance t, and then average the Probability Density Function (PDF) across all channels to update
- * the throughput (β) beta
+ * the blue channel. So to prevent color bias, we pick one wavelength channel to generate the
+ * distance t and weight by the one-sample MIS (balance heuristic) PDF over all channels.
+ * Channels are picked proportionally to the current throughput β (spectral MIS), so channels that
+ * a chromatic medium has already absorbed stop steering the distance samples.
  *
  * To sample a random scattering distance t, we use the Inverse Transform Method.
  * Set a random number ξ equal to the cumulative distribution function and solve for t:
@@ -32,8 +34,11 @@ bool SampleHomogeneous(const HomogeneousMedium& medium, const Ray& r, float t_ma
                        Spectrum& beta, MediumInteraction* mi) {
     Spectrum sigma_t = medium.Extinction();  // sigma_a + sigma_s
 
-    // Sampling a color channel to find t
-    int channel = rng.UniformInt(kNSamples);
+    // Throughput-proportional channel selection probabilities
+    Spectrum channel_pdf = ChannelPdf(beta);
+
+    // Sampling a wavelength channel to find t
+    int channel = SampleChannel(channel_pdf, rng.UniformFloat());
     float sigma_t_c = sigma_t[channel];
 
     // Solve for t
@@ -57,8 +62,9 @@ bool SampleHomogeneous(const HomogeneousMedium& medium, const Ray& r, float t_ma
 
     // If scattered: PDF = sigma_t * T_r
     // If passed through: PDF = T_r
+    // Mixed over channels with the same probabilities used to pick the channel
     Spectrum pdf_spectrum = scattered ? (sigma_t * tr) : tr;
-    float pdf = pdf_spectrum.Average();
+    float pdf = ChannelAveragedPdf(channel_pdf, pdf_spectrum);
 
     if (pdf <= 0.0f) return false;  // Maybe pdf < 1e-6f: be aware of dividing float by small nums
 
@@ -85,7 +91,8 @@ bool SampleHomogeneous(const HomogeneousMedium& medium, const Ray& r, float t_ma
 /**
  * In heterogeneous media, we take the max density as a majorant (upper bound) to sample as if it
  * were homogeneous, but for areas with density < majorant, we take a probability of the sample,
- * corresponding to the reduced density
+ * corresponding to the reduced density. The real/null decision uses spectral tracking so all
+ * channels of the packet share one set of free-flight samples.
  */
 bool SampleGrid(const GridMedium& medium, const Ray& r, float t_max_surface, RNG& rng,
                 Spectrum& beta, MediumInteraction* mi) {
@@ -103,7 +110,6 @@ bool SampleGrid(const GridMedium& medium, const Ray& r, float t_max_surface, RNG
     float majorant =
         medium.max_density * (medium.sigma_a_base + medium.sigma_s_base).MaxComponentValue();
     if (majorant <= 0.0f) return false;
-    int hero = 0;  // 0 index is always hero
 
     // Track optical depth for Deep Alpha
     float accumulated_tau = 0.0f;
@@ -126,14 +132,8 @@ bool SampleGrid(const GridMedium& medium, const Ray& r, float t_max_surface, RNG
         // approximating the integral of extinction over the distance marched.
         accumulated_tau += sigma_t.Average() * step_size;
 
-        // Probability of a REAL collision
-        float p_real = sigma_t[hero] / majorant;
-
-        if (rng.UniformFloat() < p_real) {
+        if (SpectralTrackingEvent(sigma_t, sigma_s, majorant, rng.UniformFloat(), beta)) {
             // --- REAL COLLISION! ---
-            // Divide the entire spectrum by the HERO's extinction
-            beta *= (sigma_s / sigma_t[hero]);
-
             mi->t = t;
             mi->point = r.at(t);
             mi->wo = -r.direction();
@@ -143,15 +143,7 @@ bool SampleGrid(const GridMedium& medium, const Ray& r, float t_max_surface, RNG
 
             return true;
         }
-
-        // --- NULL COLLISION ---
-        // If the grid has spectrally varying extinction (e.g., colored base_sigma_t),
-        // we must weight the non-hero channels.
-        // Note: If sigma_t is perfectly uniform across all channels (grey smoke),
-        // this safely evaluates to 1.0.
-        float denom = std::max(majorant - sigma_t[hero], Numeric::kFloatEpsilon);
-        Spectrum null_weight = (Spectrum(majorant) - sigma_t) / denom;
-        beta *= null_weight;
+        // --- NULL COLLISION --- (beta already carries the null weight)
     }
     return false;
 }
@@ -174,7 +166,6 @@ bool SampleNanoVDB(const NanoVDBMedium& medium, const Ray& r, float t_max_surfac
     float majorant = medium.max_density * base_sigma_t.MaxComponentValue();
     if (majorant <= 0.0f) return false;
 
-    int hero_idx = 0;
     float t = t_min;
     NanoVDBAccessor acc(medium);
 
@@ -189,12 +180,8 @@ bool SampleNanoVDB(const NanoVDBMedium& medium, const Ray& r, float t_max_surfac
         Spectrum sigma_t = density * base_sigma_t;
         Spectrum sigma_s = density * base_sigma_s;
 
-        float p_real = sigma_t[hero_idx] / majorant;
-
-        if (rng.UniformFloat() < p_real) {
+        if (SpectralTrackingEvent(sigma_t, sigma_s, majorant, rng.UniformFloat(), beta)) {
             // REAL COLLISION
-            beta *= (sigma_s / sigma_t[hero_idx]);
-
             mi->t = t;
             mi->point = r.at(t);
             mi->wo = -r.direction();
@@ -204,12 +191,7 @@ bool SampleNanoVDB(const NanoVDBMedium& medium, const Ray& r, float t_max_surfac
 
             return true;
         }
-
-        // NULL COLLISION (With Zero-Division Guard!)
-        float denom =
-            std::max(majorant - sigma_t[hero_idx], 1e-6f);  // i will deal w magic num later
-        Spectrum null_weight = (Spectrum(majorant) - sigma_t) / denom;
-        beta *= null_weight;
+        // NULL COLLISION (beta already carries the null weight)
     }
 
     return false;
@@ -1,10 +1,11 @@
 #ifndef SKWR_KERNELS_UTILS_DIRECT_LIGHTING_H_
 #define SKWR_KERNELS_UTILS_DIRECT_LIGHTING_H_
 
+#include <algorithm>
 #include <cmath>
 
 #include "core/math/vec3.h"
-#include "core/sampling/rng.h"
+#include "core/sampling/sampling.h"
 #include "core/spectral/spectral_utils.h"
 #include "core/spectral/spectrum.h"
 #include "scene/scene.h"
@@ -18,12 +19,15 @@ struct DirectLightSample {
     Spectrum emission;  // Unattenuated light emission
 };
 
-inline bool GenerateLightSample(const Vec3& origin, const Scene& scene, RNG& rng,
-                                const SampledWavelengths& wl, DirectLightSample* out_sample) {
+// u_light picks the light uniformly, u_pos the point on it.
+inline bool GenerateLightSample(const Vec3& origin, const Scene& scene, float u_light,
+                                Sample2D u_pos, const SampledWavelengths& wl,
+                                DirectLightSample* out_sample) {
     if (scene.Lights().empty()) return false;
 
-    int light_index = int(rng.UniformFloat() * scene.Lights().size());
-    LightSample ls = SampleLight(scene, light_index, rng);
+    const int light_count = static_cast<int>(scene.Lights().size());
+    int light_index = std::min(int(u_light * light_count), light_count - 1);
+    LightSample ls = SampleLight(scene, light_index, u_pos);
 
     Vec3 to_light = ls.p - origin;
     float dist_sq = to_light.LengthSquared();
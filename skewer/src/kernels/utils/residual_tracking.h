@@ -0,0 +1,98 @@
+#ifndef SKWR_KERNELS_UTILS_RESIDUAL_TRACKING_H_
+#define SKWR_KERNELS_UTILS_RESIDUAL_TRACKING_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/math/constants.h"
+#include "core/math/vec3.h"
+#include "core/sampling/rng.h"
+#include "core/spectral/spectrum.h"
+#include "media/nano_vdb_medium.h"
+
+namespace skwr {
+
+/**
+ * Residual ratio tracking (Novák et al. 2014) over one piece [t_min, t_max] of a shadow ray whose
+ * density lies within [min_density, max_density]. The extinction is split into a constant control
+ * part σ_c = d_c ⋅ σ_base, whose transmittance e^(−σ_c ⋅ Δt) is known in closed form, and a residual
+ * σ_t − σ_c that is ratio tracked against its own (much smaller) majorant. With d_c = 0 this is
+ * plain ratio tracking against the full majorant.
+ *
+ * The residual may be negative where the density drops below the control, which only pushes the
+ * per-step weight above 1; the estimator stays unbiased. `density_at(t)` returns the density at
+ * the ray parameter t. Multiplies the piece's transmittance into `Tr` and returns false when
+ * Russian roulette terminates the ray.
+ */
+template <typename DensityFn>
+inline bool ResidualRatioTracking(const Spectrum& base_sigma_t, float min_density,
+                                  float max_density, float control_density, float t_min,
+                                  float t_max, RNG& rng, DensityFn&& density_at, Spectrum& Tr) {
+    float d_c = std::clamp(control_density, 0.0f, std::max(max_density, 0.0f));
+
+    if (d_c > 0.0f) {
+        for (int i = 0; i < kNSamples; ++i) {
+            Tr[i] *= std::exp(-d_c * base_sigma_t[i] * (t_max - t_min));
+        }
+    }
+
+    // Bound on |σ_t − σ_c| over the piece
+    float residual_density = std::max(max_density - d_c, d_c - std::min(min_density, d_c));
+    float majorant = residual_density * base_sigma_t.MaxComponentValue();
+    if (majorant <= 0.0f) return true;
+
+    float t = t_min;
+    while (true) {
+        // Step forward using the residual majorant
+        t += -std::log(std::max(1.0f - rng.UniformFloat(), Numeric::kFloatEpsilon)) / majorant;
+        if (t >= t_max) break;
+
+        // Evaluate the residual extinction at this point
+        float residual = density_at(t) - d_c;
+        Spectrum sigma_r = residual * base_sigma_t;
+
+        // Attenuate transmittance by the probability of NOT hitting a particle
+        Spectrum null_prob = Spectrum(1.0f) - (sigma_r / majorant);
+
+        for (int i = 0; i < kNSamples; ++i) {
+            Tr[i] *= std::max(0.0f, null_prob[i]);
+        }
+
+        // Russian Roulette (If transmittance is basically 0 kill early to save expensive
+        // VDB/density lookups)
+        float max_tr = Tr.MaxComponentValue();
+        if (max_tr < 0.05f) {
+            float q = std::max(0.05f, 1.0f - max_tr);
+            if (rng.UniformFloat() < q) return false;
+            Tr = Tr / (1.0f - q);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Residual ratio tracking along the index-space ray o + t ⋅ d, one majorant cell at a time, each
+ * against that cell's density bounds. auto_control uses each cell's own control density instead of
+ * `control_density`. Multiplies the transmittance over [t_min, t_max] into `Tr` and returns false
+ * when Russian roulette terminates the ray.
+ */
+template <typename DensityFn>
+inline bool MajorantCellTracking(const MajorantGrid& majorants, const Vec3& o, const Vec3& d,
+                                 const Spectrum& base_sigma_t, float control_density,
+                                 bool auto_control, float t_min, float t_max, RNG& rng,
+                                 DensityFn&& density_at, Spectrum& Tr) {
+    bool alive = true;
+    majorants.Traverse(
+        o, d, t_min, t_max, [&](float t0, float t1, const MajorantGrid::Cell& cell) {
+            float d_c = auto_control ? cell.control : control_density;
+            alive = ResidualRatioTracking(base_sigma_t, cell.min_density, cell.max_density, d_c,
+                                          t0, t1, rng, density_at, Tr);
+            return alive;
+        });
+    return alive;
+}
+
+}  // namespace skwr
+
+#endif  // SKWR_KERNELS_UTILS_RESIDUAL_TRACKING_H_
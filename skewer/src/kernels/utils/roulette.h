@@ -0,0 +1,45 @@
+#ifndef SKWR_KERNELS_UTILS_ROULETTE_H_
+#define SKWR_KERNELS_UTILS_ROULETTE_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/spectral/spectrum.h"
+
+namespace skwr {
+
+// Expected contribution of a path's continuation relative to the pixel estimate: its throughput
+// times the radiance NEE found at the current vertex, or times the pixel estimate when that is
+// larger (nothing is known about the rest of the path).
+inline float ExpectedContribution(const Spectrum& beta, const Spectrum& vertex_L,
+                                  float pixel_estimate) {
+    return beta.MaxComponentValue() * std::max(vertex_L.Average() / pixel_estimate, 1.0f);
+}
+
+// Paths the first diffuse vertex splits into. With a pixel estimate (efficiency mode) the count
+// shrinks with the expected contribution, so paths that add little are not multiplied.
+inline int SplitCount(int split_factor, const Spectrum& beta, const Spectrum& vertex_L,
+                      float pixel_estimate) {
+    if (pixel_estimate <= 0.0f) return split_factor;
+    const float ratio = ExpectedContribution(beta, vertex_L, pixel_estimate);
+    const float scaled = static_cast<float>(split_factor) * std::min(ratio, 1.0f);
+    return std::clamp(static_cast<int>(std::ceil(scaled)), 1, split_factor);
+}
+
+// Probability that Russian roulette keeps a path with throughput beta. With a pixel estimate the
+// weight window alone decides: the path survives with probability ratio / window and is
+// reweighted by 1 / p, however small its throughput. Throughput mode survives with probability
+// max(beta) and ends negligible paths outright.
+inline float RouletteSurvival(const Spectrum& beta, const Spectrum& vertex_L, float pixel_estimate,
+                              float window) {
+    if (pixel_estimate > 0.0f) {
+        return std::min(1.0f, ExpectedContribution(beta, vertex_L, pixel_estimate) / window);
+    }
+    const float max_beta = beta.MaxComponentValue();
+    if (max_beta < 0.001f) return 0.0f;
+    return std::min(0.95f, max_beta);
+}
+
+}  // namespace skwr
+
+#endif  // SKWR_KERNELS_UTILS_ROULETTE_H_
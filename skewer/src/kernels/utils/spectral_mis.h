@@ -0,0 +1,72 @@
+#ifndef SKWR_KERNELS_UTILS_SPECTRAL_MIS_H_
+#define SKWR_KERNELS_UTILS_SPECTRAL_MIS_H_
+
+#include <cmath>
+
+#include "core/spectral/spectrum.h"
+
+namespace skwr {
+
+// Probability of sampling distances with each wavelength channel: proportional to the throughput,
+// so channels a chromatic medium has already absorbed stop steering the samples. Uniform when the
+// throughput is zero.
+inline Spectrum ChannelPdf(const Spectrum& beta) {
+    float beta_sum = 0.0f;
+    for (int i = 0; i < kNSamples; ++i) beta_sum += beta[i];
+    if (beta_sum <= 0.0f) return Spectrum(1.0f / kNSamples);
+    return beta / beta_sum;
+}
+
+// Picks a channel from channel_pdf with one uniform number
+inline int SampleChannel(const Spectrum& channel_pdf, float u) {
+    for (int i = 0; i < kNSamples - 1; ++i) {
+        if (u < channel_pdf[i]) return i;
+        u -= channel_pdf[i];
+    }
+    return kNSamples - 1;
+}
+
+// One-sample MIS (balance heuristic) pdf of a distance sample: the per-channel pdfs mixed with the
+// probabilities used to pick the channel. Dividing by it gives every channel its MIS weight.
+inline float ChannelAveragedPdf(const Spectrum& channel_pdf, const Spectrum& pdf_spectrum) {
+    float pdf = 0.0f;
+    for (int i = 0; i < kNSamples; ++i) pdf += channel_pdf[i] * pdf_spectrum[i];
+    return pdf;
+}
+
+/**
+ * Spectral tracking collision decision (Kutz et al. 2017, "Spectral and Decomposition Tracking").
+ * At a tentative collision the real/null choice is made from throughput-weighted averages over the
+ * whole wavelength packet instead of from the hero channel alone:
+ *      P_real = avg(β σ_t) / (avg(β σ_t) + avg(β |σ_n|)),  σ_n = σˉ − σ_t
+ * and β is reweighted by f / (σˉ P) for the chosen event. A hero-only decision never collides in
+ * channels where the hero is clear but the others are not, and blows up the non-hero weights when
+ * the hero extinction is tiny; averaging keeps every channel's weight bounded.
+ *
+ * Returns true for a real collision (β now carries the single-scattering albedo), false for a null
+ * collision (β now carries the null-collision ratio).
+ */
+inline bool SpectralTrackingEvent(const Spectrum& sigma_t, const Spectrum& sigma_s, float majorant,
+                                  float u, Spectrum& beta) {
+    Spectrum sigma_n = Spectrum(majorant) - sigma_t;
+    float w_real = 0.0f;
+    float w_null = 0.0f;
+    for (int i = 0; i < kNSamples; ++i) {
+        w_real += beta[i] * sigma_t[i];
+        w_null += beta[i] * std::abs(sigma_n[i]);
+    }
+    float w_sum = w_real + w_null;
+    if (w_sum <= 0.0f) return false;  // Throughput already dead; let the caller run off the end
+
+    float p_real = w_real / w_sum;
+    if (u < p_real) {
+        beta *= sigma_s / (majorant * p_real);
+        return true;
+    }
+    beta *= sigma_n / (majorant * (1.0f - p_real));
+    return false;
+}
+
+}  // namespace skwr
+
+#endif  // SKWR_KERNELS_UTILS_SPECTRAL_MIS_H_
@@ -1,11 +1,15 @@
 #include "kernels/utils/volume_tracking.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "core/math/constants.h"
 #include "core/math/onb.h"
 #include "core/ray.h"
 #include "core/sampling/rng.h"
 #include "core/spectral/spectral_utils.h"
 #include "core/spectral/spectrum.h"
+#include "kernels/utils/residual_tracking.h"
 #include "media/mediums.h"
 #include "media/nano_vdb_medium.h"
 #include "scene/scene.h"
@@ -17,6 +21,8 @@ namespace skwr {
  * Ratio Tracking treats the volume as partially transparent at every step. It steps forward using
  * the majorant and continuously multiplies the transmittance T_r by the probability of a
  * null collision: T_r ⋅(1 − σ_t(x)/σˉ_t)
+ * When the medium has a control density only the residual around it is tracked. NanoVDB media
+ * track each majorant cell along the ray against that cell's bounds.
  */
 Spectrum CalculateGridTransmittance(const GridMedium& medium, RNG& rng, const Ray& shadow_ray,
                                     float dist) {
@@ -28,39 +34,14 @@ Spectrum CalculateGridTransmittance(const GridMedium& medium, RNG& rng, const Ra
     float t_max = std::min(dist, t_max_box);
     if (t_min >= t_max) return Spectrum(1.0f);
 
-    float t = t_min;
+    // The procedural grid carves out empty space, so its minimum density is 0 and the only
+    // useful control is none
     Spectrum Tr(1.0f);
-
-    float majorant =
-        medium.max_density * (medium.sigma_a_base + medium.sigma_s_base).MaxComponentValue();
-    if (majorant <= 0.0f) return Tr;
-
-    while (true) {
-        // Step forward using the majorant
-        t += -std::log(std::max(1.0f - rng.UniformFloat(), Numeric::kFloatEpsilon)) / majorant;
-        if (t >= t_max) break;
-
-        // Evaluate actual density at this point
-        float density = medium.GetDensity(shadow_ray.at(t));
-        Spectrum sigma_t = density * (medium.sigma_a_base + medium.sigma_s_base);
-
-        // Attenuate transmittance by the probability of NOT hitting a particle
-        Spectrum null_prob = Spectrum(1.0f) - (sigma_t / majorant);
-
-        for (int i = 0; i < kNSamples; ++i) {
-            Tr[i] *= std::max(0.0f, null_prob[i]);
-        }
-
-        // Russian Roulette (If transmittance is basically 0 kill early to save expensive
-        // VDB/density lookups)
-        float max_tr = Tr.MaxComponentValue();
-        if (max_tr < 0.05f) {
-            float q = std::max(0.05f, 1.0f - max_tr);
-            if (rng.UniformFloat() < q) return Spectrum(0.0f);
-            Tr = Tr / (1.0f - q);
-        }
+    if (!ResidualRatioTracking(medium.sigma_a_base + medium.sigma_s_base, 0.0f,
+                               medium.max_density, 0.0f, t_min, t_max, rng,
+                               [&](float t) { return medium.GetDensity(shadow_ray.at(t)); }, Tr)) {
+        return Spectrum(0.0f);
     }
-
     return Tr;
 }
 
@@ -75,40 +56,28 @@ Spectrum CalculateNanoVDBTransmittance(const NanoVDBMedium& medium, RNG& rng, co
     float t_max = std::min(dist, t_max_box);
     if (t_min >= t_max) return Spectrum(1.0f);
 
+    if (!medium.float_grid && !medium.fp16_grid) return Spectrum(1.0f);
+
     Spectrum base_sigma_a = CurveToSpectrum(medium.sigma_a_base, wl);
     Spectrum base_sigma_s = CurveToSpectrum(medium.sigma_s_base, wl);
     Spectrum base_sigma_t = base_sigma_a + base_sigma_s;
 
-    Spectrum Tr(1.0f);
-    float majorant = medium.max_density * base_sigma_t.MaxComponentValue();
-    if (majorant <= 0.0f) return Tr;
-
-    float t = t_min;
-    if (!medium.float_grid && !medium.fp16_grid) return Spectrum(1.0f);
     NanoVDBAccessor acc(medium);
+    auto density_at = [&](float t) { return medium.GetDensity(shadow_ray.at(t), trs, acc); };
 
-    while (true) {
-        t += -std::log(std::max(1.0f - rng.UniformFloat(), Numeric::kFloatEpsilon)) / majorant;
-        if (t >= t_max) break;
-
-        // FETCH FROM VDB
-        float density = medium.GetDensity(shadow_ray.at(t), trs, acc);
-        Spectrum sigma_t = density * base_sigma_t;
-
-        Spectrum null_prob = Spectrum(1.0f) - (sigma_t / majorant);
-        for (int i = 0; i < kNSamples; ++i) {
-            Tr[i] *= std::max(0.0f, null_prob[i]);
-        }
-
-        float max_tr = Tr.MaxComponentValue();
-        if (max_tr < 0.05f) {
-            float q = std::max(0.05f, 1.0f - max_tr);
-            if (rng.UniformFloat() < q) return Spectrum(0.0f);
-            Tr = Tr / (1.0f - q);
-        }
+    Spectrum Tr(1.0f);
+    bool alive = true;
+    if (medium.majorants.cells.empty()) {
+        alive = ResidualRatioTracking(base_sigma_t, medium.min_density, medium.max_density,
+                                      medium.control_density, t_min, t_max, rng, density_at, Tr);
+    } else {
+        // The index-space map is affine, so the ray keeps its parameterization there
+        Vec3 o = medium.WorldToIndex(shadow_ray.at(0.0f), trs);
+        Vec3 d = medium.WorldToIndex(shadow_ray.at(1.0f), trs) - o;
+        alive = MajorantCellTracking(medium.majorants, o, d, base_sigma_t, medium.control_density,
+                                     medium.auto_control, t_min, t_max, rng, density_at, Tr);
     }
-
-    return Tr;
+    return alive ? Tr : Spectrum(0.0f);
 }
 
 Spectrum CalculateTransmittance(const Scene& scene, RNG& rng, const Ray& shadow_ray, float dist,
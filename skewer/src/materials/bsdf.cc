@@ -1,5 +1,9 @@
 #include "materials/bsdf.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+
 #include "core/math/constants.h"
 #include "core/math/onb.h"
 #include "core/sampling/sampling.h"
@@ -34,21 +38,29 @@ inline float GGX_G(const Vec3& wo, const Vec3& wi, const Vec3& h, const Vec3& n,
     return GGX_G1(wo, h, n, alpha) * GGX_G1(wi, h, n, alpha);
 }
 
-inline Vec3 SampleGGX(const Vec3& n, float alpha, RNG& rng) {
-    float xi1 = rng.UniformFloat();
-    float xi2 = rng.UniformFloat();
-
-    // Map random numbers to a microfacet normal (half-vector)
-    float phi = 2.0f * MathConstants::kPi * xi1;
-    float cosTheta = std::sqrt((1.0f - xi2) / (1.0f + (alpha * alpha - 1.0f) * xi2));
-    float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
-
-    Vec3 h_local(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
-
-    // Transform from local tangent space to world space
-    ONB uvw;
-    uvw.BuildFromW(n);
-    return uvw.Local(h_local);
+// Samples a microfacet normal from the GGX normals visible from wo (Heitz 2018, "Sampling the
+// GGX Distribution of Visible Normals"). Local frame with the normal on +z. The density is
+// D_wo(h) = G1(wo) * max(0, wo.h) * D(h) / wo.z, so no sample lands on a back-facing facet.
+inline Vec3 SampleGGXVisible(const Vec3& wo, float alpha, Sample2D u) {
+    // Stretch the view direction to the alpha = 1 configuration
+    Vec3 vh = Normalize(Vec3(alpha * wo.x(), alpha * wo.y(), wo.z()));
+
+    // Orthonormal basis around vh
+    float len_sq = vh.x() * vh.x() + vh.y() * vh.y();
+    Vec3 t1 = len_sq > 0.0f ? Vec3(-vh.y(), vh.x(), 0.0f) / std::sqrt(len_sq) : Vec3(1, 0, 0);
+    Vec3 t2 = Cross(vh, t1);
+
+    // Point on the projected hemisphere: a disk, squashed by the visible fraction
+    float r = std::sqrt(u.u);
+    float phi = 2.0f * MathConstants::kPi * u.v;
+    float p1 = r * std::cos(phi);
+    float p2 = r * std::sin(phi);
+    float s = 0.5f * (1.0f + vh.z());
+    p2 = (1.0f - s) * std::sqrt(std::max(0.0f, 1.0f - p1 * p1)) + s * p2;
+
+    // Back onto the hemisphere, then unstretch
+    Vec3 nh = p1 * t1 + p2 * t2 + std::sqrt(std::max(0.0f, 1.0f - p1 * p1 - p2 * p2)) * vh;
+    return Normalize(Vec3(alpha * nh.x(), alpha * nh.y(), std::max(1e-6f, nh.z())));
 }
 
 // Exact dielectric Fresnel reflectance
@@ -79,26 +91,121 @@ inline float FrDielectric(float cosThetaI, float etaI, float etaT) {
     return (Rparl * Rparl + Rperp * Rperp) / 2.0f;
 }
 
-Spectrum EvalBSDF(const Material& mat, const ShadingData& sd, const Vec3& wo, const Vec3& wi,
-                  const SampledWavelengths& wl) {
-    (void)wo;
-    if (mat.type != MaterialType::Lambertian) return Spectrum(0.0f);  // specular = Dirac delta
+// -----------------------------------------------------------------------------
+// Lookup Tables
+// -----------------------------------------------------------------------------
 
-    float cosine = Dot(wi, sd.n_shading);
-    if (cosine <= 0.0f) return Spectrum(0.f);
+// GGX directional albedo: cell-centred in cos_o, grid points in roughness
+constexpr int kAlbedoCosSize = 32;
+constexpr int kAlbedoRoughnessSize = 32;
+constexpr int kAlbedoSamples = 32;  // Per axis, stratified VNDF samples per table entry
+
+// Dielectric Fresnel: grid points in cos_i over [0, 1] and relative IOR over [1, kFresnelEtaMax]
+constexpr int kFresnelCosSize = 128;
+constexpr int kFresnelEtaSize = 33;
+constexpr float kFresnelEtaMax = 3.0f;
+
+struct BSDFTables {
+    std::array<float, kAlbedoCosSize * kAlbedoRoughnessSize> ggx_albedo;  // [roughness][cos]
+    std::array<float, kFresnelCosSize * kFresnelEtaSize> fresnel;         // [eta][cos]
+};
+
+inline float MetalAlpha(float roughness) { return std::max(0.001f, roughness * roughness); }
+
+// Bilinear lookup; x and y are in texels and already clamped to the table
+inline float Bilinear(const float* table, int width, float x, float y) {
+    int x0 = std::min(static_cast<int>(x), width - 2);
+    int y0 = static_cast<int>(y);
+    float fx = x - static_cast<float>(x0);
+    float fy = y - static_cast<float>(y0);
+    const float* row0 = table + y0 * width + x0;
+    const float* row1 = fy > 0.0f ? row0 + width : row0;
+    float a = row0[0] + (row0[1] - row0[0]) * fx;
+    float b = row1[0] + (row1[1] - row1[0]) * fx;
+    return a + (b - a) * fy;
+}
 
-    Spectrum albedo = CurveToSpectrum(sd.albedo, wl);
+BSDFTables BuildTables() {
+    BSDFTables t;
+
+    // E(cos_o) = integral of the F = 1 lobe times cos_i = E[G / G1(wo)] under VNDF sampling
+    const Vec3 n(0.0f, 0.0f, 1.0f);
+    for (int ri = 0; ri < kAlbedoRoughnessSize; ++ri) {
+        float alpha = MetalAlpha(static_cast<float>(ri) / (kAlbedoRoughnessSize - 1));
+        for (int ci = 0; ci < kAlbedoCosSize; ++ci) {
+            float cos_o = (static_cast<float>(ci) + 0.5f) / kAlbedoCosSize;
+            Vec3 wo(std::sqrt(1.0f - cos_o * cos_o), 0.0f, cos_o);
+            double sum = 0.0;
+            for (int i = 0; i < kAlbedoSamples; ++i) {
+                for (int j = 0; j < kAlbedoSamples; ++j) {
+                    Sample2D u{(static_cast<float>(i) + 0.5f) / kAlbedoSamples,
+                               (static_cast<float>(j) + 0.5f) / kAlbedoSamples};
+                    Vec3 h = SampleGGXVisible(wo, alpha, u);
+                    Vec3 wi = Reflect(-wo, h);
+                    if (wi.z() <= 0.0f) continue;
+                    float g1_o = GGX_G1(wo, h, n, alpha);
+                    if (g1_o <= 0.0f) continue;
+                    sum += GGX_G1(wi, h, n, alpha);  // G / G1(wo) for separable Smith G
+                }
+            }
+            t.ggx_albedo[ri * kAlbedoCosSize + ci] =
+                static_cast<float>(sum / (kAlbedoSamples * kAlbedoSamples));
+        }
+    }
 
-    return albedo * MathConstants::kInvPi;
+    for (int ei = 0; ei < kFresnelEtaSize; ++ei) {
+        float eta = 1.0f + (kFresnelEtaMax - 1.0f) * static_cast<float>(ei) / (kFresnelEtaSize - 1);
+        for (int ci = 0; ci < kFresnelCosSize; ++ci) {
+            float cos_i = static_cast<float>(ci) / (kFresnelCosSize - 1);
+            // Matched indices reflect nothing; FrDielectric's grazing limit of 1 would leak into
+            // the interpolated row above
+            t.fresnel[ei * kFresnelCosSize + ci] = ei == 0 ? 0.0f : FrDielectric(cos_i, 1.0f, eta);
+        }
+    }
+    return t;
 }
 
-float PdfBSDF(const Material& mat, const ShadingData& sd, const Vec3& wo, const Vec3& wi) {
-    (void)wo;
-    if (mat.type != MaterialType::Lambertian) return 0.0f;
+// Built on first use; the GGX integration takes a few milliseconds
+const BSDFTables& Tables() {
+    static const BSDFTables tables = BuildTables();
+    return tables;
+}
 
-    float cosine = Dot(wi, sd.n_shading);
-    if (cosine <= 0.0) return 0.f;
-    return cosine * MathConstants::kInvPi;  // Cos-weighted hemisphere sampling
+float GGXAlbedo(float cos_o, float roughness) {
+    float x = std::clamp(cos_o * kAlbedoCosSize - 0.5f, 0.0f, kAlbedoCosSize - 1.0f);
+    float y = std::clamp(roughness, 0.0f, 1.0f) * (kAlbedoRoughnessSize - 1);
+    return std::max(0.05f, Bilinear(Tables().ggx_albedo.data(), kAlbedoCosSize, x, y));
+}
+
+float FresnelDielectric(float cos_theta_i, float eta_i, float eta_t) {
+    cos_theta_i = std::clamp(cos_theta_i, -1.0f, 1.0f);
+    if (cos_theta_i < 0.0f) {
+        // Exiting: F is the same as entering at the transmitted angle, since sin_t = eta sin_i
+        std::swap(eta_i, eta_t);
+        float ratio = eta_i / eta_t;
+        float sin2_t = ratio * ratio * (1.0f - cos_theta_i * cos_theta_i);
+        if (sin2_t >= 1.0f) return 1.0f;  // Total Internal Reflection
+        cos_theta_i = std::sqrt(1.0f - sin2_t);
+        std::swap(eta_i, eta_t);
+    }
+
+    float eta = eta_t / eta_i;
+    if (!(eta >= 1.0f && eta <= kFresnelEtaMax)) return FrDielectric(cos_theta_i, eta_i, eta_t);
+    float x = cos_theta_i * (kFresnelCosSize - 1);
+    float y = (eta - 1.0f) * ((kFresnelEtaSize - 1) / (kFresnelEtaMax - 1.0f));
+    return Bilinear(Tables().fresnel.data(), kFresnelCosSize, x, y);
+}
+
+Spectrum EvalBSDF(const Material& mat, const ShadingData& sd, const Vec3& wo, const Vec3& wi,
+                  const SampledWavelengths& wl) {
+    return DispatchMaterialType(mat.type, [&](auto tag) {
+        return EvalBSDF<decltype(tag)::value>(mat, sd, wo, wi, wl);
+    });
+}
+
+float PdfBSDF(const Material& mat, const ShadingData& sd, const Vec3& wo, const Vec3& wi) {
+    return DispatchMaterialType(
+        mat.type, [&](auto tag) { return PdfBSDF<decltype(tag)::value>(mat, sd, wo, wi); });
 }
 
 /**
@@ -109,13 +216,13 @@ float PdfBSDF(const Material& mat, const ShadingData& sd, const Vec3& wo, const
  */
 
 bool SampleLambertian(const Material& mat, const ShadingData& sd, const SurfaceInteraction& si,
-                      RNG& rng, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f) {
+                      Sample2D u, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f) {
     (void)mat;
     (void)si;
     ONB uvw;
     uvw.BuildFromW(sd.n_shading);
 
-    Vec3 local_dir = RandomCosineDirection(rng);
+    Vec3 local_dir = SampleCosineHemisphere(u);
     wi = uvw.Local(local_dir);
 
     // Explicit PDF and Eval
@@ -128,52 +235,62 @@ bool SampleLambertian(const Material& mat, const ShadingData& sd, const SurfaceI
     return true;
 }
 
-bool SampleMetal(const Material& mat, const ShadingData& sd, const SurfaceInteraction& si, RNG& rng,
-                 const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f) {
+bool SampleMetal(const Material& mat, const ShadingData& sd, const SurfaceInteraction& si,
+                 Sample2D u, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f) {
     // Perceptual roughness mapping (artists prefer roughness^2)
-    // Clamp to prevent dividing by zero on perfectly smooth mirrors
-    float alpha = std::max(0.001f, mat.roughness * mat.roughness);
+    // Clamp to prevent dividing by zero on perfectly smooth mirrors. sd.roughness includes the
+    // roughness texture, if any.
+    float alpha = MetalAlpha(sd.roughness);
 
     Vec3 wo = si.wo;
+    float NoO = Dot(sd.n_shading, wo);
+    float NoO_geom = Dot(si.n_geom, wo);
+    if (NoO <= 0.0f || NoO_geom <= 0.0f) return false;
 
-    // Sample random microscopic mirror normal (half-vector 'h')
-    Vec3 h = SampleGGX(sd.n_shading, alpha, rng);
+    // Sample a microscopic mirror normal (half-vector 'h') among those visible from wo
+    ONB uvw;
+    uvw.BuildFromW(sd.n_shading);
+    Vec3 wo_local(Dot(wo, uvw.u()), Dot(wo, uvw.v()), NoO);
+    Vec3 h_local = SampleGGXVisible(wo_local, alpha, u);
+    Vec3 h = uvw.Local(h_local);
 
     // Reflect the camera ray off that specific micro-mirror to get the light direction
     wi = Reflect(-wo, h);
 
     float NoI = Dot(sd.n_shading, wi);
-    float NoO = Dot(sd.n_shading, wo);
 
     // Physical mesh calc to prevent leaking through actual mesh
     float NoI_geom = Dot(si.n_geom, wi);
-    float NoO_geom = Dot(si.n_geom, wo);
 
-    if (NoI <= 0.0f || NoO <= 0.0f || NoI_geom <= 0.0f || NoO_geom <= 0.0f)
-        return false;  // under surface = kill
+    if (NoI <= 0.0f || NoI_geom <= 0.0f) return false;  // under surface = kill
 
     // Evaluate the GGX terms
     float D = GGX_D(sd.n_shading, h, alpha);
-    float G = GGX_G(wo, wi, h, sd.n_shading, alpha);
+    float G1_o = GGX_G1(wo, h, sd.n_shading, alpha);
+    float G = G1_o * GGX_G1(wi, h, sd.n_shading, alpha);
+
+    // Visible-normal pdf of h, times the Jacobian of the reflection 1 / (4 * HoO)
+    pdf = (D * G1_o) / (4.0f * NoO);
+    if (pdf <= 0.0f) return false;
 
     // F (Fresnel) is handled by the spectral albedo curve for basic metals
     Spectrum F = CurveToSpectrum(mat.albedo, wl);
 
-    // Calculate the PDF of sampling this specific direction
-    float HoO = std::abs(Dot(h, wo));
-    pdf = (D * Dot(sd.n_shading, h)) / (4.0f * HoO);
-    if (pdf <= 0.0f) return false;
+    // The single-scattering lobe reflects only E(wo) of the energy; the rest leaves after more
+    // bounces between microfacets. Scaling by 1 + F * (1 - E) / E puts it back (Turquin 2019).
+    float E = GGXAlbedo(NoO, sd.roughness);
+    Spectrum compensation = Spectrum(1.0f) + F * ((1.0f - E) / E);
 
     // Assemble the Cook-Torrance Microfacet BRDF
     // f = (D * G * F) / (4 * NoI * NoO)
-    f = F * ((D * G) / (4.0f * NoI * NoO));
+    f = F * compensation * ((D * G) / (4.0f * NoI * NoO));
 
     return true;
 }
 
 // Returns true if a valid bounce occurred, outputs the new direction (wi), pdf, and BSDF (f)
 bool SampleDielectric(const Material& mat, const ShadingData& sd, const SurfaceInteraction& si,
-                      RNG& rng, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f) {
+                      float uc, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f) {
     (void)sd;
 
     float cosThetaI = Dot(si.wo, si.n_geom);
@@ -205,7 +322,7 @@ bool SampleDielectric(const Material& mat, const ShadingData& sd, const SurfaceI
     for (int i = 0; i < kNSamples; ++i) {
         // FrDielectric mathematically requires a negative cosine to know it is exiting
         float cosForFresnel = entering ? absCosI : -absCosI;
-        F[i] = FrDielectric(cosForFresnel, etaI[i], etaT[i]);
+        F[i] = FresnelDielectric(cosForFresnel, etaI[i], etaT[i]);
     }
 
     // Probability of reflect/refract based on the Hero Wavelength's Fresnel value
@@ -213,7 +330,7 @@ bool SampleDielectric(const Material& mat, const ShadingData& sd, const SurfaceI
     float pr = F_hero;         // Probability to reflect
     float pt = 1.0f - F_hero;  // Probability to refract
 
-    if (rng.UniformFloat() < pr) {
+    if (uc < pr) {
         // Reflection
         // Geometry is same for all wavelengths (Angle In = Angle Out) so we dont kill
         wi = Reflect(-si.wo, n_oriented);  // n_oriented and n_geom yield same result for reflection
@@ -260,20 +377,11 @@ bool SampleDielectric(const Material& mat, const ShadingData& sd, const SurfaceI
 }
 
 bool SampleBSDF(const Material& mat, const ShadingData& sd, const Ray& r_in,
-                const SurfaceInteraction& si, RNG& rng, const SampledWavelengths& wl, Vec3& wi,
-                float& pdf, Spectrum& f) {
-    (void)r_in;
-    switch (mat.type) {
-        case MaterialType::Lambertian:
-            return SampleLambertian(mat, sd, si, rng, wl, wi, pdf, f);
-
-        case MaterialType::Metal:
-            return SampleMetal(mat, sd, si, rng, wl, wi, pdf, f);
-
-        case MaterialType::Dielectric:
-            return SampleDielectric(mat, sd, si, rng, wl, wi, pdf, f);
-    }
-    return false;
+                const SurfaceInteraction& si, float uc, Sample2D u, const SampledWavelengths& wl,
+                Vec3& wi, float& pdf, Spectrum& f) {
+    return DispatchMaterialType(mat.type, [&](auto tag) {
+        return SampleBSDF<decltype(tag)::value>(mat, sd, r_in, si, uc, u, wl, wi, pdf, f);
+    });
 }
 
 }  // namespace skwr
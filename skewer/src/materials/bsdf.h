@@ -1,8 +1,10 @@
 #ifndef SKWR_MATERIALS_BSDF_H_
 #define SKWR_MATERIALS_BSDF_H_
 
+#include "core/math/constants.h"
 #include "core/math/vec3.h"
-#include "core/sampling/rng.h"
+#include "core/sampling/sampling.h"
+#include "core/spectral/spectral_utils.h"
 #include "core/spectral/spectrum.h"
 #include "core/transport/surface_interaction.h"
 #include "materials/material.h"
@@ -24,6 +26,19 @@ Spectrum EvalBSDF(const Material& mat, const ShadingData& sd, const Vec3& wo, co
  */
 float PdfBSDF(const Material& mat, const ShadingData& sd, const Vec3& wo, const Vec3& wi);
 
+/**
+ * Directional albedo E of the single-scattering GGX lobe (F = 1) for a view at cos_o, from a
+ * table integrated at first use. The remaining 1 - E is what rough metals lose to scattering
+ * between microfacets; SampleMetal adds it back.
+ */
+float GGXAlbedo(float cos_o, float roughness);
+
+/**
+ * Dielectric Fresnel reflectance, read from a table for relative IORs in [1, 3] and computed
+ * exactly otherwise. cos_theta_i < 0 means the ray leaves the eta_t side (eta_i and eta_t swap).
+ */
+float FresnelDielectric(float cos_theta_i, float eta_i, float eta_t);
+
 inline float Reflectance(float cosine, float refraction_ratio) {
     // Use Schlick's approximation for reflectance.
     auto r0 = (1 - refraction_ratio) / (1 + refraction_ratio);
@@ -32,23 +47,69 @@ inline float Reflectance(float cosine, float refraction_ratio) {
 }
 
 bool SampleLambertian(const Material& mat, const ShadingData& sd, const SurfaceInteraction& si,
-                      RNG& rng, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f);
+                      Sample2D u, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f);
 
-bool SampleMetal(const Material& mat, const ShadingData& sd, const SurfaceInteraction& si, RNG& rng,
-                 const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f);
+bool SampleMetal(const Material& mat, const ShadingData& sd, const SurfaceInteraction& si,
+                 Sample2D u, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f);
 
 bool SampleDielectric(const Material& mat, const ShadingData& sd, const SurfaceInteraction& si,
-                      RNG& rng, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f);
+                      float uc, const SampledWavelengths& wl, Vec3& wi, float& pdf, Spectrum& f);
 
 /**
  * This function takes the Incoming Ray and returns two things:
  * - Attenuation: How much light was absorbed (the color).
  * - Scattered Ray: The new direction the photon travels.
  * Dispatches to correct material type sampling function
+ * uc selects between lobes (reflect/refract), u drives the direction within a lobe.
  */
 bool SampleBSDF(const Material& mat, const ShadingData& sd, const Ray& r_in,
-                const SurfaceInteraction& si, RNG& rng, const SampledWavelengths& wl, Vec3& wi,
-                float& pdf, Spectrum& f);
+                const SurfaceInteraction& si, float uc, Sample2D u, const SampledWavelengths& wl,
+                Vec3& wi, float& pdf, Spectrum& f);
+
+/**
+ * Per-type kernels
+ * The functions above switch on mat.type on every call. Callers that already know the type
+ * (see DispatchMaterialType) call these instead; the dispatchers forward to them.
+ */
+template <MaterialType T>
+inline Spectrum EvalBSDF([[maybe_unused]] const Material& mat,
+                         [[maybe_unused]] const ShadingData& sd, [[maybe_unused]] const Vec3& wo,
+                         [[maybe_unused]] const Vec3& wi,
+                         [[maybe_unused]] const SampledWavelengths& wl) {
+    if constexpr (T != MaterialType::Lambertian) {
+        return Spectrum(0.0f);  // specular = Dirac delta
+    } else {
+        float cosine = Dot(wi, sd.n_shading);
+        if (cosine <= 0.0f) return Spectrum(0.f);
+        return CurveToSpectrum(sd.albedo, wl) * MathConstants::kInvPi;
+    }
+}
+
+template <MaterialType T>
+inline float PdfBSDF([[maybe_unused]] const Material& mat, [[maybe_unused]] const ShadingData& sd,
+                     [[maybe_unused]] const Vec3& wo, [[maybe_unused]] const Vec3& wi) {
+    if constexpr (T != MaterialType::Lambertian) {
+        return 0.0f;
+    } else {
+        float cosine = Dot(wi, sd.n_shading);
+        if (cosine <= 0.0f) return 0.f;
+        return cosine * MathConstants::kInvPi;  // Cos-weighted hemisphere sampling
+    }
+}
+
+template <MaterialType T>
+inline bool SampleBSDF(const Material& mat, const ShadingData& sd, [[maybe_unused]] const Ray& r_in,
+                       const SurfaceInteraction& si, [[maybe_unused]] float uc,
+                       [[maybe_unused]] Sample2D u, const SampledWavelengths& wl, Vec3& wi,
+                       float& pdf, Spectrum& f) {
+    if constexpr (T == MaterialType::Lambertian) {
+        return SampleLambertian(mat, sd, si, u, wl, wi, pdf, f);
+    } else if constexpr (T == MaterialType::Metal) {
+        return SampleMetal(mat, sd, si, u, wl, wi, pdf, f);
+    } else {
+        return SampleDielectric(mat, sd, si, uc, wl, wi, pdf, f);
+    }
+}
 
 }  // namespace skwr
 
@@ -2,6 +2,7 @@
 #define SKWR_MATERIALS_MATERIAL_H_
 
 #include <cstdint>
+#include <type_traits>
 
 #include "core/spectral/spectral_curve.h"
 
@@ -9,6 +10,24 @@ namespace skwr {
 
 enum class MaterialType : uint8_t { Lambertian, Metal, Dielectric };
 
+template <MaterialType T>
+using MaterialTypeTag = std::integral_constant<MaterialType, T>;
+
+// Calls f(MaterialTypeTag<type>{}). With f a generic lambda, its body is compiled once per type
+// and tests on decltype(tag)::value fold away, so a vertex switches on the type once.
+template <typename F>
+decltype(auto) DispatchMaterialType(MaterialType type, F&& f) {
+    switch (type) {
+        case MaterialType::Metal:
+            return f(MaterialTypeTag<MaterialType::Metal>{});
+        case MaterialType::Dielectric:
+            return f(MaterialTypeTag<MaterialType::Dielectric>{});
+        case MaterialType::Lambertian:
+            break;
+    }
+    return f(MaterialTypeTag<MaterialType::Lambertian>{});
+}
+
 // 32-byte aligned to fit in cache?
 struct alignas(16) Material {
     SpectralCurve albedo;                          // Color (Diffuse or Specular)
@@ -41,6 +60,8 @@ struct alignas(16) Material {
     bool HasAlbedoTexture() const { return albedo_tex != UINT32_MAX; }
     bool HasNormalMap() const { return normal_tex != UINT32_MAX; }
     bool HasRoughnessMap() const { return roughness_tex != UINT32_MAX; }
+    // Any texture lookup needs the tangent frame (normal mapping and MIP footprint)
+    bool HasTextures() const { return HasAlbedoTexture() || HasNormalMap() || HasRoughnessMap(); }
 };
 
 }  // namespace skwr
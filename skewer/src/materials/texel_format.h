@@ -0,0 +1,239 @@
+#ifndef SKWR_MATERIALS_TEXEL_FORMAT_H_
+#define SKWR_MATERIALS_TEXEL_FORMAT_H_
+
+#include <half.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "core/color/color.h"
+#include "core/math/simd.h"
+
+namespace skwr {
+
+// Compact storage formats for texels. Images are decoded to linear float and re-encoded in the
+// smallest format that preserves the source: 8-bit sources stay 8-bit (sRGB-encoded for color so
+// the quantization matches the file), HDR sources are stored as half floats, and single-channel
+// data keeps one byte per texel.
+enum class TexelFormat : uint8_t {
+    SRGB8,   // 3 x uint8, sRGB transfer curve
+    RGB8,    // 3 x uint8, linear
+    R8,      // 1 x uint8, linear; fetched as (r, r, r)
+    RGB16F,  // 3 x half, linear
+    RGB32F,  // 3 x float, linear
+};
+
+// What a texture's values mean; picks the storage format and transfer curve at load.
+enum class TextureUsage : uint8_t {
+    Color,   // Albedo-like color: 8-bit sources are sRGB-encoded
+    Data,    // Non-color vectors (normal maps): 8-bit values are used as-is
+    Scalar,  // Single-channel data (roughness): only the red channel is kept
+};
+
+constexpr int TexelBytes(TexelFormat format) {
+    switch (format) {
+        case TexelFormat::SRGB8:
+        case TexelFormat::RGB8:
+            return 3;
+        case TexelFormat::R8:
+            return 1;
+        case TexelFormat::RGB16F:
+            return 3 * static_cast<int>(sizeof(half));
+        case TexelFormat::RGB32F:
+            return 3 * static_cast<int>(sizeof(float));
+    }
+    return 0;
+}
+
+// Vector fetches load a full 4/8/16-byte word per texel, so texel storage is padded by this many
+// bytes past the last texel.
+constexpr size_t kTexelReadPadding = 16;
+
+inline TexelFormat ChooseTexelFormat(TextureUsage usage, bool hdr) {
+    if (usage == TextureUsage::Scalar) return TexelFormat::R8;
+    if (hdr) return TexelFormat::RGB16F;
+    return usage == TextureUsage::Color ? TexelFormat::SRGB8 : TexelFormat::RGB8;
+}
+
+inline float SRGBToLinear(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+inline float LinearToSRGB(float c) {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// 8-bit sRGB -> linear lookup table (built once, thread-safe static init)
+inline const std::array<float, 256>& SRGB8ToLinearTable() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> t{};
+        for (int i = 0; i < 256; ++i) t[i] = SRGBToLinear(static_cast<float>(i) / 255.0f);
+        return t;
+    }();
+    return table;
+}
+
+inline uint8_t EncodeSRGB8(float linear) {
+    float s = LinearToSRGB(std::clamp(linear, 0.0f, 1.0f));
+    return static_cast<uint8_t>(std::lround(s * 255.0f));
+}
+
+inline uint8_t EncodeUnorm8(float v) {
+    return static_cast<uint8_t>(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f));
+}
+
+// Encode one linear RGB texel into dst (TexelBytes(format) bytes).
+inline void EncodeTexel(TexelFormat format, const float* rgb, uint8_t* dst) {
+    switch (format) {
+        case TexelFormat::SRGB8:
+            dst[0] = EncodeSRGB8(rgb[0]);
+            dst[1] = EncodeSRGB8(rgb[1]);
+            dst[2] = EncodeSRGB8(rgb[2]);
+            break;
+        case TexelFormat::RGB8:
+            dst[0] = EncodeUnorm8(rgb[0]);
+            dst[1] = EncodeUnorm8(rgb[1]);
+            dst[2] = EncodeUnorm8(rgb[2]);
+            break;
+        case TexelFormat::R8:
+            dst[0] = EncodeUnorm8(rgb[0]);
+            break;
+        case TexelFormat::RGB16F: {
+            half h[3] = {half(rgb[0]), half(rgb[1]), half(rgb[2])};
+            std::memcpy(dst, h, sizeof(h));
+            break;
+        }
+        case TexelFormat::RGB32F:
+            std::memcpy(dst, rgb, 3 * sizeof(float));
+            break;
+    }
+}
+
+// Decode one texel back to linear RGB.
+inline void DecodeTexel(TexelFormat format, const uint8_t* src, float* rgb) {
+    switch (format) {
+        case TexelFormat::SRGB8: {
+            const std::array<float, 256>& lut = SRGB8ToLinearTable();
+            rgb[0] = lut[src[0]];
+            rgb[1] = lut[src[1]];
+            rgb[2] = lut[src[2]];
+            break;
+        }
+        case TexelFormat::RGB8:
+            rgb[0] = static_cast<float>(src[0]) * (1.0f / 255.0f);
+            rgb[1] = static_cast<float>(src[1]) * (1.0f / 255.0f);
+            rgb[2] = static_cast<float>(src[2]) * (1.0f / 255.0f);
+            break;
+        case TexelFormat::R8:
+            rgb[0] = rgb[1] = rgb[2] = static_cast<float>(src[0]) * (1.0f / 255.0f);
+            break;
+        case TexelFormat::RGB16F: {
+            half h[3];
+            std::memcpy(h, src, sizeof(h));
+            rgb[0] = h[0];
+            rgb[1] = h[1];
+            rgb[2] = h[2];
+            break;
+        }
+        case TexelFormat::RGB32F:
+            std::memcpy(rgb, src, 3 * sizeof(float));
+            break;
+    }
+}
+
+#ifdef SKWR_SIMD_SSE
+// Load one texel into lanes 0-2 of an SSE register. May read up to kTexelReadPadding bytes.
+template <TexelFormat F>
+inline __m128 LoadTexelSSE(const uint8_t* p) {
+    if constexpr (F == TexelFormat::SRGB8) {
+        const std::array<float, 256>& lut = SRGB8ToLinearTable();
+        return _mm_setr_ps(lut[p[0]], lut[p[1]], lut[p[2]], 0.0f);
+    } else if constexpr (F == TexelFormat::RGB8) {
+        int32_t word;
+        std::memcpy(&word, p, sizeof(word));
+        const __m128i zero = _mm_setzero_si128();
+        __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(word), zero);
+        v = _mm_unpacklo_epi16(v, zero);
+        return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 255.0f));
+    } else if constexpr (F == TexelFormat::RGB16F) {
+#if defined(__F16C__)
+        return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+#else
+        float rgb[3] = {0.0f, 0.0f, 0.0f};
+        DecodeTexel(F, p, rgb);
+        return _mm_setr_ps(rgb[0], rgb[1], rgb[2], 0.0f);
+#endif
+    } else {
+        return _mm_loadu_ps(reinterpret_cast<const float*>(p));
+    }
+}
+#endif
+
+// Bilinear blend of four texels (row y0: t00, t10; row y1: t01, t11) with weights (tx, ty).
+template <TexelFormat F>
+inline RGB BilinearTexels(const uint8_t* t00, const uint8_t* t10, const uint8_t* t01,
+                          const uint8_t* t11, float tx, float ty) {
+#ifdef SKWR_SIMD_SSE
+    if constexpr (F == TexelFormat::R8) {
+        // One channel: all four texels share a register and the blend is a dot product
+        __m128 v = _mm_setr_ps(t00[0], t10[0], t01[0], t11[0]);
+        __m128 w = _mm_setr_ps((1.0f - tx) * (1.0f - ty), tx * (1.0f - ty), (1.0f - tx) * ty,
+                               tx * ty);
+        __m128 p = _mm_mul_ps(v, w);
+        __m128 s = _mm_add_ps(p, _mm_movehl_ps(p, p));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        float r = _mm_cvtss_f32(s) * (1.0f / 255.0f);
+        return RGB(r, r, r);
+    } else {
+        __m128 c00 = LoadTexelSSE<F>(t00);
+        __m128 c10 = LoadTexelSSE<F>(t10);
+        __m128 c01 = LoadTexelSSE<F>(t01);
+        __m128 c11 = LoadTexelSSE<F>(t11);
+        __m128 wx = _mm_set1_ps(tx);
+        __m128 r0 = _mm_add_ps(c00, _mm_mul_ps(wx, _mm_sub_ps(c10, c00)));
+        __m128 r1 = _mm_add_ps(c01, _mm_mul_ps(wx, _mm_sub_ps(c11, c01)));
+        __m128 c = _mm_add_ps(r0, _mm_mul_ps(_mm_set1_ps(ty), _mm_sub_ps(r1, r0)));
+        alignas(16) float out[4];
+        _mm_store_ps(out, c);
+        return RGB(out[0], out[1], out[2]);
+    }
+#else
+    float c[4][3] = {};
+    DecodeTexel(F, t00, c[0]);
+    DecodeTexel(F, t10, c[1]);
+    DecodeTexel(F, t01, c[2]);
+    DecodeTexel(F, t11, c[3]);
+    float out[3];
+    for (int k = 0; k < 3; ++k) {
+        float r0 = c[0][k] + tx * (c[1][k] - c[0][k]);
+        float r1 = c[2][k] + tx * (c[3][k] - c[2][k]);
+        out[k] = r0 + ty * (r1 - r0);
+    }
+    return RGB(out[0], out[1], out[2]);
+#endif
+}
+
+inline RGB BilinearTexels(TexelFormat format, const uint8_t* t00, const uint8_t* t10,
+                          const uint8_t* t01, const uint8_t* t11, float tx, float ty) {
+    switch (format) {
+        case TexelFormat::SRGB8:
+            return BilinearTexels<TexelFormat::SRGB8>(t00, t10, t01, t11, tx, ty);
+        case TexelFormat::RGB8:
+            return BilinearTexels<TexelFormat::RGB8>(t00, t10, t01, t11, tx, ty);
+        case TexelFormat::R8:
+            return BilinearTexels<TexelFormat::R8>(t00, t10, t01, t11, tx, ty);
+        case TexelFormat::RGB16F:
+            return BilinearTexels<TexelFormat::RGB16F>(t00, t10, t01, t11, tx, ty);
+        case TexelFormat::RGB32F:
+            return BilinearTexels<TexelFormat::RGB32F>(t00, t10, t01, t11, tx, ty);
+    }
+    return RGB(1.0f, 0.0f, 1.0f);
+}
+
+}  // namespace skwr
+
+#endif  // SKWR_MATERIALS_TEXEL_FORMAT_H_
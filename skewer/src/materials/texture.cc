@@ -5,65 +5,299 @@
 #include "materials/texture.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <iostream>
+#include <mutex>
+#include <utility>
 
+#include "core/math/simd.h"
+#include "core/spectral/spectral_utils.h"
+#include "materials/texture_cache.h"
 #include "stb_image.h"
 
 namespace skwr {
 
-bool ImageTexture::Load(const std::string& filepath) {
+namespace {
+
+// stb_image keeps its flip flag and failure reason in globals; serialize every call into it.
+std::mutex& StbMutex() {
+    static std::mutex m;
+    return m;
+}
+
+TexelLevel EncodeLevel(const MipLevel& src, TexelFormat format) {
+    const int texel_bytes = TexelBytes(format);
+    const size_t count = static_cast<size_t>(src.width) * src.height;
+    TexelLevel dst;
+    dst.width = src.width;
+    dst.height = src.height;
+    dst.texels.assign(count * texel_bytes + kTexelReadPadding, 0);
+    for (size_t i = 0; i < count; ++i) {
+        EncodeTexel(format, &src.data[i * 3], &dst.texels[i * texel_bytes]);
+    }
+    return dst;
+}
+
+// Bilinear lookup on one MIP level.
+RGB SampleLevel(TexelFormat format, const TexelLevel& level, float u, float v,
+                TextureWrapMode wrap) {
+    BilinearFootprint fp = ComputeBilinearFootprint(level.width, level.height, u, v, wrap);
+
+    const int texel_bytes = TexelBytes(format);
+    auto texel = [&](int x, int y) {
+        return &level.texels[(static_cast<size_t>(y) * level.width + x) * texel_bytes];
+    };
+
+    return BilinearTexels(format, texel(fp.x0, fp.y0), texel(fp.x1, fp.y0), texel(fp.x0, fp.y1),
+                          texel(fp.x1, fp.y1), fp.tx, fp.ty);
+}
+
+// Bilinear lookup of rgb2spec coefficients on one level; out receives coeff[0..2] and scale.
+void SampleCurveLevel(const CurveLevel& level, float u, float v, TextureWrapMode wrap,
+                      float* out) {
+    BilinearFootprint fp = ComputeBilinearFootprint(level.width, level.height, u, v, wrap);
+
+    auto curve = [&](int x, int y) {
+        return &level.data[(static_cast<size_t>(y) * level.width + x) * 4];
+    };
+    const float* c00 = curve(fp.x0, fp.y0);
+    const float* c10 = curve(fp.x1, fp.y0);
+    const float* c01 = curve(fp.x0, fp.y1);
+    const float* c11 = curve(fp.x1, fp.y1);
+
+#if defined(SKWR_SIMD_SSE)
+    // All four curve parameters fit one register
+    using simd::Float4;
+    Float4 tx = Float4::Broadcast(fp.tx);
+    Float4 a = Float4::Load(c00);
+    Float4 b = Float4::Load(c01);
+    Float4 r0 = a + tx * (Float4::Load(c10) - a);
+    Float4 r1 = b + tx * (Float4::Load(c11) - b);
+    (r0 + Float4::Broadcast(fp.ty) * (r1 - r0)).Store(out);
+#else
+    for (int k = 0; k < 4; ++k) {
+        float r0 = c00[k] + fp.tx * (c10[k] - c00[k]);
+        float r1 = c01[k] + fp.tx * (c11[k] - c01[k]);
+        out[k] = r0 + fp.ty * (r1 - r0);
+    }
+#endif
+}
+
+}  // namespace
+
+// Odd source dimensions fold their last row/column into the final texel.
+MipLevel DownsampleMip(const MipLevel& src) {
+    MipLevel dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.data.resize(static_cast<size_t>(dst.width) * dst.height * 3);
+
+    for (int y = 0; y < dst.height; ++y) {
+        int sy0 = std::min(2 * y, src.height - 1);
+        int sy1 = (y == dst.height - 1) ? src.height - 1 : std::min(2 * y + 1, src.height - 1);
+        for (int x = 0; x < dst.width; ++x) {
+            int sx0 = std::min(2 * x, src.width - 1);
+            int sx1 = (x == dst.width - 1) ? src.width - 1 : std::min(2 * x + 1, src.width - 1);
+
+            float sum[3] = {0.0f, 0.0f, 0.0f};
+            int count = 0;
+            for (int sy = sy0; sy <= sy1; ++sy) {
+                for (int sx = sx0; sx <= sx1; ++sx) {
+                    const float* p = &src.data[(static_cast<size_t>(sy) * src.width + sx) * 3];
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                    ++count;
+                }
+            }
+            float* out = &dst.data[(static_cast<size_t>(y) * dst.width + x) * 3];
+            float inv = 1.0f / static_cast<float>(count);
+            out[0] = sum[0] * inv;
+            out[1] = sum[1] * inv;
+            out[2] = sum[2] * inv;
+        }
+    }
+    return dst;
+}
+
+bool ReadImageSize(const std::string& filepath, int* width, int* height) {
+    std::lock_guard<std::mutex> lock(StbMutex());
     int n;
-    stbi_set_flip_vertically_on_load(true);
-    float* raw = stbi_loadf(filepath.c_str(), &width, &height, &n, 3);
-    if (!raw) {
+    if (!stbi_info(filepath.c_str(), width, height, &n) || *width <= 0 || *height <= 0) {
         std::cerr << "[Texture] Failed to load: " << filepath << " (" << stbi_failure_reason()
                   << ")\n";
+        return false;
+    }
+    return true;
+}
+
+bool DecodeImageFile(const std::string& filepath, TextureUsage usage, MipLevel* image,
+                     TexelFormat* format) {
+    std::lock_guard<std::mutex> lock(StbMutex());
+    stbi_set_flip_vertically_on_load(true);
+
+    const bool hdr = stbi_is_hdr(filepath.c_str()) != 0;
+    int w = 0;
+    int h = 0;
+    int n;
+    if (hdr) {
+        float* raw = stbi_loadf(filepath.c_str(), &w, &h, &n, 3);
+        if (!raw) {
+            std::cerr << "[Texture] Failed to load: " << filepath << " ("
+                      << stbi_failure_reason() << ")\n";
+            return false;
+        }
+        image->data.assign(raw, raw + static_cast<size_t>(w) * h * 3);
+        stbi_image_free(raw);
+    } else {
+        // Load 8-bit sources as bytes so the transfer curve is ours, not stb's gamma 2.2
+        unsigned char* raw = stbi_load(filepath.c_str(), &w, &h, &n, 3);
+        if (!raw) {
+            std::cerr << "[Texture] Failed to load: " << filepath << " ("
+                      << stbi_failure_reason() << ")\n";
+            return false;
+        }
+        const size_t count = static_cast<size_t>(w) * h * 3;
+        image->data.resize(count);
+        if (usage == TextureUsage::Color) {
+            const std::array<float, 256>& lut = SRGB8ToLinearTable();
+            for (size_t i = 0; i < count; ++i) image->data[i] = lut[raw[i]];
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                image->data[i] = static_cast<float>(raw[i]) * (1.0f / 255.0f);
+            }
+        }
+        stbi_image_free(raw);
+    }
+    image->width = w;
+    image->height = h;
+
+    if (usage == TextureUsage::Scalar) {
+        for (size_t i = 0; i < image->data.size(); i += 3) {
+            image->data[i + 1] = image->data[i + 2] = image->data[i];
+        }
+    }
+    *format = ChooseTexelFormat(usage, hdr);
+    return true;
+}
+
+bool ImageTexture::Load(const std::string& filepath, TextureUsage usage) {
+    MipLevel image;
+    TexelFormat texel_format;
+    if (!DecodeImageFile(filepath, usage, &image, &texel_format)) {
         width = 0;
         height = 0;
+        levels.clear();
         return false;
     }
-    data.assign(raw, raw + width * height * 3);
-    stbi_image_free(raw);
+    SetImage(std::move(image), texel_format);
     return true;
 }
 
-RGB ImageTexture::Sample(float u, float v, TextureWrapMode wrap) const {
-    if (data.empty()) return RGB(1.0f, 0.0f, 1.0f);  // Magenta = missing texture
+bool ImageTexture::LoadCached(const std::string& filepath, TextureCache* texture_cache,
+                              TextureUsage usage) {
+    uint32_t handle = texture_cache->Register(filepath, usage);
+    if (handle == kNoTexture) return false;
+    levels.clear();
+    cache = texture_cache;
+    cache_handle = handle;
+    width = texture_cache->Width(handle);
+    height = texture_cache->Height(handle);
+    return true;
+}
 
-    if (wrap == TextureWrapMode::Repeat) {
-        u = u - std::floor(u);
-        v = v - std::floor(v);
-    } else {
-        u = std::clamp(u, 0.0f, 1.0f);
-        v = std::clamp(v, 0.0f, 1.0f);
+void ImageTexture::SetImage(MipLevel image, TexelFormat texel_format) {
+    format = texel_format;
+    width = image.width;
+    height = image.height;
+    levels.clear();
+    if (image.width <= 0 || image.height <= 0) return;
+
+    // Downsample in float and encode each level as it is produced, so only one float level is
+    // ever held in memory
+    levels.push_back(EncodeLevel(image, format));
+    while (image.width > 1 || image.height > 1) {
+        image = DownsampleMip(image);
+        levels.push_back(EncodeLevel(image, format));
     }
+}
 
-    float fx = u * static_cast<float>(width - 1);
-    float fy = v * static_cast<float>(height - 1);
+void ImageTexture::PrecomputeCurves() {
+    curve_levels.clear();
+    if (IsCached()) return;
 
-    int x0 = static_cast<int>(fx);
-    int y0 = static_cast<int>(fy);
-    int x1 = std::min(x0 + 1, width - 1);
-    int y1 = std::min(y0 + 1, height - 1);
+    curve_levels.reserve(levels.size());
+    for (int l = 0; l < LevelCount(); ++l) {
+        CurveLevel cl;
+        cl.width = levels[l].width;
+        cl.height = levels[l].height;
+        cl.data.resize(static_cast<size_t>(cl.width) * cl.height * 4);
+        for (int y = 0; y < cl.height; ++y) {
+            for (int x = 0; x < cl.width; ++x) {
+                SpectralCurve c = RGBToCurve(Texel(l, x, y));
+                float* dst = &cl.data[(static_cast<size_t>(y) * cl.width + x) * 4];
+                dst[0] = c.coeff[0];
+                dst[1] = c.coeff[1];
+                dst[2] = c.coeff[2];
+                dst[3] = c.scale;
+            }
+        }
+        curve_levels.push_back(std::move(cl));
+    }
+}
 
-    float tx = fx - static_cast<float>(x0);
-    float ty = fy - static_cast<float>(y0);
+SpectralCurve ImageTexture::SampleCurve(float u, float v, float du, float dv,
+                                        TextureWrapMode wrap) const {
+    if (!HasCurves()) return RGBToCurve(Sample(u, v, du, dv, wrap));
 
-    auto fetch = [&](int x, int y) -> RGB {
-        int idx = (y * width + x) * 3;
-        return RGB(data[idx], data[idx + 1], data[idx + 2]);
-    };
+    const int count = static_cast<int>(curve_levels.size());
+    float lod = TextureLod(width, height, du, dv, count);
+    int l0 = std::min(static_cast<int>(lod), count - 1);
+    float t = lod - static_cast<float>(l0);
+
+    float c[4];
+    SampleCurveLevel(curve_levels[l0], u, v, wrap, c);
+    if (t > 0.0f && l0 + 1 < count) {
+        float c1[4];
+        SampleCurveLevel(curve_levels[l0 + 1], u, v, wrap, c1);
+        for (int k = 0; k < 4; ++k) c[k] += t * (c1[k] - c[k]);
+    }
+    return SpectralCurve{{c[0], c[1], c[2]}, c[3]};
+}
+
+RGB ImageTexture::Texel(int level, int x, int y) const {
+    const TexelLevel& l = levels[level];
+    const size_t index = static_cast<size_t>(y) * l.width + x;
+    float rgb[3] = {0.0f, 0.0f, 0.0f};
+    DecodeTexel(format, &l.texels[index * TexelBytes(format)], rgb);
+    return RGB(rgb[0], rgb[1], rgb[2]);
+}
+
+size_t ImageTexture::ResidentBytes() const {
+    size_t bytes = 0;
+    for (const TexelLevel& l : levels) bytes += l.texels.size();
+    for (const CurveLevel& l : curve_levels) bytes += l.data.size() * sizeof(float);
+    return bytes;
+}
+
+RGB ImageTexture::Sample(float u, float v, TextureWrapMode wrap) const {
+    return Sample(u, v, 0.0f, 0.0f, wrap);
+}
+
+RGB ImageTexture::Sample(float u, float v, float du, float dv, TextureWrapMode wrap) const {
+    if (cache) return cache->Sample(cache_handle, u, v, du, dv, wrap);
+    if (!IsValid()) return RGB(1.0f, 0.0f, 1.0f);  // Magenta = missing texture
 
-    RGB c00 = fetch(x0, y0);
-    RGB c10 = fetch(x1, y0);
-    RGB c01 = fetch(x0, y1);
-    RGB c11 = fetch(x1, y1);
+    float lod = TextureLod(width, height, du, dv, LevelCount());
+    int l0 = static_cast<int>(lod);
+    if (l0 >= LevelCount() - 1) return SampleLevel(format, levels.back(), u, v, wrap);
 
-    // Bilinear blend
-    RGB r0 = (1.0f - tx) * c00 + tx * c10;
-    RGB r1 = (1.0f - tx) * c01 + tx * c11;
-    return (1.0f - ty) * r0 + ty * r1;
+    float t = lod - static_cast<float>(l0);
+    RGB c0 = SampleLevel(format, levels[l0], u, v, wrap);
+    if (t <= 0.0f) return c0;
+    RGB c1 = SampleLevel(format, levels[l0 + 1], u, v, wrap);
+    return (1.0f - t) * c0 + t * c1;
 }
 
 }  // namespace skwr
@@ -1,11 +1,16 @@
 #ifndef SKWR_MATERIALS_TEXTURE_H_
 #define SKWR_MATERIALS_TEXTURE_H_
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
 #include "core/color/color.h"
+#include "core/spectral/spectral_curve.h"
+#include "materials/texel_format.h"
 
 namespace skwr {
 
@@ -16,22 +21,143 @@ enum class TextureWrapMode {
     Clamp,
 };
 
-// Image-based texture: stores linear-light RGB float data.
-// Sample() performs bilinear interpolation with configurable UV wrapping.
-struct ImageTexture {
-    std::vector<float> data;  // Linear RGB, w*h*3 floats
+class TextureCache;
+
+// Linear-light RGB float image, w*h*3 floats. Working format for decoding and MIP generation.
+struct MipLevel {
+    std::vector<float> data;
+    int width = 0;
+    int height = 0;
+};
+
+// 2x2 box downsample to the next MIP level.
+MipLevel DownsampleMip(const MipLevel& src);
+
+// Decode an image file (flipped so v = 0 is the bottom row) to linear RGB. 8-bit Color sources
+// are sRGB-decoded; Scalar sources keep their red channel in all three. format receives the
+// storage format the image should use. Returns false on failure. Safe to call from any thread.
+bool DecodeImageFile(const std::string& filepath, TextureUsage usage, MipLevel* image,
+                     TexelFormat* format);
+
+// Read only the image header. Returns false if the file cannot be read.
+bool ReadImageSize(const std::string& filepath, int* width, int* height);
+
+// One stored level of a MIP pyramid: width*height texels in the owning texture's TexelFormat,
+// followed by kTexelReadPadding bytes.
+struct TexelLevel {
+    std::vector<uint8_t> texels;
+    int width = 0;
+    int height = 0;
+};
+
+// The four texels and weights of a bilinear lookup at (u, v) on a width x height level.
+struct BilinearFootprint {
+    int x0, y0, x1, y1;
+    float tx, ty;
+};
+
+inline BilinearFootprint ComputeBilinearFootprint(int width, int height, float u, float v,
+                                                  TextureWrapMode wrap) {
+    if (wrap == TextureWrapMode::Repeat) {
+        u = u - std::floor(u);
+        v = v - std::floor(v);
+    } else {
+        u = std::clamp(u, 0.0f, 1.0f);
+        v = std::clamp(v, 0.0f, 1.0f);
+    }
+
+    float fx = u * static_cast<float>(width - 1);
+    float fy = v * static_cast<float>(height - 1);
+
+    BilinearFootprint fp;
+    fp.x0 = static_cast<int>(fx);
+    fp.y0 = static_cast<int>(fy);
+    fp.x1 = std::min(fp.x0 + 1, width - 1);
+    fp.y1 = std::min(fp.y0 + 1, height - 1);
+    fp.tx = fx - static_cast<float>(fp.x0);
+    fp.ty = fy - static_cast<float>(fp.y0);
+    return fp;
+}
+
+// Fractional MIP level for a UV footprint (du, dv) on a width x height base level, clamped to
+// [0, level_count - 1]. A zero footprint selects level 0.
+inline float TextureLod(int width, int height, float du, float dv, int level_count) {
+    // Footprint in full-resolution texels; level L covers 2^L of them per texel
+    float texels = std::max(du * static_cast<float>(width), dv * static_cast<float>(height));
+    if (!(texels > 1.0f) || level_count <= 1) return 0.0f;
+    return std::min(std::log2(texels), static_cast<float>(level_count - 1));
+}
+
+// rgb2spec coefficients for one MIP level: width*height*4 floats, the three polynomial
+// coefficients followed by the curve scale (as produced by RGBToCurve).
+struct CurveLevel {
+    std::vector<float> data;
     int width = 0;
     int height = 0;
+};
+
+// Image-based texture: stores a MIP pyramid in a compact TexelFormat chosen from the source and
+// its TextureUsage (8-bit sRGB, 8-bit linear, single-channel 8-bit, half or float).
+// levels[0] is the full-resolution image; each following level halves both dimensions (box
+// filtered in linear float before encoding) down to 1x1. Sample() performs bilinear
+// interpolation on a single level, or trilinear interpolation between the two levels matching a
+// UV-space footprint.
+// A texture created with LoadCached() holds no texels itself and forwards lookups to a
+// TextureCache.
+// Albedo textures can additionally carry a pyramid of precomputed rgb2spec coefficients
+// (PrecomputeCurves), so SampleCurve() interpolates coefficients instead of running the rgb2spec
+// table fetch on every hit.
+struct ImageTexture {
+    TexelFormat format = TexelFormat::RGB32F;
+    std::vector<TexelLevel> levels;
+    int width = 0;  // Full-resolution size (levels[0])
+    int height = 0;
+
+    std::vector<CurveLevel> curve_levels;  // Empty unless PrecomputeCurves() was called
 
-    // Load from file using stb_image (linear float).
+    const TextureCache* cache = nullptr;
+    uint32_t cache_handle = kNoTexture;
+
+    // Load from file using stb_image and build the MIP pyramid.
     // Returns false on failure.
-    bool Load(const std::string& filepath);
+    bool Load(const std::string& filepath, TextureUsage usage = TextureUsage::Color);
+
+    // Register the file with a texture cache instead of decoding it now.
+    // Returns false if the image header cannot be read.
+    bool LoadCached(const std::string& filepath, TextureCache* texture_cache,
+                    TextureUsage usage = TextureUsage::Color);
 
-    // Sample at UV coordinates with bilinear filtering.
+    // Build the MIP pyramid from a linear-light image and store every level as texel_format.
+    void SetImage(MipLevel image, TexelFormat texel_format = TexelFormat::RGB32F);
+
+    // Sample at UV coordinates with bilinear filtering on the full-resolution level.
     // Callers pass si.uv.x() and si.uv.y().
     RGB Sample(float u, float v, TextureWrapMode wrap = TextureWrapMode::Repeat) const;
 
-    bool IsValid() const { return !data.empty(); }
+    // Sample with trilinear filtering. du/dv are the footprint extents in UV units; a zero
+    // footprint selects the full-resolution level.
+    RGB Sample(float u, float v, float du, float dv,
+               TextureWrapMode wrap = TextureWrapMode::Repeat) const;
+
+    // Spectral curve at UV: interpolated precomputed coefficients when available, otherwise
+    // RGBToCurve of the filtered RGB lookup.
+    SpectralCurve SampleCurve(float u, float v, float du, float dv,
+                              TextureWrapMode wrap = TextureWrapMode::Repeat) const;
+
+    // Convert every stored level to rgb2spec coefficients. No-op for cached textures.
+    // Requires the spectral model to be initialized.
+    void PrecomputeCurves();
+    bool HasCurves() const { return !curve_levels.empty(); }
+
+    // Decoded value of one stored texel.
+    RGB Texel(int level, int x, int y) const;
+
+    // Bytes of texel and coefficient storage held by this texture (0 for cached textures).
+    size_t ResidentBytes() const;
+
+    int LevelCount() const { return static_cast<int>(levels.size()); }
+    bool IsCached() const { return cache != nullptr; }
+    bool IsValid() const { return IsCached() || (!levels.empty() && !levels[0].texels.empty()); }
 };
 
 }  // namespace skwr
@@ -0,0 +1,346 @@
+#include "materials/texture_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "materials/texel_format.h"
+
+namespace skwr {
+
+namespace {
+
+constexpr size_t kNumShards = 32;
+
+uint64_t TileKey(uint32_t handle, int level, int tile_index) {
+    return (static_cast<uint64_t>(handle) << 40) | (static_cast<uint64_t>(level) << 32) |
+           static_cast<uint64_t>(tile_index);
+}
+
+size_t ShardIndex(uint64_t key) {
+    // SplitMix64 finalizer: neighbouring tiles land in different shards
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return static_cast<size_t>(key % kNumShards);
+}
+
+bool SeekTo(std::FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(f, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+}  // namespace
+
+struct TextureCache::Entry {
+    struct Level {
+        int width = 0;
+        int height = 0;
+        int tiles_x = 0;
+        int tiles_y = 0;
+        size_t first_tile = 0;  // Index of this level's first tile in the backing file
+    };
+
+    std::string path;
+    TextureUsage usage = TextureUsage::Color;
+    int width = 0;
+    int height = 0;
+
+    std::atomic<bool> tiled{false};  // Set once by the loader, valid or not
+    bool valid = false;
+    TexelFormat format = TexelFormat::SRGB8;
+    size_t tile_bytes = 0;
+    std::vector<Level> levels;
+
+    std::FILE* backing = nullptr;  // Anonymous tmpfile holding every tile of every level
+    mutable std::mutex file_mutex;
+
+    ~Entry() {
+        if (backing) std::fclose(backing);
+    }
+};
+
+struct TextureCache::Shard {
+    struct Slot {
+        TileRef texels;
+        std::list<uint64_t>::iterator lru_it;
+    };
+
+    std::mutex mutex;
+    std::list<uint64_t> lru;  // Front = most recently used
+    std::unordered_map<uint64_t, Slot> tiles;
+    size_t bytes = 0;
+};
+
+TextureCache::TextureCache(size_t budget_bytes) : budget_bytes_(budget_bytes) {
+    shards_.reserve(kNumShards);
+    for (size_t i = 0; i < kNumShards; ++i) shards_.push_back(std::make_unique<Shard>());
+    loader_ = std::thread([this] { LoaderLoop(); });
+}
+
+TextureCache::~TextureCache() {
+    {
+        std::lock_guard<std::mutex> lock(loader_mutex_);
+        stopping_ = true;
+    }
+    loader_cv_.notify_all();
+    loader_.join();
+}
+
+uint32_t TextureCache::Register(const std::string& filepath, TextureUsage usage) {
+    int w = 0;
+    int h = 0;
+    if (!ReadImageSize(filepath, &w, &h)) return kNoTexture;
+
+    auto entry = std::make_unique<Entry>();
+    entry->path = filepath;
+    entry->usage = usage;
+    entry->width = w;
+    entry->height = h;
+    Entry* queued = entry.get();
+    entries_.push_back(std::move(entry));
+    {
+        std::lock_guard<std::mutex> lock(loader_mutex_);
+        queue_.push_back(queued);
+        ++pending_;
+    }
+    loader_cv_.notify_one();
+    return static_cast<uint32_t>(entries_.size() - 1);
+}
+
+void TextureCache::WaitUntilTiled() const {
+    std::unique_lock<std::mutex> lock(loader_mutex_);
+    tiled_cv_.wait(lock, [&] { return pending_ == 0; });
+}
+
+void TextureCache::LoaderLoop() {
+    while (true) {
+        Entry* entry = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(loader_mutex_);
+            loader_cv_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            entry = queue_.front();
+            queue_.pop_front();
+        }
+
+        TileEntry(*entry);
+
+        {
+            std::lock_guard<std::mutex> lock(loader_mutex_);
+            entry->tiled.store(true, std::memory_order_release);
+            --pending_;
+        }
+        tiled_cv_.notify_all();
+    }
+}
+
+bool TextureCache::WaitForEntry(const Entry& entry) const {
+    if (!entry.tiled.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(loader_mutex_);
+        tiled_cv_.wait(lock, [&] { return entry.tiled.load(std::memory_order_acquire); });
+    }
+    return entry.valid;
+}
+
+int TextureCache::Width(uint32_t handle) const { return entries_[handle]->width; }
+int TextureCache::Height(uint32_t handle) const { return entries_[handle]->height; }
+
+void TextureCache::TileEntry(Entry& entry) {
+    MipLevel level;
+    TexelFormat format;
+    if (!DecodeImageFile(entry.path, entry.usage, &level, &format)) return;
+
+    entry.backing = std::tmpfile();
+    if (!entry.backing) {
+        std::cerr << "[Texture] Failed to create tile backing file for " << entry.path << "\n";
+        return;
+    }
+
+    entry.format = format;
+    const int texel_bytes = TexelBytes(entry.format);
+    entry.tile_bytes = static_cast<size_t>(kTileSize) * kTileSize * texel_bytes;
+
+    // Write each level tile by tile; only the level being tiled is held in memory
+    std::vector<uint8_t> tile(entry.tile_bytes);
+    size_t first_tile = 0;
+    while (true) {
+        Entry::Level info;
+        info.width = level.width;
+        info.height = level.height;
+        info.tiles_x = (level.width + kTileSize - 1) / kTileSize;
+        info.tiles_y = (level.height + kTileSize - 1) / kTileSize;
+        info.first_tile = first_tile;
+
+        for (int ty = 0; ty < info.tiles_y; ++ty) {
+            for (int tx = 0; tx < info.tiles_x; ++tx) {
+                for (int y = 0; y < kTileSize; ++y) {
+                    // Edge tiles replicate the border texel into their padding
+                    int sy = std::min(ty * kTileSize + y, level.height - 1);
+                    for (int x = 0; x < kTileSize; ++x) {
+                        int sx = std::min(tx * kTileSize + x, level.width - 1);
+                        const float* src =
+                            &level.data[(static_cast<size_t>(sy) * level.width + sx) * 3];
+                        EncodeTexel(entry.format, src,
+                                    &tile[(static_cast<size_t>(y) * kTileSize + x) * texel_bytes]);
+                    }
+                }
+                if (std::fwrite(tile.data(), 1, tile.size(), entry.backing) != tile.size()) {
+                    std::cerr << "[Texture] Failed to write tile backing file for " << entry.path
+                              << "\n";
+                    return;
+                }
+            }
+        }
+
+        first_tile += static_cast<size_t>(info.tiles_x) * info.tiles_y;
+        entry.levels.push_back(info);
+        if (level.width == 1 && level.height == 1) break;
+        level = DownsampleMip(level);
+    }
+    std::fflush(entry.backing);
+
+    entry.valid = true;
+    textures_decoded_.fetch_add(1, std::memory_order_relaxed);
+}
+
+TextureCache::TileRef TextureCache::AcquireTile(uint32_t handle, const Entry& entry, int level,
+                                                int tile_index) const {
+    const uint64_t key = TileKey(handle, level, tile_index);
+    Shard& shard = *shards_[ShardIndex(key)];
+
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.tiles.find(key);
+        if (it != shard.tiles.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru_it);
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return it->second.texels;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+
+    // Read the tile outside the shard lock so other lookups in this shard are not blocked on I/O
+    auto texels = std::make_shared<std::vector<uint8_t>>(entry.tile_bytes + kTexelReadPadding);
+    {
+        std::lock_guard<std::mutex> lock(entry.file_mutex);
+        uint64_t offset = (entry.levels[level].first_tile + tile_index) * entry.tile_bytes;
+        if (!SeekTo(entry.backing, offset) ||
+            std::fread(texels->data(), 1, entry.tile_bytes, entry.backing) != entry.tile_bytes) {
+            std::fill(texels->begin(), texels->end(), 0);
+        }
+    }
+
+    const size_t shard_budget = std::max(budget_bytes_ / kNumShards, entry.tile_bytes);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.tiles.try_emplace(key);
+    if (!inserted) return it->second.texels;  // Another thread loaded it first
+
+    shard.lru.push_front(key);
+    it->second.texels = texels;
+    it->second.lru_it = shard.lru.begin();
+    shard.bytes += texels->size();
+    size_t resident = bytes_resident_.fetch_add(texels->size()) + texels->size();
+    size_t peak = peak_bytes_resident_.load(std::memory_order_relaxed);
+    while (resident > peak && !peak_bytes_resident_.compare_exchange_weak(peak, resident)) {
+    }
+
+    // Evict least recently used tiles; the tile just loaded always stays
+    while (shard.bytes > shard_budget && shard.lru.size() > 1) {
+        auto victim = shard.tiles.find(shard.lru.back());
+        size_t victim_bytes = victim->second.texels->size();
+        shard.lru.pop_back();
+        shard.tiles.erase(victim);
+        shard.bytes -= victim_bytes;
+        bytes_resident_.fetch_sub(victim_bytes);
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return texels;
+}
+
+RGB TextureCache::SampleLevel(uint32_t handle, const Entry& entry, int level, float u, float v,
+                              TextureWrapMode wrap) const {
+    const Entry::Level& info = entry.levels[level];
+    BilinearFootprint fp = ComputeBilinearFootprint(info.width, info.height, u, v, wrap);
+
+    const int xs[2] = {fp.x0, fp.x1};
+    const int ys[2] = {fp.y0, fp.y1};
+    const int texel_bytes = TexelBytes(entry.format);
+
+    // Most footprints fall inside one tile; only acquire another when a corner crosses a tile
+    // edge. The refs keep every touched tile alive until the blend below.
+    int tile_ids[4] = {-1, -1, -1, -1};
+    TileRef tiles[4];
+    const uint8_t* texels[4];
+    for (int j = 0; j < 2; ++j) {
+        for (int i = 0; i < 2; ++i) {
+            const int corner = j * 2 + i;
+            int x = xs[i];
+            int y = ys[j];
+            int tile_index = (y / kTileSize) * info.tiles_x + (x / kTileSize);
+            int slot = 0;
+            while (slot < corner && tile_ids[slot] != tile_index) ++slot;
+            if (slot == corner) {
+                tiles[slot] = AcquireTile(handle, entry, level, tile_index);
+                tile_ids[slot] = tile_index;
+            }
+            size_t local = static_cast<size_t>(y % kTileSize) * kTileSize + (x % kTileSize);
+            texels[corner] = tiles[slot]->data() + local * texel_bytes;
+        }
+    }
+
+    return BilinearTexels(entry.format, texels[0], texels[1], texels[2], texels[3], fp.tx, fp.ty);
+}
+
+RGB TextureCache::Sample(uint32_t handle, float u, float v, float du, float dv,
+                         TextureWrapMode wrap) const {
+    if (handle >= entries_.size()) return RGB(1.0f, 0.0f, 1.0f);  // Magenta = missing texture
+    const Entry& entry = *entries_[handle];
+    if (!WaitForEntry(entry)) return RGB(1.0f, 0.0f, 1.0f);
+
+    const int level_count = static_cast<int>(entry.levels.size());
+    float lod = TextureLod(entry.width, entry.height, du, dv, level_count);
+    int l0 = static_cast<int>(lod);
+    if (l0 >= level_count - 1) return SampleLevel(handle, entry, level_count - 1, u, v, wrap);
+
+    float t = lod - static_cast<float>(l0);
+    RGB c0 = SampleLevel(handle, entry, l0, u, v, wrap);
+    if (t <= 0.0f) return c0;
+    RGB c1 = SampleLevel(handle, entry, l0 + 1, u, v, wrap);
+    return (1.0f - t) * c0 + t * c1;
+}
+
+TextureCacheStats TextureCache::Stats() const {
+    TextureCacheStats s;
+    s.hits = hits_.load();
+    s.misses = misses_.load();
+    s.evictions = evictions_.load();
+    s.bytes_resident = bytes_resident_.load();
+    s.peak_bytes_resident = peak_bytes_resident_.load();
+    s.textures_decoded = textures_decoded_.load();
+    return s;
+}
+
+std::string FormatTextureCacheStats(const TextureCacheStats& stats, size_t budget_bytes) {
+    constexpr double kMiB = 1024.0 * 1024.0;
+    std::ostringstream out;
+    out << "hit_rate=" << stats.HitRate() * 100.0 << "%"
+        << " resident=" << stats.bytes_resident / kMiB << "MiB"
+        << " peak=" << stats.peak_bytes_resident / kMiB << "MiB"
+        << " budget=" << budget_bytes / kMiB << "MiB"
+        << " misses=" << stats.misses << " evictions=" << stats.evictions
+        << " decoded=" << stats.textures_decoded;
+    return out.str();
+}
+
+}  // namespace skwr
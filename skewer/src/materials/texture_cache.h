@@ -0,0 +1,114 @@
+#ifndef SKWR_MATERIALS_TEXTURE_CACHE_H_
+#define SKWR_MATERIALS_TEXTURE_CACHE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/color/color.h"
+#include "materials/texture.h"
+
+namespace skwr {
+
+struct TextureCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t bytes_resident = 0;
+    size_t peak_bytes_resident = 0;
+    size_t textures_decoded = 0;
+
+    double HitRate() const {
+        uint64_t total = hits + misses;
+        return total > 0 ? static_cast<double>(hits) / static_cast<double>(total) : 0.0;
+    }
+};
+
+// One-line summary of a cache's stats against its budget, for the render logs
+std::string FormatTextureCacheStats(const TextureCacheStats& stats, size_t budget_bytes);
+
+/**
+ * Tiled texture cache with an LRU memory budget.
+ *
+ * Register() reads the image header and queues the texture on the cache's loader thread. The
+ * loader decodes each texture, builds the MIP pyramid, and writes every level as fixed-size
+ * kTileSize x kTileSize tiles in the same compact TexelFormat ImageTexture would use to an
+ * anonymous backing file, then drops the decoded image. Textures are tiled one at a time, so at
+ * most one decoded image is held outside the budget. Scene::Build() waits for the loader, which
+ * leaves tile reads as the only work lookups do at render time.
+ *
+ * Lookups pull individual tiles from the backing file on demand and keep them in a sharded LRU,
+ * evicting the least recently used tiles once the budget is exceeded. A lookup into a texture the
+ * loader has not reached yet waits for it.
+ *
+ * Sample() is safe to call from any number of render threads.
+ */
+class TextureCache {
+  public:
+    static constexpr int kTileSize = 64;
+
+    explicit TextureCache(size_t budget_bytes);
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Register an image file and queue it for tiling. Returns kNoTexture if the header cannot be
+    // read.
+    uint32_t Register(const std::string& filepath, TextureUsage usage = TextureUsage::Color);
+
+    // Block until every registered texture has been tiled.
+    void WaitUntilTiled() const;
+
+    int Width(uint32_t handle) const;
+    int Height(uint32_t handle) const;
+
+    // Same filtering as ImageTexture::Sample(u, v, du, dv, wrap).
+    RGB Sample(uint32_t handle, float u, float v, float du, float dv, TextureWrapMode wrap) const;
+
+    TextureCacheStats Stats() const;
+    size_t budget_bytes() const { return budget_bytes_; }
+
+  private:
+    struct Entry;
+    struct Shard;
+    using TileRef = std::shared_ptr<const std::vector<uint8_t>>;
+
+    void LoaderLoop();
+    void TileEntry(Entry& entry);
+    bool WaitForEntry(const Entry& entry) const;
+    TileRef AcquireTile(uint32_t handle, const Entry& entry, int level, int tile_index) const;
+    RGB SampleLevel(uint32_t handle, const Entry& entry, int level, float u, float v,
+                    TextureWrapMode wrap) const;
+
+    size_t budget_bytes_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    // Loader thread state. loader_mutex_ guards the queue and every entry's `tiled` flag.
+    mutable std::mutex loader_mutex_;
+    mutable std::condition_variable loader_cv_;  // Queue grew or stopping
+    mutable std::condition_variable tiled_cv_;   // An entry finished tiling
+    std::deque<Entry*> queue_;
+    size_t pending_ = 0;  // Queued or being tiled
+    bool stopping_ = false;
+    std::thread loader_;
+
+    mutable std::atomic<uint64_t> hits_{0};
+    mutable std::atomic<uint64_t> misses_{0};
+    mutable std::atomic<uint64_t> evictions_{0};
+    mutable std::atomic<size_t> bytes_resident_{0};
+    mutable std::atomic<size_t> peak_bytes_resident_{0};
+    mutable std::atomic<size_t> textures_decoded_{0};
+};
+
+}  // namespace skwr
+
+#endif  // SKWR_MATERIALS_TEXTURE_CACHE_H_
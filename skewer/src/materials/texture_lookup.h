@@ -1,6 +1,9 @@
 #ifndef SKWR_MATERIALS_TEXTURE_LOOKUP_H_
 #define SKWR_MATERIALS_TEXTURE_LOOKUP_H_
 
+#include <algorithm>
+
+#include "core/math/constants.h"
 #include "core/math/vec3.h"
 #include "core/spectral/spectral_curve.h"
 #include "core/spectral/spectral_utils.h"
@@ -20,8 +23,10 @@ struct ShadingData {
 
 // Resolve per-hit shading data for the given material and surface interaction.
 // Uses si.uv, si.dpdu, si.dpdv for texture lookup and normal-map transform.
+// footprint is the ray-cone width at the hit; it is projected onto the surface and converted to
+// UV units through |dpdu|/|dpdv| to pick the MIP level. 0 samples the full-resolution level.
 inline ShadingData ResolveShadingData(const Material& mat, const SurfaceInteraction& si,
-                                      const Scene& scene) {
+                                      const Scene& scene, float footprint = 0.0f) {
     ShadingData sd;
     sd.albedo = mat.albedo;
     sd.roughness = mat.roughness;
@@ -34,21 +39,32 @@ inline ShadingData ResolveShadingData(const Material& mat, const SurfaceInteract
     float u = si.uv.x();
     float v = si.uv.y();
 
+    float du = 0.0f;
+    float dv = 0.0f;
+    if (footprint > 0.0f) {
+        float cos_theta =
+            std::max(std::abs(Dot(si.wo, si.n_geom)), RenderConstants::kRayConeMinCos);
+        float width = footprint / cos_theta;
+        float len_u = si.dpdu.Length();
+        float len_v = si.dpdv.Length();
+        if (len_u > 0.0f) du = width / len_u;
+        if (len_v > 0.0f) dv = width / len_v;
+    }
+
     // Albedo texture overrides flat material color.
     if (mat.HasAlbedoTexture()) {
-        RGB color = scene.GetTexture(mat.albedo_tex).Sample(u, v);
-        sd.albedo = RGBToCurve(color);
+        sd.albedo = scene.GetTexture(mat.albedo_tex).SampleCurve(u, v, du, dv);
     }
 
     // Roughness texture overrides flat roughness value.
     if (mat.HasRoughnessMap()) {
-        RGB color = scene.GetTexture(mat.roughness_tex).Sample(u, v);
+        RGB color = scene.GetTexture(mat.roughness_tex).Sample(u, v, du, dv);
         sd.roughness = color.r();
     }
 
     // Normal map: perturb shading normal via TBN transform.
     if (mat.HasNormalMap()) {
-        RGB color = scene.GetTexture(mat.normal_tex).Sample(u, v);
+        RGB color = scene.GetTexture(mat.normal_tex).Sample(u, v, du, dv);
 
         // Convert [0,1] -> [-1,1] tangent-space normal
         Vec3 n_ts(2.0f * color.r() - 1.0f, 2.0f * color.g() - 1.0f, 2.0f * color.b() - 1.0f);
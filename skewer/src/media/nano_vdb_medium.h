@@ -4,10 +4,13 @@
 #include <nanovdb/NanoVDB.h>
 #include <nanovdb/util/IO.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -163,14 +166,199 @@ struct NanoVDBAccessor {
     }
 };
 
+// Density bounds over a coarse grid of cells in index space, built once at load time. Shadow rays
+// walk the cells along the ray so the residual ratio tracking majorant and control follow the
+// local density instead of the extrema of the whole volume.
+struct MajorantGrid {
+    struct Cell {
+        float min_density;  // Lowest density in the cell, background included
+        float max_density;
+        float control;  // Lowest density over the cell's active voxels (min_density if none)
+    };
+
+    static constexpr int kMinCellBlocks = 4;  // 4 leaves of 8 voxels = 32 voxels per cell side
+    static constexpr int kMaxCellsPerAxis = 64;
+
+    int origin[3] = {0, 0, 0};  // Index-space corner of cell (0, 0, 0)
+    int res[3] = {0, 0, 0};
+    int cell_voxels = 0;
+    std::vector<Cell> cells;
+    Cell outside{0.0f, 0.0f, 0.0f};  // Background beyond the tree's bounding box
+
+    const Cell& At(int x, int y, int z) const {
+        return cells[(static_cast<size_t>(z) * res[1] + y) * res[0] + x];
+    }
+
+    /**
+     * Builds the cells from the tree's leaves, scaled by `density_multiplier`. Regions without
+     * leaves hold the background unless the tree has active tiles, in which case cells that are
+     * not fully covered by leaves fall back to the grid-wide extrema.
+     */
+    template <typename GridT>
+    void Build(const GridT& grid, float density_multiplier) {
+        using LeafT = typename GridT::TreeType::LeafNodeType;
+        const auto& tree = grid.tree();
+        const float background = tree.background();
+        float tree_min, tree_max;
+        tree.extrema(tree_min, tree_max);
+        const bool has_tiles = tree.activeTileCount(1) + tree.activeTileCount(2) +
+                                   tree.activeTileCount(3) >
+                               0;
+        outside = {background * density_multiplier, background * density_multiplier,
+                   background * density_multiplier};
+
+        const auto index_bbox = grid.indexBBox();
+        int blocks[3];
+        for (int a = 0; a < 3; ++a) {
+            const int lo = index_bbox.min()[a] >> 3;  // Leaf coordinates, floored
+            const int hi = index_bbox.max()[a] >> 3;
+            if (hi < lo) return;
+            origin[a] = lo * 8;
+            blocks[a] = hi - lo + 1;
+        }
+        const int max_blocks = std::max({blocks[0], blocks[1], blocks[2]});
+        const int cell_blocks =
+            std::max(kMinCellBlocks, (max_blocks + kMaxCellsPerAxis - 1) / kMaxCellsPerAxis);
+        cell_voxels = cell_blocks * 8;
+        for (int a = 0; a < 3; ++a) res[a] = (blocks[a] + cell_blocks - 1) / cell_blocks;
+
+        const float kInf = std::numeric_limits<float>::infinity();
+        cells.assign(static_cast<size_t>(res[0]) * res[1] * res[2], Cell{kInf, -kInf, kInf});
+        std::vector<int> leaf_counts(cells.size(), 0);
+
+        const LeafT* leaves = tree.getFirstLeaf();
+        const uint32_t leaf_count = tree.nodeCount(0);
+        for (uint32_t i = 0; i < leaf_count; ++i) {
+            const LeafT& leaf = leaves[i];
+            const auto leaf_origin = leaf.origin();
+            int cell_xyz[3];
+            bool inside = true;
+            for (int a = 0; a < 3; ++a) {
+                const int offset = leaf_origin[a] - origin[a];
+                cell_xyz[a] = offset / cell_voxels;
+                inside = inside && offset >= 0 && cell_xyz[a] < res[a];
+            }
+            if (!inside) continue;  // Leaf without active voxels beyond the active bbox
+            const size_t c =
+                (static_cast<size_t>(cell_xyz[2]) * res[1] + cell_xyz[1]) * res[0] + cell_xyz[0];
+            Cell& cell = cells[c];
+            ++leaf_counts[c];
+            for (uint32_t n = 0; n < LeafT::SIZE; ++n) {
+                const float v = static_cast<float>(leaf.getValue(n));
+                cell.min_density = std::min(cell.min_density, v);
+                cell.max_density = std::max(cell.max_density, v);
+                if (leaf.isActive(n)) cell.control = std::min(cell.control, v);
+            }
+        }
+
+        const int leaves_per_cell = cell_blocks * cell_blocks * cell_blocks;
+        for (size_t c = 0; c < cells.size(); ++c) {
+            Cell& cell = cells[c];
+            if (leaf_counts[c] < leaves_per_cell) {
+                cell.min_density = std::min(cell.min_density, background);
+                cell.max_density = std::max(cell.max_density, background);
+                if (has_tiles) {
+                    cell.min_density = std::min(cell.min_density, tree_min);
+                    cell.max_density = std::max(cell.max_density, tree_max);
+                }
+            }
+            if (cell.control == kInf) cell.control = cell.min_density;
+            cell.min_density = std::max(0.0f, cell.min_density) * density_multiplier;
+            cell.max_density = std::max(0.0f, cell.max_density) * density_multiplier;
+            cell.control = std::max(0.0f, cell.control) * density_multiplier;
+        }
+    }
+
+    /**
+     * Walks the cells crossed by the index-space ray o + t ⋅ d over [t_min, t_max] (3D DDA),
+     * calling fn(t0, t1, cell) for each piece in order. Pieces outside the grid get `outside`.
+     * Stops early when fn returns false.
+     */
+    template <typename Fn>
+    void Traverse(const Vec3& o, const Vec3& d, float t_min, float t_max, Fn&& fn) const {
+        // Work in cell units
+        float qo[3], qd[3];
+        float ta = t_min;
+        float tb = t_max;
+        for (int a = 0; a < 3; ++a) {
+            qo[a] = (o[a] - static_cast<float>(origin[a])) / static_cast<float>(cell_voxels);
+            qd[a] = d[a] / static_cast<float>(cell_voxels);
+            if (qd[a] == 0.0f) {
+                if (qo[a] < 0.0f || qo[a] >= static_cast<float>(res[a])) ta = tb;
+                continue;
+            }
+            float t0 = -qo[a] / qd[a];
+            float t1 = (static_cast<float>(res[a]) - qo[a]) / qd[a];
+            if (t0 > t1) std::swap(t0, t1);
+            ta = std::max(ta, t0);
+            tb = std::min(tb, t1);
+        }
+        if (ta >= tb) {
+            fn(t_min, t_max, outside);
+            return;
+        }
+        if (ta > t_min && !fn(t_min, ta, outside)) return;
+
+        const float kInf = std::numeric_limits<float>::infinity();
+        int cell[3], step[3];
+        float next[3], delta[3];
+        for (int a = 0; a < 3; ++a) {
+            const float p = qo[a] + qd[a] * ta;
+            cell[a] = std::clamp(static_cast<int>(std::floor(p)), 0, res[a] - 1);
+            if (qd[a] > 0.0f) {
+                step[a] = 1;
+                next[a] = (static_cast<float>(cell[a] + 1) - qo[a]) / qd[a];
+                delta[a] = 1.0f / qd[a];
+            } else if (qd[a] < 0.0f) {
+                step[a] = -1;
+                next[a] = (static_cast<float>(cell[a]) - qo[a]) / qd[a];
+                delta[a] = -1.0f / qd[a];
+            } else {
+                step[a] = 0;
+                next[a] = kInf;
+                delta[a] = kInf;
+            }
+        }
+
+        float t = ta;
+        while (true) {
+            const int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2)
+                                               : (next[1] < next[2] ? 1 : 2);
+            const float t_end = std::min(next[axis], tb);
+            if (t_end > t && !fn(t, t_end, At(cell[0], cell[1], cell[2]))) return;
+            if (t_end >= tb) break;
+            t = t_end;
+            cell[axis] += step[axis];
+            if (cell[axis] < 0 || cell[axis] >= res[axis]) {
+                // Rounding left the grid before tb; finish in the last cell
+                cell[axis] -= step[axis];
+                next[axis] = kInf;
+            } else {
+                next[axis] += delta[axis];
+            }
+        }
+
+        if (tb < t_max) fn(tb, t_max, outside);
+    }
+};
+
 struct NanoVDBMedium {
     SpectralCurve sigma_a_base;
     SpectralCurve sigma_s_base;
 
     float g;
     float max_density = 1.0f;
+    float min_density = 0.0f;  // Lowest density inside the bbox (including background voxels)
     float density_multiplier = 1.0f;
 
+    // Residual ratio tracking: control density whose transmittance is integrated analytically on
+    // shadow rays. 0 disables it (plain ratio tracking); auto_control uses each majorant cell's
+    // lowest active density instead.
+    float control_density = 0.0f;
+    bool auto_control = false;
+
+    MajorantGrid majorants;
+
     MappedFile mapped_file;
     nanovdb::GridHandle<> handle;
 
@@ -253,6 +441,10 @@ struct NanoVDBMedium {
                 float min_val, max_val;
                 float_grid->tree().extrema(min_val, max_val);
                 max_density = max_val * density_multiplier;
+                min_density =
+                    std::max(0.0f, std::min(min_val, float_grid->tree().background())) *
+                    density_multiplier;
+                majorants.Build(*float_grid, density_multiplier);
 
             } else if (meta->gridType() == nanovdb::GridType::Fp16) {
                 is_fp16 = true;
@@ -263,6 +455,9 @@ struct NanoVDBMedium {
                 float min_v, max_v;
                 fp16_grid->tree().extrema(min_v, max_v);
                 max_density = max_v * density_multiplier;
+                min_density = std::max(0.0f, std::min(min_v, fp16_grid->tree().background())) *
+                              density_multiplier;
+                majorants.Build(*fp16_grid, density_multiplier);
 
             } else {
                 std::cerr << "Unsupported NanoVDB grid type! Must be Float or Fp16.\n";
@@ -319,6 +514,13 @@ struct NanoVDBMedium {
     float GetDensity(const Point3& p_world, const TRS& trs, const NanoVDBAccessor& acc) const {
         if (!float_grid && !fp16_grid) return 0.0f;
 
+        Vec3 p = WorldToIndex(p_world, trs);
+        return acc.GetValue(nanovdb::Vec3f(p.x(), p.y(), p.z())) * density_multiplier;
+    }
+
+    // Maps a world-space point to the grid's continuous index space. The map is affine, so a ray
+    // maps to a ray with the same parameterization.
+    Vec3 WorldToIndex(const Point3& p_world, const TRS& trs) const {
         // Undo outer world-space TRS
         Vec3 p = TRSInverseApplyPoint(trs, p_world);
 
@@ -335,7 +537,7 @@ struct NanoVDBMedium {
             p_index = float_grid->worldToIndexF(nanovdb::Vec3f(p_vdb.x(), p_vdb.y(), p_vdb.z()));
         }
 
-        return acc.GetValue(p_index) * density_multiplier;
+        return Vec3(p_index[0], p_index[1], p_index[2]);
     }
 
     BoundBox GetWorldBBox(const TRS& trs) const { return TransformBounds(trs, bbox); }
@@ -0,0 +1,203 @@
+#include "scene/camera.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "core/math/constants.h"
+
+namespace skwr {
+
+namespace {
+
+// Float layout of one CameraFrame in the shutter table and in GenerateRays()' per-sample frames
+constexpr int kOrigin = 0;
+constexpr int kCorner = 3;
+constexpr int kHorizontal = 6;
+constexpr int kVertical = 9;
+constexpr int kU = 12;
+constexpr int kV = 15;
+constexpr int kW = 18;
+constexpr int kLensRadius = 21;
+constexpr int kViewportHeight = 22;
+constexpr int kConeSpread = 23;
+constexpr int kFrameFloats = 24;
+
+using PackedFrame = std::array<float, kFrameFloats>;
+
+PackedFrame PackFrame(const CameraFrame& f) {
+    PackedFrame out{};
+    const Vec3* vecs[] = {&f.origin, &f.lower_left_corner, &f.horizontal, &f.vertical,
+                          &f.u,      &f.v,                 &f.w};
+    for (int i = 0; i < 7; ++i) {
+        for (int c = 0; c < 3; ++c) out[3 * i + c] = (*vecs[i])[c];
+    }
+    out[kLensRadius] = f.lens_radius;
+    out[kViewportHeight] = f.viewport_height;
+    out[kConeSpread] = f.cone_spread;
+    return out;
+}
+
+CameraFrame UnpackFrame(const PackedFrame& in) {
+    auto vec = [&in](int at) { return Vec3(in[at], in[at + 1], in[at + 2]); };
+    CameraFrame f;
+    f.origin = vec(kOrigin);
+    f.lower_left_corner = vec(kCorner);
+    f.horizontal = vec(kHorizontal);
+    f.vertical = vec(kVertical);
+    f.u = Normalize(vec(kU));
+    f.v = Normalize(vec(kV));
+    f.w = Normalize(vec(kW));
+    f.lens_radius = in[kLensRadius];
+    f.viewport_height = in[kViewportHeight];
+    f.cone_spread = in[kConeSpread];
+    return f;
+}
+
+}  // namespace
+
+void Camera::BuildShutterTable() {
+    shutter_table_.clear();
+    has_lens_ = static_frame_.lens_radius > 0.0f;
+    if (!animated_) return;
+
+    // Component-major: entry e of component c is at c * kEntries + e
+    constexpr int kEntries = kShutterSteps + 1;
+    shutter_table_.resize(static_cast<size_t>(kFrameFloats) * kEntries);
+    const float duration = shutter_close_ - shutter_open_;
+    shutter_inv_step_ = duration > 0.0f ? static_cast<float>(kShutterSteps) / duration : 0.0f;
+    for (int e = 0; e < kEntries; ++e) {
+        const float time = shutter_open_ + duration * static_cast<float>(e) / kShutterSteps;
+        const CameraFrame frame = InterpolateFrame(time);
+        const PackedFrame packed = PackFrame(frame);
+        for (int c = 0; c < kFrameFloats; ++c) shutter_table_[c * kEntries + e] = packed[c];
+        has_lens_ = has_lens_ || frame.lens_radius > 0.0f;
+    }
+}
+
+CameraFrame Camera::TableFrame(float time) const {
+    if (shutter_table_.empty() || time < shutter_open_ || time > shutter_close_) {
+        return InterpolateFrame(time);
+    }
+    constexpr int kEntries = kShutterSteps + 1;
+    const float f = (time - shutter_open_) * shutter_inv_step_;
+    const int k = std::min(static_cast<int>(f), kShutterSteps - 1);
+    const float a = f - static_cast<float>(k);
+    PackedFrame packed;
+    for (int c = 0; c < kFrameFloats; ++c) {
+        const float* col = &shutter_table_[c * kEntries];
+        packed[c] = col[k] + (col[k + 1] - col[k]) * a;
+    }
+    return UnpackFrame(packed);
+}
+
+void Camera::GenerateRays(CameraRayBlock* block) const {
+    constexpr int kN = CameraRayBlock::kCapacity;
+    CameraRayBlock& b = *block;
+    const int n = std::clamp(b.count, 0, kN);
+
+    const float duration = shutter_close_ - shutter_open_;
+    for (int i = 0; i < n; ++i) b.time[i] = shutter_open_ + b.u_time[i] * duration;
+
+    // 1. Camera frame of every sample, component-major like the table
+    float frame[kFrameFloats][kN];
+    if (animated_) {
+        constexpr int kEntries = kShutterSteps + 1;
+        int idx[kN];
+        float alpha[kN];
+        for (int i = 0; i < n; ++i) {
+            const float f = std::clamp((b.time[i] - shutter_open_) * shutter_inv_step_, 0.0f,
+                                       static_cast<float>(kShutterSteps));
+            const int k = std::min(static_cast<int>(f), kShutterSteps - 1);
+            idx[i] = k;
+            alpha[i] = f - static_cast<float>(k);
+        }
+        for (int c = 0; c < kFrameFloats; ++c) {
+            const float* col = &shutter_table_[c * kEntries];
+            float* dst = frame[c];
+            for (int i = 0; i < n; ++i) {
+                const float f0 = col[idx[i]];
+                const float f1 = col[idx[i] + 1];
+                dst[i] = f0 + (f1 - f0) * alpha[i];
+            }
+        }
+        // Lerped bases are slightly short; renormalize them as InterpolateFrame() does
+        for (int basis : {kU, kV, kW}) {
+            float* bx = frame[basis];
+            float* by = frame[basis + 1];
+            float* bz = frame[basis + 2];
+            for (int i = 0; i < n; ++i) {
+                const float len_sq = bx[i] * bx[i] + by[i] * by[i] + bz[i] * bz[i];
+                const float inv_len = 1.0f / std::sqrt(len_sq);
+                bx[i] *= inv_len;
+                by[i] *= inv_len;
+                bz[i] *= inv_len;
+            }
+        }
+    } else {
+        const PackedFrame packed = PackFrame(static_frame_);
+        for (int c = 0; c < kFrameFloats; ++c) std::fill(frame[c], frame[c] + n, packed[c]);
+    }
+
+    // 2. Thin-lens offsets: SampleUniformDiskConcentric() with the branches turned into selects
+    float off_x[kN];
+    float off_y[kN];
+    float off_z[kN];
+    if (has_lens_) {
+        constexpr float kQuarterPi = 0.25f * MathConstants::kPi;
+        // Disk radius in off_x and angle in off_y until the last loop. cos and sin get loops of
+        // their own: in one loop GCC fuses them into a sincosf call it cannot vectorize.
+        for (int i = 0; i < n; ++i) {
+            const float a = 2.0f * b.lens_u[i] - 1.0f;
+            const float c = 2.0f * b.lens_v[i] - 1.0f;
+            const bool major_a = std::abs(a) > std::abs(c);
+            const float r = major_a ? a : c;
+            const float q = (major_a ? c : a) / (r != 0.0f ? r : 1.0f);
+            off_x[i] = r * frame[kLensRadius][i];
+            off_y[i] = major_a ? kQuarterPi * q : 2.0f * kQuarterPi - kQuarterPi * q;
+        }
+        for (int i = 0; i < n; ++i) off_z[i] = off_x[i] * std::cos(off_y[i]);
+        for (int i = 0; i < n; ++i) off_y[i] = off_x[i] * std::sin(off_y[i]);
+        for (int i = 0; i < n; ++i) {
+            const float dx = off_z[i];
+            const float dy = off_y[i];
+            off_x[i] = frame[kU][i] * dx + frame[kV][i] * dy;
+            off_y[i] = frame[kU + 1][i] * dx + frame[kV + 1][i] * dy;
+            off_z[i] = frame[kU + 2][i] * dx + frame[kV + 2][i] * dy;
+        }
+    } else {
+        std::fill(off_x, off_x + n, 0.0f);
+        std::fill(off_y, off_y + n, 0.0f);
+        std::fill(off_z, off_z + n, 0.0f);
+    }
+
+    // 3. Ray from the lens point through the focal plane point
+    for (int i = 0; i < n; ++i) {
+        const float s = b.s[i];
+        const float t = b.t[i];
+        const float ox = frame[kOrigin][i] + off_x[i];
+        const float oy = frame[kOrigin + 1][i] + off_y[i];
+        const float oz = frame[kOrigin + 2][i] + off_z[i];
+        const float fx = frame[kCorner][i] + frame[kHorizontal][i] * s + frame[kVertical][i] * t;
+        const float fy =
+            frame[kCorner + 1][i] + frame[kHorizontal + 1][i] * s + frame[kVertical + 1][i] * t;
+        const float fz =
+            frame[kCorner + 2][i] + frame[kHorizontal + 2][i] * s + frame[kVertical + 2][i] * t;
+        const float dx = fx - ox;
+        const float dy = fy - oy;
+        const float dz = fz - oz;
+        const float inv_len = 1.0f / std::sqrt(dx * dx + dy * dy + dz * dz);
+        b.origin_x[i] = ox;
+        b.origin_y[i] = oy;
+        b.origin_z[i] = oz;
+        b.dir_x[i] = dx * inv_len;
+        b.dir_y[i] = dy * inv_len;
+        b.dir_z[i] = dz * inv_len;
+        b.forward_x[i] = -frame[kW][i];
+        b.forward_y[i] = -frame[kW + 1][i];
+        b.forward_z[i] = -frame[kW + 2][i];
+        b.cone_spread[i] = frame[kConeSpread][i];
+    }
+}
+
+}  // namespace skwr
@@ -13,6 +13,7 @@
 #include "core/ray.h"
 #include "core/sampling/rng.h"
 #include "core/sampling/sampling.h"
+#include "core/transport/ray_cone.h"
 #include "scene/interp_curve.h"
 
 namespace skwr {
@@ -96,6 +97,42 @@ struct CameraFrame {
     Vec3 v;
     Vec3 w;
     float lens_radius = 0.0f;
+    float viewport_height = 2.0f;  // Image plane height at unit distance (2 * tan(vfov / 2))
+    float cone_spread = 0.0f;      // Primary ray cone spread angle, set by SetImageHeight()
+};
+
+// A block of camera samples and the rays generated for them, one array per component so
+// Camera::GenerateRays() runs as straight loops over contiguous floats.
+struct CameraRayBlock {
+    static constexpr int kCapacity = 64;
+    int count = 0;
+
+    // Inputs: normalized film position, shutter sample and lens sample
+    float s[kCapacity];
+    float t[kCapacity];
+    float u_time[kCapacity];
+    float lens_u[kCapacity];
+    float lens_v[kCapacity];
+
+    // Outputs
+    float origin_x[kCapacity];
+    float origin_y[kCapacity];
+    float origin_z[kCapacity];
+    float dir_x[kCapacity];
+    float dir_y[kCapacity];
+    float dir_z[kCapacity];
+    float time[kCapacity];
+    float forward_x[kCapacity];  // Camera forward axis at the ray's time
+    float forward_y[kCapacity];
+    float forward_z[kCapacity];
+    float cone_spread[kCapacity];
+
+    Ray GetRay(int i) const {
+        return Ray(Point3(origin_x[i], origin_y[i], origin_z[i]),
+                   Vec3(dir_x[i], dir_y[i], dir_z[i]), time[i]);
+    }
+    Vec3 Forward(int i) const { return Vec3(forward_x[i], forward_y[i], forward_z[i]); }
+    RayCone Cone(int i) const { return RayCone{0.0f, cone_spread[i]}; }
 };
 
 // LookAt camera with thin-lens depth of field.
@@ -122,20 +159,29 @@ class Camera {
                 keyframe_frames_.push_back(BuildFrame(kf.state, aspect_ratio_));
             }
         }
+        BuildShutterTable();
     }
 
     // Ray generation: takes normalized coords [0,1] and returns a world-space ray.
-    // When lens_radius_ > 0, applies thin-lens DoF by sampling the aperture disk.
-    Ray GetRay(float s, float t, RNG& rng, Vec3* cam_forward = nullptr) const {
-        float ray_time = shutter_open_ + rng.UniformFloat() * (shutter_close_ - shutter_open_);
-        const CameraFrame frame = animated_ ? InterpolateFrame(ray_time) : static_frame_;
+    // u_time picks the shutter time and u_lens the point on the aperture disk used for thin-lens
+    // DoF when lens_radius_ > 0.
+    // If cone is given it receives the primary ray cone (zero width, one-pixel spread angle);
+    // the spread is zero until SetImageHeight() has been called.
+    Ray GetRay(float s, float t, float u_time, Sample2D u_lens, Vec3* cam_forward = nullptr,
+               RayCone* cone = nullptr) const {
+        float ray_time = shutter_open_ + u_time * (shutter_close_ - shutter_open_);
+        const CameraFrame frame = FrameAt(ray_time);
         if (cam_forward != nullptr) {
             *cam_forward = -frame.w;
         }
+        if (cone != nullptr) {
+            cone->width = 0.0f;
+            cone->spread = frame.cone_spread;
+        }
 
         Vec3 offset(0.0f, 0.0f, 0.0f);
         if (frame.lens_radius > 0.0f) {
-            Vec3 rd = RandomInUnitDisk(rng) * frame.lens_radius;
+            Vec3 rd = SampleUniformDiskConcentric(u_lens) * frame.lens_radius;
             offset = frame.u * rd.x() + frame.v * rd.y();
         }
         Vec3 focal_point = frame.lower_left_corner + frame.horizontal * s + frame.vertical * t;
@@ -143,6 +189,42 @@ class Camera {
         return Ray(frame.origin + offset, dir, ray_time);
     }
 
+    // Same as above with the time and lens samples drawn from rng.
+    Ray GetRay(float s, float t, RNG& rng, Vec3* cam_forward = nullptr,
+               RayCone* cone = nullptr) const {
+        float u_time = rng.UniformFloat();
+        Sample2D u_lens{rng.UniformFloat(), rng.UniformFloat()};
+        return GetRay(s, t, u_time, u_lens, cam_forward, cone);
+    }
+
+    // Inverse of GetRay through the lens centre: the normalized (s, t) at which world point p
+    // appears at the given time. Returns false for points on or behind the camera plane.
+    bool Project(const Point3& p, float time, float* s, float* t) const {
+        const CameraFrame frame = FrameAt(time);
+        Vec3 d = p - frame.origin;
+        float z = -Dot(d, frame.w);
+        if (z <= 1e-6f) return false;
+        float inv_h = 1.0f / (z * frame.viewport_height);
+        *s = Dot(d, frame.u) * inv_h / aspect_ratio_ + 0.5f;
+        *t = Dot(d, frame.v) * inv_h + 0.5f;
+        return true;
+    }
+
+    float ShutterOpen() const { return shutter_open_; }
+    float ShutterClose() const { return shutter_close_; }
+
+    // Batched GetRay(): fills the outputs of the first block->count samples. Animated cameras
+    // lerp the shutter frame table, and the lens and pixel math runs as vectorizable loops.
+    void GenerateRays(CameraRayBlock* block) const;
+
+    // Film height in pixels, used to derive the per-pixel ray cone spread angle.
+    void SetImageHeight(int height) {
+        image_height_ = height;
+        static_frame_.cone_spread = ConeSpread(static_frame_.viewport_height);
+        for (CameraFrame& f : keyframe_frames_) f.cone_spread = ConeSpread(f.viewport_height);
+        BuildShutterTable();
+    }
+
     Vec3 GetW() const { return static_frame_.w; }
     const CameraTimeline& Timeline() const { return timeline_; }
 
@@ -160,6 +242,25 @@ class Camera {
         return timeline;
     }
 
+    // Shutter sub-steps in the frame table. Easing curves are sampled this finely, which keeps
+    // the piecewise-linear approximation well below a pixel for any sensible camera move.
+    static constexpr int kShutterSteps = 64;
+
+    float ConeSpread(float viewport_height) const {
+        return image_height_ > 0 ? std::atan(viewport_height / static_cast<float>(image_height_))
+                                 : 0.0f;
+    }
+
+    // Frame used for rays at the given time: the table inside the shutter interval,
+    // InterpolateFrame() outside it.
+    CameraFrame FrameAt(float time) const {
+        if (!animated_) return static_frame_;
+        return TableFrame(time);
+    }
+
+    void BuildShutterTable();
+    CameraFrame TableFrame(float time) const;
+
     static CameraFrame BuildFrame(const CameraState& state, float aspect_ratio) {
         auto theta = state.vfov * MathConstants::kPi / 180.0f;
         auto h = std::tan(theta / 2.0f);
@@ -172,6 +273,7 @@ class Camera {
         frame.v = Cross(frame.w, frame.u);
         frame.origin = state.look_from;
         frame.lens_radius = state.aperture_radius;
+        frame.viewport_height = viewport_height;
         frame.horizontal = frame.u * (viewport_width * state.focus_distance);
         frame.vertical = frame.v * (viewport_height * state.focus_distance);
         frame.lower_left_corner = frame.origin - frame.horizontal / 2.0f - frame.vertical / 2.0f -
@@ -214,6 +316,9 @@ class Camera {
         out.v = Normalize(LerpVec3(f0.v, f1.v, alpha));
         out.w = Normalize(LerpVec3(f0.w, f1.w, alpha));
         out.lens_radius = f0.lens_radius + (f1.lens_radius - f0.lens_radius) * alpha;
+        out.viewport_height =
+            f0.viewport_height + (f1.viewport_height - f0.viewport_height) * alpha;
+        out.cone_spread = f0.cone_spread + (f1.cone_spread - f0.cone_spread) * alpha;
         return out;
     }
 
@@ -224,9 +329,15 @@ class Camera {
     float shutter_open_ = 0.0f;
     float shutter_close_ = 0.0f;
     bool animated_ = false;
+    int image_height_ = 0;
     CameraFrame static_frame_;
     // Precomputed frames at each keyframe time; lerped between in InterpolateFrame().
     std::vector<CameraFrame> keyframe_frames_;
+    // Animated cameras only: frames at kShutterSteps + 1 evenly spaced shutter times, stored
+    // component-major (see camera.cc) so GenerateRays() can gather and lerp them per sample.
+    std::vector<float> shutter_table_;
+    float shutter_inv_step_ = 0.0f;  // Table steps per unit of time
+    bool has_lens_ = false;          // Any frame in the shutter interval has lens_radius > 0
 };
 
 }  // namespace skwr
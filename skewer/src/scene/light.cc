@@ -21,7 +21,7 @@ float LightPdfArea(const Scene& scene, int light_index) {
     return 0.0f;
 }
 
-LightSample SampleLight(const Scene& scene, int light_index, RNG& rng) {
+LightSample SampleLight(const Scene& scene, int light_index, Sample2D u) {
     const AreaLight& light = scene.Lights()[light_index];
     LightSample result;
     result.emission = light.emission;
@@ -29,17 +29,17 @@ LightSample SampleLight(const Scene& scene, int light_index, RNG& rng) {
     if (light.type == AreaLight::Sphere) {
         const Sphere& s = scene.LightSpheres()[light.primitive_index];
 
-        Vec3 random_point = RandomUnitVector(rng);
-        result.p = s.center + random_point * s.radius;
-        result.n = random_point;
+        Vec3 dir = SampleUniformSphere(u);
+        result.p = s.center + dir * s.radius;
+        result.n = dir;
 
         result.pdf = LightPdfArea(scene, light_index);
     } else if (light.type == AreaLight::Triangle) {
         const Triangle& t = scene.LightTriangles()[light.primitive_index];
 
         // Uniform sample on triangle (sqrt trick for uniform distribution)
-        float r1 = rng.UniformFloat();
-        float r2 = rng.UniformFloat();
+        float r1 = u.u;
+        float r2 = u.v;
         float sqrt_r1 = std::sqrt(r1);
 
         Vec3 p0 = t.p0;
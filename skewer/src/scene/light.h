@@ -2,7 +2,7 @@
 #define SKWR_SCENE_LIGHT_H_
 
 #include "core/math/vec3.h"
-#include "core/sampling/rng.h"
+#include "core/sampling/sampling.h"
 #include "core/spectral/spectral_curve.h"
 
 namespace skwr {
@@ -24,8 +24,8 @@ struct LightSample {
     float pdf;               // Probability density = (1 / Area)
 };
 
-// Returns a random point on the surface of the light
-LightSample SampleLight(const Scene& scene, int light_index, RNG& rng);
+// Maps a uniform sample u to a point on the surface of the light
+LightSample SampleLight(const Scene& scene, int light_index, Sample2D u);
 
 float LightPdfArea(const Scene& scene, int light_index);
 
@@ -79,7 +79,7 @@ uint32_t Scene::EnsureBlasForMesh(uint32_t mesh_id,
         t.interior_medium = kVacuumMediumId;
         t.exterior_medium = kVacuumMediumId;
         t.priority = 0;
-        t.needs_tangent_frame = mat != nullptr && mat->HasNormalMap();
+        t.needs_tangent_frame = mat != nullptr && mat->HasTextures();
 
         if (!mesh_ref.n.empty()) {
             t.n0 = mesh_ref.n[i0];
@@ -212,7 +212,7 @@ void Scene::BuildLegacyMeshBvhAndLights() {
             t.interior_medium = kVacuumMediumId;
             t.exterior_medium = kVacuumMediumId;
             t.priority = 0;
-            t.needs_tangent_frame = mat != nullptr && mat->HasNormalMap();
+            t.needs_tangent_frame = mat != nullptr && mat->HasTextures();
 
             if (!mesh_ref.n.empty()) {
                 t.n0 = mesh_ref.n[i0];
@@ -371,27 +371,52 @@ void Scene::Build() {
     }
 
     inv_light_count_ = lights_.empty() ? 0.0f : 1.0f / static_cast<float>(lights_.size());
+    ComputeBounds();
+
+    // Cached textures are tiled on the cache's loader thread while the scene builds; finish
+    // before rendering so lookups only read tiles
+    if (texture_cache_) texture_cache_->WaitUntilTiled();
+}
+
+void Scene::ComputeBounds() {
+    bounds_ = BoundBox();
+    auto expand_sphere = [this](const Sphere& s) {
+        Vec3 r(s.radius, s.radius, s.radius);
+        bounds_.Expand(BoundBox(s.center - r, s.center + r));
+    };
+    for (const Sphere& s : spheres_) expand_sphere(s);
+    for (const AnimatedSphere& as : animated_spheres_) {
+        expand_sphere(as.EvaluateAt(shutter_open_));
+        expand_sphere(as.EvaluateAt(shutter_close_));
+    }
+    if (!tlas_.IsEmpty()) bounds_.Expand(tlas_.Bounds());
+    if (!bvh_.IsEmpty()) bounds_.Expand(bvh_.GetNodes()[0].bounds);
 }
 
 bool Scene::Intersect(const Ray& r, float t_min, float t_max, SurfaceInteraction* si) const {
     bool hit_anything = false;
     float closest_t = t_max;
 
-    for (const AnimatedSphere& asphere : animated_spheres_) {
+    const uint32_t sphere_base = static_cast<uint32_t>(instances_.size());
+    const uint32_t animated_base = sphere_base + static_cast<uint32_t>(spheres_.size());
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(animated_spheres_.size()); ++i) {
         TRS trs;
-        Sphere s = asphere.EvaluateAt(r.time(), &trs);
+        Sphere s = animated_spheres_[i].EvaluateAt(r.time(), &trs);
         if (IntersectSphere(r, s, t_min, closest_t, si)) {
             hit_anything = true;
             closest_t = si->t;
             si->nano_vdb_trs = trs;
+            si->object_id = animated_base + i;
         }
     }
 
-    for (const Sphere& sphere : spheres_) {
-        if (IntersectSphere(r, sphere, t_min, closest_t, si)) {
+    for (uint32_t i = 0; i < static_cast<uint32_t>(spheres_.size()); ++i) {
+        if (IntersectSphere(r, spheres_[i], t_min, closest_t, si)) {
             hit_anything = true;
             closest_t = si->t;
-            si->nano_vdb_trs = sphere.nano_vdb_trs;
+            si->nano_vdb_trs = spheres_[i].nano_vdb_trs;
+            si->object_id = sphere_base + i;
         }
     }
 
@@ -402,6 +427,7 @@ bool Scene::Intersect(const Ray& r, float t_min, float t_max, SurfaceInteraction
     } else if (!bvh_.IsEmpty()) {
         if (bvh_.Intersect(r, t_min, closest_t, si, triangles_)) {
             hit_anything = true;
+            si->object_id = kNoObjectId;
         }
     }
 
@@ -413,6 +439,30 @@ bool Scene::SampleSkybox(const Ray& r, float t_min, float t_max, SkyboxSample* s
     return skybox_->Sample(r, t_min, t_max, sample);
 }
 
+void Scene::ObjectPointAtShutter(uint32_t object_id, const Point3& p, float time,
+                                 Point3* p_open, Point3* p_close) const {
+    *p_open = p;
+    *p_close = p;
+    const uint32_t sphere_base = static_cast<uint32_t>(instances_.size());
+    const uint32_t animated_base = sphere_base + static_cast<uint32_t>(spheres_.size());
+
+    if (object_id < sphere_base) {
+        const Instance& inst = instances_[object_id];
+        if (inst.is_static) return;
+        Point3 local = TRSInverseApplyPoint(EvaluateTransformChain(inst.transform_chain, time), p);
+        *p_open = TRSApplyPoint(EvaluateTransformChain(inst.transform_chain, shutter_open_), local);
+        *p_close =
+            TRSApplyPoint(EvaluateTransformChain(inst.transform_chain, shutter_close_), local);
+    } else if (object_id >= animated_base &&
+               object_id - animated_base < animated_spheres_.size()) {
+        const AnimatedSphere& as = animated_spheres_[object_id - animated_base];
+        if (as.local_data.center_is_world) return;
+        Point3 local = TRSInverseApplyPoint(EvaluateTransformChain(as.transform_chain, time), p);
+        *p_open = TRSApplyPoint(EvaluateTransformChain(as.transform_chain, shutter_open_), local);
+        *p_close = TRSApplyPoint(EvaluateTransformChain(as.transform_chain, shutter_close_), local);
+    }
+}
+
 uint32_t Scene::AddSphere(const Sphere& s) {
     spheres_.push_back(s);
     return static_cast<uint32_t>(spheres_.size() - 1);
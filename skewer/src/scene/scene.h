@@ -4,6 +4,7 @@
 #include <sys/types.h>
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <unordered_map>
 #include <utility>
@@ -19,6 +20,7 @@
 #include "geometry/triangle.h"
 #include "materials/material.h"
 #include "materials/texture.h"
+#include "materials/texture_cache.h"
 #include "media/mediums.h"
 #include "media/nano_vdb_medium.h"
 #include "scene/light.h"
@@ -47,6 +49,14 @@ class Scene {
 
     const Material& GetMaterial(uint32_t id) const { return materials_[id]; }
     const ImageTexture& GetTexture(uint32_t id) const { return textures_[id]; }
+    // Route subsequent texture loads through a tiled cache limited to budget_bytes.
+    void EnableTextureCache(size_t budget_bytes) {
+        texture_cache_ = std::make_unique<TextureCache>(budget_bytes);
+    }
+    TextureCache* texture_cache() const { return texture_cache_.get(); }
+    // Precompute rgb2spec coefficients for albedo textures loaded after this call.
+    void SetPrecomputeTextureCurves(bool enable) { precompute_texture_curves_ = enable; }
+    bool precompute_texture_curves() const { return precompute_texture_curves_; }
     const Mesh& GetMesh(uint32_t id) const { return meshes_[id]; }
     Mesh& GetMutableMesh(uint32_t id) { return meshes_[id]; }
     size_t MeshCount() const { return meshes_.size(); }
@@ -60,6 +70,8 @@ class Scene {
     const std::vector<GridMedium>& grid_media() const { return grid_media_; }
     const std::vector<NanoVDBMedium>& nanovdb_media() const { return nanovdb_media_; }
     const float& InvLightCount() const { return inv_light_count_; }
+    // World bounds of all geometry, computed by Build().
+    const BoundBox& Bounds() const { return bounds_; }
     void SetSkybox(const Skybox& skybox) { skybox_ = skybox; }
     void SetSkybox(Skybox&& skybox) { skybox_ = std::move(skybox); }
     bool HasSkybox() const { return skybox_.has_value() && skybox_->IsValid(); }
@@ -78,18 +90,26 @@ class Scene {
 
     bool Intersect(const Ray& r, float t_min, float t_max, SurfaceInteraction* si) const;
 
+    // Where the surface point p of object_id (as set by Intersect) hit at `time` sits at shutter
+    // open and close. Static objects return p for both.
+    void ObjectPointAtShutter(uint32_t object_id, const Point3& p, float time, Point3* p_open,
+                              Point3* p_close) const;
+
   private:
     void ExtractInstancesFromGraph(const SceneNode& node, std::vector<AnimatedTransform> prefix,
                                    std::unordered_map<uint32_t, uint32_t>& mesh_to_blas);
     uint32_t EnsureBlasForMesh(uint32_t mesh_id,
                                std::unordered_map<uint32_t, uint32_t>& mesh_to_blas);
     void BuildLegacyMeshBvhAndLights();
+    void ComputeBounds();
 
     std::optional<SceneNode> graph_root_;
     std::vector<Sphere> spheres_;
     std::vector<AnimatedSphere> animated_spheres_;
     std::vector<Material> materials_;
     std::vector<ImageTexture> textures_;
+    std::unique_ptr<TextureCache> texture_cache_;  // Null when textures are fully resident
+    bool precompute_texture_curves_ = false;
     std::vector<Mesh> meshes_;
     std::vector<Triangle> triangles_;
     std::vector<Triangle> light_triangles_;
@@ -104,6 +124,7 @@ class Scene {
     TLAS tlas_;
     BVH bvh_;
     float inv_light_count_ = 0.0f;
+    BoundBox bounds_;
     float shutter_open_ = 0.0f;
     float shutter_close_ = 0.0f;
     uint16_t global_medium_id_ = 0;  // 0 represents Vacuum
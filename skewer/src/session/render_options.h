@@ -3,8 +3,11 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "core/math/vec3.h"
+#include "core/sampling/sampler.h"
+#include "film/aov.h"
 
 namespace skwr {
 
@@ -13,12 +16,18 @@ enum class IntegratorType {
     Normals,
 };
 
+enum class RouletteMode {
+    Throughput,  // From depth 4, survive with probability max(beta)
+    Efficiency,  // From depth 1, weight window on the expected contribution (see Li())
+};
+
 struct IntegratorConfig {
     int max_depth;
     int max_samples;  // Upper bound on samples per pixel
     int start_sample;
     int num_threads = 0;  // 0 = auto-detect (hardware_concurrency)
     int tile_size = 32;   // Tile dimensions for work-stealing (NxN pixels)
+    SamplerType sampler = SamplerType::ZSobol;  // Camera, wavelength, light and BSDF samples
 
     // Adaptive sampling: when noise_threshold > 0, pixels that converge
     // below the threshold stop early. When 0, all pixels render to max_samples.
@@ -27,6 +36,21 @@ struct IntegratorConfig {
     int adaptive_step = 16;        // Samples between convergence checks
     bool save_sample_map = false;  // Debug: write per-pixel sample count heatmap
     bool enable_deep = false;
+    // Collect first-hit albedo/normal and denoise the flat image after rendering
+    bool denoise = false;
+    // Path guiding: learn an SD-tree of incident radiance during the first quarter of the
+    // samples and mix it with BSDF sampling on diffuse surfaces.
+    bool path_guiding = false;
+    // Trace one sample of every pixel in a tile to its first hit, then shade the hits grouped by
+    // material type and id instead of in pixel order. Same samples, more coherent shading.
+    bool material_sort = false;
+    // Russian roulette and splitting. Efficiency roulette keeps every path whose expected
+    // contribution is at least roulette_window times the pixel estimate. split_factor > 1 traces
+    // up to that many indirect paths from the first diffuse vertex, fewer where the expected
+    // contribution is small. Splitting is skipped for deep output and guiding training passes.
+    RouletteMode roulette = RouletteMode::Throughput;
+    float roulette_window = 0.25f;
+    int split_factor = 1;
     // When true, primary rays that miss all geometry produce alpha=0 instead of
     // opaque black. Enables clean layer compositing without a black background matte.
     // nullopt = not explicitly set by the user (renderer may apply a default).
@@ -47,6 +71,7 @@ struct ImageConfig {
     int height;
     std::string outfile;
     std::string exrfile;
+    std::vector<AOVType> aovs;  // Extra flat EXR channels
 };
 
 struct RenderOptions {
@@ -4,6 +4,7 @@
 #include <exrio/deep_writer.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <iostream>
@@ -14,6 +15,8 @@
 #include "core/cpu_config.h"
 #include "core/math/vec3.h"
 #include "core/spectral/spectral_utils.h"
+#include "film/aov.h"
+#include "film/denoiser.h"
 #include "film/film.h"
 #include "film/image_buffer.h"
 #include "geometry/boundbox.h"
@@ -23,6 +26,7 @@
 #include "io/image_io.h"
 #include "io/scene_loader.h"
 #include "materials/material.h"
+#include "materials/texture_cache.h"
 #include "scene/camera.h"
 #include "scene/scene.h"
 #include "session/render_options.h"
@@ -100,6 +104,49 @@ static bool LayerStemMatches(const std::string& layer_path, const std::string& s
     return LayerStemFromPath(layer_path) == stem_or_path;
 }
 
+static void PrintTextureCacheStats(const Scene& scene) {
+    const TextureCache* cache = scene.texture_cache();
+    if (!cache) return;
+    std::cout << "[Session] Texture cache: "
+              << FormatTextureCacheStats(cache->Stats(), cache->budget_bytes()) << "\n";
+}
+
+// Film sized for the image config, with the requested AOVs enabled. Denoising also needs the
+// albedo and normal AOVs as features.
+static std::unique_ptr<Film> CreateFilm(const RenderOptions& opts) {
+    auto film = std::make_unique<Film>(opts.image_config.width, opts.image_config.height);
+    for (AOVType type : opts.image_config.aovs) film->EnableAOV(type);
+    if (opts.integrator_config.denoise) {
+        film->EnableAOV(AOVType::Albedo);
+        film->EnableAOV(AOVType::Normal);
+    }
+    return film;
+}
+
+// Writes the flat image. PNG has no room for AOVs, so when AOVs were requested next to a PNG
+// they go to a "<outfile>_aovs.exr" sibling holding the beauty plus the AOV channels.
+static void WriteFlatOutputs(const Film& film, const ImageConfig& img) {
+    film.WriteImage(img.outfile);
+    if (img.aovs.empty() || img.outfile.ends_with(".exr")) return;
+    auto dot = img.outfile.rfind('.');
+    std::string aov_file =
+        (dot != std::string::npos ? img.outfile.substr(0, dot) : img.outfile) + "_aovs.exr";
+    film.WriteImage(aov_file);
+}
+
+// Post-render denoise of the flat image; deep buckets are left as rendered.
+static void DenoiseFilm(Film* film, const IntegratorConfig& ic) {
+    if (!ic.denoise) return;
+    DenoiseOptions dopts;
+    dopts.num_threads = ic.num_threads;
+    const auto start = std::chrono::steady_clock::now();
+    film->Denoise(dopts);
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    std::cout << "[Session] Denoised in " << ms << " ms\n";
+}
+
 static void RenderLayerPass(const SceneConfig& config, const std::string& layer_path,
                             float shutter_open, float shutter_close,
                             const std::pair<std::string, std::string>& out_paths,
@@ -109,6 +156,10 @@ static void RenderLayerPass(const SceneConfig& config, const std::string& layer_
     if (config.skybox) {
         layer_scene->SetSkybox(*config.skybox);
     }
+    if (config.texture_cache_mb > 0) {
+        layer_scene->EnableTextureCache(config.texture_cache_mb << 20);
+    }
+    layer_scene->SetPrecomputeTextureCurves(config.spectral_textures);
     LoadContextIntoScene(config.context_paths, *layer_scene);
     LayerConfig lcfg = LoadLayerFile(layer_path, *layer_scene);
     layer_scene->SetShutter(shutter_open, shutter_close);
@@ -132,9 +183,10 @@ static void RenderLayerPass(const SceneConfig& config, const std::string& layer_
         static_cast<float>(opts.image_config.width) / static_cast<float>(opts.image_config.height);
     auto cam =
         std::make_unique<Camera>(config.camera_timeline, aspect, shutter_open, shutter_close);
+    cam->SetImageHeight(opts.image_config.height);
     ic.cam_w = -cam->GetW();
 
-    auto film = std::make_unique<Film>(opts.image_config.width, opts.image_config.height);
+    auto film = CreateFilm(opts);
     auto integ = CreateIntegrator(opts.integrator_type);
 
     const auto& lic = opts.integrator_config;
@@ -142,8 +194,10 @@ static void RenderLayerPass(const SceneConfig& config, const std::string& layer_
               << " | Samples: " << lic.max_samples << " | Depth: " << lic.max_depth << "\n";
 
     integ->Render(*layer_scene, *cam, film.get(), ic);
+    PrintTextureCacheStats(*layer_scene);
+    DenoiseFilm(film.get(), ic);
 
-    film->WriteImage(opts.image_config.outfile);
+    WriteFlatOutputs(*film, opts.image_config);
     std::cout << "[Session] Wrote " << opts.image_config.outfile << "\n";
 
     if (ic.enable_deep) {
@@ -334,8 +388,9 @@ void RenderSession::LoadLayerDirect(const std::string& layer_file, Vec3 look_fro
     float aspect = static_cast<float>(options_.image_config.width) /
                    static_cast<float>(options_.image_config.height);
     camera_ = std::make_unique<Camera>(cam_timeline_, aspect);
+    camera_->SetImageHeight(options_.image_config.height);
 
-    film_ = std::make_unique<Film>(options_.image_config.width, options_.image_config.height);
+    film_ = CreateFilm(options_);
     integrator_ = CreateIntegrator(options_.integrator_type);
     options_.integrator_config.cam_w = -camera_->GetW();
 
@@ -361,6 +416,10 @@ void RenderSession::LoadSceneFromFile(const std::string& scene_file, int thread_
     if (config.skybox) {
         scene_->SetSkybox(*config.skybox);
     }
+    if (config.texture_cache_mb > 0) {
+        scene_->EnableTextureCache(config.texture_cache_mb << 20);
+    }
+    scene_->SetPrecomputeTextureCurves(config.spectral_textures);
     LoadContextIntoScene(config.context_paths, *scene_);
 
     if (config.layer_paths.empty()) {
@@ -398,9 +457,10 @@ void RenderSession::LoadSceneFromFile(const std::string& scene_file, int thread_
                    static_cast<float>(options_.image_config.height);
     camera_ =
         std::make_unique<Camera>(cam_timeline_, aspect, cam_shutter_open_, cam_shutter_close_);
+    camera_->SetImageHeight(options_.image_config.height);
 
     // 7. Create film and integrator
-    film_ = std::make_unique<Film>(options_.image_config.width, options_.image_config.height);
+    film_ = CreateFilm(options_);
     integrator_ = CreateIntegrator(options_.integrator_type);
     // GetW() returns the backward-facing basis vector (look_from - look_at).
     // Negate it so cam_w points forward for correct depth projection.
@@ -423,9 +483,10 @@ void RenderSession::RebuildFilm() {
                    static_cast<float>(options_.image_config.height);
     camera_ =
         std::make_unique<Camera>(cam_timeline_, aspect, cam_shutter_open_, cam_shutter_close_);
+    camera_->SetImageHeight(options_.image_config.height);
     options_.integrator_config.cam_w = -camera_->GetW();
 
-    film_ = std::make_unique<Film>(options_.image_config.width, options_.image_config.height);
+    film_ = CreateFilm(options_);
 }
 
 /**
@@ -440,6 +501,8 @@ void RenderSession::Render() {
     std::cout << "[Session] Starting Render...\n";
 
     integrator_->Render(*scene_, *camera_, film_.get(), options_.integrator_config);
+    PrintTextureCacheStats(*scene_);
+    DenoiseFilm(film_.get(), options_.integrator_config);
 }
 
 /**
@@ -447,7 +510,7 @@ void RenderSession::Render() {
  */
 void RenderSession::Save() const {
     if (film_) {
-        film_->WriteImage(options_.image_config.outfile);
+        WriteFlatOutputs(*film_, options_.image_config);
 
         if (options_.integrator_config.save_sample_map) {
             // Insert "_samples" before the file extension
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+
+#include "core/math/constants.h"
+#include "core/math/vec3.h"
+#include "core/sampling/sampling.h"
+#include "film/aov.h"
+#include "film/film.h"
+#include "scene/camera.h"
+
+namespace skwr {
+
+TEST(AOVTest, DisabledAOVsAreIgnored) {
+    Film film(1, 1);
+    EXPECT_FALSE(film.HasAOVs());
+    const float depth = 3.0f;
+    film.AddAOVSample(0, 0, AOVType::Depth, &depth, 1.0f);
+    EXPECT_EQ(film.GetAOV(0, 0, AOVType::Depth, 0), 0.0f);
+
+    film.EnableAOV(AOVType::Depth);
+    EXPECT_TRUE(film.HasAOVs());
+    EXPECT_TRUE(film.HasAOV(AOVType::Depth));
+    EXPECT_FALSE(film.HasAOV(AOVType::Normal));
+}
+
+TEST(AOVTest, FiltersCombineSamples) {
+    Film film(2, 1);
+    film.EnableAOV(AOVType::Depth);
+    film.EnableAOV(AOVType::Normal);
+    film.EnableAOV(AOVType::ObjectId);
+
+    const float depths[] = {5.0f, 2.0f, 4.0f};
+    const float ids[] = {HashIdToFloat(7), HashIdToFloat(9), HashIdToFloat(7)};
+    const float normals[2][3] = {{0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}};
+    for (int s = 0; s < 3; ++s) {
+        film.AddSample(0, 0, RGB(0.5f), 1.0f);
+        film.AddAOVSample(0, 0, AOVType::Depth, &depths[s], 1.0f);
+        film.AddAOVSample(0, 0, AOVType::ObjectId, &ids[s], 1.0f);
+    }
+    film.AddAOVSample(0, 0, AOVType::Normal, normals[0], 1.0f);
+    film.AddAOVSample(0, 0, AOVType::Normal, normals[1], 1.0f);
+
+    // Min keeps the nearest hit, First the first id, Average divides by the pixel's weight
+    // (three samples, one of which missed for the normal)
+    EXPECT_EQ(film.GetAOV(0, 0, AOVType::Depth, 0), 2.0f);
+    EXPECT_EQ(film.GetAOV(0, 0, AOVType::ObjectId, 0), HashIdToFloat(7));
+    EXPECT_NEAR(film.GetAOV(0, 0, AOVType::Normal, 1), 1.0f / 3.0f, 1e-6f);
+    EXPECT_NEAR(film.GetAOV(0, 0, AOVType::Normal, 2), 1.0f / 3.0f, 1e-6f);
+
+    // A pixel nothing hit
+    film.AddSample(1, 0, RGB(0.0f), 1.0f);
+    EXPECT_EQ(film.GetAOV(1, 0, AOVType::Depth, 0), RenderConstants::kFarClip);
+    EXPECT_EQ(film.GetAOV(1, 0, AOVType::ObjectId, 0), 0.0f);
+    EXPECT_EQ(film.GetAOV(1, 0, AOVType::Normal, 2), 0.0f);
+}
+
+TEST(AOVTest, IdHashesAreFiniteAndDistinct) {
+    for (uint32_t id = 0; id < 4096; ++id) {
+        float h = HashIdToFloat(id);
+        EXPECT_TRUE(std::isnormal(h)) << id;
+        EXPECT_NE(h, HashIdToFloat(id + 1)) << id;
+    }
+}
+
+TEST(AOVTest, CameraProjectInvertsGetRay) {
+    Camera cam(Vec3(1.0f, 2.0f, 3.0f), Vec3(0.0f, 0.0f, -2.0f), Vec3(0.0f, 1.0f, 0.0f), 50.0f,
+               16.0f / 9.0f);
+    for (float s : {0.1f, 0.5f, 0.83f}) {
+        for (float t : {0.2f, 0.5f, 0.95f}) {
+            Ray r = cam.GetRay(s, t, 0.0f, Sample2D{0.5f, 0.5f});
+            float ps = 0.0f;
+            float pt = 0.0f;
+            ASSERT_TRUE(cam.Project(r.at(7.5f), 0.0f, &ps, &pt));
+            EXPECT_NEAR(ps, s, 1e-4f);
+            EXPECT_NEAR(pt, t, 1e-4f);
+        }
+    }
+    float ps = 0.0f;
+    float pt = 0.0f;
+    EXPECT_FALSE(cam.Project(Vec3(1.0f, 2.0f, 10.0f), 0.0f, &ps, &pt));  // Behind the camera
+}
+
+}  // namespace skwr
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/math/vec3.h"
+#include "core/ray.h"
+#include "core/sampling/sampling.h"
+#include "core/sampling/wavelength_sampler.h"
+#include "core/spectral/spectral_curve.h"
+#include "core/spectral/spectrum.h"
+#include "core/transport/surface_interaction.h"
+#include "materials/bsdf.h"
+#include "materials/material.h"
+#include "materials/texture_lookup.h"
+
+namespace skwr {
+
+namespace {
+
+constexpr MaterialType kAllTypes[] = {MaterialType::Lambertian, MaterialType::Metal,
+                                      MaterialType::Dielectric};
+
+Material MakeMaterial(MaterialType type) {
+    Material mat{};
+    mat.type = type;
+    mat.albedo = SpectralCurve{{-1e-5f, 0.01f, -2.0f}, 0.8f};  // A smooth, non-flat curve
+    mat.roughness = 0.4f;
+    mat.ior = 1.5f;
+    mat.dispersion = 0.0f;
+    return mat;
+}
+
+// Exact dielectric Fresnel reflectance from air into a medium of IOR eta, for cos_i in [0, 1]
+float ReferenceFresnel(float cos_i, float eta) {
+    float sin_t = std::sqrt(std::max(0.0f, 1.0f - cos_i * cos_i)) / eta;
+    float cos_t = std::sqrt(std::max(0.0f, 1.0f - sin_t * sin_t));
+    float r_parl = (eta * cos_i - cos_t) / (eta * cos_i + cos_t);
+    float r_perp = (cos_i - eta * cos_t) / (cos_i + eta * cos_t);
+    return 0.5f * (r_parl * r_parl + r_perp * r_perp);
+}
+
+void ExpectSpectrumEq(const Spectrum& a, const Spectrum& b) {
+    for (int i = 0; i < kNSamples; ++i) EXPECT_EQ(a[i], b[i]) << i;
+}
+
+}  // namespace
+
+TEST(BSDFTest, DispatchPassesTheType) {
+    for (MaterialType type : kAllTypes) {
+        MaterialType seen =
+            DispatchMaterialType(type, [](auto tag) { return decltype(tag)::value; });
+        EXPECT_EQ(seen, type);
+    }
+}
+
+// The per-type kernels must give exactly what the switching entry points give
+TEST(BSDFTest, TypedKernelsMatchDispatch) {
+    SampledWavelengths wl = WavelengthSampler::Sample(0.37f);
+    SurfaceInteraction si{};
+    si.point = Point3(0.0f, 0.0f, 0.0f);
+    si.n_geom = Vec3(0.0f, 0.0f, 1.0f);
+    si.wo = Normalize(Vec3(0.3f, -0.2f, 1.0f));
+    Ray r_in(Point3(0.0f, 0.0f, 1.0f), -si.wo, 0.0f);
+    const Vec3 wi_eval = Normalize(Vec3(-0.4f, 0.1f, 1.0f));
+
+    for (MaterialType type : kAllTypes) {
+        const Material mat = MakeMaterial(type);
+        const ShadingData sd{mat.albedo, mat.roughness, si.n_geom};
+        DispatchMaterialType(type, [&](auto tag) {
+            constexpr MaterialType kType = decltype(tag)::value;
+            ExpectSpectrumEq(EvalBSDF<kType>(mat, sd, si.wo, wi_eval, wl),
+                             EvalBSDF(mat, sd, si.wo, wi_eval, wl));
+            EXPECT_EQ(PdfBSDF<kType>(mat, sd, si.wo, wi_eval), PdfBSDF(mat, sd, si.wo, wi_eval));
+
+            for (float uc : {0.02f, 0.5f, 0.98f}) {
+                const Sample2D u{uc, 1.0f - uc};
+                Vec3 wi_a, wi_b;
+                float pdf_a = 0.0f;
+                float pdf_b = 0.0f;
+                Spectrum f_a(0.0f), f_b(0.0f);
+                const bool ok_a =
+                    SampleBSDF<kType>(mat, sd, r_in, si, uc, u, wl, wi_a, pdf_a, f_a);
+                const bool ok_b = SampleBSDF(mat, sd, r_in, si, uc, u, wl, wi_b, pdf_b, f_b);
+                ASSERT_EQ(ok_a, ok_b);
+                if (!ok_a) continue;
+                EXPECT_EQ(wi_a.x(), wi_b.x());
+                EXPECT_EQ(wi_a.y(), wi_b.y());
+                EXPECT_EQ(wi_a.z(), wi_b.z());
+                EXPECT_EQ(pdf_a, pdf_b);
+                ExpectSpectrumEq(f_a, f_b);
+            }
+        });
+    }
+}
+
+TEST(BSDFTest, FresnelTableMatchesExact) {
+    for (float eta : {1.0f, 1.33f, 1.5f, 2.42f, 3.0f}) {
+        for (int i = 1; i <= 200; ++i) {
+            float cos_i = static_cast<float>(i) / 200.0f;
+            EXPECT_NEAR(FresnelDielectric(cos_i, 1.0f, eta), ReferenceFresnel(cos_i, eta), 2e-3f)
+                << "eta " << eta << " cos " << cos_i;
+        }
+    }
+    // Leaving glass: total internal reflection past the critical angle, and reciprocity below it
+    EXPECT_EQ(FresnelDielectric(-0.3f, 1.0f, 1.5f), 1.0f);
+    float cos_t = std::sqrt(1.0f - 1.5f * 1.5f * (1.0f - 0.9f * 0.9f));
+    EXPECT_NEAR(FresnelDielectric(-0.9f, 1.0f, 1.5f), ReferenceFresnel(cos_t, 1.5f), 2e-3f);
+    // Outside the table range falls back to the exact formula
+    EXPECT_NEAR(FresnelDielectric(0.6f, 1.0f, 4.0f), ReferenceFresnel(0.6f, 4.0f), 1e-6f);
+}
+
+TEST(BSDFTest, GGXAlbedoFallsWithRoughness) {
+    EXPECT_NEAR(GGXAlbedo(0.8f, 0.0f), 1.0f, 0.01f);
+    EXPECT_NEAR(GGXAlbedo(0.8f, 1.0f), 0.341f, 0.01f);  // Brute-force hemisphere integral
+    for (int i = 1; i <= 10; ++i) {
+        float r = static_cast<float>(i) / 10.0f;
+        EXPECT_LE(GGXAlbedo(0.5f, r), GGXAlbedo(0.5f, r - 0.1f) + 1e-4f) << r;
+    }
+}
+
+// White furnace: with F = 1 and the multiple-scattering compensation, a rough metal reflects all
+// of the incident energy
+TEST(BSDFTest, RoughMetalConservesEnergy) {
+    SampledWavelengths wl = WavelengthSampler::Sample(0.5f);
+    Material mat = MakeMaterial(MaterialType::Metal);
+    mat.albedo = SpectralCurve{{0.0f, 0.0f, 0.0f}, 2.0f};  // sigmoid(0) * 2 = 1 everywhere
+    SurfaceInteraction si{};
+    si.n_geom = Vec3(0.0f, 0.0f, 1.0f);
+    Ray r_in(Point3(0.0f, 0.0f, 1.0f), Vec3(0.0f, 0.0f, -1.0f), 0.0f);
+
+    for (float roughness : {0.3f, 0.7f, 1.0f}) {
+        mat.roughness = roughness;
+        const ShadingData sd{mat.albedo, roughness, si.n_geom};
+        for (float cos_o : {0.3f, 0.7f, 1.0f}) {
+            si.wo = Vec3(std::sqrt(1.0f - cos_o * cos_o), 0.0f, cos_o);
+            constexpr int kN = 64;
+            double sum = 0.0;
+            for (int i = 0; i < kN; ++i) {
+                for (int j = 0; j < kN; ++j) {
+                    Sample2D u{(i + 0.5f) / kN, (j + 0.5f) / kN};
+                    Vec3 wi;
+                    float pdf = 0.0f;
+                    Spectrum f(0.0f);
+                    if (!SampleBSDF(mat, sd, r_in, si, 0.5f, u, wl, wi, pdf, f)) continue;
+                    sum += f[0] * wi.z() / pdf;
+                }
+            }
+            EXPECT_NEAR(sum / (kN * kN), 1.0, 0.02) << roughness << " " << cos_o;
+        }
+    }
+}
+
+// A roughness texture reaches the metal lobe through sd.roughness; the flat material value must not
+// change the sampled lobe or its energy compensation
+TEST(BSDFTest, MetalUsesShadingRoughness) {
+    SampledWavelengths wl = WavelengthSampler::Sample(0.5f);
+    Material textured = MakeMaterial(MaterialType::Metal);
+    Material flat = textured;
+    textured.roughness = 0.05f;
+    flat.roughness = 0.7f;
+    SurfaceInteraction si{};
+    si.n_geom = Vec3(0.0f, 0.0f, 1.0f);
+    si.wo = Normalize(Vec3(0.4f, 0.0f, 1.0f));
+    Ray r_in(Point3(0.0f, 0.0f, 1.0f), -si.wo, 0.0f);
+    const ShadingData sd{textured.albedo, 0.7f, si.n_geom};
+
+    for (Sample2D u : {Sample2D{0.2f, 0.3f}, Sample2D{0.6f, 0.9f}, Sample2D{0.85f, 0.1f}}) {
+        Vec3 wi_a, wi_b;
+        float pdf_a = 0.0f, pdf_b = 0.0f;
+        Spectrum f_a(0.0f), f_b(0.0f);
+        bool ok_a = SampleBSDF(textured, sd, r_in, si, 0.5f, u, wl, wi_a, pdf_a, f_a);
+        bool ok_b = SampleBSDF(flat, sd, r_in, si, 0.5f, u, wl, wi_b, pdf_b, f_b);
+        ASSERT_EQ(ok_a, ok_b);
+        if (!ok_a) continue;
+        EXPECT_EQ(pdf_a, pdf_b);
+        ExpectSpectrumEq(f_a, f_b);
+    }
+}
+
+}  // namespace skwr
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+
+#include "core/color/color.h"
+#include "film/aov.h"
+#include "film/denoiser.h"
+#include "film/film.h"
+
+namespace skwr {
+
+namespace {
+
+constexpr int kW = 48;
+constexpr int kH = 40;
+
+// Deterministic noise in [-1, 1)
+float Noise(uint32_t i) {
+    i ^= i >> 16;
+    i *= 0x7feb352dU;
+    i ^= i >> 15;
+    i *= 0x846ca68bU;
+    i ^= i >> 16;
+    return static_cast<float>(i >> 8) / 8388608.0f - 1.0f;
+}
+
+// Left half dark, right half bright, with matching albedo and uniform noise of the given
+// amplitude. The variance planes hold the true variance of that noise.
+DenoiseImage MakeStepImage(float amplitude) {
+    DenoiseImage img(kW, kH);
+    for (int y = 0; y < kH; ++y) {
+        for (int x = 0; x < kW; ++x) {
+            const size_t i = static_cast<size_t>(y) * kW + x;
+            const float base = x < kW / 2 ? 0.2f : 0.8f;
+            for (int c = 0; c < 3; ++c) {
+                img.color[c][i] = base + amplitude * Noise(static_cast<uint32_t>(3 * i + c));
+                img.variance[c][i] = amplitude * amplitude / 3.0f;
+                img.albedo[c][i] = base;
+            }
+            img.normal[2][i] = 1.0f;
+        }
+    }
+    return img;
+}
+
+float TrueValue(int x) { return x < kW / 2 ? 0.2f : 0.8f; }
+
+float MeanAbsError(const std::array<std::vector<float>, 3>& planes) {
+    double err = 0.0;
+    for (int y = 0; y < kH; ++y) {
+        for (int x = 0; x < kW; ++x) {
+            const size_t i = static_cast<size_t>(y) * kW + x;
+            for (int c = 0; c < 3; ++c) err += std::abs(planes[c][i] - TrueValue(x));
+        }
+    }
+    return static_cast<float>(err / (3.0 * kW * kH));
+}
+
+}  // namespace
+
+TEST(DenoiserTest, ReducesNoise) {
+    DenoiseImage img = MakeStepImage(0.15f);
+    DenoiseOptions opts;
+    opts.num_threads = 3;
+    std::array<std::vector<float>, 3> out = Denoise(img, opts);
+    EXPECT_LT(MeanAbsError(out), 0.4f * MeanAbsError(img.color));
+}
+
+TEST(DenoiserTest, AlbedoEdgeDoesNotBleed) {
+    DenoiseImage img = MakeStepImage(0.15f);
+    std::array<std::vector<float>, 3> out = Denoise(img, DenoiseOptions{});
+    // Columns right next to the step stay on their own side
+    for (int y = 0; y < kH; ++y) {
+        const size_t left = static_cast<size_t>(y) * kW + kW / 2 - 1;
+        EXPECT_NEAR(out[1][left], 0.2f, 0.08f);
+        EXPECT_NEAR(out[1][left + 1], 0.8f, 0.08f);
+    }
+}
+
+TEST(DenoiserTest, NoiseFreeImageIsPreserved) {
+    DenoiseImage img = MakeStepImage(0.0f);
+    for (size_t i = 0; i < img.color[0].size(); ++i) img.color[0][i] += 0.05f * (i % 7);
+    std::array<std::vector<float>, 3> out = Denoise(img, DenoiseOptions{});
+    for (int c = 0; c < 3; ++c) {
+        for (size_t i = 0; i < out[c].size(); ++i) EXPECT_NEAR(out[c][i], img.color[c][i], 1e-3f);
+    }
+}
+
+TEST(DenoiserTest, FilmProvidesVarianceAndFeatures) {
+    Film film(2, 1);
+    film.EnableAOV(AOVType::Albedo);
+    film.EnableAOV(AOVType::Normal);
+    // Two samples of 0.5 +- 0.1 at one pixel, one clean sample at the other
+    film.AddSample(0, 0, RGB(0.4f), 1.0f);
+    film.AddSample(0, 0, RGB(0.6f), 1.0f);
+    const float albedo[2][3] = {{0.3f, 0.3f, 0.3f}, {0.5f, 0.5f, 0.5f}};
+    const float normal[2][3] = {{0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}};
+    for (int s = 0; s < 2; ++s) {
+        film.AddAOVSample(0, 0, AOVType::Albedo, albedo[s], 1.0f);
+        film.AddAOVSample(0, 0, AOVType::Normal, normal[s], 1.0f);
+    }
+    film.AddSample(1, 0, RGB(0.25f), 1.0f);
+
+    DenoiseImage img = film.CreateDenoiseImage();
+    EXPECT_NEAR(img.color[0][0], 0.5f, 1e-6f);
+    // Sample variance 0.02 over 2 samples
+    EXPECT_NEAR(img.variance[0][0], 0.01f, 1e-5f);
+    EXPECT_NEAR(img.albedo[1][0], 0.4f, 1e-6f);
+    EXPECT_NEAR(img.normal[1][0], 0.5f, 1e-6f);
+    EXPECT_NEAR(img.normal[2][0], 0.5f, 1e-6f);
+    EXPECT_EQ(img.variance[0][1], 0.0f);
+    EXPECT_NEAR(img.color[2][1], 0.25f, 1e-6f);
+}
+
+}  // namespace skwr
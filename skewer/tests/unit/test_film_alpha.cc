@@ -88,6 +88,18 @@ TEST_F(FilmAlphaTest, WeightedSamplesRespectWeight) {
     ASSERT_NE(buf, nullptr);
 }
 
+TEST_F(FilmAlphaTest, PixelLuminanceIsWeightedMean) {
+    Film film(kW, kH);
+    EXPECT_EQ(film.PixelLuminance(2, 2), 0.0f);  // No samples yet
+
+    film.AddSample(2, 2, RGB(1.0f, 1.0f, 1.0f), 1.0f, 3.0f);
+    film.AddSample(2, 2, RGB(0.0f, 0.0f, 0.0f), 1.0f, 1.0f);
+    EXPECT_NEAR(film.PixelLuminance(2, 2), 0.75f, kTol);
+
+    film.AddSample(3, 2, RGB(0.0f, 1.0f, 0.0f), 1.0f, 1.0f);
+    EXPECT_NEAR(film.PixelLuminance(3, 2), Rec709::kWeightGreen, kTol);
+}
+
 // ============================================================================
 // PathSample default alpha
 // ============================================================================
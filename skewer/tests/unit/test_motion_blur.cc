@@ -1,13 +1,18 @@
 #include <gtest/gtest.h>
 
+#include <memory>
+
 #include "core/math/transform.h"
 #include "core/math/vec3.h"
 #include "core/ray.h"
 #include "core/sampling/rng.h"
+#include "core/sampling/sampling.h"
+#include "core/transport/ray_cone.h"
 #include "geometry/animated_sphere.h"
 #include "media/mediums.h"
 #include "scene/animation.h"
 #include "scene/camera.h"
+#include "scene/interp_curve.h"
 
 namespace skwr {
 
@@ -92,6 +97,61 @@ TEST(CameraAnimation, RayOriginUsesPoseAtSampledTime) {
     EXPECT_NEAR(cam_forward.z(), -1.0f, 1e-4f);
 }
 
+TEST(CameraAnimation, BatchedRaysMatchGetRay) {
+    CameraTimeline timeline;
+    timeline.base.look_from = Vec3(0.0f, 0.0f, 0.0f);
+    timeline.base.look_at = Vec3(0.0f, 0.0f, -1.0f);
+    timeline.base.vfov = 50.0f;
+    timeline.base.aperture_radius = 0.05f;
+    timeline.base.focus_distance = 3.0f;
+    CameraKeyframe k0;
+    k0.state = timeline.base;
+    CameraKeyframe k1;
+    k1.time = 1.0f;
+    k1.state = k0.state;
+    k1.state.look_from = Vec3(2.0f, 1.0f, 0.5f);
+    k1.state.vfov = 30.0f;
+    k1.curve = std::make_shared<BezierCurve>(0.42f, 0.0f, 0.58f, 1.0f);
+    timeline.keyframes = {k0, k1};
+
+    Camera animated(timeline, 1.5f, 0.1f, 0.9f);
+    Camera still(Vec3(1.0f, 1.0f, 1.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), 40.0f,
+                 1.5f, 0.02f, 2.0f);
+    for (Camera* cam : {&animated, &still}) {
+        cam->SetImageHeight(240);
+        CameraRayBlock block;
+        block.count = 37;
+        for (int i = 0; i < block.count; ++i) {
+            block.s[i] = (i % 7) / 7.0f;
+            block.t[i] = (i % 5) / 5.0f;
+            block.u_time[i] = i / 36.0f;
+            block.lens_u[i] = (i % 3) / 2.0f;
+            block.lens_v[i] = (i % 11) / 10.0f;
+        }
+        cam->GenerateRays(&block);
+        for (int i = 0; i < block.count; ++i) {
+            Vec3 forward;
+            RayCone cone;
+            Ray r = cam->GetRay(block.s[i], block.t[i], block.u_time[i],
+                                Sample2D{block.lens_u[i], block.lens_v[i]}, &forward, &cone);
+            Ray b = block.GetRay(i);
+            EXPECT_NEAR(b.time(), r.time(), 1e-6f);
+            for (int c = 0; c < 3; ++c) {
+                EXPECT_NEAR(b.origin()[c], r.origin()[c], 1e-5f) << i;
+                EXPECT_NEAR(b.direction()[c], r.direction()[c], 1e-5f) << i;
+                EXPECT_NEAR(block.Forward(i)[c], forward[c], 1e-5f) << i;
+            }
+            EXPECT_NEAR(block.Cone(i).spread, cone.spread, 1e-7f);
+        }
+    }
+
+    // The shutter table stays close to the eased timeline between its sub-steps
+    Ray r = animated.GetRay(0.5f, 0.5f, 0.37f, Sample2D{0.5f, 0.5f});
+    CameraState state = timeline.Evaluate(r.time());
+    EXPECT_NEAR(r.origin().x(), state.look_from.x(), 1e-3f);
+    EXPECT_NEAR(r.origin().y(), state.look_from.y(), 1e-3f);
+}
+
 TEST(MotionBlur, TRSInverseApplyRoundTripPoint) {
     TRS trs =
         TRSFromEuler(Vec3(1.0f, 2.0f, 3.0f), Vec3(10.0f, 20.0f, 30.0f), Vec3(2.0f, 2.0f, 2.0f));
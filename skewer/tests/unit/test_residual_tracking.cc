@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "core/math/vec3.h"
+#include "core/sampling/rng.h"
+#include "core/spectral/spectrum.h"
+#include "kernels/utils/residual_tracking.h"
+#include "media/nano_vdb_medium.h"
+
+namespace skwr {
+
+namespace {
+
+constexpr int kCellVoxels = 32;
+
+// 4 x 3 x 2 cells of 32 voxels from index (0, 0, 0), each cell's max density set to its index + 1
+MajorantGrid MakeGrid() {
+    MajorantGrid grid;
+    grid.res[0] = 4;
+    grid.res[1] = 3;
+    grid.res[2] = 2;
+    grid.cell_voxels = kCellVoxels;
+    grid.cells.resize(4 * 3 * 2);
+    for (size_t c = 0; c < grid.cells.size(); ++c) {
+        const float v = static_cast<float>(c + 1);
+        grid.cells[c] = {v, v, v};
+    }
+    return grid;
+}
+
+struct Piece {
+    float t0;
+    float t1;
+    const MajorantGrid::Cell* cell;
+};
+
+std::vector<Piece> Walk(const MajorantGrid& grid, const Vec3& o, const Vec3& d, float t_min,
+                        float t_max) {
+    std::vector<Piece> pieces;
+    grid.Traverse(o, d, t_min, t_max, [&](float t0, float t1, const MajorantGrid::Cell& cell) {
+        pieces.push_back({t0, t1, &cell});
+        return true;
+    });
+    return pieces;
+}
+
+// The pieces must tile [t_min, t_max] without gaps, and each must report the cell (or the outside)
+// that holds its midpoint
+void ExpectCovers(const MajorantGrid& grid, const Vec3& o, const Vec3& d, float t_min,
+                  float t_max) {
+    std::vector<Piece> pieces = Walk(grid, o, d, t_min, t_max);
+    ASSERT_FALSE(pieces.empty());
+    EXPECT_EQ(pieces.front().t0, t_min);
+    EXPECT_EQ(pieces.back().t1, t_max);
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        EXPECT_LT(pieces[i].t0, pieces[i].t1) << "piece " << i;
+        if (i > 0) {
+            EXPECT_EQ(pieces[i].t0, pieces[i - 1].t1) << "piece " << i;
+        }
+
+        const Vec3 p = o + d * (0.5f * (pieces[i].t0 + pieces[i].t1));
+        int xyz[3];
+        bool inside = true;
+        for (int a = 0; a < 3; ++a) {
+            xyz[a] = static_cast<int>(std::floor(p[a] / kCellVoxels));
+            inside = inside && xyz[a] >= 0 && xyz[a] < grid.res[a];
+        }
+        const MajorantGrid::Cell* expected =
+            inside ? &grid.At(xyz[0], xyz[1], xyz[2]) : &grid.outside;
+        EXPECT_EQ(pieces[i].cell, expected) << "piece " << i;
+    }
+}
+
+}  // namespace
+
+TEST(MajorantGridTest, TraverseCoversRayInsideGrid) {
+    const MajorantGrid grid = MakeGrid();
+    ExpectCovers(grid, Vec3(5.0f, 7.0f, 3.0f), Vec3(0.8f, 0.5f, 0.3f), 0.0f, 100.0f);
+    ExpectCovers(grid, Vec3(120.0f, 90.0f, 60.0f), Vec3(-1.0f, -0.6f, -0.4f), 2.0f, 110.0f);
+}
+
+TEST(MajorantGridTest, TraverseCoversRayStartingOutsideGrid) {
+    const MajorantGrid grid = MakeGrid();
+    // Enters through the -x face and leaves through +x, with outside pieces at both ends
+    std::vector<Piece> pieces =
+        Walk(grid, Vec3(-40.0f, 10.0f, 10.0f), Vec3(1.0f, 0.1f, 0.05f), 0.0f, 200.0f);
+    EXPECT_EQ(pieces.front().cell, &grid.outside);
+    EXPECT_EQ(pieces.back().cell, &grid.outside);
+    ExpectCovers(grid, Vec3(-40.0f, 10.0f, 10.0f), Vec3(1.0f, 0.1f, 0.05f), 0.0f, 200.0f);
+    ExpectCovers(grid, Vec3(200.0f, 120.0f, -30.0f), Vec3(-1.0f, -0.5f, 0.4f), 0.0f, 300.0f);
+
+    // A ray that misses the grid is one outside piece
+    pieces = Walk(grid, Vec3(-10.0f, 200.0f, 10.0f), Vec3(1.0f, 0.0f, 0.0f), 0.0f, 50.0f);
+    ASSERT_EQ(pieces.size(), 1u);
+    EXPECT_EQ(pieces[0].cell, &grid.outside);
+    EXPECT_EQ(pieces[0].t0, 0.0f);
+    EXPECT_EQ(pieces[0].t1, 50.0f);
+}
+
+TEST(MajorantGridTest, TraverseCoversAxisParallelRays) {
+    const MajorantGrid grid = MakeGrid();
+    ExpectCovers(grid, Vec3(-10.0f, 40.0f, 20.0f), Vec3(1.0f, 0.0f, 0.0f), 0.0f, 150.0f);
+    ExpectCovers(grid, Vec3(50.0f, 100.0f, 20.0f), Vec3(0.0f, -1.0f, 0.0f), 0.0f, 120.0f);
+    ExpectCovers(grid, Vec3(70.0f, 70.0f, 0.0f), Vec3(0.0f, 0.0f, 2.0f), 0.0f, 40.0f);
+
+    // Along x through the four cells of row (y, z) = (1, 0)
+    std::vector<Piece> pieces =
+        Walk(grid, Vec3(0.0f, 40.0f, 20.0f), Vec3(1.0f, 0.0f, 0.0f), 0.0f, 128.0f);
+    ASSERT_EQ(pieces.size(), 4u);
+    for (int x = 0; x < 4; ++x) {
+        EXPECT_EQ(pieces[x].cell, &grid.At(x, 1, 0));
+        EXPECT_FLOAT_EQ(pieces[x].t1 - pieces[x].t0, 32.0f);
+    }
+}
+
+// Residual ratio tracking must reproduce the analytic transmittance exp(−∫σ_t) whatever the
+// control: none (plain ratio tracking), one below the density, or each cell's own.
+class ResidualTrackingTest : public ::testing::Test {
+  protected:
+    static constexpr int kSamples = 20000;
+
+    // Density per x column of the grid; the ray only ever crosses cells by their x index
+    float ColumnDensity(const Vec3& p) const {
+        const int x = static_cast<int>(std::floor(p[0] / kCellVoxels));
+        return (x >= 0 && x < 4) ? column_density[x] : 0.0f;
+    }
+
+    MajorantGrid MakeColumnGrid() const {
+        MajorantGrid grid = MakeGrid();
+        for (int z = 0; z < grid.res[2]; ++z) {
+            for (int y = 0; y < grid.res[1]; ++y) {
+                for (int x = 0; x < grid.res[0]; ++x) {
+                    const float v = column_density[x];
+                    // Loose bounds so the residual is actually tracked
+                    grid.cells[(static_cast<size_t>(z) * grid.res[1] + y) * grid.res[0] + x] = {
+                        0.0f, 2.0f * v + 0.1f, 0.5f * v};
+                }
+            }
+        }
+        return grid;
+    }
+
+    Spectrum Estimate(const MajorantGrid& grid, const Vec3& o, const Vec3& d, float t_min,
+                      float t_max, float control, bool auto_control) const {
+        RNG rng(3, 0);
+        Spectrum sum(0.0f);
+        for (int n = 0; n < kSamples; ++n) {
+            Spectrum Tr(1.0f);
+            if (MajorantCellTracking(grid, o, d, base_sigma_t, control, auto_control, t_min, t_max,
+                                     rng, [&](float t) { return ColumnDensity(o + d * t); }, Tr)) {
+                sum += Tr;
+            }
+        }
+        return sum / static_cast<float>(kSamples);
+    }
+
+    void ExpectTransmittance(const Spectrum& estimate, float optical_depth) const {
+        for (int i = 0; i < kNSamples; ++i) {
+            EXPECT_NEAR(estimate[i], std::exp(-base_sigma_t[i] * optical_depth), 0.01f)
+                << "channel " << i;
+        }
+    }
+
+    Spectrum base_sigma_t = [] {
+        Spectrum s;
+        for (int i = 0; i < kNSamples; ++i) s[i] = 0.005f + 0.005f * static_cast<float>(i);
+        return s;
+    }();
+    float column_density[4] = {0.6f, 0.6f, 0.6f, 0.6f};
+};
+
+TEST_F(ResidualTrackingTest, HomogeneousGridMatchesBeerLambert) {
+    const MajorantGrid grid = MakeColumnGrid();
+    const Vec3 o(-20.0f, 40.0f, 20.0f);
+    const Vec3 d(1.0f, 0.0f, 0.0f);
+    const float depth = 0.6f * 128.0f;  // Outside pieces at both ends carry no density
+    ExpectTransmittance(Estimate(grid, o, d, 0.0f, 170.0f, 0.0f, false), depth);
+    ExpectTransmittance(Estimate(grid, o, d, 0.0f, 170.0f, 0.3f, false), depth);
+    ExpectTransmittance(Estimate(grid, o, d, 0.0f, 170.0f, 0.0f, true), depth);
+}
+
+TEST_F(ResidualTrackingTest, PiecewiseConstantGridMatchesAnalyticTransmittance) {
+    column_density[0] = 0.2f;
+    column_density[1] = 1.0f;
+    column_density[2] = 0.0f;
+    column_density[3] = 0.6f;
+    const MajorantGrid grid = MakeColumnGrid();
+
+    // Diagonal ray staying within y and z: each column is crossed over 32 / d.x of t
+    const Vec3 o(1.0f, 5.0f, 3.0f);
+    const Vec3 d(1.0f, 0.3f, 0.2f);
+    const float depth = (0.2f + 1.0f + 0.0f + 0.6f) * 32.0f;
+    ExpectTransmittance(Estimate(grid, o, d, 0.0f, 127.0f, 0.0f, false),
+                        depth - 0.2f * 1.0f);  // The ray starts 1 voxel into column 0
+    ExpectTransmittance(Estimate(grid, o, d, 0.0f, 127.0f, 0.0f, true), depth - 0.2f * 1.0f);
+}
+
+}  // namespace skwr
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "core/spectral/spectrum.h"
+#include "kernels/utils/roulette.h"
+
+namespace skwr {
+
+TEST(RouletteTest, SplitCountFollowsExpectedContribution) {
+    const Spectrum dark(0.0f);
+    EXPECT_EQ(SplitCount(4, Spectrum(1.0f), dark, 0.0f), 4);  // No estimate: always split fully
+    EXPECT_EQ(SplitCount(4, Spectrum(1.0f), dark, 1.0f), 4);
+    EXPECT_EQ(SplitCount(4, Spectrum(0.3f), dark, 1.0f), 2);
+    EXPECT_EQ(SplitCount(4, Spectrum(0.01f), dark, 1.0f), 1);
+}
+
+TEST(RouletteTest, WeightWindowIgnoresTheThroughputCutoff) {
+    // A throughput of 1e-4 ends the path in throughput mode, but the weight window still gives it
+    // a chance in proportion to its expected contribution
+    const Spectrum beta(1e-4f);
+    EXPECT_EQ(RouletteSurvival(beta, Spectrum(0.0f), 0.0f, 0.25f), 0.0f);
+    EXPECT_NEAR(RouletteSurvival(beta, Spectrum(0.0f), 1.0f, 0.25f), 4e-4f, 1e-9f);
+}
+
+// The path kernel's splitting and efficiency roulette on a toy scene: the camera ray hits a
+// diffuse surface that splits, each branch reaches a dark vertex with a throughput around 1e-3,
+// and the next vertex sees a light of radiance 1000. The exact pixel value is 1; the estimate
+// must match it even though most branches are rouletted away.
+TEST(RouletteTest, SplittingAndEfficiencyRouletteKeepThePixelValue) {
+    constexpr int kSplitFactor = 4;
+    constexpr float kWindow = 0.25f;
+    constexpr float kLightL = 1000.0f;
+    constexpr int kSamples = 200000;
+    const float pixel_estimate = 1.0f;
+    const Spectrum dark(0.0f);
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    for (int i = 0; i < kSamples; ++i) {
+        // First diffuse vertex: nothing seen yet, so the split is sized on the throughput alone
+        const int split = SplitCount(kSplitFactor, Spectrum(1.0f), dark, pixel_estimate);
+        double L = 0.0;
+        for (int b = 0; b < split; ++b) {
+            // Scattering weight with mean 1e-3, split between the branches
+            Spectrum beta(0.002f * uniform(gen) / static_cast<float>(split));
+
+            // Roulette at the dark vertex judges the throughput from before the split
+            const float p = RouletteSurvival(beta * static_cast<float>(split), dark,
+                                             pixel_estimate, kWindow);
+            if (p <= 0.0f) continue;
+            if (p < 1.0f) {
+                if (uniform(gen) > p) continue;
+                beta = beta * (1.0f / p);
+            }
+            L += beta[0] * kLightL;
+        }
+        sum += L;
+        sum_sq += L * L;
+    }
+
+    const double mean = sum / kSamples;
+    const double std_error = std::sqrt((sum_sq / kSamples - mean * mean) / kSamples);
+    EXPECT_NEAR(mean, 1.0, 4.0 * std_error);
+    // A hard throughput cutoff at 1e-3 would lose about a quarter of the value
+    EXPECT_LT(4.0 * std_error, 0.1);
+}
+
+}  // namespace skwr
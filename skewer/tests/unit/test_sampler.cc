@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <set>
+#include <vector>
+
+#include "core/sampling/sampler.h"
+#include "core/sampling/sampling.h"
+
+namespace skwr {
+
+namespace {
+
+constexpr int kSpp = 16;
+
+// The first 2D sample of every sample index in one pixel
+std::vector<Sample2D> PixelSamples(Sampler& sampler, int x, int y) {
+    std::vector<Sample2D> out;
+    for (int s = 0; s < kSpp; ++s) {
+        sampler.StartPixelSample(x, y, s);
+        out.push_back(sampler.GetPixel2D());
+    }
+    return out;
+}
+
+}  // namespace
+
+TEST(SamplerTest, ValuesAreDeterministicAndInRange) {
+    for (SamplerType type : {SamplerType::Independent, SamplerType::ZSobol}) {
+        Sampler a(type, kSpp, 64, 32);
+        Sampler b(type, kSpp, 64, 32);
+        for (int s = 0; s < kSpp; ++s) {
+            a.StartPixelSample(13, 7, s);
+            b.StartPixelSample(13, 7, s);
+            for (int d = 0; d < 40; ++d) {
+                float va = a.Get1D();
+                EXPECT_EQ(va, b.Get1D());
+                EXPECT_GE(va, 0.0f);
+                EXPECT_LT(va, 1.0f);
+            }
+        }
+    }
+}
+
+TEST(SamplerTest, ZSobolStratifiesEachPixel) {
+    Sampler sampler(SamplerType::ZSobol, kSpp, 64, 64);
+    for (int y : {0, 5, 31}) {
+        for (int x : {0, 9, 62}) {
+            // 16 points of a scrambled (0, 2)-sequence block: one per cell of a 4x4 grid and one
+            // per 1/16 row or column strip
+            std::vector<Sample2D> pts = PixelSamples(sampler, x, y);
+            std::set<int> grid, rows, cols;
+            for (const Sample2D& p : pts) {
+                grid.insert(int(p.u * 4) * 4 + int(p.v * 4));
+                cols.insert(int(p.u * kSpp));
+                rows.insert(int(p.v * kSpp));
+            }
+            EXPECT_EQ(grid.size(), static_cast<size_t>(kSpp));
+            EXPECT_EQ(cols.size(), static_cast<size_t>(kSpp));
+            EXPECT_EQ(rows.size(), static_cast<size_t>(kSpp));
+        }
+    }
+}
+
+TEST(SamplerTest, BounceDimensionsDoNotDependOnConsumption) {
+    Sampler a(SamplerType::ZSobol, kSpp, 16, 16);
+    Sampler b(SamplerType::ZSobol, kSpp, 16, 16);
+    a.StartPixelSample(3, 4, 5);
+    b.StartPixelSample(3, 4, 5);
+
+    a.StartBounce(0);
+    a.Get1D();  // Only part of bounce 0 is consumed
+    b.StartBounce(0);
+    for (int d = 0; d < Sampler::kBounceDimensions; ++d) b.Get1D();
+
+    a.StartBounce(1);
+    b.StartBounce(1);
+    EXPECT_EQ(a.Get1D(), b.Get1D());
+    Sample2D pa = a.Get2D();
+    Sample2D pb = b.Get2D();
+    EXPECT_EQ(pa.u, pb.u);
+    EXPECT_EQ(pa.v, pb.v);
+}
+
+TEST(SamplerTest, ZSobolLowersIntegrationError) {
+    // Mean absolute error of the per-pixel estimate of the integral of u * v over [0, 1)^2
+    auto mean_error = [](SamplerType type) {
+        Sampler sampler(type, kSpp, 32, 32);
+        double total = 0.0;
+        for (int y = 0; y < 32; ++y) {
+            for (int x = 0; x < 32; ++x) {
+                double sum = 0.0;
+                for (const Sample2D& p : PixelSamples(sampler, x, y)) sum += p.u * p.v;
+                total += std::abs(sum / kSpp - 0.25);
+            }
+        }
+        return total / (32 * 32);
+    };
+    EXPECT_LT(mean_error(SamplerType::ZSobol), 0.5 * mean_error(SamplerType::Independent));
+}
+
+TEST(SamplerTest, SampleCountRoundsUpToPowerOfTwo) {
+    EXPECT_EQ(Sampler(SamplerType::ZSobol, 100, 8, 8).samples_per_pixel(), 128);
+    EXPECT_EQ(Sampler(SamplerType::ZSobol, 64, 8, 8).samples_per_pixel(), 64);
+    EXPECT_EQ(Sampler(SamplerType::Independent, 100, 8, 8).samples_per_pixel(), 100);
+}
+
+TEST(SamplingWarpTest, ConcentricDiskStaysInsideUnitDisk) {
+    for (float a : {0.0f, 0.1f, 0.5f, 0.77f, 0.999f}) {
+        for (float b : {0.0f, 0.3f, 0.5f, 0.9f, 0.999f}) {
+            Vec3 p = SampleUniformDiskConcentric({a, b});
+            EXPECT_LE(p.LengthSquared(), 1.0f + 1e-5f);
+            EXPECT_EQ(p.z(), 0.0f);
+            EXPECT_NEAR(SampleUniformSphere({a, b}).Length(), 1.0f, 1e-5f);
+        }
+    }
+}
+
+}  // namespace skwr
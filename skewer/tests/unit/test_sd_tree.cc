@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "core/math/constants.h"
+#include "core/transport/sd_tree.h"
+
+namespace skwr {
+
+namespace {
+
+// Midpoint-rule integral of a DTree density over the canonical square
+float IntegratePdf(const DTree& tree, int n) {
+    float sum = 0.0f;
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            sum += tree.Pdf({(i + 0.5f) / n, (j + 0.5f) / n});
+        }
+    }
+    return sum / static_cast<float>(n * n);
+}
+
+}  // namespace
+
+TEST(SDTreeTest, CanonicalMappingRoundTrips) {
+    for (const Vec3& d : {Vec3(0, 0, 1), Vec3(0.6f, 0.0f, 0.8f), Vec3(-0.48f, -0.6f, -0.64f)}) {
+        // The canonical square is half-open, so the poles come back slightly off-axis
+        Vec3 r = CanonicalToDirection(DirectionToCanonical(d));
+        EXPECT_NEAR(r.x(), d.x(), 1e-3f);
+        EXPECT_NEAR(r.y(), d.y(), 1e-3f);
+        EXPECT_NEAR(r.z(), d.z(), 1e-3f);
+    }
+}
+
+TEST(SDTreeTest, RefinedTreeDensityIsNormalized) {
+    DTree tree;
+    // Concentrate energy near one corner over a few refinements to build a deep, uneven tree
+    for (int pass = 0; pass < 3; ++pass) {
+        if (pass > 0) {
+            tree = tree.Refined(0.01f, 20);
+            EXPECT_TRUE(tree.IsEmpty());
+        }
+        for (int i = 0; i < 1000; ++i) {
+            float t = static_cast<float>(i) / 1000.0f;
+            tree.Record({0.1f * t, 0.05f + 0.1f * t}, 10.0f);
+            tree.Record({t, 1.0f - t}, 0.1f);
+        }
+    }
+    EXPECT_GT(tree.NodeCount(), 8u);
+    EXPECT_NEAR(IntegratePdf(tree, 512), 1.0f, 0.02f);
+    EXPECT_GT(tree.Pdf({0.05f, 0.1f}), 10.0f);
+
+    // Sample() draws from the density Pdf() reports
+    int hits = 0;
+    const int n = 4096;
+    for (int i = 0; i < n; ++i) {
+        Sample2D p = tree.Sample({(i + 0.5f) / n, std::fmod(i * 0.618034f, 1.0f)});
+        EXPECT_GT(tree.Pdf(p), 0.0f);
+        if (p.u < 0.125f && p.v < 0.25f) ++hits;
+    }
+    EXPECT_GT(hits, n / 2);
+}
+
+TEST(SDTreeTest, LearnsDominantDirection) {
+    BoundBox bounds(Point3(-1, -1, -1), Point3(1, 1, 1));
+    SDTree tree(bounds);
+    const Vec3 light_dir = Normalize(Vec3(0.2f, 0.3f, 1.0f));
+    EXPECT_FALSE(tree.IsTrained());
+    // The first pass only trains the four root quadrants; later passes refine them
+    int leaf = 0;
+    for (int pass = 0; pass < 4; ++pass) {
+        leaf = tree.LeafIndex(Point3(0, 0, 0));
+        for (int i = 0; i < 2000; ++i) {
+            tree.Record(leaf, light_dir, 50.0f);
+            tree.Record(leaf, Normalize(Vec3(1.0f, -0.5f, -0.2f)), 0.5f);
+        }
+        tree.Refine(1);
+    }
+    EXPECT_TRUE(tree.IsTrained());
+
+    const float uniform = 0.25f * MathConstants::kInvPi;
+    EXPECT_GT(tree.Pdf(leaf, light_dir), 20.0f * uniform);
+    Vec3 d = tree.Sample(leaf, {0.5f, 0.5f});
+    EXPECT_NEAR(d.Length(), 1.0f, 1e-4f);
+
+    // Recording is ignored once training is switched off: the next pass learns nothing
+    tree.SetTraining(false);
+    tree.Record(leaf, Vec3(0, 0, -1), 1e6f);
+    tree.SetTraining(true);
+    tree.Refine(1);
+    EXPECT_NEAR(tree.Pdf(leaf, Vec3(0, 0, -1)), uniform, 1e-6f);
+}
+
+TEST(SDTreeTest, BusyLeavesSplitSpatially) {
+    SDTree tree(BoundBox(Point3(0, 0, 0), Point3(4, 4, 4)));
+    EXPECT_EQ(tree.LeafCount(), 1u);
+    for (int i = 0; i < 50000; ++i) {
+        Point3 p(4.0f * (i % 97) / 97.0f, 4.0f * (i % 89) / 89.0f, 4.0f * (i % 83) / 83.0f);
+        tree.Record(tree.LeafIndex(p), Vec3(0, 0, 1), 1.0f);
+    }
+    tree.Refine(1);
+    EXPECT_GE(tree.LeafCount(), 4u);
+    EXPECT_NE(tree.LeafIndex(Point3(0.1f, 0.1f, 0.1f)), tree.LeafIndex(Point3(3.9f, 3.9f, 3.9f)));
+}
+
+TEST(SDTreeTest, ConcurrentRecordsAreNotLost) {
+    DTree tree;
+    tree = DTree().Refined(0.0f, 1);  // Empty source: stays a single root
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&tree, t] {
+            for (int i = 0; i < 10000; ++i) {
+                tree.Record({0.25f * t + 0.1f, static_cast<float>(i % 100) / 100.0f}, 1.0f);
+            }
+        });
+    }
+    for (std::thread& th : threads) th.join();
+    EXPECT_FLOAT_EQ(tree.Energy(), 40000.0f);
+}
+
+}  // namespace skwr
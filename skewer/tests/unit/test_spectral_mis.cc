@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "core/spectral/spectrum.h"
+#include "kernels/utils/spectral_mis.h"
+
+namespace skwr {
+
+namespace {
+
+Spectrum MakeSpectrum(float a, float b, float c, float d) {
+    Spectrum s;
+    s[0] = a;
+    s[1] = b;
+    s[2] = c;
+    s[3] = d;
+    return s;
+}
+
+}  // namespace
+
+TEST(SpectralMISTest, ChannelPdfFollowsThroughput) {
+    Spectrum pdf = ChannelPdf(MakeSpectrum(1.0f, 0.5f, 0.25f, 0.25f));
+    EXPECT_FLOAT_EQ(pdf[0], 0.5f);
+    EXPECT_FLOAT_EQ(pdf[1], 0.25f);
+    EXPECT_FLOAT_EQ(pdf[2], 0.125f);
+    EXPECT_FLOAT_EQ(pdf[3], 0.125f);
+
+    // Dead throughput falls back to uniform picks
+    Spectrum uniform = ChannelPdf(Spectrum(0.0f));
+    for (int i = 0; i < kNSamples; ++i) EXPECT_FLOAT_EQ(uniform[i], 1.0f / kNSamples);
+
+    EXPECT_EQ(SampleChannel(pdf, 0.0f), 0);
+    EXPECT_EQ(SampleChannel(pdf, 0.6f), 1);
+    EXPECT_EQ(SampleChannel(pdf, 0.8f), 2);
+    EXPECT_EQ(SampleChannel(pdf, 0.99f), 3);
+}
+
+// With the same extinction in every channel the channel pick does not matter: the averaged pdf is
+// the single-channel pdf and the MIS weights give the usual albedo (scatter) and 1 (pass through).
+TEST(SpectralMISTest, GreyMediumReducesToSingleChannelEstimator) {
+    const float sigma_t = 0.8f;
+    const float sigma_s = 0.6f;
+    const float t = 1.3f;
+    const float tr = std::exp(-sigma_t * t);
+    const Spectrum channel_pdf = ChannelPdf(MakeSpectrum(1.0f, 0.4f, 0.1f, 0.02f));
+
+    const float scatter_pdf = ChannelAveragedPdf(channel_pdf, Spectrum(sigma_t * tr));
+    EXPECT_NEAR(scatter_pdf, sigma_t * tr, 1e-6f);
+    const Spectrum scatter_weight = Spectrum(tr * sigma_s) / scatter_pdf;
+    for (int i = 0; i < kNSamples; ++i) EXPECT_NEAR(scatter_weight[i], sigma_s / sigma_t, 1e-5f);
+
+    const float pass_pdf = ChannelAveragedPdf(channel_pdf, Spectrum(tr));
+    EXPECT_NEAR(tr / pass_pdf, 1.0f, 1e-6f);
+
+    // Spectral tracking: P_real is σ_t / σˉ, a real collision weighs by the albedo and a null
+    // collision leaves the throughput alone
+    const float majorant = 2.0f;
+    const Spectrum beta = MakeSpectrum(1.0f, 0.5f, 0.25f, 0.125f);
+    Spectrum real_beta = beta;
+    EXPECT_TRUE(SpectralTrackingEvent(Spectrum(sigma_t), Spectrum(sigma_s), majorant,
+                                      0.99f * sigma_t / majorant, real_beta));
+    Spectrum null_beta = beta;
+    EXPECT_FALSE(SpectralTrackingEvent(Spectrum(sigma_t), Spectrum(sigma_s), majorant,
+                                       1.01f * sigma_t / majorant, null_beta));
+    for (int i = 0; i < kNSamples; ++i) {
+        EXPECT_NEAR(real_beta[i], beta[i] * sigma_s / sigma_t, 1e-5f);
+        EXPECT_NEAR(null_beta[i], beta[i], 1e-5f);
+    }
+}
+
+// In a chromatic medium both estimators must still give each channel its own transmittance:
+// distance sampling through the channel-averaged pdf, and spectral tracking against a majorant.
+TEST(SpectralMISTest, ChromaticTransmittanceIsUnbiased) {
+    constexpr int kSamples = 400000;
+    const Spectrum sigma_t = MakeSpectrum(0.2f, 0.9f, 1.6f, 3.0f);
+    const Spectrum beta = MakeSpectrum(1.0f, 0.7f, 0.3f, 0.1f);
+    const float d = 0.8f;
+    const float majorant = 3.5f;
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    Spectrum distance_sum(0.0f);
+    Spectrum tracking_sum(0.0f);
+    const Spectrum channel_pdf = ChannelPdf(beta);
+    for (int n = 0; n < kSamples; ++n) {
+        const int channel = SampleChannel(channel_pdf, uniform(gen));
+        const float t = -std::log(1.0f - uniform(gen)) / sigma_t[channel];
+        if (t >= d) {
+            Spectrum tr;
+            for (int i = 0; i < kNSamples; ++i) tr[i] = std::exp(-sigma_t[i] * d);
+            distance_sum += tr / ChannelAveragedPdf(channel_pdf, tr);
+        }
+
+        Spectrum w = beta;
+        float s = 0.0f;
+        while (true) {
+            s -= std::log(1.0f - uniform(gen)) / majorant;
+            if (s >= d) {
+                tracking_sum += w;
+                break;
+            }
+            if (SpectralTrackingEvent(sigma_t, sigma_t, majorant, uniform(gen), w)) break;
+        }
+    }
+
+    for (int i = 0; i < kNSamples; ++i) {
+        const float expected = std::exp(-sigma_t[i] * d);
+        EXPECT_NEAR(distance_sum[i] / kSamples, expected, 0.01f) << "channel " << i;
+        EXPECT_NEAR(tracking_sum[i] / kSamples, beta[i] * expected, 0.01f) << "channel " << i;
+    }
+}
+
+}  // namespace skwr
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "core/sampling/wavelength_sampler.h"
+#include "core/spectral/spectral_utils.h"
+#include "core/spectral/spectrum.h"
+
+namespace skwr {
+
+namespace {
+
+Spectrum MakeSpectrum(float a, float step) {
+    Spectrum s;
+    for (int i = 0; i < kNSamples; ++i) s[i] = a + step * static_cast<float>(i);
+    return s;
+}
+
+}  // namespace
+
+TEST(SpectralPacketTest, ArithmeticIsLanewise) {
+    Spectrum a = MakeSpectrum(1.0f, 1.0f);
+    Spectrum b = MakeSpectrum(2.0f, 0.5f);
+    Spectrum sum = a + b;
+    Spectrum diff = a - b;
+    Spectrum prod = a * b;
+    Spectrum scaled = 2.0f * a / 4.0f;
+    for (int i = 0; i < kNSamples; ++i) {
+        EXPECT_FLOAT_EQ(sum[i], a[i] + b[i]);
+        EXPECT_FLOAT_EQ(diff[i], a[i] - b[i]);
+        EXPECT_FLOAT_EQ(prod[i], a[i] * b[i]);
+        EXPECT_FLOAT_EQ(scaled[i], a[i] * 0.5f);
+    }
+}
+
+TEST(SpectralPacketTest, DivisionByZeroLanesIsZero) {
+    Spectrum a(3.0f);
+    Spectrum b = MakeSpectrum(0.0f, 1.5f);  // Lane 0 is exactly zero
+    Spectrum q = a / b;
+    EXPECT_FLOAT_EQ(q[0], 0.0f);
+    for (int i = 1; i < kNSamples; ++i) EXPECT_FLOAT_EQ(q[i], 3.0f / b[i]);
+
+    a /= Spectrum(1e-12f);
+    EXPECT_TRUE(a.IsBlack());
+}
+
+TEST(CurveToSpectrumTest, MatchesPreciseEvaluation) {
+    // Sigmoid-polynomial coefficients in the rgb2spec parameterization (lambda in nm)
+    SpectralCurve curve{{-2e-4f, 0.21f, -54.0f}, 1.5f};
+    for (float u : {0.05f, 0.4f, 0.9f}) {
+        SampledWavelengths wl = WavelengthSampler::Sample(u);
+        Spectrum s = CurveToSpectrum(curve, wl);
+        for (int i = 0; i < kNSamples; ++i) {
+            float expected = rgb2spec_eval_precise(curve.coeff, wl.lambda[i]) * curve.scale;
+            EXPECT_NEAR(s[i], expected, 2e-3f);  // Fast paths use an approximate rsqrt
+        }
+    }
+    EXPECT_TRUE(CurveToSpectrum(SpectralCurve{}, WavelengthSampler::Sample(0.5f)).IsBlack());
+}
+
+}  // namespace skwr
@@ -0,0 +1,266 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+
+#include "core/sampling/wavelength_sampler.h"
+#include "core/spectral/spectral_utils.h"
+#include "materials/texture.h"
+#include "materials/texture_cache.h"
+
+namespace skwr {
+
+namespace {
+
+// Checkerboard of 0/1 texels; every 2x2 block averages to 0.5.
+ImageTexture MakeChecker(int w, int h, TexelFormat format = TexelFormat::RGB32F) {
+    MipLevel image;
+    image.width = w;
+    image.height = h;
+    image.data.resize(static_cast<size_t>(w) * h * 3);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            float c = ((x + y) & 1) ? 1.0f : 0.0f;
+            for (int k = 0; k < 3; ++k) image.data[(y * w + x) * 3 + k] = c;
+        }
+    }
+    ImageTexture tex;
+    tex.SetImage(std::move(image), format);
+    return tex;
+}
+
+// Write a w x h binary PPM with a smooth gradient; returns its path.
+std::string WriteGradientPPM(const std::string& name, int w, int h) {
+    std::string path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream out(path, std::ios::binary);
+    out << "P6\n" << w << " " << h << "\n255\n";
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            uint8_t px[3] = {static_cast<uint8_t>(x * 255 / (w - 1)),
+                             static_cast<uint8_t>(y * 255 / (h - 1)), 128};
+            out.write(reinterpret_cast<const char*>(px), 3);
+        }
+    }
+    return path;
+}
+
+}  // namespace
+
+TEST(TextureMipTest, ChainHalvesDownToOneTexel) {
+    ImageTexture tex = MakeChecker(16, 4);
+    ASSERT_EQ(tex.LevelCount(), 5);
+    EXPECT_EQ(tex.levels[1].width, 8);
+    EXPECT_EQ(tex.levels[1].height, 2);
+    EXPECT_EQ(tex.levels[2].height, 1);
+    EXPECT_EQ(tex.levels[4].width, 1);
+    EXPECT_EQ(tex.levels[4].height, 1);
+}
+
+TEST(TextureMipTest, OddSizesKeepEveryTexel) {
+    ImageTexture tex = MakeChecker(5, 3);
+    ASSERT_EQ(tex.LevelCount(), 3);
+    EXPECT_EQ(tex.levels[1].width, 2);
+    EXPECT_EQ(tex.levels[1].height, 1);
+    // Level 2 approximates the mean of all 15 texels (7 white on a 5x3 checker)
+    EXPECT_NEAR(tex.Texel(2, 0, 0).r(), 7.0f / 15.0f, 0.1f);
+}
+
+TEST(TextureMipTest, BoxFilterAveragesChecker) {
+    ImageTexture tex = MakeChecker(8, 8);
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) EXPECT_FLOAT_EQ(tex.Texel(1, x, y).g(), 0.5f);
+    }
+}
+
+TEST(TextureMipTest, ZeroFootprintMatchesBilinear) {
+    ImageTexture tex = MakeChecker(8, 8);
+    RGB a = tex.Sample(0.3f, 0.6f);
+    RGB b = tex.Sample(0.3f, 0.6f, 0.0f, 0.0f);
+    EXPECT_FLOAT_EQ(a.r(), b.r());
+    EXPECT_FLOAT_EQ(a.g(), b.g());
+}
+
+TEST(TextureMipTest, LargeFootprintFiltersToAverage) {
+    ImageTexture tex = MakeChecker(8, 8);
+    // Footprint spanning the whole texture selects the 1x1 level
+    RGB c = tex.Sample(0.1f, 0.9f, 1.0f, 1.0f);
+    EXPECT_FLOAT_EQ(c.r(), 0.5f);
+    // One-texel footprint leaves level 0 untouched at texel centers
+    RGB d = tex.Sample(0.0f, 0.0f, 1.0f / 8.0f, 1.0f / 8.0f);
+    EXPECT_FLOAT_EQ(d.r(), 0.0f);
+}
+
+TEST(TextureMipTest, InvalidTextureReturnsMagenta) {
+    ImageTexture tex;
+    RGB c = tex.Sample(0.5f, 0.5f, 0.1f, 0.1f);
+    EXPECT_FLOAT_EQ(c.r(), 1.0f);
+    EXPECT_FLOAT_EQ(c.g(), 0.0f);
+    EXPECT_FLOAT_EQ(c.b(), 1.0f);
+}
+
+TEST(TexelFormatTest, SRGB8RoundTripsEveryCode) {
+    for (int i = 0; i < 256; ++i) {
+        uint8_t src[3] = {static_cast<uint8_t>(i), 0, 255};
+        float rgb[3];
+        DecodeTexel(TexelFormat::SRGB8, src, rgb);
+        uint8_t dst[3];
+        EncodeTexel(TexelFormat::SRGB8, rgb, dst);
+        EXPECT_EQ(dst[0], src[0]);
+    }
+}
+
+TEST(TexelFormatTest, CompactFormatsMatchFloatSampling) {
+    // 0/1 checker is exact in every format; filtered levels differ only by quantization
+    ImageTexture ref = MakeChecker(16, 16);
+    const TexelFormat formats[] = {TexelFormat::SRGB8, TexelFormat::RGB8, TexelFormat::R8,
+                                   TexelFormat::RGB16F};
+    for (TexelFormat f : formats) {
+        ImageTexture tex = MakeChecker(16, 16, f);
+        for (float du : {0.0f, 0.1f, 0.3f}) {
+            RGB a = ref.Sample(0.37f, 0.81f, du, du);
+            RGB b = tex.Sample(0.37f, 0.81f, du, du);
+            EXPECT_NEAR(a.r(), b.r(), 0.01f);
+            EXPECT_NEAR(a.g(), b.g(), 0.01f);
+            EXPECT_NEAR(a.b(), b.b(), 0.01f);
+        }
+    }
+}
+
+TEST(TexelFormatTest, LoadPicksFormatFromUsage) {
+    std::string path = WriteGradientPPM("skewer_texel_usage.ppm", 64, 32);
+    ImageTexture color;
+    ImageTexture data;
+    ImageTexture scalar;
+    ASSERT_TRUE(color.Load(path, TextureUsage::Color));
+    ASSERT_TRUE(data.Load(path, TextureUsage::Data));
+    ASSERT_TRUE(scalar.Load(path, TextureUsage::Scalar));
+    EXPECT_EQ(color.format, TexelFormat::SRGB8);
+    EXPECT_EQ(data.format, TexelFormat::RGB8);
+    EXPECT_EQ(scalar.format, TexelFormat::R8);
+    EXPECT_LT(scalar.ResidentBytes(), data.ResidentBytes());
+
+    // Data keeps stored values; Color decodes the sRGB curve; Scalar keeps red only
+    RGB d = data.Texel(0, 63, 0);
+    EXPECT_NEAR(d.r(), 1.0f, 1e-6f);
+    EXPECT_NEAR(d.b(), 128.0f / 255.0f, 1e-6f);
+    EXPECT_NEAR(color.Texel(0, 63, 0).b(), SRGBToLinear(128.0f / 255.0f), 1e-6f);
+    RGB s = scalar.Texel(0, 63, 0);
+    EXPECT_FLOAT_EQ(s.r(), 1.0f);
+    EXPECT_FLOAT_EQ(s.b(), 1.0f);
+    std::filesystem::remove(path);
+}
+
+TEST(TextureCurveTest, PrecomputedCurvesMatchPerHitConversion) {
+    InitSpectralModel();
+    MipLevel image;
+    image.width = 16;
+    image.height = 8;
+    for (int y = 0; y < image.height; ++y) {
+        for (int x = 0; x < image.width; ++x) {
+            // Red stays the largest channel so every texel uses the same rgb2spec sub-table
+            image.data.push_back(0.5f + 0.4f * static_cast<float>(x) / 15.0f);
+            image.data.push_back(0.1f + 0.2f * static_cast<float>(y) / 7.0f);
+            image.data.push_back(0.2f);
+        }
+    }
+    ImageTexture tex;
+    tex.SetImage(std::move(image));
+    const size_t rgb_bytes = tex.ResidentBytes();
+    tex.PrecomputeCurves();
+    ASSERT_TRUE(tex.HasCurves());
+    EXPECT_GT(tex.ResidentBytes(), rgb_bytes);
+
+    // Texel centers reproduce the per-hit conversion exactly
+    SpectralCurve a = tex.SampleCurve(3.0f / 15.0f, 5.0f / 7.0f, 0.0f, 0.0f);
+    SpectralCurve b = RGBToCurve(tex.Sample(3.0f / 15.0f, 5.0f / 7.0f));
+    for (int k = 0; k < 3; ++k) EXPECT_NEAR(a.coeff[k], b.coeff[k], 1e-4f * std::abs(b.coeff[k]));
+    EXPECT_FLOAT_EQ(a.scale, b.scale);
+
+    // Between texels, interpolated coefficients stay close to converting the interpolated RGB
+    SampledWavelengths wl = WavelengthSampler::Sample(0.37f);
+    for (float u : {0.11f, 0.52f, 0.93f}) {
+        Spectrum sa = CurveToSpectrum(tex.SampleCurve(u, 0.4f, 0.0f, 0.0f), wl);
+        Spectrum sb = CurveToSpectrum(RGBToCurve(tex.Sample(u, 0.4f)), wl);
+        for (int i = 0; i < kNSamples; ++i) EXPECT_NEAR(sa[i], sb[i], 0.05f);
+    }
+}
+
+TEST(TextureCacheTest, TilesOnTheLoaderThread) {
+    std::string path = WriteGradientPPM("skewer_cache_loader.ppm", 130, 70);
+    TextureCache cache(1 << 20);
+    ImageTexture tex;
+    ASSERT_TRUE(tex.LoadCached(path, &cache));
+    EXPECT_TRUE(tex.IsValid());
+    EXPECT_EQ(tex.width, 130);
+    EXPECT_EQ(tex.height, 70);
+
+    // Tiling finishes without any lookup, and the first lookup only reads a tile
+    cache.WaitUntilTiled();
+    EXPECT_EQ(cache.Stats().textures_decoded, 1u);
+    EXPECT_EQ(cache.Stats().misses, 0u);
+    tex.Sample(0.5f, 0.5f);
+    EXPECT_EQ(cache.Stats().textures_decoded, 1u);
+    EXPECT_EQ(cache.Stats().misses, 1u);
+    std::filesystem::remove(path);
+}
+
+TEST(TextureCacheTest, MatchesResidentTexture) {
+    std::string path = WriteGradientPPM("skewer_cache_match.ppm", 130, 70);
+    ImageTexture resident;
+    ASSERT_TRUE(resident.Load(path));
+    TextureCache cache(1 << 20);
+    ImageTexture cached;
+    ASSERT_TRUE(cached.LoadCached(path, &cache));
+
+    // Includes lookups straddling tile edges and filtered footprints
+    const float uvs[][4] = {{0.1f, 0.2f, 0.0f, 0.0f},
+                            {0.495f, 0.93f, 0.0f, 0.0f},
+                            {0.9f, 0.4f, 0.02f, 0.03f},
+                            {0.3f, 0.7f, 0.2f, 0.2f},
+                            {1.7f, -0.3f, 0.0f, 0.0f}};
+    for (const auto& q : uvs) {
+        RGB a = resident.Sample(q[0], q[1], q[2], q[3]);
+        RGB b = cached.Sample(q[0], q[1], q[2], q[3]);
+        // 8-bit sRGB tile storage quantizes the filtered MIP levels
+        EXPECT_NEAR(a.r(), b.r(), 0.01f);
+        EXPECT_NEAR(a.g(), b.g(), 0.01f);
+        EXPECT_NEAR(a.b(), b.b(), 0.01f);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(TextureCacheTest, EvictsBeyondBudget) {
+    std::string path = WriteGradientPPM("skewer_cache_evict.ppm", 512, 512);
+    // Zero budget: every shard keeps at most the tile it just loaded
+    TextureCache cache(0);
+    ImageTexture tex;
+    ASSERT_TRUE(tex.LoadCached(path, &cache));
+    for (int i = 0; i < 256; ++i) {
+        float u = static_cast<float>(i % 16) / 16.0f + 0.01f;
+        float v = static_cast<float>(i / 16) / 16.0f + 0.01f;
+        tex.Sample(u, v);
+    }
+    // Repeat the first lookup twice in a row: the second one must hit
+    tex.Sample(0.01f, 0.01f);
+    tex.Sample(0.01f, 0.01f);
+
+    TextureCacheStats s = cache.Stats();
+    EXPECT_GT(s.evictions, 0u);
+    EXPECT_GT(s.hits, 0u);
+    EXPECT_LE(s.bytes_resident, s.peak_bytes_resident);
+    EXPECT_LT(s.peak_bytes_resident, static_cast<size_t>(512) * 512 * 3);
+    std::filesystem::remove(path);
+}
+
+TEST(TextureCacheTest, MissingFileFailsToRegister) {
+    TextureCache cache(1 << 20);
+    ImageTexture tex;
+    EXPECT_FALSE(tex.LoadCached("/nonexistent/skewer_missing.png", &cache));
+    EXPECT_FALSE(tex.IsValid());
+}
+
+}  // namespace skwr